@@ -0,0 +1,134 @@
+/* Benchmark da amostragem adaptativa contra a grade uniforme.
+ *
+ * Para cada curva, compara a grade uniforme de PLOT_DEFAULT_SAMPLES pontos
+ * com a amostragem adaptativa: avaliações gastas, tempo e erro visual. O erro
+ * é medido contra uma grade densa de referência: para cada ponto de
+ * referência na tela, a distância em pixels (área PLOT_ADAPTIVE_VIEW_W x
+ * PLOT_ADAPTIVE_VIEW_H) até o segmento da polilinha que cobre o mesmo t.
+ *
+ * Uso: bench_adaptive [tolerância] [amostras da referência] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+/* Faixa 2%..98% dos valores (a "tela" da referência, sem os polos). */
+static void faixa(const double *v, int n, double *lo, double *hi) {
+    double *tmp = malloc(n * sizeof(double));
+    int m = 0;
+    for (int i = 0; tmp && i < n; i++) {
+        if (isfinite(v[i])) tmp[m++] = v[i];
+    }
+    if (m == 0) {
+        *lo = -1.0;
+        *hi = 1.0;
+    } else {
+        qsort(tmp, m, sizeof(double), comparar_double);
+        *lo = tmp[m * 2 / 100];
+        *hi = tmp[m - 1 - m * 2 / 100];
+    }
+    free(tmp);
+    if (!(*hi - *lo > 0.0)) *hi = *lo + 1.0;
+}
+
+/* Distância do ponto P ao segmento AB. */
+static double dist_segmento(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx * dx + dy * dy;
+    double u = (len2 > 0.0) ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0.0;
+    if (u < 0.0) u = 0.0;
+    if (u > 1.0) u = 1.0;
+    return hypot(px - (ax + u * dx), py - (ay + u * dy));
+}
+
+/* Erro máximo e médio (pixels) de `data` contra a referência `ref`. */
+static void medir_erro(const PlotData *ref, const PlotData *data, double *max, double *media) {
+    double lo[2], hi[2];
+    faixa(ref->x, ref->count, &lo[0], &hi[0]);
+    faixa(ref->y, ref->count, &lo[1], &hi[1]);
+    const double sx = PLOT_ADAPTIVE_VIEW_W / (hi[0] - lo[0]);
+    const double sy = PLOT_ADAPTIVE_VIEW_H / (hi[1] - lo[1]);
+
+    double soma = 0.0;
+    int n = 0, k = 0;
+    *max = 0.0;
+    for (int i = 0; i < ref->count; i++) {
+        const double t = ref->t[i], x = ref->x[i], y = ref->y[i];
+        if (x < lo[0] || x > hi[0] || y < lo[1] || y > hi[1]) continue;
+        while (k + 1 < data->count && data->t[k + 1] < t) k++;
+        if (k + 1 >= data->count || data->t[k] > t) continue;
+
+        double d = dist_segmento(x * sx, y * sy, data->x[k] * sx, data->y[k] * sy,
+                                 data->x[k + 1] * sx, data->y[k + 1] * sy);
+        if (!isfinite(d)) continue;
+        if (d > *max) *max = d;
+        soma += d;
+        n++;
+    }
+    *media = n ? soma / n : 0.0;
+}
+
+int main(int argc, char **argv) {
+    double tolerancia = (argc > 1) ? atof(argv[1]) : PLOT_ADAPTIVE_TOLERANCE;
+    int densa = (argc > 2) ? atoi(argv[2]) : 100000;
+    if (tolerancia <= 0.0) tolerancia = PLOT_ADAPTIVE_TOLERANCE;
+    if (densa < 2) densa = 2;
+
+    long aval[2] = { 0, 0 };
+    double tempo[2] = { 0.0, 0.0 }, soma_max[2] = { 0.0, 0.0 };
+    int curvas = 0, melhores = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-40s %18s %18s %18s\n", "", "avaliações", "erro máx (px)", "erro médio (px)");
+    printf("%-40s %9s %8s %9s %8s %9s %8s\n", "curva",
+           "uniforme", "adapt.", "uniforme", "adapt.", "uniforme", "adapt.");
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+
+        plot->samples = densa;
+        PlotData *ref = plot_generate_samples(plot, NULL);
+
+        PlotData *data[2];
+        plot->samples = PLOT_DEFAULT_SAMPLES;
+        plot->tolerance = tolerancia;
+        for (int m = 0; m < 2; m++) {
+            plot->adaptive = m;
+            double inicio = agora();
+            data[m] = plot_generate_samples(plot, NULL);
+            tempo[m] += agora() - inicio;
+        }
+
+        if (ref && data[0] && data[1] && ref->count > 0) {
+            double emax[2], emed[2];
+            for (int m = 0; m < 2; m++) {
+                medir_erro(ref, data[m], &emax[m], &emed[m]);
+                aval[m] += data[m]->evaluations;
+                soma_max[m] += emax[m];
+            }
+            melhores += (emax[1] <= emax[0]);
+            curvas++;
+            printf("%-40.40s %9d %8d %9.3f %8.3f %9.3f %8.3f\n", linha,
+                   data[0]->evaluations, data[1]->evaluations, emax[0], emax[1], emed[0], emed[1]);
+        }
+
+        plot_data_free(ref);
+        plot_data_free(data[0]);
+        plot_data_free(data[1]);
+        plot_free(plot);
+    }
+
+    printf("%-40s %9ld %8ld %9.3f %8.3f\n", "TOTAL (erro: média dos máximos)", aval[0], aval[1],
+           curvas ? soma_max[0] / curvas : 0.0, curvas ? soma_max[1] / curvas : 0.0);
+    printf("tempo: uniforme %.3f ms, adaptativa %.3f ms\n", tempo[0] * 1e3, tempo[1] * 1e3);
+    printf("%d curvas, adaptativa com erro máximo <= uniforme em %d (tolerância %.2f px)\n",
+           curvas, melhores, tolerancia);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/* Benchmark dos motores do avaliador em lote (scalar, block, threaded, jit).
+ *
+ * Tempo de plot_generate_samples() de cada curva em cada motor, com o cache
+ * de programas limpo antes de cada um (o programa do motor JIT tem código de
+ * máquina, os outros não).
+ *
+ * x, y, t e a máscara valid de cada motor têm de ser idênticos bit a bit aos
+ * do scalar (a referência). O block usa os kernels de vecmath, que podem
+ * mudar o último bit: ele é conferido numa geração a mais, fora do tempo,
+ * com vecmath no nível scalar (libm).
+ *
+ * Uso: bench_engines [amostras] [repetições] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/batch_eval.h"
+#include "../include/vecmath.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const BatchEngine ENGINES[] = {
+    BATCH_ENGINE_SCALAR, BATCH_ENGINE_BLOCK, BATCH_ENGINE_THREADED, BATCH_ENGINE_JIT
+};
+#define ENGINE_COUNT 4
+
+static int mesmos_dados(const PlotData *a, const PlotData *b) {
+    if (a->count != b->count || a->evaluations != b->evaluations) return 0;
+    return memcmp(a->x, b->x, a->count * sizeof(double)) == 0 &&
+           memcmp(a->y, b->y, a->count * sizeof(double)) == 0 &&
+           memcmp(a->t, b->t, a->count * sizeof(double)) == 0 &&
+           memcmp(a->valid, b->valid, ((size_t)a->evaluations + 7) / 8) == 0;
+}
+
+/* Tempo médio (s) de plot_generate_samples; *dados recebe a última geração
+ * (NULL se falhou). */
+static double medir(const Plot *plot, int reps, PlotData **dados) {
+    *dados = NULL;
+    double inicio = agora();
+    for (int r = 0; r < reps; r++) {
+        plot_data_free(*dados);
+        *dados = plot_generate_samples(plot, NULL);
+        if (!*dados) return -1.0;
+    }
+    return (agora() - inicio) / reps;
+}
+
+/* Geração de `plot` no motor block com vecmath em libm, comparada com
+ * `referencia` */
+static int block_igual(const Plot *plot, const PlotData *referencia) {
+    const VecMathLevel nivel = vecmath_level();
+    vecmath_set_level(VECMATH_SCALAR);
+    batch_set_engine(BATCH_ENGINE_BLOCK);
+    plot_cache_clear();
+    PlotData *data = plot_generate_samples(plot, NULL);
+    vecmath_set_level(nivel);
+    const int igual = data && referencia && mesmos_dados(data, referencia);
+    plot_data_free(data);
+    return igual;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 20000;
+    int reps = (argc > 2) ? atoi(argv[2]) : 5;
+    if (amostras < 2) amostras = 2;
+    if (reps < 1) reps = 1;
+
+    double total[ENGINE_COUNT] = { 0 };
+    int curvas = 0, divergentes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s", "curva");
+    for (int e = 0; e < ENGINE_COUNT; e++) printf(" %10s", batch_engine_name(ENGINES[e]));
+    printf("   (ms, %d amostras)\n", amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+
+        double t[ENGINE_COUNT];
+        PlotData *dados[ENGINE_COUNT];
+        for (int e = 0; e < ENGINE_COUNT; e++) {
+            batch_set_engine(ENGINES[e]);
+            plot_cache_clear();
+            t[e] = medir(plot, reps, &dados[e]);
+        }
+
+        int diverge = !dados[0];
+        for (int e = 1; e < ENGINE_COUNT && !diverge; e++) {
+            if (ENGINES[e] == BATCH_ENGINE_BLOCK) {
+                diverge = !block_igual(plot, dados[0]);
+            } else {
+                diverge = !dados[e] || !mesmos_dados(dados[e], dados[0]);
+            }
+        }
+        for (int e = 0; e < ENGINE_COUNT; e++) plot_data_free(dados[e]);
+        plot_free(plot);
+        divergentes += diverge;
+        curvas++;
+
+        printf("%-44.44s", linha);
+        for (int e = 0; e < ENGINE_COUNT; e++) {
+            total[e] += t[e];
+            printf(" %10.3f", t[e] * 1e3);
+        }
+        printf("%s\n", diverge ? "   DIVERGE" : "");
+    }
+
+    printf("%-44s", "TOTAL");
+    for (int e = 0; e < ENGINE_COUNT; e++) printf(" %10.3f", total[e] * 1e3);
+    printf("\n%-44s", "speedup vs scalar");
+    for (int e = 0; e < ENGINE_COUNT; e++) printf(" %9.2fx", total[e] > 0 ? total[0] / total[e] : 0.0);
+    printf("\n%d curvas, %d com amostras diferentes do scalar\n", curvas, divergentes);
+
+    batch_set_engine(BATCH_ENGINE_BLOCK);
+    return divergentes ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/* Benchmark do cache de programas compilados.
+ *
+ * Simula um servidor que recebe as mesmas curvas várias vezes: em cada
+ * rodada, todas as curvas são geradas de novo com outro número de amostras e
+ * outro intervalo (e com espaços diferentes na expressão nas rodadas ímpares,
+ * que o cache tem de reconhecer). A mesma
+ * carga roda com o cache desligado (plot_cache_set_limits(0, 0)) e ligado,
+ * em cada motor, e a saída tem de ser idêntica bit a bit.
+ *
+ * Uso: bench_exprcache [rodadas=20] [amostras=200] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/batch_eval.h"
+#include "../include/batch_jit.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_CURVES 256
+
+/* Mesma expressão com espaços em volta dos parênteses e operadores */
+static char *espacar(const char *expr) {
+    char *s = malloc(3 * strlen(expr) + 1);
+    if (!s) return NULL;
+    char *p = s;
+    for (; *expr; expr++) {
+        if (strchr("()+-/,", *expr)) {
+            *p++ = ' ';
+            *p++ = *expr;
+            *p++ = ' ';
+        } else {
+            *p++ = *expr;
+        }
+    }
+    *p = '\0';
+    return s;
+}
+
+/* Uma rodada de pedidos: cada curva com o seu número de amostras e
+ * intervalo. Soma as coordenadas em `soma` para conferir entre cargas. */
+static int rodada(Plot **plots, int n, int r, int amostras, double *soma) {
+    for (int k = 0; k < n; k++) {
+        Plot *p = plots[k];
+        p->samples = amostras + 17 * ((r + k) % 7);
+        p->adaptive = 0;
+        PlotData *data = plot_generate_samples(p, NULL);
+        if (!data) return 0;
+        for (int i = 0; i < data->count; i++) soma[k] += data->x[i] * 0.5 + data->y[i];
+        plot_data_free(data);
+    }
+    return 1;
+}
+
+/* Roda a carga inteira. Retorna o tempo em segundos (negativo se falhou). */
+static double carga(Plot **plots, Plot **espacados, int n, int rodadas, int amostras, double *soma) {
+    memset(soma, 0, n * sizeof(double));
+    double t0 = agora();
+    for (int r = 0; r < rodadas; r++) {
+        if (!rodada((r & 1) ? espacados : plots, n, r, amostras, soma)) return -1.0;
+    }
+    return agora() - t0;
+}
+
+int main(int argc, char **argv) {
+    int rodadas = (argc > 1) ? atoi(argv[1]) : 20;
+    int amostras = (argc > 2) ? atoi(argv[2]) : 200;
+    if (rodadas < 1) rodadas = 1;
+    if (amostras < 2) amostras = 2;
+
+    Plot *plots[BENCH_MAX_CURVES], *espacados[BENCH_MAX_CURVES];
+    int n = 0;
+    char linha[BENCH_MAX_LINE];
+    while (n < BENCH_MAX_CURVES && ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *p = plot_parse_text(linha, NULL);
+        if (!p) continue;
+        // Curvas que nem compilam não entram (erros não ficam no cache)
+        PlotData *d = plot_generate_samples(p, NULL);
+        if (!d) {
+            plot_free(p);
+            continue;
+        }
+        plot_data_free(d);
+
+        Plot *e = plot_parse_text(linha, NULL);
+        char *s1 = espacar(e->expr1), *s2 = e->expr2 ? espacar(e->expr2) : NULL;
+        free(e->expr1);
+        free(e->expr2);
+        e->expr1 = s1;
+        e->expr2 = s2;
+        plots[n] = p;
+        espacados[n++] = e;
+    }
+
+    double *sem = calloc(n, sizeof(double)), *com = calloc(n, sizeof(double));
+    const BatchEngine motores[] = { BATCH_ENGINE_BLOCK, BATCH_ENGINE_THREADED, BATCH_ENGINE_JIT };
+    int divergentes = 0;
+
+    printf("%d curvas x %d rodadas, ~%d amostras por curva\n", n, rodadas, amostras);
+    printf("%-10s %12s %12s %10s %9s %9s %10s\n", "motor", "sem cache", "com cache", "ganho",
+           "acertos", "faltas", "KB");
+    for (size_t m = 0; m < sizeof(motores) / sizeof(motores[0]); m++) {
+        if (motores[m] == BATCH_ENGINE_JIT && !batch_jit_available()) continue;
+        batch_set_engine(motores[m]);
+
+        plot_cache_set_limits(0, 0);
+        double t_sem = carga(plots, espacados, n, rodadas, amostras, sem);
+
+        plot_cache_set_limits(PLOT_CACHE_MAX_BYTES, PLOT_CACHE_MAX_ENTRIES);
+        plot_cache_clear();
+        ExprCacheStats antes, depois;
+        plot_cache_stats(&antes);
+        double t_com = carga(plots, espacados, n, rodadas, amostras, com);
+        plot_cache_stats(&depois);
+
+        int diverge = t_sem < 0 || t_com < 0 || memcmp(sem, com, n * sizeof(double)) != 0;
+        divergentes += diverge;
+        printf("%-10s %9.2f ms %9.2f ms %9.2fx %9lu %9lu %10.1f%s\n", batch_engine_name(motores[m]),
+               t_sem * 1e3, t_com * 1e3, t_sem / t_com, depois.hits - antes.hits,
+               depois.misses - antes.misses, depois.bytes / 1024.0,
+               diverge ? "   (saída diferente!)" : "");
+    }
+
+    for (int k = 0; k < n; k++) {
+        plot_free(plots[k]);
+        plot_free(espacados[k]);
+    }
+    free(sem);
+    free(com);
+    return divergentes ? 1 : 0;
+}
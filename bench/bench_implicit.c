@@ -0,0 +1,125 @@
+/* Benchmark das curvas implícitas F(x,y) = 0 (implicit.h).
+ *
+ * Para cada curva clássica da tabela, a forma implícita contra a forma polar
+ * equivalente (a das 77 curvas): tempo, avaliações, pontos, trechos e bytes
+ * do SVG. Depois, o folium de Descartes em grades cada vez mais finas: as
+ * avaliações da quadtree crescem com o comprimento da curva (~N), as de uma
+ * grade cheia de N x N células, com a área (N²).
+ *
+ * As avaliações vêm do Stats (stats.h), então o binário precisa ser compilado
+ * sem MULTICURVAS_NO_STATS.
+ *
+ * Uso: bench_implicit [células por lado=512]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/render.h"
+#include "../include/stats.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char *nome;
+    const char *implicita;
+    const char *polar;
+} Par;
+
+static const Par CURVAS[] = {
+    { "folium", "x^3+y^3=6*x*y:-5,5:", "R=(6*sin(t)*cos(t))/(sin(t)^3+cos(t)^3)" },
+    { "estrofoide", "x*(x*x+y*y)+3*(x*x-y*y)=0:-5,5:", "R=-3*cos(2*t)/(cos(t)):.1,1.4:" },
+    { "cissoide", "y^2*(2-x)=x^3:-5,5:", "R=2*tan(t)*sin(t):0,1:" },
+    { "cruciforme", "x*x*y*y=x*x+y*y:-5,5:", "R=2/sin(2*t):.1,1.5:" },
+    { "trissectriz", "x*(x*x+y*y)=3*x*x-y*y:-5,5:", "R=4*sin(3*t)/sin(2*t):.1,1.5:" },
+};
+
+#define NUM_CURVAS ((int)(sizeof(CURVAS) / sizeof(CURVAS[0])))
+
+static int conta_bytes(void *ctx, const char *data, size_t n) {
+    (void)ctx;
+    (void)data;
+    (void)n;
+    return 1;
+}
+
+typedef struct {
+    double segundos;
+    int avaliacoes;
+    int pontos;
+    int trechos;
+    size_t bytes;
+} Medida;
+
+/* Trechos desenhados: pontos seguidos sem amostra inválida entre eles */
+static int contar_trechos(const PlotData *data) {
+    int trechos = 0, amostra = 0;
+    for (int p = 0; p < data->count; p++) {
+        int quebrou = (p == 0);
+        while (!PLOT_DATA_VALID(data, amostra)) {
+            quebrou |= data->segmented;
+            amostra++;
+        }
+        amostra++;
+        trechos += quebrou;
+    }
+    return trechos;
+}
+
+static int medir(const char *linha, int amostras, Medida *m) {
+    Plot *plot = plot_parse_text(linha, NULL);
+    if (!plot) return 0;
+    if (amostras > 0) plot->samples = amostras;
+
+    // Avaliações pelo Stats: na implícita, PlotData.evaluations só conta
+    // as posições da sequência de pontos, não os pontos da grade avaliados
+    Stats st = { 0 };
+    const double inicio = agora();
+    stats_attach(&st);
+    PlotData *data = plot_generate_samples(plot, NULL);
+    stats_detach();
+    OutBuf out;
+    int ok = data && data->count > 0 && outbuf_init_sink(&out, conta_bytes, NULL, 0);
+    if (ok) {
+        render_svg_out(&out, data, linha, 800, 600, RENDER_SIMPLIFY_TOLERANCE, NULL);
+        outbuf_close(&out);
+        m->segundos = agora() - inicio;
+        m->avaliacoes = (int)st.evaluations;
+        m->pontos = data->count;
+        m->trechos = contar_trechos(data);
+        m->bytes = out.written;
+    }
+    plot_data_free(data);
+    plot_free(plot);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    int celulas = (argc > 1) ? atoi(argv[1]) : 512;
+    if (celulas < 1) celulas = 1;
+
+    printf("%-12s %-9s %9s %8s %7s %7s %8s\n", "curva", "forma", "tempo ms", "aval.", "pontos", "trechos",
+           "SVG");
+    for (int c = 0; c < NUM_CURVAS; c++) {
+        Medida imp = { 0 }, pol = { 0 };
+        if (!medir(CURVAS[c].implicita, celulas, &imp) || !medir(CURVAS[c].polar, 0, &pol)) {
+            printf("%-12s falhou\n", CURVAS[c].nome);
+            continue;
+        }
+        printf("%-12s %-9s %9.3f %8d %7d %7d %8zu\n", CURVAS[c].nome, "implícita", imp.segundos * 1e3,
+               imp.avaliacoes, imp.pontos, imp.trechos, imp.bytes);
+        printf("%-12s %-9s %9.3f %8d %7d %7d %8zu\n", "", "polar", pol.segundos * 1e3, pol.avaliacoes,
+               pol.pontos, pol.trechos, pol.bytes);
+    }
+
+    printf("\n%s: quadtree x grade cheia\n", CURVAS[0].implicita);
+    printf("%8s %9s %10s %12s %8s\n", "N", "tempo ms", "aval.", "grade N²", "razão");
+    for (int n = 256; n <= 8192; n *= 2) {
+        Medida m = { 0 };
+        if (!medir(CURVAS[0].implicita, n, &m)) continue;
+        const double cheia = (double)(n + 1) * (n + 1);
+        printf("%8d %9.3f %10d %12.0f %7.1fx\n", n, m.segundos * 1e3, m.avaliacoes, cheia,
+               cheia / m.avaliacoes);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/* Benchmark da amostragem com aritmética intervalar (Plot.interval).
+ *
+ * Para cada curva, compara a grade uniforme de PLOT_DEFAULT_SAMPLES pontos,
+ * a adaptativa e a intervalar:
+ * avaliações, tempo, trechos desenhados e "pontes" — traços da polilinha
+ * que passam por cima de um polo ou de uma lacuna de domínio. A referência é
+ * uma grade densa: um traço entre os pontos de t_k e t_k+1 é ponte se alguma
+ * amostra densa em (t_k, t_k+1) deu erro ou foge da caixa dos dois extremos
+ * por mais de PONTE_FAIXAS faixas 2%..98% da referência (a curva vai ao
+ * infinito e volta). O erro visual máximo é medido como no bench_adaptive,
+ * só nos traços que não são ponte.
+ *
+ * Uso: bench_interval [amostras da referência] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PONTE_FAIXAS   3.0
+#define MODOS          3
+
+static const char *const NOMES[MODOS] = { "uniforme", "adapt.", "interv." };
+
+/* Faixa 2%..98% dos valores (a "tela" da referência, sem os polos). */
+static void faixa(const double *v, int n, double *lo, double *hi) {
+    double *tmp = malloc(n * sizeof(double));
+    int m = 0;
+    for (int i = 0; tmp && i < n; i++) {
+        if (isfinite(v[i])) tmp[m++] = v[i];
+    }
+    if (m == 0) {
+        *lo = -1.0;
+        *hi = 1.0;
+    } else {
+        qsort(tmp, m, sizeof(double), comparar_double);
+        *lo = tmp[m * 2 / 100];
+        *hi = tmp[m - 1 - m * 2 / 100];
+    }
+    free(tmp);
+    if (!(*hi - *lo > 0.0)) *hi = *lo + 1.0;
+}
+
+/* Distância do ponto P ao segmento AB. */
+static double dist_segmento(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx * dx + dy * dy;
+    double u = (len2 > 0.0) ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0.0;
+    if (u < 0.0) u = 0.0;
+    if (u > 1.0) u = 1.0;
+    return hypot(px - (ax + u * dx), py - (ay + u * dy));
+}
+
+/* Referência densa: t de cada amostra, erro[i] = 1 se a amostra i não
+ * virou ponto, e a tela (faixas 2%..98%) com a escala em pixels. */
+typedef struct {
+    double *t;
+    unsigned char *erro;
+    int n;
+    double lo[2], hi[2];
+    double sx, sy;
+    double fx, fy;      /* Folga de uma ponte: PONTE_FAIXAS faixas */
+} Referencia;
+
+static int montar_referencia(const Plot *plot, const PlotData *ref, Referencia *r) {
+    double C, D;
+    plot_interval(plot, &C, &D);
+    r->n = ref->evaluations;
+    r->t = malloc(r->n * sizeof(double));
+    r->erro = malloc(r->n);
+    if (!r->t || !r->erro) return 0;
+
+    faixa(ref->x, ref->count, &r->lo[0], &r->hi[0]);
+    faixa(ref->y, ref->count, &r->lo[1], &r->hi[1]);
+    r->sx = PLOT_ADAPTIVE_VIEW_W / (r->hi[0] - r->lo[0]);
+    r->sy = PLOT_ADAPTIVE_VIEW_H / (r->hi[1] - r->lo[1]);
+    r->fx = PONTE_FAIXAS * (r->hi[0] - r->lo[0]);
+    r->fy = PONTE_FAIXAS * (r->hi[1] - r->lo[1]);
+
+    const double passo = (D - C) / (r->n - 1);
+    for (int i = 0; i < r->n; i++) {
+        r->t[i] = C + i * passo;
+        r->erro[i] = !PLOT_DATA_VALID(ref, i);
+    }
+    return 1;
+}
+
+/* Trechos desenhados, pontes e erro máximo (pixels, fora das pontes) de
+ * `data` contra a referência. */
+static void medir(const Referencia *r, const PlotData *ref, const PlotData *data, int *trechos, int *pontes,
+                  double *erro) {
+    *trechos = 0;
+    *pontes = 0;
+    *erro = 0.0;
+    int amostra = 0, i = 0, k = 0;
+    for (int p = 0; p < data->count; p++) {
+        // O traço de p-1 a p existe se nenhuma amostra sem ponto os separa
+        int quebrou = (p == 0);
+        while (!PLOT_DATA_VALID(data, amostra)) {
+            quebrou |= data->segmented;
+            amostra++;
+        }
+        amostra++;
+        if (quebrou) {
+            (*trechos)++;
+            continue;
+        }
+
+        const double t0 = data->t[p - 1], t1 = data->t[p];
+        const double x0 = fmin(data->x[p - 1], data->x[p]) - r->fx, x1 = fmax(data->x[p - 1], data->x[p]) + r->fx;
+        const double y0 = fmin(data->y[p - 1], data->y[p]) - r->fy, y1 = fmax(data->y[p - 1], data->y[p]) + r->fy;
+        while (i < r->n && r->t[i] <= t0) {
+            k += PLOT_DATA_VALID(ref, i);
+            i++;
+        }
+        int ponte = 0;
+        double pior = 0.0;
+        for (int j = i, q = k; j < r->n && r->t[j] < t1; j++) {
+            if (r->erro[j]) {
+                ponte = 1;
+                break;
+            }
+            const double x = ref->x[q], y = ref->y[q];
+            q++;
+            if (!(x >= x0 && x <= x1 && y >= y0 && y <= y1)) {
+                ponte = 1;
+                break;
+            }
+            if (x < r->lo[0] || x > r->hi[0] || y < r->lo[1] || y > r->hi[1]) continue;
+            const double d = dist_segmento(x * r->sx, y * r->sy, data->x[p - 1] * r->sx, data->y[p - 1] * r->sy,
+                                           data->x[p] * r->sx, data->y[p] * r->sy);
+            if (isfinite(d) && d > pior) pior = d;
+        }
+        if (ponte) {
+            (*pontes)++;
+        } else if (pior > *erro) {
+            *erro = pior;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int densa = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (densa < 2) densa = 2;
+
+    long aval[MODOS] = { 0 }, pontes_total[MODOS] = { 0 }, trechos_total[MODOS] = { 0 };
+    double tempo[MODOS] = { 0.0 }, soma_erro[MODOS] = { 0.0 };
+    int curvas = 0, com_pontes = 0, resolvidas = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-36s %24s %17s %24s\n", "", "avaliações", "pontes", "erro máx (px)");
+    printf("%-36s %8s %7s %7s %5s %5s %5s %8s %7s %7s\n", "curva", NOMES[0], NOMES[1], NOMES[2],
+           "uni.", "adp.", "int.", NOMES[0], NOMES[1], NOMES[2]);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+
+        plot->samples = densa;
+        PlotData *ref = plot_generate_samples(plot, NULL);
+
+        PlotData *data[MODOS];
+        plot->samples = PLOT_DEFAULT_SAMPLES;
+        for (int m = 0; m < MODOS; m++) {
+            plot->adaptive = (m == 1);
+            plot->interval = (m == 2);
+            double inicio = agora();
+            data[m] = plot_generate_samples(plot, NULL);
+            tempo[m] += agora() - inicio;
+        }
+
+        Referencia r;
+        memset(&r, 0, sizeof(r));
+        if (ref && data[0] && data[1] && data[2] && ref->count > 0 && montar_referencia(plot, ref, &r)) {
+            int trechos[MODOS], pontes[MODOS];
+            double erro[MODOS];
+            for (int m = 0; m < MODOS; m++) {
+                medir(&r, ref, data[m], &trechos[m], &pontes[m], &erro[m]);
+                aval[m] += data[m]->evaluations;
+                pontes_total[m] += pontes[m];
+                trechos_total[m] += trechos[m];
+                soma_erro[m] += erro[m];
+            }
+            if (pontes[1] > 0) {
+                com_pontes++;
+                resolvidas += (pontes[2] == 0);
+            }
+            curvas++;
+            printf("%-36.36s %8d %7d %7d %5d %5d %5d %8.3f %7.3f %7.3f\n", linha, data[0]->evaluations,
+                   data[1]->evaluations, data[2]->evaluations, pontes[0], pontes[1], pontes[2], erro[0], erro[1],
+                   erro[2]);
+        }
+        free(r.t);
+        free(r.erro);
+
+        plot_data_free(ref);
+        for (int m = 0; m < MODOS; m++) plot_data_free(data[m]);
+        plot_free(plot);
+    }
+
+    printf("%-36s %8ld %7ld %7ld %5ld %5ld %5ld %8.3f %7.3f %7.3f\n", "TOTAL (erro: média dos máximos)",
+           aval[0], aval[1], aval[2], pontes_total[0], pontes_total[1], pontes_total[2],
+           curvas ? soma_erro[0] / curvas : 0.0, curvas ? soma_erro[1] / curvas : 0.0,
+           curvas ? soma_erro[2] / curvas : 0.0);
+    printf("tempo: uniforme %.3f ms, adaptativa %.3f ms, intervalar %.3f ms\n", tempo[0] * 1e3, tempo[1] * 1e3,
+           tempo[2] * 1e3);
+    printf("trechos: uniforme %ld, adaptativa %ld, intervalar %ld\n", trechos_total[0], trechos_total[1],
+           trechos_total[2]);
+    printf("%d curvas; %d com pontes na adaptativa, %d delas sem nenhuma na intervalar\n", curvas, com_pontes,
+           resolvidas);
+    return 0;
+}
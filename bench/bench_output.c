@@ -0,0 +1,241 @@
+/* Benchmark da camada de saída (outbuf) contra o printf.
+ *
+ * Primeiro confere o formatador: outbuf_format_fixed tem de dar os mesmos
+ * bytes que snprintf("%.*f") para 0..OUTBUF_MAX_DECIMALS casas, em valores
+ * aleatórios de várias magnitudes e em empates exatos (k/2^n).
+ *
+ * Depois gera cada curva e escreve os pontos em /dev/null de dois jeitos:
+ * fprintf por ponto (o renderizador antigo) e OutBuf. Mede MB/s nos dois
+ * formatos que os renderizadores usam, "%.6f,%.6f\n" (CSV) e "%.2f,%.2f "
+ * (pontos da polyline do SVG), e confere que os bytes são os mesmos.
+ *
+ * Uso: bench_output [amostras=200000] [repetições=3] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/outbuf.h"
+#include "bench_util.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_VALORES_ALEATORIOS 2000000
+
+/* xorshift64*: determinístico entre execuções */
+static unsigned long long estado = 0x9E3779B97F4A7C15ull;
+static unsigned long long aleatorio(void) {
+    estado ^= estado >> 12;
+    estado ^= estado << 25;
+    estado ^= estado >> 27;
+    return estado * 0x2545F4914F6CDD1Dull;
+}
+
+static int confere(double v, int casas) {
+    char esperado[OUTBUF_FIXED_MAX + 1], obtido[OUTBUF_FIXED_MAX + 1];
+    int n = snprintf(esperado, sizeof(esperado), "%.*f", casas, v);
+    size_t m = outbuf_format_fixed(obtido, v, casas);
+    obtido[m] = '\0';
+    if ((size_t)n == m && memcmp(esperado, obtido, m) == 0) return 1;
+    fprintf(stderr, "  divergência: %.17g com %d casas: printf \"%s\", outbuf \"%s\"\n",
+            v, casas, esperado, obtido);
+    return 0;
+}
+
+/* Retorna o número de valores em que outbuf e printf discordam. */
+static long conferir_formatador(void) {
+    static const double especiais[] = {
+        0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.125, 0.375, -0.625, 1.005, 2.675,
+        0.045, 1e-7, 5e-7, 4.9999999e-7, 999999.9999995, 1e15, 4503599627370495.5,
+        4503599627370496.0, 1e22, 1e300, -1e300, 1.7976931348623157e308,
+        4.9e-324, INFINITY, -INFINITY, NAN
+    };
+    long erros = 0, total = 0;
+    const int n_especiais = (int)(sizeof(especiais) / sizeof(especiais[0]));
+
+    for (int casas = 0; casas <= OUTBUF_MAX_DECIMALS; casas++) {
+        for (int i = 0; i < n_especiais; i++, total++) erros += !confere(especiais[i], casas);
+
+        // Empates exatos: múltiplos de 2^-n caem no meio entre dois decimais
+        for (long k = -5000; k <= 5000; k++, total += 3) {
+            erros += !confere(k / 8.0, casas);
+            erros += !confere(k / 1024.0, casas);
+            erros += !confere(k * 0.5 + 1e5, casas);
+        }
+    }
+
+    for (long i = 0; i < BENCH_VALORES_ALEATORIOS && erros < 20; i++, total++) {
+        int casas = (int)(aleatorio() % (OUTBUF_MAX_DECIMALS + 1));
+        // Mantissa aleatória com expoente entre 2^-40 e 2^60
+        double m = (double)(aleatorio() >> 11) / 9007199254740992.0;
+        double v = ldexp(m, (int)(aleatorio() % 100) - 40);
+        if (aleatorio() & 1) v = -v;
+        erros += !confere(v, casas);
+    }
+
+    printf("formatador: %ld valores conferidos com snprintf, %ld divergências\n", total, erros);
+    return erros;
+}
+
+/* ---- Pontos em /dev/null: printf x outbuf ---- */
+
+static size_t escrever_printf(FILE *out, const PlotData *d, int casas, char sep, char fim) {
+    size_t bytes = 0;
+    for (int i = 0; i < d->count; i++) {
+        int n = fprintf(out, "%.*f%c%.*f%c", casas, d->x[i], sep, casas, d->y[i], fim);
+        if (n > 0) bytes += (size_t)n;
+    }
+    fflush(out);
+    return bytes;
+}
+
+static void escrever_outbuf(OutBuf *out, const PlotData *d, int casas, char sep, char fim) {
+    for (int i = 0; i < d->count; i++) {
+        outbuf_fixed(out, d->x[i], casas);
+        outbuf_char(out, sep);
+        outbuf_fixed(out, d->y[i], casas);
+        outbuf_char(out, fim);
+    }
+}
+
+/* Destino em memória, para comparar os bytes */
+typedef struct {
+    char *buf;
+    size_t size, capacity;
+} Memoria;
+
+static int sink_memoria(void *ctx, const char *data, size_t n) {
+    Memoria *m = ctx;
+    if (m->size + n > m->capacity) {
+        size_t cap = m->capacity ? m->capacity : 1 << 20;
+        while (cap < m->size + n) cap *= 2;
+        char *novo = realloc(m->buf, cap);
+        if (!novo) return 0;
+        m->buf = novo;
+        m->capacity = cap;
+    }
+    memcpy(m->buf + m->size, data, n);
+    m->size += n;
+    return 1;
+}
+
+static int mesmos_bytes(const PlotData *d, int casas, char sep, char fim) {
+    char *antes = NULL;
+    size_t n_antes = 0;
+    FILE *mem = open_memstream(&antes, &n_antes);
+    if (!mem) return 0;
+    escrever_printf(mem, d, casas, sep, fim);
+    fclose(mem);
+
+    Memoria depois = { NULL, 0, 0 };
+    OutBuf ob;
+    int ok = outbuf_init_sink(&ob, sink_memoria, &depois, 0);
+    if (ok) {
+        escrever_outbuf(&ob, d, casas, sep, fim);
+        ok = outbuf_close(&ob);
+    }
+    ok = ok && n_antes == depois.size && memcmp(antes, depois.buf, n_antes) == 0;
+    free(antes);
+    free(depois.buf);
+    return ok;
+}
+
+typedef struct {
+    const char *nome;
+    int casas;
+    char sep, fim;
+    double bytes, s_printf, s_outbuf;
+} Formato;
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 200000;
+    int repeticoes = (argc > 2) ? atoi(argv[2]) : 3;
+    if (amostras < 2) amostras = 2;
+    if (repeticoes < 1) repeticoes = 1;
+
+    long erros_formatador = conferir_formatador();
+
+    FILE *nulo = fopen("/dev/null", "w");
+    int fd_nulo = open("/dev/null", O_WRONLY);
+    if (!nulo || fd_nulo < 0) {
+        fprintf(stderr, "não foi possível abrir /dev/null\n");
+        return 1;
+    }
+    // Mesmo tamanho de buffer dos dois lados
+    setvbuf(nulo, NULL, _IOFBF, OUTBUF_CAPACITY);
+
+    Formato formatos[2] = {
+        { "CSV %.6f", 6, ',', '\n', 0, 0, 0 },
+        { "SVG %.2f", 2, ',', ' ', 0, 0, 0 },
+    };
+    int curvas = 0, divergentes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s %12s %12s %12s %12s   (MB/s, %d amostras)\n", "curva",
+           "csv printf", "csv outbuf", "svg printf", "svg outbuf", amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+        PlotData *data = plot_generate_samples(plot, NULL);
+        plot_free(plot);
+        if (!data) continue;
+
+        int diverge = 0;
+        printf("%-44.44s", linha);
+        for (int f = 0; f < 2; f++) {
+            Formato *fmt = &formatos[f];
+            size_t bytes = 0;
+
+            double inicio = agora();
+            for (int r = 0; r < repeticoes; r++) {
+                bytes = escrever_printf(nulo, data, fmt->casas, fmt->sep, fmt->fim);
+            }
+            double s_printf = agora() - inicio;
+
+            OutBuf ob;
+            if (!outbuf_init_fd(&ob, fd_nulo, 0)) return 1;
+            inicio = agora();
+            for (int r = 0; r < repeticoes; r++) {
+                escrever_outbuf(&ob, data, fmt->casas, fmt->sep, fmt->fim);
+                outbuf_flush(&ob);
+            }
+            double s_outbuf = agora() - inicio;
+            outbuf_close(&ob);
+
+            fmt->bytes += (double)bytes * repeticoes;
+            fmt->s_printf += s_printf;
+            fmt->s_outbuf += s_outbuf;
+            diverge |= !mesmos_bytes(data, fmt->casas, fmt->sep, fmt->fim);
+
+            double mb = (double)bytes * repeticoes / 1e6;
+            printf(" %12.1f %12.1f", s_printf > 0 ? mb / s_printf : 0.0,
+                   s_outbuf > 0 ? mb / s_outbuf : 0.0);
+        }
+        printf("%s\n", diverge ? "   (saída diverge!)" : "");
+        divergentes += diverge;
+        curvas++;
+        plot_data_free(data);
+    }
+
+    printf("%-44s", "TOTAL");
+    for (int f = 0; f < 2; f++) {
+        double mb = formatos[f].bytes / 1e6;
+        printf(" %12.1f %12.1f", formatos[f].s_printf > 0 ? mb / formatos[f].s_printf : 0.0,
+               formatos[f].s_outbuf > 0 ? mb / formatos[f].s_outbuf : 0.0);
+    }
+    printf("\n");
+    for (int f = 0; f < 2; f++) {
+        printf("%s: %.1f MB, speedup %.2fx\n", formatos[f].nome, formatos[f].bytes / 1e6,
+               formatos[f].s_outbuf > 0 ? formatos[f].s_printf / formatos[f].s_outbuf : 0.0);
+    }
+    printf("%d curvas, %d com saída divergente\n", curvas, divergentes);
+
+    fclose(nulo);
+    close(fd_nulo);
+    return (divergentes || erros_formatador) ? 1 : 0;
+}
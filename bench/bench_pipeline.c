@@ -0,0 +1,512 @@
+/* Benchmark do pipeline inteiro do Multicurvas, etapa por etapa.
+ *
+ * Mede, para cada curva:
+ *
+ *   parse    plot_parse_text() (e plot_free)
+ *   compile  plot_compile() com o cache de programas desligado (tokens, RPN,
+ *            BatchProgram, otimizador, JIT se for o motor; inclui descartar)
+ *   sample   plot_generate_samples_into() com o programa já no cache
+ *   svg/csv  render_svg_out()/render_csv_out() num OutBuf que descarta
+ *
+ * e as três últimas para cada número de amostras de --samples. Cada medida
+ * é a mediana e o p95 de --reps repetições depois de --warmup de
+ * aquecimento; etapas rápidas demais para o relógio repetem várias vezes
+ * dentro de cada repetição (pelo menos BENCH_MIN_REP segundos).
+ *
+ * Imprime os totais por etapa (soma das medianas das curvas) e, com
+ * --json=<arquivo>, grava todas as medidas: um objeto por linha em
+ * "medidas", fácil de ler de volta por este programa ou por outras
+ * ferramentas. Com --compare=<base.json>, compara com uma execução salva:
+ * um total que piorou mais que --threshold (padrão 10%) é REGRESSÃO e o
+ * código de saída é 1; as curvas que mais pioraram são listadas. Com
+ * --from=<atual.json> não mede nada: compara dois arquivos.
+ * `make bench` grava build/bench.json; `make bench-compare BASE=<arquivo>`
+ * compara com ele.
+ *
+ * Uso: bench_pipeline [--samples=500,5000,50000] [--reps=9] [--warmup=2]
+ *                     [--json=<arquivo>] [--compare=<base.json>]
+ *                     [--threshold=10] [--from=<atual.json>] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/render.h"
+#include "../include/batch_eval.h"
+#include "../include/vecmath.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_CURVAS   256
+#define BENCH_MAX_TAMANHOS 8
+#define BENCH_MAX_REPS     1000
+#define BENCH_MIN_REP      50e-6    /* Duração mínima de uma repetição (s) */
+#define BENCH_PISO_US      5.0      /* Diferença mínima para listar uma curva */
+
+static const char *const ETAPAS[] = { "parse", "compile", "sample", "svg", "csv" };
+#define N_ETAPAS 5
+
+/* Uma medida: curva x etapa x amostras (0 em parse e compile) */
+typedef struct {
+    char curva[BENCH_MAX_LINE];
+    int etapa;
+    int amostras;
+    double mediana_us, p95_us;
+    long pontos;                /* Avaliações (sample) ou pontos escritos (svg/csv) */
+} Medida;
+
+typedef struct {
+    Medida *v;
+    int n, capacidade;
+} Medidas;
+
+static Medida *nova_medida(Medidas *m) {
+    if (m->n == m->capacidade) {
+        int cap = m->capacidade ? 2 * m->capacidade : 256;
+        Medida *v = realloc(m->v, cap * sizeof(Medida));
+        if (!v) return NULL;
+        m->v = v;
+        m->capacidade = cap;
+    }
+    Medida *r = &m->v[m->n++];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+static int etapa_por_nome(const char *nome) {
+    for (int k = 0; k < N_ETAPAS; k++) {
+        if (strcmp(nome, ETAPAS[k]) == 0) return k;
+    }
+    return -1;
+}
+
+/* ---- Medição ---- */
+
+typedef int (*Funcao)(void *ctx);
+
+/* Mediana e p95 de `reps` repetições de f, em microssegundos por chamada. */
+static int medir(Funcao f, void *ctx, int reps, int warmup, double *med, double *p95) {
+    static double tempos[BENCH_MAX_REPS];
+
+    // Calibra quantas chamadas cabem numa repetição
+    double t0 = agora();
+    if (!f(ctx)) return 0;
+    double t1 = agora() - t0;
+    long interno = (t1 >= BENCH_MIN_REP) ? 1 : (long)(BENCH_MIN_REP / (t1 > 1e-8 ? t1 : 1e-8)) + 1;
+
+    for (int w = 0; w < warmup; w++) {
+        for (long i = 0; i < interno; i++) f(ctx);
+    }
+    for (int r = 0; r < reps; r++) {
+        t0 = agora();
+        for (long i = 0; i < interno; i++) f(ctx);
+        tempos[r] = (agora() - t0) / interno * 1e6;
+    }
+    qsort(tempos, reps, sizeof(double), comparar_double);
+    *med = mediana(tempos, reps);
+    *p95 = percentil(tempos, reps, 0.95);
+    return 1;
+}
+
+typedef struct {
+    const char *expr;
+    Plot *plot;
+    PlotData dados;
+    OutBuf out;
+} Curva;
+
+static int descartar(void *ctx, const char *data, size_t n) {
+    (void)ctx;
+    (void)data;
+    (void)n;
+    return 1;
+}
+
+static int etapa_parse(void *ctx) {
+    Curva *c = ctx;
+    Plot *p = plot_parse_text(c->expr, NULL);
+    plot_free(p);
+    return p != NULL;
+}
+
+static int etapa_compile(void *ctx) {
+    Curva *c = ctx;
+    return plot_compile(c->plot, NULL);
+}
+
+static int etapa_sample(void *ctx) {
+    Curva *c = ctx;
+    return plot_generate_samples_into(c->plot, &c->dados, NULL);
+}
+
+static int etapa_svg(void *ctx) {
+    Curva *c = ctx;
+    outbuf_reset(&c->out, NULL);
+    render_svg_out(&c->out, &c->dados, c->expr, 800, 600, RENDER_SIMPLIFY_TOLERANCE, NULL);
+    return outbuf_flush(&c->out);
+}
+
+static int etapa_csv(void *ctx) {
+    Curva *c = ctx;
+    outbuf_reset(&c->out, NULL);
+    render_csv_out(&c->out, &c->dados);
+    return outbuf_flush(&c->out);
+}
+
+static void guardar(Medidas *m, const char *expr, int etapa, int amostras, double med, double p95,
+                    long pontos) {
+    Medida *r = nova_medida(m);
+    if (!r) return;
+    snprintf(r->curva, sizeof(r->curva), "%.*s", (int)sizeof(r->curva) - 1, expr);
+    r->etapa = etapa;
+    r->amostras = amostras;
+    r->mediana_us = med;
+    r->p95_us = p95;
+    r->pontos = pontos;
+}
+
+/* Mede todas as etapas de uma curva. Retorna 0 se a curva não funciona. */
+static int medir_curva(Medidas *m, const char *expr, const int *tamanhos, int n_tamanhos, int reps,
+                       int warmup) {
+    Curva c;
+    memset(&c, 0, sizeof(c));
+    c.expr = expr;
+    c.plot = plot_parse_text(expr, NULL);
+    if (!c.plot || !outbuf_init_sink(&c.out, descartar, NULL, 0)) {
+        plot_free(c.plot);
+        return 0;
+    }
+
+    double med, p95;
+    int ok = medir(etapa_parse, &c, reps, warmup, &med, &p95);
+    if (ok) guardar(m, expr, 0, 0, med, p95, 0);
+
+    plot_cache_set_limits(0, 0);
+    ok = ok && medir(etapa_compile, &c, reps, warmup, &med, &p95);
+    plot_cache_set_limits(PLOT_CACHE_MAX_BYTES, PLOT_CACHE_MAX_ENTRIES);
+    if (ok) guardar(m, expr, 1, 0, med, p95, 0);
+
+    for (int k = 0; ok && k < n_tamanhos; k++) {
+        c.plot->samples = tamanhos[k];
+        ok = medir(etapa_sample, &c, reps, warmup, &med, &p95);
+        if (!ok) break;
+        guardar(m, expr, 2, tamanhos[k], med, p95, c.dados.evaluations);
+        // Os renderizadores leem o PlotData da última geração
+        if (medir(etapa_svg, &c, reps, warmup, &med, &p95)) {
+            guardar(m, expr, 3, tamanhos[k], med, p95, c.dados.count);
+        }
+        if (medir(etapa_csv, &c, reps, warmup, &med, &p95)) {
+            guardar(m, expr, 4, tamanhos[k], med, p95, c.dados.count);
+        }
+    }
+
+    outbuf_close(&c.out);
+    plot_data_release(&c.dados);
+    plot_free(c.plot);
+    return ok;
+}
+
+/* ---- JSON ---- */
+
+static void json_texto(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int gravar_json(const char *caminho, const Medidas *m, const int *tamanhos, int n_tamanhos, int reps,
+                       int warmup) {
+    FILE *f = fopen(caminho, "w");
+    if (!f) return 0;
+    fprintf(f, "{\n  \"bench\": \"pipeline\",\n  \"versao\": 1,\n");
+    fprintf(f, "  \"motor\": \"%s\",\n  \"vecmath\": \"%s\",\n", batch_engine_name(batch_engine()),
+            vecmath_level_name(vecmath_level()));
+    fprintf(f, "  \"reps\": %d,\n  \"warmup\": %d,\n  \"amostras\": [", reps, warmup);
+    for (int k = 0; k < n_tamanhos; k++) fprintf(f, "%s%d", k ? ", " : "", tamanhos[k]);
+    fprintf(f, "],\n  \"medidas\": [\n");
+    for (int k = 0; k < m->n; k++) {
+        const Medida *r = &m->v[k];
+        fprintf(f, "    {\"curva\": ");
+        json_texto(f, r->curva);
+        fprintf(f, ", \"etapa\": \"%s\", \"amostras\": %d, \"mediana_us\": %.3f, \"p95_us\": %.3f, "
+                "\"pontos\": %ld}%s\n", ETAPAS[r->etapa], r->amostras, r->mediana_us, r->p95_us,
+                r->pontos, k + 1 < m->n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+/* Valor de "chave": em `linha` (texto com escapes desfeitos ou número) */
+static const char *campo(const char *linha, const char *chave) {
+    char padrao[64];
+    snprintf(padrao, sizeof(padrao), "\"%s\": ", chave);
+    const char *p = strstr(linha, padrao);
+    return p ? p + strlen(padrao) : NULL;
+}
+
+static int ler_texto(const char *p, char *dst, size_t max) {
+    if (!p || *p != '"') return 0;
+    size_t n = 0;
+    for (p++; *p && *p != '"'; p++) {
+        if (*p == '\\' && p[1]) p++;
+        if (n + 1 < max) dst[n++] = *p;
+    }
+    dst[n] = '\0';
+    return *p == '"';
+}
+
+/* Lê as medidas de um arquivo gravado por gravar_json (uma por linha). */
+static int ler_json(const char *caminho, Medidas *m) {
+    FILE *f = fopen(caminho, "r");
+    if (!f) return 0;
+    char linha[2 * BENCH_MAX_LINE];
+    char etapa[16];
+    while (fgets(linha, sizeof(linha), f)) {
+        const char *pc = campo(linha, "curva"), *pe = campo(linha, "etapa");
+        const char *pa = campo(linha, "amostras"), *pm = campo(linha, "mediana_us");
+        const char *pp = campo(linha, "p95_us"), *pn = campo(linha, "pontos");
+        if (!pc || !pe || !pa || !pm || !pp || !pn) continue;
+        Medida *r = nova_medida(m);
+        if (!r || !ler_texto(pc, r->curva, sizeof(r->curva)) || !ler_texto(pe, etapa, sizeof(etapa)) ||
+            (r->etapa = etapa_por_nome(etapa)) < 0) {
+            fclose(f);
+            return 0;
+        }
+        r->amostras = atoi(pa);
+        r->mediana_us = atof(pm);
+        r->p95_us = atof(pp);
+        r->pontos = atol(pn);
+    }
+    fclose(f);
+    return m->n > 0;
+}
+
+/* ---- Relatórios ---- */
+
+/* Totais de uma etapa e número de amostras (soma das curvas) */
+typedef struct {
+    double mediana_us, p95_us;
+    long pontos;
+    int curvas;
+} Total;
+
+static Total totalizar(const Medidas *m, int etapa, int amostras) {
+    Total t = { 0, 0, 0, 0 };
+    for (int k = 0; k < m->n; k++) {
+        const Medida *r = &m->v[k];
+        if (r->etapa != etapa || r->amostras != amostras) continue;
+        t.mediana_us += r->mediana_us;
+        t.p95_us += r->p95_us;
+        t.pontos += r->pontos;
+        t.curvas++;
+    }
+    return t;
+}
+
+/* Tamanhos distintos presentes nas medidas, em ordem crescente (0 primeiro) */
+static int tamanhos_de(const Medidas *m, int *tamanhos) {
+    int n = 0;
+    for (int k = 0; k < m->n; k++) {
+        int a = m->v[k].amostras, j = 0;
+        while (j < n && tamanhos[j] != a) j++;
+        if (j == n && n < BENCH_MAX_TAMANHOS + 1) tamanhos[n++] = a;
+    }
+    for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0 && tamanhos[j - 1] > tamanhos[j]; j--) {
+            int t = tamanhos[j];
+            tamanhos[j] = tamanhos[j - 1];
+            tamanhos[j - 1] = t;
+        }
+    }
+    return n;
+}
+
+static void imprimir_totais(const Medidas *m) {
+    int tamanhos[BENCH_MAX_TAMANHOS + 1];
+    int n = tamanhos_de(m, tamanhos);
+    printf("%-8s %9s %7s %14s %14s %14s\n", "etapa", "amostras", "curvas", "mediana (ms)", "p95 (ms)",
+           "pontos/s");
+    for (int e = 0; e < N_ETAPAS; e++) {
+        for (int k = 0; k < n; k++) {
+            Total t = totalizar(m, e, tamanhos[k]);
+            if (!t.curvas) continue;
+            char amostras[16] = "-";
+            if (tamanhos[k]) snprintf(amostras, sizeof(amostras), "%d", tamanhos[k]);
+            printf("%-8s %9s %7d %14.3f %14.3f", ETAPAS[e], amostras, t.curvas, t.mediana_us * 1e-3,
+                   t.p95_us * 1e-3);
+            if (t.pontos) printf(" %14.3e\n", t.pontos / (t.mediana_us * 1e-6));
+            else printf(" %14s\n", "-");
+        }
+    }
+}
+
+static const Medida *achar(const Medidas *m, const Medida *r) {
+    for (int k = 0; k < m->n; k++) {
+        const Medida *b = &m->v[k];
+        if (b->etapa == r->etapa && b->amostras == r->amostras && strcmp(b->curva, r->curva) == 0) return b;
+    }
+    return NULL;
+}
+
+typedef struct {
+    const Medida *atual;
+    double razao;
+    double base_us;
+} Variacao;
+
+static int comparar_variacao(const void *a, const void *b) {
+    double x = ((const Variacao *)a)->razao, y = ((const Variacao *)b)->razao;
+    return (x < y) - (x > y);
+}
+
+/* Compara `atual` com `base` (só as curvas presentes nos dois). Retorna o
+ * número de totais em regressão. */
+static int comparar(const Medidas *base, const Medidas *atual, double limite) {
+    int tamanhos[BENCH_MAX_TAMANHOS + 1];
+    int n = tamanhos_de(atual, tamanhos);
+    int regressoes = 0;
+
+    printf("\n%-8s %9s %7s %12s %12s %8s\n", "etapa", "amostras", "curvas", "base (ms)", "atual (ms)",
+           "razão");
+    for (int e = 0; e < N_ETAPAS; e++) {
+        for (int k = 0; k < n; k++) {
+            double soma_base = 0, soma_atual = 0;
+            int curvas = 0;
+            for (int i = 0; i < atual->n; i++) {
+                const Medida *r = &atual->v[i];
+                if (r->etapa != e || r->amostras != tamanhos[k]) continue;
+                const Medida *b = achar(base, r);
+                if (!b) continue;
+                soma_base += b->mediana_us;
+                soma_atual += r->mediana_us;
+                curvas++;
+            }
+            if (!curvas) continue;
+            const double razao = soma_atual / soma_base;
+            const int pior = razao > 1.0 + limite;
+            regressoes += pior;
+            char amostras[16] = "-";
+            if (tamanhos[k]) snprintf(amostras, sizeof(amostras), "%d", tamanhos[k]);
+            printf("%-8s %9s %7d %12.3f %12.3f %7.2fx%s\n", ETAPAS[e], amostras, curvas, soma_base * 1e-3,
+                   soma_atual * 1e-3, razao, pior ? "  REGRESSÃO" : (razao < 1.0 - limite ? "  melhora" : ""));
+        }
+    }
+
+    // Curvas que mais pioraram (acima do limite e de BENCH_PISO_US)
+    Variacao *v = malloc(atual->n * sizeof(Variacao));
+    int nv = 0;
+    for (int i = 0; v && i < atual->n; i++) {
+        const Medida *r = &atual->v[i];
+        const Medida *b = achar(base, r);
+        if (!b || b->mediana_us <= 0) continue;
+        const double razao = r->mediana_us / b->mediana_us;
+        if (razao > 1.0 + limite && r->mediana_us - b->mediana_us > BENCH_PISO_US) {
+            v[nv].atual = r;
+            v[nv].razao = razao;
+            v[nv].base_us = b->mediana_us;
+            nv++;
+        }
+    }
+    if (nv > 0) {
+        qsort(v, nv, sizeof(Variacao), comparar_variacao);
+        printf("\n%d medidas de curva pioraram mais de %.0f%%; as maiores:\n", nv, limite * 100);
+        for (int i = 0; i < nv && i < 10; i++) {
+            const Medida *r = v[i].atual;
+            printf("  %5.2fx %-8s %7d  %10.1f -> %10.1f us  %.60s\n", v[i].razao, ETAPAS[r->etapa], r->amostras,
+                   v[i].base_us, r->mediana_us, r->curva);
+        }
+    }
+    free(v);
+    printf("\n%s\n", regressoes ? "REGRESSÃO em pelo menos um total" : "Sem regressões nos totais");
+    return regressoes;
+}
+
+/* ---- main ---- */
+
+int main(int argc, char **argv) {
+    int tamanhos[BENCH_MAX_TAMANHOS] = { 500, 5000, 50000 };
+    int n_tamanhos = 3, reps = 9, warmup = 2;
+    double limite = 0.10;
+    const char *json = NULL, *base = NULL, *de = NULL;
+
+    for (int k = 1; k < argc; k++) {
+        const char *a = argv[k];
+        if (strncmp(a, "--samples=", 10) == 0) {
+            n_tamanhos = 0;
+            for (const char *p = a + 10; *p && n_tamanhos < BENCH_MAX_TAMANHOS;) {
+                char *fim;
+                long v = strtol(p, &fim, 10);
+                if (fim == p || v < 2 || v > 100000000L) break;
+                tamanhos[n_tamanhos++] = (int)v;
+                p = (*fim == ',') ? fim + 1 : fim;
+            }
+        } else if (strncmp(a, "--reps=", 7) == 0) {
+            reps = atoi(a + 7);
+        } else if (strncmp(a, "--warmup=", 9) == 0) {
+            warmup = atoi(a + 9);
+        } else if (strncmp(a, "--json=", 7) == 0) {
+            json = a + 7;
+        } else if (strncmp(a, "--compare=", 10) == 0) {
+            base = a + 10;
+        } else if (strncmp(a, "--threshold=", 12) == 0) {
+            limite = atof(a + 12) / 100.0;
+        } else if (strncmp(a, "--from=", 7) == 0) {
+            de = a + 7;
+        } else {
+            fprintf(stderr, "opção '%s' desconhecida\n", a);
+            return 1;
+        }
+    }
+    if (n_tamanhos == 0 || reps < 1 || reps > BENCH_MAX_REPS || warmup < 0 || !(limite > 0)) {
+        fprintf(stderr, "opções inválidas\n");
+        return 1;
+    }
+
+    Medidas atual = { NULL, 0, 0 };
+    if (de) {
+        if (!ler_json(de, &atual)) {
+            fprintf(stderr, "não foi possível ler as medidas de '%s'\n", de);
+            return 1;
+        }
+        printf("medidas de %s\n", de);
+    } else {
+        static char curvas[BENCH_MAX_CURVAS][BENCH_MAX_LINE];
+        int n = 0;
+        while (n < BENCH_MAX_CURVAS && ler_linha(stdin, curvas[n], BENCH_MAX_LINE)) n++;
+        printf("%d curvas, motor %s, vecmath %s, %d repetições (+%d de aquecimento), amostras", n,
+               batch_engine_name(batch_engine()), vecmath_level_name(vecmath_level()), reps, warmup);
+        for (int k = 0; k < n_tamanhos; k++) printf("%s%d", k ? "," : " ", tamanhos[k]);
+        printf("\n");
+        fflush(stdout);
+
+        double t0 = agora();
+        int falhas = 0;
+        for (int k = 0; k < n; k++) {
+            if (!medir_curva(&atual, curvas[k], tamanhos, n_tamanhos, reps, warmup)) falhas++;
+        }
+        printf("(%.1f s; %d curvas com erro ficaram de fora)\n", agora() - t0, falhas);
+        if (json && !gravar_json(json, &atual, tamanhos, n_tamanhos, reps, warmup)) {
+            fprintf(stderr, "não foi possível gravar '%s'\n", json);
+            return 1;
+        }
+    }
+    imprimir_totais(&atual);
+
+    int status = 0;
+    if (base) {
+        Medidas ref = { NULL, 0, 0 };
+        if (!ler_json(base, &ref)) {
+            fprintf(stderr, "não foi possível ler a base '%s'\n", base);
+            return 1;
+        }
+        printf("\ncomparando com %s (limite +%.0f%%)\n", base, limite * 100);
+        status = comparar(&ref, &atual, limite) ? 1 : 0;
+        free(ref.v);
+    }
+    free(atual.v);
+    return status;
+}
@@ -0,0 +1,159 @@
+/* Benchmark do arquivo binário de pontos contra o CSV.
+ *
+ * Gera cada curva e faz a viagem completa por um arquivo temporário nos dois
+ * formatos:
+ *   - CSV: render_csv_out num OutBuf sobre o fd; leitura com fgets + strtod
+ *   - bin: pointfile_write no mesmo tipo de OutBuf; leitura com
+ *     pointfile_open (mmap) somando as colunas x e y
+ * Mede milhões de pontos por segundo na escrita e na leitura, o tamanho dos
+ * arquivos e o erro máximo do que voltou (o CSV arredonda para 6 casas; o
+ * binário tem de voltar idêntico, bit a bit, incluindo t).
+ *
+ * Uso: bench_pointfile [amostras=200000] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/pointfile.h"
+#include "../include/render.h"
+#include "bench_util.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* Regrava `caminho` do zero com o formato pedido. Retorna o tamanho ou 0. */
+static size_t gravar(const char *caminho, const char *linha, const Plot *plot, const PlotData *data,
+                     int binario) {
+    FILE *f = fopen(caminho, "wb");
+    if (!f) return 0;
+    OutBuf ob;
+    int ok = outbuf_init_fd(&ob, fileno(f), 0);
+    if (ok) {
+        if (binario) {
+            pointfile_write(&ob, linha, plot, data);
+        } else {
+            render_csv_out(&ob, data);
+        }
+        ok = outbuf_close(&ob);
+    }
+    if (fclose(f) != 0) ok = 0;
+    return ok ? ob.written : 0;
+}
+
+/* Lê o CSV de volta e retorna o erro máximo contra `data` (-1 se divergiu
+ * na contagem). */
+static double ler_csv(const char *caminho, const PlotData *data) {
+    FILE *f = fopen(caminho, "r");
+    if (!f) return -1.0;
+    char linha[BENCH_MAX_LINE];
+    double erro = 0.0;
+    int n = 0;
+    if (!fgets(linha, sizeof(linha), f)) n = -1;     /* Cabeçalho "x,y" */
+    while (n >= 0 && fgets(linha, sizeof(linha), f)) {
+        char *fim;
+        double x = strtod(linha, &fim);
+        double y = strtod(fim + 1, NULL);
+        if (n >= data->count) {
+            n = -1;
+            break;
+        }
+        double e = fmax(fabs(x - data->x[n]), fabs(y - data->y[n]));
+        if (e > erro) erro = e;
+        n++;
+    }
+    fclose(f);
+    return (n == data->count) ? erro : -1.0;
+}
+
+/* Abre o binário, percorre as colunas e confere bit a bit. Retorna 1 se
+ * voltou idêntico. */
+static int ler_bin(const char *caminho, const PlotData *data, double *soma) {
+    PointFile *pf = pointfile_open(caminho, NULL);
+    if (!pf) return 0;
+    const PlotData *v = &pf->data;
+    double s = 0.0;
+    for (int i = 0; i < v->count; i++) s += v->x[i] + v->y[i];
+    *soma += s;
+
+    size_t bytes = (size_t)data->count * sizeof(double);
+    int ok = v->count == data->count && v->evaluations == data->evaluations &&
+             memcmp(v->x, data->x, bytes) == 0 && memcmp(v->y, data->y, bytes) == 0 &&
+             memcmp(v->t, data->t, bytes) == 0 &&
+             memcmp(v->valid, data->valid, ((size_t)data->evaluations + 7) / 8) == 0;
+    pointfile_close(pf);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (amostras < 2) amostras = 2;
+
+    const char *dir = getenv("TMPDIR");
+    char csv[256], bin[256];
+    snprintf(csv, sizeof(csv), "%s/bench_pointfile_%d.csv", dir ? dir : "/tmp", (int)getpid());
+    snprintf(bin, sizeof(bin), "%s/bench_pointfile_%d.bin", dir ? dir : "/tmp", (int)getpid());
+
+    double t_csv_w = 0, t_csv_r = 0, t_bin_w = 0, t_bin_r = 0, bytes_csv = 0, bytes_bin = 0;
+    double pior_csv = 0, soma = 0;
+    long pontos = 0;
+    int curvas = 0, divergentes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s %9s %9s %9s %9s %8s %8s %10s   (Mpontos/s, %d amostras)\n", "curva", "csv escr",
+           "csv leit", "bin escr", "bin leit", "csv MB", "bin MB", "erro csv", amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+        PlotData *data = plot_generate_samples(plot, NULL);
+        if (!data || data->count == 0) {
+            plot_data_free(data);
+            plot_free(plot);
+            continue;
+        }
+
+        double t0 = agora();
+        size_t b_csv = gravar(csv, linha, plot, data, 0);
+        double t1 = agora();
+        double erro = ler_csv(csv, data);
+        double t2 = agora();
+        size_t b_bin = gravar(bin, linha, plot, data, 1);
+        double t3 = agora();
+        int igual = ler_bin(bin, data, &soma);
+        double t4 = agora();
+
+        const double mp = data->count / 1e6;
+        int diverge = !b_csv || !b_bin || erro < 0 || !igual;
+        printf("%-44.44s %9.1f %9.1f %9.1f %9.1f %8.2f %8.2f %10.2g%s\n", linha, mp / (t1 - t0),
+               mp / (t2 - t1), mp / (t3 - t2), mp / (t4 - t3), b_csv / 1e6, b_bin / 1e6, erro,
+               diverge ? "   (não voltou igual!)" : "");
+
+        t_csv_w += t1 - t0;
+        t_csv_r += t2 - t1;
+        t_bin_w += t3 - t2;
+        t_bin_r += t4 - t3;
+        bytes_csv += b_csv;
+        bytes_bin += b_bin;
+        if (erro > pior_csv) pior_csv = erro;
+        pontos += data->count;
+        divergentes += diverge;
+        curvas++;
+
+        plot_data_free(data);
+        plot_free(plot);
+    }
+    unlink(csv);
+    unlink(bin);
+
+    const double mp = pontos / 1e6;
+    printf("%-44s %9.1f %9.1f %9.1f %9.1f %8.1f %8.1f %10.2g\n", "TOTAL", mp / t_csv_w, mp / t_csv_r,
+           mp / t_bin_w, mp / t_bin_r, bytes_csv / 1e6, bytes_bin / 1e6, pior_csv);
+    printf("escrita: bin %.1fx mais rápida; leitura: bin %.1fx mais rápida; %.1f MB/s lidos do bin\n",
+           t_csv_w / t_bin_w, t_csv_r / t_bin_r, bytes_bin / 1e6 / t_bin_r);
+    printf("%d curvas, %ld pontos, %d sem volta idêntica (soma %.3g)\n", curvas, pontos, divergentes, soma);
+    return divergentes ? 1 : 0;
+}
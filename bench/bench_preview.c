@@ -0,0 +1,227 @@
+/* Benchmark da qualidade de prévia (Plot.quality = PLOT_QUALITY_PREVIEW)
+ * contra a exata.
+ *
+ * Para cada curva, com N amostras da grade uniforme:
+ *   - tempo de plot_generate_samples nas duas qualidades (melhor de 3) e,
+ *     dentro dele, o da etapa de avaliação do Stats, com a conferência da
+ *     prévia (o binário precisa ser compilado sem MULTICURVAS_NO_STATS);
+ *   - o maior desvio de um ponto da prévia em relação ao exato, em pixels
+ *     da área de plotagem de um canvas 800x600 (escala da caixa exata);
+ *   - os pixels diferentes entre os PBM 800x600 das duas, no total e os sem
+ *     a mesma cor na outra a até 1 pixel.
+ * Curvas cujos pontos saem idênticos bit a bit foram refeitas no modo exato
+ * (a conferência reprovou a prévia, ou todas as lanes foram para o caminho
+ * lento).
+ *
+ * Sai com erro se algum ponto desviou mais de meio pixel, se as amostras
+ * válidas não são as mesmas ou se algum pixel dos PBM difere além da
+ * vizinhança de 1 pixel: é o teste de que a prévia desenha o mesmo que o
+ * modo exato.
+ *
+ * Uso: bench_preview [amostras=200000] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/render.h"
+#include "../include/stats.h"
+#include "bench_util.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPETICOES 3
+#define CANVAS_W 800
+#define CANVAS_H 600
+#define DESVIO_MAXIMO 0.5
+
+/* Bytes da saída em memória */
+typedef struct {
+    unsigned char *dados;
+    size_t n, cap;
+} Buffer;
+
+static int buffer_sink(void *ctx, const char *data, size_t n) {
+    Buffer *b = ctx;
+    if (b->n + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (cap < b->n + n) cap *= 2;
+        unsigned char *novo = realloc(b->dados, cap);
+        if (!novo) return 0;
+        b->dados = novo;
+        b->cap = cap;
+    }
+    memcpy(b->dados + b->n, data, n);
+    b->n += n;
+    return 1;
+}
+
+static int pbm(const PlotData *data, Buffer *b) {
+    OutBuf out;
+    b->n = 0;
+    if (!outbuf_init_sink(&out, buffer_sink, b, 0)) return 0;
+    int ok = render_raster_out(&out, data, RENDER_PBM, CANVAS_W, CANVAS_H, RENDER_SIMPLIFY_TOLERANCE, 0, NULL);
+    outbuf_close(&out);
+    return ok && !out.error;
+}
+
+static int pixel(const unsigned char *bits, int px, int py) {
+    const int linha = (CANVAS_W + 7) / 8;
+    return (bits[(size_t)py * linha + px / 8] >> (7 - px % 8)) & 1;
+}
+
+/* Pixels diferentes entre dois PBM CANVAS_W x CANVAS_H; *longe recebe os
+ * que não têm a mesma cor no outro a até 1 pixel de distância (um traço que
+ * andou mais que isso; a borda do traço antialiasado, cortada no limiar do
+ * PBM, muda com desvios bem menores). Retorna -1 se os tamanhos diferem. */
+static long pixels_diferentes(const Buffer *a, const Buffer *b, long *longe) {
+    const size_t bytes = (size_t)(CANVAS_W + 7) / 8 * CANVAS_H;
+    if (a->n != b->n || a->n < bytes) return -1;
+    const unsigned char *pa = a->dados + a->n - bytes, *pb = b->dados + b->n - bytes;
+    long n = 0;
+    *longe = 0;
+    for (int py = 0; py < CANVAS_H; py++) {
+        for (int px = 0; px < CANVAS_W; px++) {
+            const int v = pixel(pa, px, py);
+            if (v == pixel(pb, px, py)) continue;
+            n++;
+            int perto = 0;
+            for (int dy = -1; dy <= 1 && !perto; dy++) {
+                for (int dx = -1; dx <= 1 && !perto; dx++) {
+                    const int qx = px + dx, qy = py + dy;
+                    if (qx < 0 || qy < 0 || qx >= CANVAS_W || qy >= CANVAS_H) continue;
+                    perto = pixel(pb, qx, qy) == v;
+                }
+            }
+            *longe += !perto;
+        }
+    }
+    return n;
+}
+
+/* Melhor de REPETICOES: *segundos é o tempo da geração e *avaliacao, o da
+ * etapa de avaliação (Stats) na mesma rodada */
+static PlotData *gerar(const char *linha, int amostras, PlotQuality qualidade, double *segundos,
+                       double *avaliacao) {
+    PlotData *melhor = NULL;
+    *segundos = INFINITY;
+    for (int r = 0; r < REPETICOES; r++) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) return NULL;
+        plot->samples = amostras;
+        plot->quality = qualidade;
+        Stats st = { 0 };
+        stats_attach(&st);
+        const double inicio = agora();
+        PlotData *data = plot_generate_samples(plot, NULL);
+        const double s = agora() - inicio;
+        stats_detach();
+        plot_free(plot);
+        if (!data) {
+            plot_data_free(melhor);
+            return NULL;
+        }
+        if (s < *segundos) {
+            *segundos = s;
+            *avaliacao = st.seconds[STATS_EVAL];
+        }
+        plot_data_free(melhor);
+        melhor = data;
+    }
+    return melhor;
+}
+
+/* Maior desvio, em pixels, entre os pontos de `a` e `b` (mesmas amostras
+ * válidas), na escala da caixa de `a`. Retorna -1 se as amostras válidas
+ * diferem; *identicos = 1 se os pontos são iguais bit a bit. */
+static double desvio_pixels(const PlotData *a, const PlotData *b, int *identicos) {
+    if (a->count != b->count || a->evaluations != b->evaluations ||
+        memcmp(a->valid, b->valid, ((size_t)a->evaluations + 7) / 8) != 0) {
+        return -1;
+    }
+    *identicos = memcmp(a->x, b->x, a->count * sizeof(double)) == 0 &&
+                 memcmp(a->y, b->y, a->count * sizeof(double)) == 0;
+    if (a->count == 0) return 0;
+
+    RenderBounds caixa;
+    render_bounds(a, &caixa);
+    const double rx = caixa.maxx - caixa.minx, ry = caixa.maxy - caixa.miny;
+    const double sx = (rx > 0) ? CANVAS_W * 0.8 / rx : 0;
+    const double sy = (ry > 0) ? CANVAS_H * 0.8 / ry : 0;
+
+    double pior = 0;
+    for (int i = 0; i < a->count; i++) {
+        // Fora da caixa o ponto não é desenhado (filtro do render)
+        if (!(fabs(a->x[i]) <= 1e6 && fabs(a->y[i]) <= 1e6)) continue;
+        const double d = fmax(fabs(a->x[i] - b->x[i]) * sx, fabs(a->y[i] - b->y[i]) * sy);
+        if (!(d <= pior)) pior = d;
+    }
+    return pior;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (amostras < 2) amostras = 2;
+
+    double t_exato = 0, t_previa = 0, av_exato = 0, av_previa = 0, pior = 0;
+    int curvas = 0, refeitas = 0, divergentes = 0, falhas = 0;
+    Buffer pbm_exato = { 0 }, pbm_previa = { 0 };
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-36s %8s %8s %7s %7s %7s %7s %9s %7s %5s  (%d amostras)\n", "curva", "exata ms", "prévia", "ganho",
+           "aval.", "prévia", "ganho", "desvio px", "pixels", "longe", amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        double s_exato, s_previa, a_exato = 0, a_previa = 0;
+        PlotData *exato = gerar(linha, amostras, PLOT_QUALITY_EXACT, &s_exato, &a_exato);
+        PlotData *previa = exato ? gerar(linha, amostras, PLOT_QUALITY_PREVIEW, &s_previa, &a_previa) : NULL;
+        if (!previa) {
+            plot_data_free(exato);
+            falhas++;
+            continue;
+        }
+
+        int identicos = 0;
+        const double desvio = desvio_pixels(exato, previa, &identicos);
+        long pixels = -1, longe = 0;
+        if (exato->count > 0 && pbm(exato, &pbm_exato) && pbm(previa, &pbm_previa)) {
+            pixels = pixels_diferentes(&pbm_exato, &pbm_previa, &longe);
+        } else if (exato->count == 0) {
+            pixels = 0;
+        }
+
+        const int diverge = desvio < 0 || desvio > DESVIO_MAXIMO || pixels < 0 || longe > 0;
+        printf("%-36.36s %8.2f %8.2f %6.2fx %7.2f %7.2f %6.2fx ", linha, s_exato * 1e3, s_previa * 1e3,
+               s_exato / s_previa, a_exato * 1e3, a_previa * 1e3, a_exato / a_previa);
+        if (desvio < 0) {
+            printf("%9s ", "amostras");
+        } else {
+            printf("%9.4f ", desvio);
+        }
+        printf("%7ld %5ld%s%s\n", pixels, longe, identicos ? "  exata" : "", diverge ? "  DIVERGE" : "");
+
+        curvas++;
+        t_exato += s_exato;
+        t_previa += s_previa;
+        av_exato += a_exato;
+        av_previa += a_previa;
+        refeitas += identicos;
+        divergentes += diverge;
+        if (desvio > pior) pior = desvio;
+        plot_data_free(exato);
+        plot_data_free(previa);
+    }
+    free(pbm_exato.dados);
+    free(pbm_previa.dados);
+
+    printf("\n%d curvas (%d falharam), %d refeitas no modo exato\n", curvas, falhas, refeitas);
+    if (t_previa > 0) {
+        printf("geração: exata %.1f ms, prévia %.1f ms (%.2fx)\n", t_exato * 1e3, t_previa * 1e3,
+               t_exato / t_previa);
+        printf("avaliação: exata %.1f ms, prévia %.1f ms (%.2fx)\n", av_exato * 1e3, av_previa * 1e3,
+               av_exato / av_previa);
+    }
+    printf("maior desvio: %.4f px; %d curvas divergentes\n", pior, divergentes);
+    return divergentes ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/* Benchmark da reamostragem incremental (Plot.incremental).
+ *
+ * Para cada curva, simula uma exploração interativa sobre o seu intervalo:
+ * 5 pans de 10% para a direita, 4 zooms in de 2x e 3 zooms out de 2x, 13
+ * vistas ao todo. A sessão roda com o cache de amostras
+ * desligado e ligado (a grade diádica é a mesma nos dois) e mede o tempo,
+ * as amostras avaliadas e se cada vista saiu idêntica bit a bit.
+ *
+ * O motor pesa: com os kernels vetoriais (block) uma amostra custa pouco mais
+ * que consultar o cache; com o avaliador escalar (scalar) é bem mais cara.
+ *
+ * Uso: bench_resample [amostras=20000] [motor=block] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/batch_eval.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_VISTAS   13
+
+/* Intervalos da sessão a partir de [C,D] */
+static void sessao(double C, double D, double *vc, double *vd) {
+    const double w = D - C;
+    int k = 0;
+    vc[k] = C;
+    vd[k++] = D;
+    for (int i = 0; i < 5; i++, k++) {
+        vc[k] = vc[k - 1] + 0.1 * w;
+        vd[k] = vd[k - 1] + 0.1 * w;
+    }
+    for (int i = 0; i < 4; i++, k++) {
+        const double m = 0.5 * (vc[k - 1] + vd[k - 1]), h = 0.25 * (vd[k - 1] - vc[k - 1]);
+        vc[k] = m - h;
+        vd[k] = m + h;
+    }
+    for (int i = 0; i < 3; i++, k++) {
+        const double m = 0.5 * (vc[k - 1] + vd[k - 1]), h = vd[k - 1] - vc[k - 1];
+        vc[k] = m - h;
+        vd[k] = m + h;
+    }
+}
+
+/* Gera as vistas; guarda cada PlotData em `vistas` (se não NULL) ou compara
+ * com o que está lá. Retorna o tempo, ou -1 se falhou ou divergiu. */
+static double rodar(Plot *plot, const double *vc, const double *vd, PlotData **vistas, int comparar) {
+    double total = 0.0;
+    for (int k = 0; k < BENCH_VISTAS; k++) {
+        plot->C = vc[k];
+        plot->D = vd[k];
+        plot->has_interval = 1;
+        double t0 = agora();
+        PlotData *d = plot_generate_samples(plot, NULL);
+        total += agora() - t0;
+        if (!d) return -1.0;
+
+        if (!comparar) {
+            vistas[k] = d;
+            continue;
+        }
+        const PlotData *r = vistas[k];
+        size_t bytes = (size_t)d->count * sizeof(double);
+        int igual = d->count == r->count && d->evaluations == r->evaluations &&
+                    memcmp(d->x, r->x, bytes) == 0 && memcmp(d->y, r->y, bytes) == 0 &&
+                    memcmp(d->t, r->t, bytes) == 0 &&
+                    memcmp(d->valid, r->valid, ((size_t)d->evaluations + 7) / 8) == 0;
+        plot_data_free(d);
+        if (!igual) return -1.0;
+    }
+    return total;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (amostras < 2) amostras = 2;
+    BatchEngine motor = BATCH_ENGINE_BLOCK;
+    if (argc > 2 && !batch_engine_parse(argv[2], &motor)) {
+        fprintf(stderr, "motor '%s' inválido\n", argv[2]);
+        return 1;
+    }
+    batch_set_engine(motor);
+
+    double t_sem = 0, t_com = 0;
+    unsigned long aval_sem = 0, aval_com = 0;
+    int curvas = 0, divergentes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s %10s %10s %8s %9s   (%d vistas, %d amostras, motor %s)\n", "curva", "sem cache",
+           "com cache", "ganho", "avaliadas", BENCH_VISTAS, amostras, batch_engine_name(motor));
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+        plot->incremental = 1;
+        double C, D, vc[BENCH_VISTAS], vd[BENCH_VISTAS];
+        plot_interval(plot, &C, &D);
+        if (plot->type == PLOT_POLAR_R || plot->type == PLOT_POLAR_R2) {
+            // plot->C/D ficam na escala da entrada (múltiplos de pi)
+            C /= 3.14159265358979323846;
+            D /= 3.14159265358979323846;
+        }
+        sessao(C, D, vc, vd);
+
+        PlotData *vistas[BENCH_VISTAS];
+        memset(vistas, 0, sizeof(vistas));
+        PlotSampleCacheStats s0, s1;
+
+        plot_sample_cache_set_limits(0, 0);
+        plot_sample_cache_stats(&s0);
+        double sem = rodar(plot, vc, vd, vistas, 0);
+        plot_sample_cache_stats(&s1);
+        const unsigned long a_sem = s1.evaluated - s0.evaluated;
+
+        plot_sample_cache_set_limits(PLOT_SAMPLE_CACHE_MAX_BYTES, PLOT_SAMPLE_CACHE_MAX_CURVES);
+        plot_sample_cache_clear();
+        plot_sample_cache_stats(&s0);
+        double com = (sem >= 0) ? rodar(plot, vc, vd, vistas, 1) : -1.0;
+        plot_sample_cache_stats(&s1);
+        const unsigned long a_com = s1.evaluated - s0.evaluated;
+
+        int diverge = sem < 0 || com < 0;
+        if (!diverge) {
+            printf("%-44.44s %7.2f ms %7.2f ms %7.2fx %8.1f%%\n", linha, sem * 1e3, com * 1e3, sem / com,
+                   a_sem ? 100.0 * a_com / a_sem : 0.0);
+            t_sem += sem;
+            t_com += com;
+            aval_sem += a_sem;
+            aval_com += a_com;
+            curvas++;
+        } else if (sem >= 0) {
+            printf("%-44.44s   (vista diferente com o cache!)\n", linha);
+            divergentes++;
+        }
+
+        for (int k = 0; k < BENCH_VISTAS; k++) plot_data_free(vistas[k]);
+        plot_free(plot);
+    }
+
+    printf("%-44s %7.2f ms %7.2f ms %7.2fx %8.1f%%\n", "TOTAL", t_sem * 1e3, t_com * 1e3,
+           t_com > 0 ? t_sem / t_com : 0.0, aval_sem ? 100.0 * aval_com / aval_sem : 0.0);
+    printf("%d curvas, %lu amostras avaliadas sem cache, %lu com cache, %d com vista diferente\n", curvas,
+           aval_sem, aval_com, divergentes);
+    return divergentes ? 1 : 0;
+}
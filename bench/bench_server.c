@@ -0,0 +1,341 @@
+/* Gerador de carga do servidor de renderização (--serve).
+ *
+ * Pede as curvas da entrada em rodízio ao servidor em `endereço`, por
+ * várias conexões ao mesmo tempo, cada uma mandando um pedido e esperando a
+ * resposta inteira antes do próximo. Mede pedidos/s, MB/s e a latência
+ * (p50, p90, p99 e máxima) de cada pedido, do envio ao "0\n" final.
+ *
+ * Com --exec=<multicurvas>, faz o mesmo com um processo por pedido (saída
+ * lida por um pipe), para comparar com o custo de subir o executável.
+ * O alvo `make bench-server` sobe o servidor num socket em build/ e o
+ * derruba no fim.
+ *
+ * Uso: bench_server <socket | tcp:porta> [--conns=8] [--requests=4000]
+ *                   [--format=svg] [--samples=500] [--exec=<multicurvas>]
+ *                   < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+
+#define BENCH_MAX_CURVAS  256
+#define BENCH_MAX_CONNS   256
+#define BENCH_MAX_EXEC    1000     /* Pedidos no modo processo por pedido */
+
+extern char **environ;
+
+typedef struct {
+    const char *endereco;
+    const char *exec;            /* NULL: pede ao servidor */
+    const char *formato;
+    int amostras;
+    char (*curvas)[BENCH_MAX_LINE];
+    int n_curvas;
+    int pedidos;
+
+    pthread_mutex_t lock;
+    int proximo;
+    double *latencias;           /* Em ms, uma por pedido */
+    unsigned long bytes;
+    int erros;
+    int falhou;                  /* Conexão perdida ou resposta mal formada */
+} Carga;
+
+/* Conecta, tentando por até 5 s enquanto o servidor sobe. Retorna o fd ou -1. */
+static int conectar(const char *endereco) {
+    for (int tentativa = 0; tentativa < 100; tentativa++) {
+        int fd;
+        int ok;
+        if (strncmp(endereco, "tcp:", 4) == 0) {
+            struct sockaddr_in sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sin_family = AF_INET;
+            sa.sin_port = htons((unsigned short)atoi(endereco + 4));
+            sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            int um = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+            ok = fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0;
+        } else {
+            struct sockaddr_un sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sun_family = AF_UNIX;
+            strncpy(sa.sun_path, endereco, sizeof(sa.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            ok = fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0;
+        }
+        if (ok) return fd;
+        if (fd >= 0) close(fd);
+        struct timespec espera = { 0, 50 * 1000000L };
+        nanosleep(&espera, NULL);
+    }
+    return -1;
+}
+
+/* Leitura com buffer de uma conexão */
+typedef struct {
+    int fd;
+    char buf[64 * 1024];
+    size_t ini, fim;
+} Leitor;
+
+static int encher(Leitor *l) {
+    if (l->ini < l->fim) return 1;
+    ssize_t r;
+    do {
+        r = read(l->fd, l->buf, sizeof(l->buf));
+    } while (r < 0 && errno == EINTR);
+    if (r <= 0) return 0;
+    l->ini = 0;
+    l->fim = (size_t)r;
+    return 1;
+}
+
+/* Lê a resposta de um pedido. Retorna 1 (OK), 0 (ERRO) ou -1 (conexão
+ * perdida ou resposta mal formada); soma os bytes da saída em *bytes. */
+static int ler_resposta(Leitor *l, unsigned long *bytes) {
+    for (;;) {
+        char linha[256];
+        size_t n = 0;
+        for (;;) {
+            if (!encher(l)) return -1;
+            char c = l->buf[l->ini++];
+            if (c == '\n') break;
+            if (n < sizeof(linha) - 1) linha[n++] = c;
+        }
+        linha[n] = '\0';
+        if (strncmp(linha, "ERRO", 4) == 0) return 0;
+
+        char *fim;
+        unsigned long tam = strtoul(linha, &fim, 10);
+        if (fim == linha || *fim) return -1;
+        if (tam == 0) return 1;
+        *bytes += tam;
+        while (tam > 0) {
+            if (!encher(l)) return -1;
+            size_t k = l->fim - l->ini;
+            if (k > tam) k = tam;
+            l->ini += k;
+            tam -= k;
+        }
+    }
+}
+
+static int enviar_tudo(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+/* Próximo pedido, ou -1 quando acabaram */
+static int proximo(Carga *c) {
+    pthread_mutex_lock(&c->lock);
+    int k = (c->falhou || c->proximo >= c->pedidos) ? -1 : c->proximo++;
+    pthread_mutex_unlock(&c->lock);
+    return k;
+}
+
+static void *cliente_servidor(void *arg) {
+    Carga *c = arg;
+    Leitor *l = malloc(sizeof(Leitor));
+    int fd = l ? conectar(c->endereco) : -1;
+    if (fd < 0) {
+        pthread_mutex_lock(&c->lock);
+        c->falhou = 1;
+        pthread_mutex_unlock(&c->lock);
+        free(l);
+        return NULL;
+    }
+    l->fd = fd;
+    l->ini = l->fim = 0;
+
+    unsigned long bytes = 0;
+    int erros = 0, falhou = 0, k;
+    char pedido[BENCH_MAX_LINE + 64];
+    while (!falhou && (k = proximo(c)) >= 0) {
+        int n = snprintf(pedido, sizeof(pedido), "\"%s\" %s 800x600 samples=%d\n",
+                         c->curvas[k % c->n_curvas], c->formato, c->amostras);
+        double t0 = agora();
+        int r = enviar_tudo(fd, pedido, (size_t)n) ? ler_resposta(l, &bytes) : -1;
+        c->latencias[k] = (agora() - t0) * 1e3;
+        if (r == 0) erros++;
+        if (r < 0) falhou = 1;
+    }
+    close(fd);
+    free(l);
+
+    pthread_mutex_lock(&c->lock);
+    c->bytes += bytes;
+    c->erros += erros;
+    if (falhou) c->falhou = 1;
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+/* O mesmo pedido como um processo: multicurvas --samples=N expr fmt 800 600 */
+static void *cliente_processo(void *arg) {
+    Carga *c = arg;
+    unsigned long bytes = 0;
+    int erros = 0, k;
+    char amostras[32];
+    snprintf(amostras, sizeof(amostras), "--samples=%d", c->amostras);
+    char buf[64 * 1024];
+
+    while ((k = proximo(c)) >= 0) {
+        char *args[] = { (char *)c->exec, amostras, c->curvas[k % c->n_curvas], (char *)c->formato,
+                         "800", "600", NULL };
+        int p[2];
+        double t0 = agora();
+        if (pipe(p) != 0) {
+            erros++;
+            continue;
+        }
+        // Sem herdar o pipe de outro cliente (o read só termina quando todos fecham)
+        fcntl(p[0], F_SETFD, FD_CLOEXEC);
+        fcntl(p[1], F_SETFD, FD_CLOEXEC);
+        posix_spawn_file_actions_t acoes;
+        posix_spawn_file_actions_init(&acoes);
+        posix_spawn_file_actions_adddup2(&acoes, p[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&acoes, p[0]);
+        posix_spawn_file_actions_addclose(&acoes, p[1]);
+        posix_spawn_file_actions_addopen(&acoes, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+        pid_t pid;
+        int r = posix_spawn(&pid, c->exec, &acoes, NULL, args, environ);
+        posix_spawn_file_actions_destroy(&acoes);
+        close(p[1]);
+        if (r == 0) {
+            ssize_t n;
+            while ((n = read(p[0], buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR)) {
+                if (n > 0) bytes += (unsigned long)n;
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) erros++;
+        } else {
+            erros++;
+        }
+        close(p[0]);
+        c->latencias[k] = (agora() - t0) * 1e3;
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->bytes += bytes;
+    c->erros += erros;
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+/* Roda `pedidos` pedidos em `conns` clientes e imprime uma linha. */
+static int rodar(Carga *c, const char *nome, int conns, int pedidos) {
+    c->pedidos = pedidos;
+    c->proximo = 0;
+    c->bytes = 0;
+    c->erros = 0;
+    c->falhou = 0;
+    c->latencias = calloc(pedidos, sizeof(double));
+    if (!c->latencias) return 0;
+
+    pthread_t th[BENCH_MAX_CONNS];
+    int criadas = 0;
+    double t0 = agora();
+    for (int k = 0; k < conns; k++) {
+        if (pthread_create(&th[criadas], NULL, c->exec ? cliente_processo : cliente_servidor, c) == 0) {
+            criadas++;
+        }
+    }
+    for (int k = 0; k < criadas; k++) pthread_join(th[k], NULL);
+    double total = agora() - t0;
+
+    int ok = !c->falhou && c->proximo == pedidos;
+    if (ok) {
+        qsort(c->latencias, pedidos, sizeof(double), comparar_double);
+        printf("%-10s %8d %6d %6d %10.0f %8.1f %8.3f %8.3f %8.3f %8.3f\n", nome, pedidos, c->erros, conns,
+               pedidos / total, c->bytes / total / 1048576.0, percentil(c->latencias, pedidos, 0.50),
+               percentil(c->latencias, pedidos, 0.90), percentil(c->latencias, pedidos, 0.99),
+               c->latencias[pedidos - 1]);
+    } else {
+        printf("%-10s falhou (conexão perdida ou resposta mal formada)\n", nome);
+    }
+    free(c->latencias);
+    c->latencias = NULL;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || strncmp(argv[1], "--", 2) == 0) {
+        fprintf(stderr, "Uso: %s <socket | tcp:porta> [--conns=8] [--requests=4000] [--format=svg] "
+                "[--samples=500] [--exec=<multicurvas>] < curvas.txt\n", argv[0]);
+        return 1;
+    }
+
+    static char curvas[BENCH_MAX_CURVAS][BENCH_MAX_LINE];
+    Carga c;
+    memset(&c, 0, sizeof(c));
+    pthread_mutex_init(&c.lock, NULL);
+    c.endereco = argv[1];
+    c.formato = "svg";
+    c.amostras = 500;
+    c.curvas = curvas;
+    int conns = 8, pedidos = 4000;
+    const char *exec = NULL;
+
+    for (int k = 2; k < argc; k++) {
+        if (strncmp(argv[k], "--conns=", 8) == 0) conns = atoi(argv[k] + 8);
+        else if (strncmp(argv[k], "--requests=", 11) == 0) pedidos = atoi(argv[k] + 11);
+        else if (strncmp(argv[k], "--format=", 9) == 0) c.formato = argv[k] + 9;
+        else if (strncmp(argv[k], "--samples=", 10) == 0) c.amostras = atoi(argv[k] + 10);
+        else if (strncmp(argv[k], "--exec=", 7) == 0) exec = argv[k] + 7;
+        else {
+            fprintf(stderr, "opção '%s' desconhecida\n", argv[k]);
+            return 1;
+        }
+    }
+    if (conns < 1) conns = 1;
+    if (conns > BENCH_MAX_CONNS) conns = BENCH_MAX_CONNS;
+    if (pedidos < 1) pedidos = 1;
+
+    while (c.n_curvas < BENCH_MAX_CURVAS && ler_linha(stdin, curvas[c.n_curvas], BENCH_MAX_LINE)) {
+        if (!strchr(curvas[c.n_curvas], '"')) c.n_curvas++;
+    }
+    if (c.n_curvas == 0) {
+        fprintf(stderr, "nenhuma curva na entrada\n");
+        return 1;
+    }
+
+    printf("%d curvas em rodízio, %s 800x600, %d amostras\n", c.n_curvas, c.formato, c.amostras);
+    printf("%-10s %8s %6s %6s %10s %8s %8s %8s %8s %8s\n", "modo", "pedidos", "erros", "conns",
+           "pedidos/s", "MB/s", "p50 ms", "p90 ms", "p99 ms", "máx ms");
+
+    int ok = rodar(&c, "servidor", conns, pedidos);
+    if (ok && conns > 1) ok = rodar(&c, "servidor", 1, pedidos / conns > 0 ? pedidos / conns : 1);
+    if (ok && exec) {
+        c.exec = exec;
+        const int n = pedidos < BENCH_MAX_EXEC ? pedidos : BENCH_MAX_EXEC;
+        ok = rodar(&c, "processo", conns, n);
+        if (ok && conns > 1) ok = rodar(&c, "processo", 1, n / conns > 0 ? n / conns : 1);
+    }
+    return ok ? 0 : 1;
+}
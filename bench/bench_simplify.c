@@ -0,0 +1,149 @@
+/* Benchmark da simplificação da polyline do SVG.
+ *
+ * Para cada curva, renderiza o SVG com e sem simplificação num destino que
+ * só conta bytes: pontos na polyline, tamanho do arquivo e tempo da
+ * simplificação. Também confere a garantia do algoritmo: cada ponto
+ * original fica a no máximo `tol` pixels do segmento simplificado que o
+ * cobre (pixels do canvas 800x600, mesma transformação do render.c).
+ *
+ * Uso: bench_simplify [amostras=500] [tolerância=RENDER_SIMPLIFY_TOLERANCE] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/render.h"
+#include "../include/simplify.h"
+#include "bench_util.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_CANVAS_W 800
+#define BENCH_CANVAS_H 600
+
+static int sink_contador(void *ctx, const char *data, size_t n) {
+    (void)ctx;
+    (void)data;
+    (void)n;
+    return 1;
+}
+
+static size_t tamanho_svg(const PlotData *data, const char *titulo, double tol, RenderStats *stats) {
+    OutBuf ob;
+    if (!outbuf_init_sink(&ob, sink_contador, NULL, 0)) return 0;
+    render_svg_out(&ob, data, titulo, BENCH_CANVAS_W, BENCH_CANVAS_H, tol, stats);
+    outbuf_close(&ob);
+    return ob.written;
+}
+
+/* Distância de P ao segmento AB */
+static double distancia(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay;
+    double l2 = dx * dx + dy * dy;
+    double u = l2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / l2 : 0.0;
+    if (u < 0) u = 0;
+    if (u > 1) u = 1;
+    double ex = ax + u * dx - px, ey = ay + u * dy - py;
+    return sqrt(ex * ex + ey * ey);
+}
+
+/* Pixels dos pontos válidos, como em render_svg_out. Retorna quantos. */
+static int pixels(const PlotData *d, double *px, double *py) {
+    double minx = d->x[0], maxx = d->x[0], miny = d->y[0], maxy = d->y[0];
+    for (int i = 1; i < d->count; i++) {
+        double x = d->x[i], y = d->y[i];
+        if (!isfinite(x) || fabs(x) > 1e6 || !isfinite(y) || fabs(y) > 1e6) continue;
+        if (x < minx) minx = x;
+        if (x > maxx) maxx = x;
+        if (y < miny) miny = y;
+        if (y > maxy) maxy = y;
+    }
+    double rangex = maxx - minx, rangey = maxy - miny;
+    if (rangex < 0.01) rangex = 1.0;
+    if (rangey < 0.01) rangey = 1.0;
+
+    int n = 0;
+    for (int i = 0; i < d->count; i++) {
+        double x = d->x[i], y = d->y[i];
+        if (!isfinite(x) || !isfinite(y)) continue;
+        if (x < minx || x > maxx || y < miny || y > maxy) continue;
+        px[n] = BENCH_CANVAS_W * 0.1 + (x - minx) * BENCH_CANVAS_W * 0.8 / rangex;
+        py[n] = BENCH_CANVAS_H * 0.9 - (y - miny) * BENCH_CANVAS_H * 0.8 / rangey;
+        n++;
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : PLOT_DEFAULT_SAMPLES;
+    double tol = (argc > 2) ? atof(argv[2]) : RENDER_SIMPLIFY_TOLERANCE;
+    if (amostras < 2) amostras = 2;
+
+    long tot_in = 0, tot_out = 0;
+    double bytes_antes = 0, bytes_depois = 0, tempo = 0, pior = 0;
+    int curvas = 0, violacoes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s %8s %8s %10s %10s %8s %7s   (tol %.2f px, %d amostras)\n", "curva", "pontos",
+           "escritos", "bytes", "bytes simp", "erro px", "ns/pt", tol, amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+        PlotData *data = plot_generate_samples(plot, NULL);
+        plot_free(plot);
+        if (!data || data->count == 0) {
+            plot_data_free(data);
+            continue;
+        }
+
+        RenderStats antes, depois;
+        size_t b0 = tamanho_svg(data, linha, 0.0, &antes);
+        size_t b1 = tamanho_svg(data, linha, tol, &depois);
+
+        double *px = malloc(data->count * sizeof(double));
+        double *py = malloc(data->count * sizeof(double));
+        int *keep = malloc(data->count * sizeof(int));
+        int n = pixels(data, px, py);
+
+        double inicio = agora();
+        int m = simplify_polyline(px, py, n, tol, keep);
+        double ns = n > 0 ? (agora() - inicio) * 1e9 / n : 0.0;
+
+        // Cada ponto original contra o segmento simplificado que o cobre
+        double erro = 0.0;
+        for (int s = 0; s + 1 < m; s++) {
+            for (int i = keep[s] + 1; i < keep[s + 1]; i++) {
+                double e = distancia(px[i], py[i], px[keep[s]], py[keep[s]], px[keep[s + 1]], py[keep[s + 1]]);
+                if (e > erro) erro = e;
+            }
+        }
+        int viola = erro > tol * (1 + 1e-9) + 1e-9;
+
+        printf("%-44.44s %8d %8d %10zu %10zu %8.3f %7.1f%s\n", linha, antes.points_out,
+               depois.points_out, b0, b1, erro, ns, viola ? "   (acima da tolerância!)" : "");
+
+        tot_in += antes.points_out;
+        tot_out += depois.points_out;
+        bytes_antes += b0;
+        bytes_depois += b1;
+        tempo += ns * n;
+        if (erro > pior) pior = erro;
+        violacoes += viola;
+        curvas++;
+
+        free(px);
+        free(py);
+        free(keep);
+        plot_data_free(data);
+    }
+
+    printf("%-44s %8ld %8ld %10.0f %10.0f %8.3f\n", "TOTAL", tot_in, tot_out, bytes_antes, bytes_depois, pior);
+    printf("pontos: %.1f%% mantidos; SVG: %.1f%% do tamanho; simplificação: %.1f ns/ponto\n",
+           tot_in ? 100.0 * tot_out / tot_in : 0.0, bytes_antes ? 100.0 * bytes_depois / bytes_antes : 0.0,
+           tot_in ? tempo / tot_in : 0.0);
+    printf("%d curvas, %d acima da tolerância\n", curvas, violacoes);
+    return violacoes ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/* Benchmark da renderização em fluxo (stream.h) contra a geração inteira.
+ *
+ * Para cada curva, com N amostras da grade uniforme, cada medida roda num
+ * processo filho (fork), para que o pico de memória (ru_maxrss do wait4) seja
+ * só dela:
+ *   - normal: plot_generate_samples + render_svg_out/render_csv_out
+ *   - fluxo:  stream_render com a caixa da pré-passada
+ *   - fluxo com viewport = caixa da geração inteira (tem de dar o mesmo SVG)
+ * A saída vai para um OutBuf que só calcula um hash (FNV-1a) dos bytes: o
+ * CSV em fluxo e o SVG com a caixa exata precisam sair idênticos aos da
+ * geração inteira.
+ *
+ * Uso: bench_stream [amostras=1000000] < curvas.txt
+ */
+#define _DEFAULT_SOURCE
+
+#include "../include/multicurvas_plot.h"
+#include "../include/render.h"
+#include "../include/stream.h"
+#include "bench_util.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/* O que o filho manda de volta pelo pipe */
+typedef struct {
+    int ok;
+    double segundos;
+    uint64_t hash;
+    size_t bytes;
+    RenderBounds caixa;     /* Da geração inteira (modo normal) */
+} Resultado;
+
+static int hash_sink(void *ctx, const char *data, size_t n) {
+    uint64_t *h = ctx;
+    for (size_t i = 0; i < n; i++) {
+        *h ^= (unsigned char)data[i];
+        *h *= 1099511628211ULL;
+    }
+    return 1;
+}
+
+static void gerar(const char *linha, int amostras, RenderFormat formato, int fluxo,
+                  const RenderBounds *viewport, Resultado *r) {
+    Plot *plot = plot_parse_text(linha, NULL);
+    if (!plot) return;
+    plot->samples = amostras;
+
+    uint64_t hash = 14695981039346656037ULL;
+    OutBuf out;
+    if (!outbuf_init_sink(&out, hash_sink, &hash, 0)) return;
+
+    const double inicio = agora();
+    if (fluxo) {
+        StreamOptions opcoes = { 0, 0, viewport, RENDER_SIMPLIFY_TOLERANCE };
+        r->ok = stream_render(&out, plot, formato, linha, 800, 600, &opcoes, NULL, NULL);
+    } else {
+        PlotData *data = plot_generate_samples(plot, NULL);
+        r->ok = data != NULL;
+        if (data && data->count > 0) {
+            render_bounds(data, &r->caixa);
+            if (formato == RENDER_CSV) {
+                render_csv_out(&out, data);
+            } else {
+                render_svg_out(&out, data, linha, 800, 600, RENDER_SIMPLIFY_TOLERANCE, NULL);
+            }
+        } else {
+            r->ok = 0;
+        }
+        plot_data_free(data);
+    }
+    outbuf_close(&out);
+    r->segundos = agora() - inicio;
+    r->hash = hash;
+    r->bytes = out.written;
+    plot_free(plot);
+}
+
+/* gerar() num processo filho; *pico recebe o ru_maxrss dele, em MB. */
+static int medir(const char *linha, int amostras, RenderFormat formato, int fluxo,
+                 const RenderBounds *viewport, Resultado *r, double *pico) {
+    memset(r, 0, sizeof(*r));
+    int canal[2];
+    if (pipe(canal) != 0) return 0;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(canal[0]);
+        close(canal[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        close(canal[0]);
+        Resultado filho;
+        memset(&filho, 0, sizeof(filho));
+        gerar(linha, amostras, formato, fluxo, viewport, &filho);
+        ssize_t escritos = write(canal[1], &filho, sizeof(filho));
+        _exit(escritos == (ssize_t)sizeof(filho) ? 0 : 1);
+    }
+    close(canal[1]);
+    ssize_t lidos = read(canal[0], r, sizeof(*r));
+    close(canal[0]);
+
+    int status = 0;
+    struct rusage uso;
+    if (wait4(pid, &status, 0, &uso) != pid) return 0;
+    *pico = uso.ru_maxrss / 1024.0;
+    return lidos == (ssize_t)sizeof(*r) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && r->ok;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 1000000;
+    if (amostras < 2) amostras = 2;
+
+    double t_normal = 0, t_fluxo = 0, t_csv_normal = 0, t_csv_fluxo = 0;
+    double pico_normal = 0, pico_fluxo = 0;
+    int curvas = 0, divergentes = 0, falhas = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-40s %9s %9s %9s %9s %8s %8s  (%d amostras)\n", "curva", "svg (s)", "fluxo", "csv (s)",
+           "fluxo", "pico MB", "fluxo", amostras);
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Resultado svg, svg_fluxo, svg_caixa, csv, csv_fluxo;
+        double p_svg, p_fluxo, p_caixa, p_csv, p_csv_fluxo;
+        if (!medir(linha, amostras, RENDER_SVG, 0, NULL, &svg, &p_svg)) {
+            falhas++;
+            continue;
+        }
+        const int ok = medir(linha, amostras, RENDER_SVG, 1, NULL, &svg_fluxo, &p_fluxo) &&
+                       medir(linha, amostras, RENDER_SVG, 1, &svg.caixa, &svg_caixa, &p_caixa) &&
+                       medir(linha, amostras, RENDER_CSV, 0, NULL, &csv, &p_csv) &&
+                       medir(linha, amostras, RENDER_CSV, 1, NULL, &csv_fluxo, &p_csv_fluxo);
+        if (!ok) {
+            falhas++;
+            continue;
+        }
+
+        const int diverge = svg_caixa.hash != svg.hash || svg_caixa.bytes != svg.bytes ||
+                            csv_fluxo.hash != csv.hash || csv_fluxo.bytes != csv.bytes;
+        const double pn = p_svg > p_csv ? p_svg : p_csv;
+        double pf = p_fluxo > p_caixa ? p_fluxo : p_caixa;
+        if (p_csv_fluxo > pf) pf = p_csv_fluxo;
+        printf("%-40.40s %9.3f %9.3f %9.3f %9.3f %8.1f %8.1f%s\n", linha, svg.segundos, svg_fluxo.segundos,
+               csv.segundos, csv_fluxo.segundos, pn, pf, diverge ? "   (saída diferente!)" : "");
+
+        t_normal += svg.segundos;
+        t_fluxo += svg_fluxo.segundos;
+        t_csv_normal += csv.segundos;
+        t_csv_fluxo += csv_fluxo.segundos;
+        if (pn > pico_normal) pico_normal = pn;
+        if (pf > pico_fluxo) pico_fluxo = pf;
+        divergentes += diverge;
+        curvas++;
+    }
+
+    printf("%-40s %9.3f %9.3f %9.3f %9.3f %8.1f %8.1f\n", "TOTAL (pico: maior)", t_normal, t_fluxo,
+           t_csv_normal, t_csv_fluxo, pico_normal, pico_fluxo);
+    printf("svg: fluxo %.2fx do tempo; csv: %.2fx; pico de memória %.1f MB -> %.1f MB\n",
+           t_normal > 0 ? t_fluxo / t_normal : 0.0, t_csv_normal > 0 ? t_csv_fluxo / t_csv_normal : 0.0,
+           pico_normal, pico_fluxo);
+    printf("%d curvas, %d com saída diferente (csv, svg com a caixa exata), %d falhas\n", curvas, divergentes,
+           falhas);
+    return divergentes ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/* Benchmark da varredura de parâmetros livres (plot_generate_frames).
+ *
+ * Para cada família da tabela, os N quadros de duas maneiras:
+ *   - reanálise: o texto da curva refeito a cada quadro, com o valor do
+ *     parâmetro no lugar do nome ("%.17g"), e uma geração inteira (parse,
+ *     compilação e amostragem) por quadro;
+ *   - varredura: uma compilação e os quadros com os parâmetros trocados por
+ *     constantes, em 1 thread e em todas as CPUs.
+ * Mostra o tempo de cada uma, as compilações e avaliações do Stats (o binário
+ * precisa ser compilado sem MULTICURVAS_NO_STATS) e o maior desvio relativo
+ * de um ponto da varredura em relação à reanálise.
+ *
+ * Sai com erro se as amostras válidas de algum quadro diferem ou se algum
+ * ponto desviou mais que DESVIO_MAXIMO: a varredura desenha o mesmo que a
+ * curva escrita com o valor.
+ *
+ * Uso: bench_sweep [quadros=100] [amostras=20000]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "../include/stats.h"
+#include "bench_util.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DESVIO_MAXIMO 1e-12
+
+typedef struct {
+    const char *nome;
+    const char *curva;
+    const char *params[3];  /* "nome=de,até"; NULL no fim */
+} Familia;
+
+static const Familia FAMILIAS[] = {
+    { "rosa", "R=sin(k*t):0,2*pi:", { "k=1,8" } },
+    { "lissajous", "X=sin(a*t);Y=sin(b*t):0,2*pi:", { "a=1,3", "b=2,5" } },
+    { "epicicloide", "X=(k+1)*cos(t)-cos((k+1)*t);Y=(k+1)*sin(t)-sin((k+1)*t):0,2*pi:", { "k=1,6" } },
+    { "espiral", "R=t^k:0,4*pi:", { "k=0.5,2" } },
+    { "cardioide", "R=a*(1+cos(t))+b:0,2*pi:", { "a=0.5,2", "b=0,1" } },
+    { "potencias", "Y=x^k+k*x:-2,2:", { "k=1,6" } },
+};
+
+#define NUM_FAMILIAS ((int)(sizeof(FAMILIAS) / sizeof(FAMILIAS[0])))
+
+/* `curva` com cada identificador igual ao nome de um parâmetro trocado pelo
+ * seu valor no quadro, entre parênteses */
+static int substituir(const char *curva, const PlotParam *params, int n, int quadro, int quadros,
+                      char *saida, size_t tamanho) {
+    size_t o = 0;
+    for (const char *p = curva; *p;) {
+        if (isalpha((unsigned char)*p)) {
+            const char *fim = p;
+            while (isalnum((unsigned char)*fim)) fim++;
+            const size_t len = (size_t)(fim - p);
+            int k = 0;
+            while (k < n && !(strlen(params[k].name) == len && strncmp(params[k].name, p, len) == 0)) k++;
+            int w;
+            if (k < n) {
+                w = snprintf(saida + o, tamanho - o, "(%.17g)", plot_param_value(&params[k], quadro, quadros));
+            } else {
+                w = snprintf(saida + o, tamanho - o, "%.*s", (int)len, p);
+            }
+            if (w < 0 || (size_t)w >= tamanho - o) return 0;
+            o += (size_t)w;
+            p = fim;
+            continue;
+        }
+        if (o + 1 >= tamanho) return 0;
+        saida[o++] = *p++;
+    }
+    saida[o] = '\0';
+    return 1;
+}
+
+/* Quadros pela reanálise do texto, em data[0..quadros) */
+static int reanalisar(const Familia *f, const PlotParam *params, int n, int quadros, int amostras,
+                      PlotData *data) {
+    char linha[BENCH_MAX_LINE];
+    for (int q = 0; q < quadros; q++) {
+        if (!substituir(f->curva, params, n, q, quadros, linha, sizeof(linha))) return 0;
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) return 0;
+        plot->samples = amostras;
+        plot->threads = 1;
+        PlotData *d = plot_generate_samples(plot, NULL);
+        plot_free(plot);
+        if (!d) return 0;
+        data[q] = *d;
+        free(d);
+    }
+    return 1;
+}
+
+static int varrer(const Familia *f, const PlotParam *params, int n, int quadros, int amostras, int threads,
+                  PlotData *data) {
+    Plot *plot = plot_parse_text(f->curva, NULL);
+    if (!plot) return 0;
+    plot->samples = amostras;
+    plot->threads = threads;
+    memcpy(plot->params, params, (size_t)n * sizeof(PlotParam));
+    plot->n_params = n;
+    char *errmsg = NULL;
+    const int ok = plot_generate_frames(plot, quadros, data, &errmsg);
+    if (!ok) fprintf(stderr, "%s: %s\n", f->nome, errmsg ? errmsg : "erro");
+    free(errmsg);
+    plot_free(plot);
+    return ok;
+}
+
+/* Maior desvio relativo entre os pontos de `a` e `b`; -1 se as amostras
+ * válidas diferem */
+static double desvio(const PlotData *a, const PlotData *b) {
+    if (a->count != b->count || a->evaluations != b->evaluations ||
+        memcmp(a->valid, b->valid, ((size_t)a->evaluations + 7) / 8) != 0) {
+        return -1;
+    }
+    double pior = 0;
+    for (int i = 0; i < a->count; i++) {
+        const double ex = fabs(a->x[i] - b->x[i]) / fmax(1.0, fmax(fabs(a->x[i]), fabs(b->x[i])));
+        const double ey = fabs(a->y[i] - b->y[i]) / fmax(1.0, fmax(fabs(a->y[i]), fabs(b->y[i])));
+        const double d = fmax(ex, ey);
+        if (!(d <= pior)) pior = d;
+    }
+    return pior;
+}
+
+static void liberar(PlotData *data, int quadros) {
+    for (int q = 0; q < quadros; q++) plot_data_release(&data[q]);
+}
+
+int main(int argc, char **argv) {
+    int quadros = (argc > 1) ? atoi(argv[1]) : 100;
+    int amostras = (argc > 2) ? atoi(argv[2]) : 20000;
+    if (quadros < 2) quadros = 2;
+    if (amostras < 2) amostras = 2;
+    const int cpus = plot_thread_count(PLOT_THREADS_AUTO);
+
+    PlotData *texto = calloc((size_t)quadros, sizeof(PlotData));
+    PlotData *um = calloc((size_t)quadros, sizeof(PlotData));
+    PlotData *todas = calloc((size_t)quadros, sizeof(PlotData));
+    if (!texto || !um || !todas) return 1;
+
+    printf("%-12s %9s %6s %9s %6s %9s %6s %7s %11s %9s  (%d quadros, %d amostras, %d threads)\n", "família",
+           "texto ms", "comp.", "1 thr ms", "comp.", "N thr ms", "ganho", "ganho N", "avaliações", "desvio",
+           quadros, amostras, cpus);
+
+    double t_texto = 0, t_um = 0, t_todas = 0, pior = 0;
+    int divergentes = 0, falhas = 0;
+    for (int i = 0; i < NUM_FAMILIAS; i++) {
+        const Familia *f = &FAMILIAS[i];
+        PlotParam params[PLOT_MAX_PARAMS];
+        int n = 0;
+        while (n < 3 && f->params[n]) {
+            if (!plot_param_parse(f->params[n], &params[n], NULL)) break;
+            n++;
+        }
+
+        Stats st_texto = { 0 }, st_um = { 0 }, st_todas = { 0 };
+        plot_cache_clear();
+        stats_attach(&st_texto);
+        double inicio = agora();
+        int ok = reanalisar(f, params, n, quadros, amostras, texto);
+        const double s_texto = agora() - inicio;
+        stats_detach();
+
+        plot_cache_clear();
+        stats_attach(&st_um);
+        inicio = agora();
+        ok = ok && varrer(f, params, n, quadros, amostras, 1, um);
+        const double s_um = agora() - inicio;
+        stats_detach();
+
+        plot_cache_clear();
+        stats_attach(&st_todas);
+        inicio = agora();
+        ok = ok && varrer(f, params, n, quadros, amostras, PLOT_THREADS_AUTO, todas);
+        const double s_todas = agora() - inicio;
+        stats_detach();
+
+        if (!ok) {
+            printf("%-12s falhou\n", f->nome);
+            falhas++;
+            liberar(texto, quadros);
+            liberar(um, quadros);
+            liberar(todas, quadros);
+            continue;
+        }
+
+        double d = 0;
+        for (int q = 0; q < quadros && d >= 0; q++) {
+            const double a = desvio(&texto[q], &um[q]);
+            const double b = desvio(&um[q], &todas[q]);
+            if (a < 0 || b != 0) {
+                d = -1;
+            } else if (a > d) {
+                d = a;
+            }
+        }
+        const int diverge = d < 0 || d > DESVIO_MAXIMO;
+        printf("%-12s %9.2f %6lu %9.2f %6lu %9.2f %5.1fx %6.1fx %11lu ", f->nome, s_texto * 1e3,
+               st_texto.calls[STATS_COMPILE], s_um * 1e3, st_um.calls[STATS_COMPILE], s_todas * 1e3,
+               s_texto / s_um, s_texto / s_todas, st_um.evaluations);
+        if (d < 0) {
+            printf("%9s", "amostras");
+        } else {
+            printf("%9.2g", d);
+        }
+        printf("%s\n", diverge ? "  DIVERGE" : "");
+
+        t_texto += s_texto;
+        t_um += s_um;
+        t_todas += s_todas;
+        divergentes += diverge;
+        if (d > pior) pior = d;
+        liberar(texto, quadros);
+        liberar(um, quadros);
+        liberar(todas, quadros);
+    }
+    free(texto);
+    free(um);
+    free(todas);
+
+    if (t_um > 0 && t_todas > 0) {
+        printf("\ntotal: reanálise %.1f ms, varredura %.1f ms em 1 thread (%.2fx), %.1f ms em %d (%.2fx)\n",
+               t_texto * 1e3, t_um * 1e3, t_texto / t_um, t_todas * 1e3, cpus, t_texto / t_todas);
+    }
+    printf("maior desvio relativo: %.2g; %d famílias divergentes, %d falharam\n", pior, divergentes, falhas);
+    return (divergentes || falhas) ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/* Benchmark da geração de amostras em várias threads.
+ *
+ * Gera cada curva com 1, 2, 4, ... threads e compara o PlotData com o de uma
+ * thread só: x, y, t e a máscara valid têm de ser idênticos bit a bit.
+ *
+ * Uso: bench_threads [amostras=1000000] [threads máx.=8] < curvas.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/multicurvas_plot.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_CONFIGS 8
+
+static int mesmos_dados(const PlotData *a, const PlotData *b) {
+    if (a->count != b->count || a->evaluations != b->evaluations) return 0;
+    return memcmp(a->x, b->x, a->count * sizeof(double)) == 0 &&
+           memcmp(a->y, b->y, a->count * sizeof(double)) == 0 &&
+           memcmp(a->t, b->t, a->count * sizeof(double)) == 0 &&
+           memcmp(a->valid, b->valid, ((size_t)a->evaluations + 7) / 8) == 0;
+}
+
+int main(int argc, char **argv) {
+    int amostras = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : 8;
+    if (amostras < 2) amostras = 2;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > PLOT_MAX_THREADS) max_threads = PLOT_MAX_THREADS;
+
+    int threads[BENCH_MAX_CONFIGS];
+    int configs = 0;
+    for (int t = 1; t <= max_threads && configs < BENCH_MAX_CONFIGS; t *= 2) threads[configs++] = t;
+
+    double total[BENCH_MAX_CONFIGS] = { 0 };
+    int curvas = 0, divergentes = 0;
+    char linha[BENCH_MAX_LINE];
+
+    printf("%-44s", "curva");
+    for (int c = 0; c < configs; c++) printf(" %7d th", threads[c]);
+    printf("   (ms, %d amostras, %d CPUs)\n", amostras, plot_thread_count(PLOT_THREADS_AUTO));
+
+    while (ler_linha(stdin, linha, sizeof(linha))) {
+        Plot *plot = plot_parse_text(linha, NULL);
+        if (!plot) continue;
+        plot->samples = amostras;
+
+        PlotData *ref = NULL;
+        double ms[BENCH_MAX_CONFIGS];
+        int diverge = 0;
+        for (int c = 0; c < configs; c++) {
+            plot->threads = threads[c];
+            double inicio = agora();
+            PlotData *data = plot_generate_samples(plot, NULL);
+            ms[c] = (agora() - inicio) * 1e3;
+            if (!data) {
+                diverge = 1;
+                continue;
+            }
+            if (!ref) {
+                ref = data;
+                continue;
+            }
+            diverge |= !mesmos_dados(ref, data);
+            plot_data_free(data);
+        }
+        plot_data_free(ref);
+        plot_free(plot);
+
+        divergentes += diverge;
+        curvas++;
+        printf("%-44.44s", linha);
+        for (int c = 0; c < configs; c++) {
+            total[c] += ms[c];
+            printf(" %10.2f", ms[c]);
+        }
+        printf("%s\n", diverge ? "   (saída diverge!)" : "");
+    }
+
+    printf("%-44s", "TOTAL");
+    for (int c = 0; c < configs; c++) printf(" %10.2f", total[c]);
+    printf("\n%-44s", "speedup vs 1 thread");
+    for (int c = 0; c < configs; c++) printf(" %9.2fx", total[c] > 0 ? total[0] / total[c] : 0.0);
+    printf("\n%d curvas, %d com saída divergente\n", curvas, divergentes);
+    return divergentes ? 1 : 0;
+}
@@ -0,0 +1,54 @@
+/* Utilitários comuns dos benchmarks (bench/bench_*.c).
+ *
+ * Os benchmarks que leem curvas as recebem pela entrada padrão, uma por
+ * linha, na sintaxe da CLI; os alvos `make bench-*` alimentam com as 77
+ * curvas de gerar_77_curvas.sh. Cada benchmark é um executável de um .c só,
+ * então tudo aqui é static inline (o que um deles não usa não gera código
+ * nem aviso). Quem inclui define _POSIX_C_SOURCE antes (clock_gettime).
+ */
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_LINE 512
+
+/* Relógio monotônico, em segundos. */
+static inline double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Ordem crescente de doubles, para o qsort. */
+static inline int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentil p (0..1) de v[0..n) já ordenado: o valor na posição p*(n-1),
+ * arredondada. */
+static inline double percentil(const double *v, int n, double p) {
+    int k = (int)(p * (n - 1) + 0.5);
+    return v[k];
+}
+
+/* Mediana de v[0..n) já ordenado (média dos dois do meio se n é par). */
+static inline double mediana(const double *v, int n) {
+    return (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+/* Próxima linha não vazia de `f` em linha[0..tamanho), sem o "\r\n".
+ * Retorna 0 no fim da entrada. */
+static inline int ler_linha(FILE *f, char *linha, int tamanho) {
+    while (fgets(linha, tamanho, f)) {
+        linha[strcspn(linha, "\r\n")] = '\0';
+        if (linha[0]) return 1;
+    }
+    return 0;
+}
+
+#endif /* BENCH_UTIL_H */
@@ -1,6 +1,7 @@
 #!/bin/bash
 # Script para gerar as 77 curvas do programa original ZX81 CURVAS
 # Baseado em Referencia/Curvas.txt
+# Mesmas curvas num processo só: make originais (originais.manifest)
 
 EXEC="./build/multicurvas"
 OUTDIR="originais"
@@ -11,45 +11,61 @@ echo "=== Gerando curvas de teste ==="
 echo
 
 # Teste 1: Parábola simples
-echo "[1/10] Parábola..."
+echo "[1/14] Parábola..."
 $EXEC "Y=x*x" svg > "$OUTDIR/01_parabola.svg"
 
 # Teste 2: Seno
-echo "[2/10] Seno..."
+echo "[2/14] Seno..."
 $EXEC "Y=sin(x)" svg > "$OUTDIR/02_seno.svg"
 
 # Teste 3: Círculo (polar)
-echo "[3/10] Círculo..."
+echo "[3/14] Círculo..."
 $EXEC "R=5" svg > "$OUTDIR/03_circulo.svg"
 
 # Teste 4: Espiral de Arquimedes
-echo "[4/10] Espiral de Arquimedes..."
+echo "[4/14] Espiral de Arquimedes..."
 $EXEC "R=t" svg > "$OUTDIR/04_espiral.svg"
 
 # Teste 5: Rosa de 4 pétalas
-echo "[5/10] Rosa de 4 pétalas..."
+echo "[5/14] Rosa de 4 pétalas..."
 $EXEC "R=sin(2*t)" svg > "$OUTDIR/05_rosa4.svg"
 
 # Teste 6: Lemniscata de Bernoulli
-echo "[6/10] Lemniscata..."
+echo "[6/14] Lemniscata..."
 $EXEC "R**2=cos(2*t)" svg > "$OUTDIR/06_lemniscata.svg"
 
 # Teste 7: Círculo paramétrico
-echo "[7/10] Círculo paramétrico..."
+echo "[7/14] Círculo paramétrico..."
 $EXEC "X=3*cos(t);Y=3*sin(t)" svg > "$OUTDIR/07_circulo_param.svg"
 
 # Teste 8: Hipérbole com intervalo customizado
-echo "[8/10] Hipérbole (intervalo custom)..."
+echo "[8/14] Hipérbole (intervalo custom)..."
 $EXEC "Y=1/x:-5,5:" svg > "$OUTDIR/08_hiperbole.svg"
 
 # Teste 9: Função exponencial decrescente
-echo "[9/10] Exponencial..."
+echo "[9/14] Exponencial..."
 $EXEC "Y=exp(-x/3)" svg > "$OUTDIR/09_exponencial.svg"
 
 # Teste 10: Lissajous (3:2)
-echo "[10/10] Curva de Lissajous..."
+echo "[10/14] Curva de Lissajous..."
 $EXEC "X=sin(3*t);Y=sin(2*t)" svg > "$OUTDIR/10_lissajous.svg"
 
+# Teste 11: Folium de Descartes (implícita)
+echo "[11/14] Folium de Descartes (implícita)..."
+$EXEC "x^3+y^3=6*x*y:-5,5:" svg > "$OUTDIR/11_folium_implicita.svg"
+
+# Teste 12: Estrofoide (implícita, laço e ramos abertos)
+echo "[12/14] Estrofoide (implícita)..."
+$EXEC "x*(x*x+y*y)+3*(x*x-y*y)=0:-5,5:" svg > "$OUTDIR/12_estrofoide_implicita.svg"
+
+# Teste 13: Cissoide de Diocles (implícita, com cúspide)
+echo "[13/14] Cissoide (implícita)..."
+$EXEC "F=y^2*(2-x)-x^3:-5,5:" svg > "$OUTDIR/13_cissoide_implicita.svg"
+
+# Teste 14: Cruciforme (implícita, quatro ramos)
+echo "[14/14] Cruciforme (implícita)..."
+$EXEC "x*x*y*y=x*x+y*y:-5,5:" svg > "$OUTDIR/14_cruciforme_implicita.svg"
+
 echo
 echo "✓ Todos os SVGs gerados em $OUTDIR/"
 ls -lh "$OUTDIR"/*.svg
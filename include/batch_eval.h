@@ -0,0 +1,218 @@
+/* Avaliação em lote (vetorizada) de expressões RPN do Abaco.
+ *
+ * O avaliador escalar da lib (`evaluator_eval_rpn`) refaz o despacho de
+ * tokens, a montagem da pilha e o retorno de `EvalResult` a cada ponto.
+ * Aqui a RPN é "baixada" uma única vez para um `BatchProgram` e executada
+ * sobre blocos de BATCH_BLOCK_SIZE amostras: cada posição da pilha vira uma
+ * coluna de doubles, e cada operação roda um laço simples sobre o bloco
+ * (que o compilador consegue vetorizar).
+ *
+ * FLUXO DE USO:
+ * 1. parser_tokenize() + parser_to_rpn() como de costume
+ * 2. batch_compile() → BatchProgram
+ * 3. batch_eval() com um array de valores de t → arrays de valores e erros
+ * 4. batch_free()
+ *
+ * Semântica de erro: idêntica à do avaliador escalar. Lanes que produzem
+ * qualquer valor não finito (NaN/Inf) em algum passo são reavaliadas com
+ * `evaluator_eval_rpn`, que é quem decide o `EvalError` final.
+ *
+ * Valores: sin, cos, exp e log passam pelos kernels SIMD de vecmath.h e podem
+ * diferir da libm em até 2 ULP (ver limites documentados lá).
+ */
+#ifndef BATCH_EVAL_H
+#define BATCH_EVAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "parser.h"
+#include "evaluator.h"
+
+#define BATCH_BLOCK_SIZE 256
+
+/* Variáveis da lib Abaco são no máximo 10 (range de tokens 129-138). Todas
+ * recebem o mesmo valor de t: x, theta e t são aliases no Multicurvas. */
+#define BATCH_MAX_VARIABLES 10
+
+/* Saídas de um programa fundido (paramétrico: X e Y; polar: X, Y e R). */
+#define BATCH_MAX_OUTPUTS 4
+
+typedef enum {
+    BATCH_OP_CONST = 0,  /* slot ← values[arg] */
+    BATCH_OP_VAR,        /* slot ← t (arg: índice da variável na RPN) */
+    BATCH_OP_NEG,        /* slot ← -slot */
+    BATCH_OP_ADD,        /* slot ← slot + slot+1 */
+    BATCH_OP_SUB,
+    BATCH_OP_MUL,
+    BATCH_OP_DIV,
+    BATCH_OP_POW,
+    BATCH_OP_FUNC,       /* slot ← f(slot), f = token arg (libm) */
+    BATCH_OP_CALL,       /* slot ← f(slot) via avaliador escalar (token arg) */
+    BATCH_OP_LOAD,       /* slot ← temp[arg] (subexpressão comum) */
+    BATCH_OP_STORE,      /* temp[arg] ← slot (slot não muda) */
+    BATCH_OP_SINCOS,     /* slot ← sin(slot), temp[arg] ← cos(slot) */
+    BATCH_OP_COSSIN      /* slot ← cos(slot), temp[arg] ← sin(slot) */
+} BatchOpCode;
+
+/* Uma instrução do programa em lote. `slot` é a posição da pilha (coluna)
+ * onde o resultado fica; como a profundidade é conhecida em tempo de
+ * compilação, não há ponteiro de pilha em tempo de execução. */
+typedef struct {
+    uint8_t op;
+    uint8_t slot;
+    uint16_t arg;
+} BatchOp;
+
+typedef struct BatchProgram {
+    const AbacoContext *ctx;  /* Contexto usado na reavaliação escalar */
+    const TokenBuffer *rpn[BATCH_MAX_OUTPUTS];  /* RPN de cada saída (não pertencem ao programa) */
+    int outputs;              /* Número de saídas (1, ou mais se fundido) */
+    int result[BATCH_MAX_OUTPUTS];  /* Temporário com cada saída (-1 = slot 0) */
+    BatchOp *ops;
+    int size;
+    double *values;           /* Constantes (cópia de rpn->values) */
+    int values_size;
+    int depth;                /* Profundidade máxima da pilha (nº de colunas) */
+    int temps;                /* Colunas temporárias (após as da pilha) */
+    TokenBuffer *calls;       /* Mini-programas [var, f] para BATCH_OP_CALL */
+    int calls_size;
+} BatchProgram;
+
+/* Baixa uma RPN validada para um BatchProgram.
+ * Retorna 1 se sucesso, 0 se a RPN contém token não suportado, está mal
+ * formada ou falta memória (nesse caso use o avaliador escalar).
+ * A RPN deve continuar viva enquanto o programa for usado.
+ */
+int batch_compile(const AbacoContext *ctx, const TokenBuffer *rpn, BatchProgram *prog);
+
+/* Compila várias RPNs (até BATCH_MAX_OUTPUTS) num único programa fundido,
+ * que calcula todas as saídas numa só passada. Depois de batch_optimize()
+ * com BATCH_OPT_CSE, termos comuns às saídas (ex.: sin(t) em X e em Y) são
+ * calculados uma vez só. Mesmos retornos de batch_compile(). */
+int batch_compile_multi(const AbacoContext *ctx, const TokenBuffer *const *rpns, int count,
+                        BatchProgram *prog);
+
+/* Avalia o programa para n valores de t.
+ * - values[i]: resultado para t[i] (válido apenas se errors[i] == EVAL_OK)
+ * - errors[i]: mesmo EvalError que evaluator_eval_rpn daria para t[i]
+ * Num programa fundido, devolve só a primeira saída.
+ * Thread-safe: o programa é só lido; a pilha de colunas é local à chamada.
+ */
+void batch_eval(const BatchProgram *prog, const double *t, double *values, EvalError *errors, int n);
+
+/* Avalia todas as saídas de um programa: values[k] / errors[k] recebem a
+ * saída k, com a mesma semântica de batch_eval(). Lanes que caem no caminho
+ * lento são refeitas em todas as saídas, cada uma com a sua RPN. */
+void batch_eval_multi(const BatchProgram *prog, const double *t,
+                      double *const *values, EvalError *const *errors, int n);
+
+/* Avalia a primeira saída com uma coluna por variável do contexto, em vez de
+ * t para todas: vars[k][i] é o valor da variável k na amostra i (nvars
+ * colunas, de 1 a BATCH_MAX_VARIABLES). Mesma semântica de erro de
+ * batch_eval(); a reavaliação escalar recebe os mesmos valores. Usado pelas
+ * curvas implícitas F(x,y) = 0. Roda sempre no motor BLOCK (THREADED e JIT
+ * só sabem ler t), ou no SCALAR se for o atual. */
+void batch_eval_vars(const BatchProgram *prog, const double *const *vars, int nvars,
+                     double *values, EvalError *errors, int n);
+
+/* Prévia (Plot.quality = PLOT_QUALITY_PREVIEW, batch_preview.c): avalia
+ * todas as saídas como batch_eval_multi(), mas em float: o dobro de lanes
+ * por vetor e os kernels em float de vecmath.h. Os valores têm erro relativo
+ * da ordem de 1e-7 por operação (mais o cancelamento que a expressão tiver);
+ * quem precisa de um limite em pixels confere uma parte das amostras no modo
+ * exato (multicurvas_plot.c). Lanes com Inf/NaN em algum passo, inclusive
+ * por overflow do float, são refeitas em double com evaluator_eval_rpn, então
+ * os EvalError são os do modo exato, salvo um valor que é 0 exato em double
+ * e não em float (divisor ou raiz de uma diferença que cancela). Não depende
+ * do motor atual. */
+void batch_eval_preview(const BatchProgram *prog, const double *t,
+                        double *const *values, EvalError *const *errors, int n);
+
+/* Parâmetros livres: variáveis do contexto de índice first..first+count-1
+ * que valem uma constante na avaliação inteira (ex.: k em sin(k*t), com k
+ * varrido de um quadro para o outro). batch_bind() copia `prog` para `out`
+ * trocando cada BATCH_OP_VAR dessas variáveis por um BATCH_OP_CONST com
+ * values[arg - first]; as demais variáveis continuam lendo t. Não passa pelo
+ * parser, pelo compilador nem pelo otimizador: custa uma cópia das
+ * instruções. O caminho lento precisa das mesmas trocas nas RPNs:
+ * batch_bind_rpn() copia uma RPN com os TOKEN_VARIABLE dessas variáveis
+ * como TOKEN_NUMBER, e `rpns` (prog->outputs RPNs assim copiadas, que não
+ * passam a pertencer a `out`) substituem as de `prog`. Liberar `out` com
+ * batch_free() e a RPN com parser_free_buffer(). Retornam 0 se faltou
+ * memória (nada a liberar). */
+int batch_bind(const BatchProgram *prog, int first, const double *values, int count,
+               const TokenBuffer *const *rpns, BatchProgram *out);
+int batch_bind_rpn(const TokenBuffer *rpn, int first, const double *values, int count, TokenBuffer *out);
+
+/* Otimizações de batch_optimize() (combináveis com |):
+ * - FOLD: subárvores constantes viram uma constante, calculada pelo próprio
+ *   avaliador escalar (mesmo valor; subárvores com erro não são dobradas)
+ * - POW:  x^2 vira x*x (expoentes maiores ficam com pow)
+ * - EXP:  e^x vira exp(x) (README: 35% mais rápido)
+ * - CSE:  subexpressões repetidas (ex.: sin(t) usado duas vezes, inclusive
+ *   entre saídas de um programa fundido) são calculadas uma vez e guardadas
+ *   em colunas temporárias; sin(u) e cos(u) do mesmo u viram um BATCH_OP_SINCOS
+ * FOLD e CSE não mudam nenhum bit do resultado e formam BATCH_OPT_ALL. POW
+ * e EXP podem mudar o último bit (o pow da glibc não arredonda sempre
+ * correto: pow(x, 2) às vezes difere de x*x em 1 ULP), então só entram
+ * pedidos à parte. Os erros continuam idênticos: lanes com erro são refeitas
+ * com a RPN original. */
+#define BATCH_OPT_FOLD  0x01
+#define BATCH_OPT_POW   0x02
+#define BATCH_OPT_EXP   0x04
+#define BATCH_OPT_CSE   0x08
+#define BATCH_OPT_ALL   (BATCH_OPT_FOLD | BATCH_OPT_CSE)
+
+/* Reescreve o programa aplicando as otimizações em `flags`.
+ * Retorna 1 se sucesso; 0 se faltou memória (o programa fica intacto). */
+int batch_optimize(BatchProgram *prog, unsigned flags);
+
+/* Imprime o programa em formato legível (debug do bytecode). */
+void batch_dump(const BatchProgram *prog, FILE *out);
+
+/* Motores de execução, escolhidos em tempo de execução. Todos dão os mesmos
+ * EvalError; os valores podem diferir no último bit entre motores (BLOCK usa
+ * os kernels de vecmath.h, os outros a libm).
+ * - BLOCK:    colunas de BATCH_BLOCK_SIZE amostras, `switch` por instrução e
+ *             por bloco (padrão)
+ * - THREADED: ponto a ponto sobre registradores, código threaded (computed
+ *             goto no GCC/Clang), sem checagem de pilha no laço
+ * - SCALAR:   evaluator_eval_rpn da lib Abaco a cada ponto (referência)
+ * - JIT:      código de máquina x86-64 gerado em tempo de execução
+ *             (batch_jit.h); sem JIT na plataforma, cai no BLOCK */
+typedef enum {
+    BATCH_ENGINE_BLOCK = 0,
+    BATCH_ENGINE_THREADED,
+    BATCH_ENGINE_SCALAR,
+    BATCH_ENGINE_JIT
+} BatchEngine;
+
+/* Motor usado por batch_eval() / batch_eval_multi() (global ao processo). */
+void batch_set_engine(BatchEngine engine);
+BatchEngine batch_engine(void);
+
+/* Nome do motor ("block", "threaded", "scalar", "jit"). */
+const char *batch_engine_name(BatchEngine engine);
+
+/* Converte um nome em motor. Retorna 1 se reconhecido, 0 caso contrário. */
+int batch_engine_parse(const char *name, BatchEngine *engine);
+
+/* Motor THREADED com a assinatura de evaluator_eval_rpn (um ponto, valores
+ * por variável). Serve para rodar a suíte de testes da lib Abaco contra ele. */
+EvalResult batch_threaded_eval_rpn(const AbacoContext *ctx, const TokenBuffer *rpn,
+                                   const double *var_values);
+
+/* Libera os buffers internos de um BatchProgram. */
+void batch_free(BatchProgram *prog);
+
+/* Conveniência: compila, otimiza (BATCH_OPT_ALL), avalia e libera. Se a RPN
+ * não puder ser baixada, cai no laço escalar com evaluator_eval_rpn. */
+void batch_eval_rpn(const AbacoContext *ctx, const TokenBuffer *rpn,
+                    const double *t, double *values, EvalError *errors, int n);
+
+/* Idem para várias RPNs avaliadas juntas (batch_compile_multi): values[k] e
+ * errors[k] recebem a saída k. */
+void batch_eval_rpn_multi(const AbacoContext *ctx, const TokenBuffer *const *rpns, int count,
+                          const double *t, double *const *values, EvalError *const *errors, int n);
+
+#endif /* BATCH_EVAL_H */
@@ -0,0 +1,58 @@
+/* Compilação JIT de um BatchProgram para código de máquina x86-64.
+ *
+ * O programa (já otimizado ou não) vira uma função nativa escrita direto numa
+ * página obtida com mmap: cada instrução do lote é traduzida para SSE2 escalar
+ * (movsd/addsd/mulsd/...) sobre um banco de registradores em memória, e as
+ * funções transcendentais chamam a libm. A página é gravada e depois
+ * protegida como só-leitura/execução (nunca W+X ao mesmo tempo).
+ *
+ * Valores: +, -, *, /, neg e cópias são as mesmas operações IEEE dos
+ * interpretadores, então expressões só aritméticas dão exatamente os mesmos
+ * bits. Funções usam a libm, como o motor threaded (bit a bit iguais a ele).
+ * Erros: mesmo esquema do motor threaded (acumulador de v - v); pontos com
+ * Inf/NaN em algum passo são refeitos com evaluator_eval_rpn.
+ *
+ * Fora de x86-64, sem mmap, ou compilado com -DMULTICURVAS_NO_JIT,
+ * batch_jit_available() retorna 0 e o motor BATCH_ENGINE_JIT cai no
+ * interpretador em blocos.
+ */
+#ifndef BATCH_JIT_H
+#define BATCH_JIT_H
+
+#include <stddef.h>
+#include "batch_eval.h"
+
+typedef struct BatchJitCall BatchJitCall;
+
+typedef struct BatchJit {
+    const BatchProgram *prog;  /* Programa de origem (deve continuar vivo) */
+    void *code;                /* Página executável (mmap) */
+    size_t code_size;          /* Tamanho mapeado */
+    double *bank;              /* Banco modelo: registradores, t, chk e constantes */
+    int bank_size;
+    BatchJitCall *calls;       /* Contexto das chamadas ao avaliador (BATCH_OP_CALL) */
+} BatchJit;
+
+/* 1 se o JIT pode ser usado nesta plataforma/build. */
+int batch_jit_available(void);
+
+/* Compila o programa. Retorna 1 se sucesso, 0 se o JIT não está disponível
+ * ou faltou memória (use um dos interpretadores). */
+int batch_jit_compile(const BatchProgram *prog, BatchJit *jit);
+
+/* f(t): primeira saída do programa no ponto t. `error` (se não NULL)
+ * recebe o mesmo EvalError do avaliador escalar. Thread-safe. */
+double batch_jit_eval(const BatchJit *jit, double t, EvalError *error);
+
+/* Versão em lote: values/errors como em batch_eval() (primeira saída). */
+void batch_jit_eval_array(const BatchJit *jit, const double *t, double *values,
+                          EvalError *errors, int n);
+
+/* Todas as saídas, como batch_eval_multi(). Retorna 0 se faltou memória. */
+int batch_jit_eval_multi(const BatchJit *jit, const double *t,
+                         double *const *values, EvalError *const *errors, int n);
+
+/* Libera a página e os buffers do JIT. */
+void batch_jit_free(BatchJit *jit);
+
+#endif /* BATCH_JIT_H */
@@ -0,0 +1,87 @@
+/* Cache LRU de expressões compiladas, compartilhado entre threads.
+ *
+ * Compilar uma curva (tokenizar, checar as variáveis, converter para RPN,
+ * baixar para BatchProgram, otimizar e, com o motor JIT, gerar código) custa
+ * o mesmo que avaliar milhares de pontos. Em modo --batch, ou num servidor,
+ * a mesma curva volta várias vezes só com outro intervalo, outro número de
+ * amostras ou outro canvas: o programa pode ser reaproveitado.
+ *
+ * O cache não sabe o que guarda: cada valor vem com o seu tamanho em bytes
+ * e é destruído pela função passada em exprcache_create(). O chamador
+ * escolhe a chave (ver exprcache_normalize()).
+ *
+ * FLUXO DE USO:
+ * 1. exprcache_get(): se achou, o valor já está pronto
+ * 2. senão, compila e entrega com exprcache_put()
+ * 3. usa exprcache_value() e devolve com exprcache_release()
+ *
+ * Entradas em uso nunca são destruídas: se saem do cache (LRU, limite
+ * diminuído, exprcache_clear), o último exprcache_release() libera o valor.
+ */
+#ifndef EXPRCACHE_H
+#define EXPRCACHE_H
+
+#include <stddef.h>
+
+#define EXPRCACHE_BUCKETS 256     /* Listas da tabela de hash */
+
+typedef struct ExprCache ExprCache;
+typedef struct ExprCacheEntry ExprCacheEntry;
+
+typedef struct {
+    unsigned long hits;       /* exprcache_get() que acharam a chave */
+    unsigned long misses;     /* exprcache_get() que não acharam */
+    unsigned long evictions;  /* Entradas descartadas por falta de espaço */
+    int entries;
+    size_t bytes;             /* Valores + chaves + controle das entradas guardadas */
+    size_t max_bytes;
+    int max_entries;
+} ExprCacheStats;
+
+/* Cria um cache vazio. `liberar` destrói os valores. max_bytes == 0 ou
+ * max_entries == 0 desligam o cache (tudo é falta). Retorna NULL se faltou
+ * memória. */
+ExprCache *exprcache_create(size_t max_bytes, int max_entries, void (*liberar)(void *value));
+
+/* Destrói o cache e os valores. Não pode haver entradas em uso. */
+void exprcache_destroy(ExprCache *cache);
+
+/* Procura `key` e, se achar, marca como a mais recente e retorna a entrada
+ * com uma referência (devolver com exprcache_release). NULL se não achou. */
+ExprCacheEntry *exprcache_get(ExprCache *cache, const char *key);
+
+/* Guarda `value` (de `bytes` bytes) sob `key`, descartando as entradas menos
+ * usadas até caber, e retorna a entrada com uma referência. Se outra thread
+ * guardou a mesma chave antes, `value` é destruído e vale a que já estava. Um
+ * valor maior que o limite não entra no cache, mas a entrada volta mesmo
+ * assim (é liberada no release). NULL se faltou memória (`value` destruído). */
+ExprCacheEntry *exprcache_put(ExprCache *cache, const char *key, void *value, size_t bytes);
+
+void *exprcache_value(const ExprCacheEntry *entry);
+
+/* Atualiza o tamanho de um valor que cresceu ou diminuiu depois do put
+ * (quem chama tem uma referência), descartando as outras entradas menos
+ * usadas até caber. Se só ela já passa do limite, sai do cache (e é liberada
+ * no release). */
+void exprcache_resize(ExprCache *cache, ExprCacheEntry *entry, size_t bytes);
+
+/* Devolve a referência de exprcache_get/exprcache_put. */
+void exprcache_release(ExprCache *cache, ExprCacheEntry *entry);
+
+/* Troca os limites, descartando o que passar deles. */
+void exprcache_set_limits(ExprCache *cache, size_t max_bytes, int max_entries);
+
+/* Descarta todas as entradas (as em uso vivem até o release). Os contadores
+ * continuam. */
+void exprcache_clear(ExprCache *cache);
+
+void exprcache_stats(ExprCache *cache, ExprCacheStats *stats);
+
+/* Texto de `expr` sem os espaços que o tokenizador ignora: some todo espaço
+ * exceto entre dois caracteres de nome/número ("2 x") ou entre dois
+ * operadores ("* *"), onde ele separa tokens. Assim "sin( x ) + 1" e
+ * "sin(x)+1" dão a mesma chave. Grava em `out` (cabe strlen(expr)+1) e
+ * retorna o tamanho. */
+size_t exprcache_normalize(const char *expr, char *out);
+
+#endif /* EXPRCACHE_H */
@@ -0,0 +1,28 @@
+/* Escolha da grade do SVG por "números redondos" (1-2-5).
+ *
+ * O passo das linhas principais sai da faixa visível e do tamanho em pixels
+ * do eixo: o menor 1, 2 ou 5 × 10^k cujas linhas ficam a pelo menos
+ * GRID_MIN_MAJOR_PX pixels uma da outra. Os tics menores dividem o passo em
+ * 5 (passos 1 e 5) ou 4 (passo 2). Assim o número de linhas depende só do
+ * canvas (no máximo ~pixels/12 tics por eixo), não de quão grandes são os
+ * valores da função.
+ */
+#ifndef GRID_H
+#define GRID_H
+
+#define GRID_MIN_MAJOR_PX  60.0
+#define GRID_MAX_TICKS     4096  /* Trava de segurança por eixo */
+
+typedef struct {
+    double major;       /* Passo das linhas principais */
+    double minor;       /* Passo dos tics menores (major / subdivisions) */
+    int subdivisions;
+    long first, last;   /* Tics visíveis: posição k * minor, first <= k <= last;
+                           k múltiplo de subdivisions é linha principal */
+} GridAxis;
+
+/* Calcula a grade de um eixo que mostra [min, max] em `pixels` pixels.
+ * Retorna 1 se sucesso, 0 se a faixa não é finita/positiva (sem grade). */
+int grid_axis(double min, double max, double pixels, GridAxis *axis);
+
+#endif /* GRID_H */
@@ -0,0 +1,66 @@
+/* Contorno de curvas implícitas F(x,y) = 0 por quadtree e marching squares.
+ *
+ * F é avaliada primeiro numa grade de base x base células sobre a caixa;
+ * cada célula em que F muda de sinal entre os cantos (ou em que parte dos
+ * cantos dá erro) é dividida em quatro, nível a nível, até a grade fina de
+ * base * 2^depth células por lado. Só essas células são refinadas, então o
+ * número de avaliações cresce com o comprimento da curva, não com a área:
+ * cada nível pede os pontos novos de todas as células ativas num lote só
+ * (pontos repetidos entre vizinhas são avaliados uma vez), que o chamador
+ * pode dividir entre threads.
+ *
+ * Nas células da grade fina com os quatro cantos válidos, marching squares
+ * corta cada aresta com troca de sinal por interpolação linear (sempre a
+ * partir do canto de menor índice, então as duas células de uma aresta dão
+ * o mesmo ponto bit a bit) e liga as arestas em segmentos; no ponto de sela
+ * a média dos cantos decide. Os segmentos são encadeados pela identidade das
+ * arestas em polylines, abertas (bordas da caixa ou de domínio) ou fechadas
+ * (o último ponto repete o primeiro).
+ *
+ * Limites: uma volta da curva menor que uma célula da base, ou que entra e
+ * sai pela mesma aresta sem troca de sinal nos cantos, não é vista. Um polo
+ * também troca o sinal de F; na grade fina, a célula é descartada se a
+ * variação de F nos cantos não diminuiu em relação à da célula mãe (perto de
+ * um zero liso ela cai pela metade a cada nível; perto de um polo, cresce).
+ *
+ * Com max_evaluations, um nível cujo lote passaria do teto não é avaliado: o
+ * contorno sai das células do último nível que coube (mais grosso que a
+ * grade fina). A grade da base é sempre avaliada; cabe ao chamador escolher
+ * uma base que caiba no teto.
+ */
+#ifndef IMPLICIT_H
+#define IMPLICIT_H
+
+#define IMPLICIT_MAX_DEPTH 12
+
+/* Avalia F nos n pontos (x[i], y[i]): f[i] recebe o valor e ok[i] = 1 se
+ * não houve erro de avaliação. Retorna 0 se faltou memória. */
+typedef int (*ImplicitEval)(void *ctx, const double *x, const double *y, int n, double *f,
+                            unsigned char *ok);
+
+typedef struct {
+    double x0, x1, y0, y1;  /* Caixa (x0 < x1, y0 < y1) */
+    int base;               /* Células por lado da grade inicial (>= 1) */
+    int depth;              /* Divisões até a grade fina (0..IMPLICIT_MAX_DEPTH) */
+    long max_evaluations;   /* Teto de avaliações (0 = sem teto) */
+} ImplicitGrid;
+
+/* Polylines do contorno, uma depois da outra: a polyline k vai dos pontos
+ * start[k] a start[k+1]-1 (start tem lines+1 posições). */
+typedef struct {
+    double *x, *y;
+    int count;
+    int *start;
+    int lines;
+    long evaluations;   /* Pontos da grade avaliados */
+    long cells;         /* Células da grade fina examinadas */
+} ImplicitContour;
+
+/* Contorna F = 0 em `grid`. Retorna 1 se sucesso (o contorno pode ser
+ * vazio), 0 se faltou memória ou `eval` falhou (o contorno fica vazio). */
+int implicit_contour(const ImplicitGrid *grid, ImplicitEval eval, void *ctx, ImplicitContour *out);
+
+/* Libera os arrays de um contorno e o deixa zerado. */
+void implicit_contour_free(ImplicitContour *c);
+
+#endif /* IMPLICIT_H */
@@ -0,0 +1,51 @@
+/* Aritmética intervalar sobre um BatchProgram.
+ *
+ * Em vez de avaliar o programa num valor de t, avalia-o sobre um intervalo
+ * [t0, t1] inteiro: cada coluna da pilha vira um par [lo, hi] e cada
+ * operação devolve um intervalo que contém todos os seus resultados possíveis
+ * (a + b → [a.lo + b.lo, a.hi + b.hi], sin sobre um máximo de π/2 + 2kπ → hi
+ * = 1, e assim por diante). O resultado de cada saída é uma caixa garantida:
+ * f(t) está nela para todo t do intervalo. Os limites são alargados alguns
+ * ULPs para fora a cada passo, o que cobre o arredondamento e o erro dos
+ * kernels de vecmath.h (até 2 ULP).
+ *
+ * Junto com a caixa vem a prova de regularidade: se nenhuma operação pode
+ * sair do domínio, dar infinito ou saltar no intervalo (divisor sem o 0, log
+ * de positivos, tan e floor/ceil longe dos polos e dos inteiros...), então
+ * todas as saídas são contínuas e definidas em todo [t0, t1] e nenhum t dali
+ * dá EvalError. Caso contrário o intervalo "pode ser singular": pode conter
+ * um polo, uma fronteira de domínio ou um salto, ou só ter sido estimado com
+ * folga demais (a caixa cresce com a largura do intervalo e com variáveis
+ * repetidas: t - t dá [-w, w]); dividir ao meio resolve o segundo caso.
+ *
+ * Usado pela amostragem com Plot.interval (multicurvas_plot.h) para não
+ * subdividir trechos provadamente lisos e para isolar polos e saltos.
+ */
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include "batch_eval.h"
+
+typedef struct {
+    double lo, hi;
+} Interval;
+
+/* Resultados de interval_eval() */
+#define INTERVAL_REGULAR      1   /* Saídas contínuas e definidas em todo o intervalo */
+#define INTERVAL_SINGULAR     0   /* Pode ter polo, fronteira de domínio ou salto */
+#define INTERVAL_UNSUPPORTED (-1) /* Programa com operação sem versão intervalar */
+
+/* 1 se interval_eval() sabe avaliar `prog` (todas as operações têm versão
+ * intervalar; BATCH_OP_CALL, como frac, não tem). */
+int interval_supported(const BatchProgram *prog);
+
+/* Colunas de trabalho (Interval) que interval_eval() usa para `prog`. */
+int interval_stack_size(const BatchProgram *prog);
+
+/* Avalia `prog` para t em [t0, t1] (t0 <= t1, finitos). `stack` tem
+ * interval_stack_size(prog) posições. Com INTERVAL_REGULAR, out[k] recebe a
+ * caixa da saída k (prog->outputs saídas); com INTERVAL_SINGULAR, out não é
+ * preenchido. Thread-safe: o programa é só lido. */
+int interval_eval(const BatchProgram *prog, double t0, double t1, Interval *stack, Interval *out);
+
+#endif /* INTERVAL_H */
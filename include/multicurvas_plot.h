@@ -2,7 +2,8 @@
  * Define a estrutura `Plot` e funções para preparar dados de plotagem.
  *
  * FLUXO DE USO:
- * 1. Usuário fornece string: "Y=sin(x):-3,3:" ou "X=cos(t);Y=sin(t):0,6:"
+ * 1. Usuário fornece string: "Y=sin(x):-3,3:", "X=cos(t);Y=sin(t):0,6:" ou
+ *    "x^3+y^3=6*x*y:-5,5:" (implícita, também escrita "F=x^3+y^3-6*x*y")
  * 2. Chama plot_parse_text() → retorna struct Plot com tipo, expressões e intervalo
  * 3. Chama plot_generate_samples() → compila expressões e gera buffer de pontos (x,y)
  * 4. Usa os dados para renderizar (SDL, terminal, arquivo, etc.)
@@ -12,15 +13,107 @@
 #define MULTICURVAS_PLOT_H
 
 #include <stddef.h>
+#include <stdio.h>
+#include "exprcache.h"
 
 #define PLOT_DEFAULT_SAMPLES 500
 
+/* Amostragem adaptativa (Plot.adaptive): a tolerância é medida em pixels de
+ * uma área de PLOT_ADAPTIVE_VIEW_W x PLOT_ADAPTIVE_VIEW_H (a área útil do
+ * SVG padrão de 800x600). */
+#define PLOT_ADAPTIVE_INITIAL     129    /* Grade uniforme inicial */
+#define PLOT_ADAPTIVE_TOLERANCE   0.5    /* Desvio máximo da corda (pixels) */
+#define PLOT_ADAPTIVE_MAX_SAMPLES 4000   /* Limite de avaliações */
+#define PLOT_ADAPTIVE_MAX_DEPTH   16     /* Subdivisões de um intervalo da grade inicial */
+#define PLOT_ADAPTIVE_VIEW_W      640
+#define PLOT_ADAPTIVE_VIEW_H      480
+
+/* Adaptativa guiada por aritmética intervalar (Plot.interval, interval.h):
+ * intervalos que podem conter um polo, uma fronteira de domínio ou um salto
+ * são divididos até a prova de regularidade, até PLOT_INTERVAL_MAX_DEPTH ou
+ * até os dois extremos saírem da tela (no mínimo PLOT_INTERVAL_MIN_DEPTH
+ * divisões); os que sobram viram quebras (pen-up) da curva. */
+#define PLOT_INTERVAL_MIN_DEPTH   4
+#define PLOT_INTERVAL_MAX_DEPTH   32
+
+/* Curvas implícitas (PLOT_IMPLICIT, implicit.h): F é avaliada numa grade de
+ * PLOT_IMPLICIT_BASE x PLOT_IMPLICIT_BASE células sobre [C,D]x[C,D], e só as
+ * células em que F muda de sinal são divididas, até a grade fina de pelo
+ * menos Plot.samples células por lado (PLOT_IMPLICIT_BASE * 2^k).
+ * Plot.max_samples é o teto de avaliações de F (padrão da implícita:
+ * PLOT_IMPLICIT_MAX_SAMPLES): a base diminui até caber nele, e o refinamento
+ * para no último nível que coube. */
+#define PLOT_IMPLICIT_BASE        64
+#define PLOT_IMPLICIT_MAX_SAMPLES 1000000
+
+/* Qualidade da avaliação (Plot.quality). A prévia avalia em float
+ * (batch_eval_preview) e confere no modo exato uma amostra a cada
+ * PLOT_PREVIEW_CHECK_STRIDE, a última de cada lote e as dos extremos de x e
+ * y: se algum ponto conferido se afasta mais de PLOT_PREVIEW_TOLERANCE
+ * pixels de uma área PLOT_ADAPTIVE_VIEW_W x PLOT_ADAPTIVE_VIEW_H com a caixa
+ * dos pontos conferidos até ali, ou muda de válido para erro, o lote é
+ * refeito e a curva segue no modo exato. */
+typedef enum {
+    PLOT_QUALITY_EXACT = 0,   /* double, no motor de batch_set_engine() (padrão) */
+    PLOT_QUALITY_PREVIEW      /* float, conferido em pixels (miniaturas, pré-visualização) */
+} PlotQuality;
+
+#define PLOT_PREVIEW_TOLERANCE    0.1
+#define PLOT_PREVIEW_CHECK_STRIDE 16
+
+/* Nome da qualidade ("exact", "preview") e o inverso: retorna 1 se `name`
+ * é reconhecido, 0 caso contrário. */
+const char *plot_quality_name(PlotQuality quality);
+int plot_quality_parse(const char *name, PlotQuality *quality);
+
+/* Avaliação em paralelo (Plot.threads): cada thread recebe uma fatia
+ * contígua de pelo menos PLOT_PARALLEL_MIN_CHUNK valores de t. */
+#define PLOT_THREADS_AUTO        (-1)   /* Uma thread por CPU */
+#define PLOT_MAX_THREADS         64
+#define PLOT_PARALLEL_MIN_CHUNK  16384
+
+/* Cache de programas compilados (exprcache.h): uma curva já vista (mesmo
+ * tipo e mesmas expressões, a menos de espaços) não passa de novo pelo
+ * parser nem pelo compilador. Limites padrão do processo: */
+#define PLOT_CACHE_MAX_BYTES     (4 * 1024 * 1024)
+#define PLOT_CACHE_MAX_ENTRIES   256
+
+/* Cache de amostras (Plot.incremental, samplecache.h): pontos já avaliados
+ * de cada curva, reaproveitados quando o intervalo muda. */
+#define PLOT_SAMPLE_CACHE_MAX_BYTES   (64 * 1024 * 1024)
+#define PLOT_SAMPLE_CACHE_MAX_CURVES  64
+
+/* Parâmetros livres (Plot.params): nomes além das variáveis da curva (ex.: k
+ * em "R=sin(k*t)"), compilados como variáveis do contexto Abaco (que tem no
+ * máximo 10: sobram 7 depois de x, theta e t) e trocados por constantes a
+ * cada geração, sem compilar de novo (batch_bind(), batch_eval.h). Numa
+ * varredura (plot_generate_frames) o valor vai de `from` a `to` em passos
+ * iguais; com from == to o parâmetro é fixo. */
+#define PLOT_MAX_PARAMS      7
+#define PLOT_PARAM_NAME_MAX  16     /* Com o '\0' */
+
+typedef struct {
+    char name[PLOT_PARAM_NAME_MAX];
+    double from, to;
+} PlotParam;
+
+/* Analisa "nome=valor" (fixo) ou "nome=de,até" (varrido), com os valores na
+ * sintaxe dos extremos do intervalo (3, -pi, 2*pi, 1/3...). O nome é um
+ * identificador que não é variável, função nem constante da curva. Retorna
+ * 1 se válido, senão 0 com a mensagem em *errmsg. */
+int plot_param_parse(const char *text, PlotParam *param, char **errmsg);
+
+/* Valor de `param` no quadro `frame` de `frames` (from no primeiro, to no
+ * último; com um quadro só, from). */
+double plot_param_value(const PlotParam *param, int frame, int frames);
+
 typedef enum {
     PLOT_UNKNOWN = 0,
     PLOT_CARTESIAN,   /* Y = f(x) */
     PLOT_POLAR_R,     /* R = f(t) */
     PLOT_POLAR_R2,    /* R**2 = f(t) */
-    PLOT_PARAMETRIC   /* X = f(t), Y = f(t) */
+    PLOT_PARAMETRIC,  /* X = f(t), Y = f(t) */
+    PLOT_IMPLICIT     /* F(x,y) = 0 */
 } PlotType;
 
 typedef enum {
@@ -31,23 +124,58 @@ typedef enum {
 
 typedef struct Plot {
     PlotType type;
-    char *expr1;    /* Para cartesiano: Y; polar: R ou R**2; paramétrico: X */
+    char *expr1;    /* Para cartesiano: Y; polar: R ou R**2; paramétrico: X; implícita: F */
     char *expr2;    /* Para paramétrico: Y. Caso contrário NULL */
-    double C;       /* Início do domínio/parâmetro */
+    double C;       /* Início do domínio/parâmetro (implícita: da caixa [C,D]x[C,D]) */
     double D;       /* Fim do domínio/parâmetro */
     int has_interval;
-    int samples;    /* número de amostras (padrão: PLOT_DEFAULT_SAMPLES) */
+    int samples;    /* número de amostras (padrão: PLOT_DEFAULT_SAMPLES); implícita: células por lado */
+    int adaptive;   /* 1 = amostragem adaptativa em vez da grade uniforme */
+    double tolerance; /* Adaptativa: tolerância em pixels (padrão: PLOT_ADAPTIVE_TOLERANCE) */
+    int max_samples;  /* Adaptativa e implícita: limite de avaliações (padrão: PLOT_*_MAX_SAMPLES) */
+    int threads;      /* Threads de avaliação (0 ou 1: só a thread atual; PLOT_THREADS_AUTO) */
+    int incremental;  /* 1 = grade diádica e cache de amostras: pan/zoom só avaliam os t novos */
+    int interval;     /* 1 = adaptativa guiada por aritmética intervalar, com a curva em trechos */
+    PlotQuality quality; /* Exata (padrão) ou prévia em float; a implícita é sempre exata */
+    PlotParam params[PLOT_MAX_PARAMS]; /* Parâmetros livres das expressões (nomes distintos) */
+    int n_params;
 } Plot;
 
-/* Buffer de dados prontos para plotagem */
+/* Alinhamento das colunas de PlotData: uma linha de cache, o que também
+ * cobre vetores de até 512 bits */
+#define PLOT_DATA_ALIGN 64
+
+/* Buffer de dados prontos para plotagem.
+ *
+ * Colunas e máscara moram numa única arena alinhada a PLOT_DATA_ALIGN (cada
+ * coluna começa num múltiplo de PLOT_DATA_ALIGN). Os pontos válidos ficam
+ * compactados em ordem de t; `valid` tem um bit por amostra avaliada, na
+ * ordem em que foram avaliadas, e o k-ésimo ponto é a k-ésima amostra com
+ * bit 1. Um PlotData pode ser reaproveitado por plot_generate_samples_into():
+ * a arena só volta ao malloc quando a nova curva não cabe nela.
+ *
+ * Com `segmented`, a curva é uma sequência de trechos: entre dois pontos
+ * seguidos separados por uma amostra com bit 0 (erro, ou a marca que a
+ * amostragem com Plot.interval põe num polo ou salto) a caneta levanta.
+ * Numa curva implícita, cada trecho é uma polyline do contorno e t é só a
+ * posição do ponto na sequência. */
 typedef struct PlotData {
     double *x;      /* Coordenadas X dos pontos */
     double *y;      /* Coordenadas Y dos pontos */
-    int *status;    /* Status de cada ponto (0=OK, 1=erro) */
+    double *t;      /* Parâmetro (x, t ou theta) de cada ponto, crescente */
+    unsigned char *valid; /* Bit i (byte i/8, menos significativo primeiro) = 1 se a
+                             amostra i virou ponto; bits depois de evaluations são 0 */
     int count;      /* Número de pontos válidos */
-    int capacity;   /* Tamanho alocado dos arrays */
+    int capacity;   /* Amostras que cabem na arena */
+    int evaluations; /* Valores de t avaliados (bits de valid) */
+    int segmented;  /* 1 = amostras com bit 0 separam trechos (Plot.interval) */
+    void *arena;    /* Alocação única das colunas; NULL em visões (pointfile.h) */
+    size_t arena_size;
 } PlotData;
 
+/* 1 se a amostra avaliada `i` de `d` virou ponto */
+#define PLOT_DATA_VALID(d, i) (((d)->valid[(i) >> 3] >> ((i) & 7)) & 1)
+
 /* Analisa a string de entrada e aloca um `Plot`.
  * Retorna Plot alocado ou NULL em caso de erro.
  * Se errmsg não for NULL, grava mensagem de erro (caller deve liberar).
@@ -59,14 +187,109 @@ void plot_free(Plot *p);
 
 /* Gera dados de plotagem a partir de um Plot.
  * - Compila as expressões usando o parser/avaliador existente
- * - Gera samples pontos no intervalo [C,D]
- * - Avalia as expressões e preenche arrays x,y
+ * - Gera samples pontos no intervalo [C,D] (ou, com plot->adaptive, parte de
+ *   PLOT_ADAPTIVE_INITIAL pontos e subdivide onde a curva se afasta da corda,
+ *   muda de direção ou entra/sai de uma região com erro; com plot->interval,
+ *   também onde a aritmética intervalar não prova que o trecho é liso, e
+ *   marca os polos e saltos achados como quebras em PlotData.segmented)
+ * - Curva implícita: contorno de F = 0 na caixa [C,D]x[C,D] (implicit.h),
+ *   em trechos (PlotData.segmented); adaptive, interval e incremental não
+ *   se aplicam. Os lotes de cada nível do quadtree usam plot->threads
+ * - Avalia as expressões e preenche arrays x,y (com plot->threads > 1, em
+ *   fatias paralelas; a saída é idêntica à de uma thread só)
  * - Marca pontos com erro de avaliação (divisão por zero, domínio, etc.)
  * Retorna PlotData alocado ou NULL em caso de erro.
  */
 PlotData *plot_generate_samples(const Plot *plot, char **errmsg);
 
+/* Intervalo [C,D] efetivamente amostrado: o padrão do tipo quando o plot
+ * não tem ":C,D:" e, nas curvas polares, já em radianos (mesma escala de
+ * PlotData.t). */
+void plot_interval(const Plot *plot, double *C, double *D);
+
+/* Como plot_generate_samples, mas no PlotData do chamador (zerado ou de uma
+ * geração anterior), reaproveitando a arena se couber. Retorna 1 se
+ * sucesso; em caso de erro o PlotData fica vazio (count 0), ainda válido
+ * para outra geração ou para plot_data_release(). */
+int plot_generate_samples_into(const Plot *plot, PlotData *data, char **errmsg);
+
+/* Grade uniforme de plot->samples pontos avaliada em partes, para quem não
+ * quer a curva inteira na memória (a renderização em fluxo, stream.h). O
+ * programa sai do cache uma vez, no open; plot_sampler_block() avalia os
+ * pontos first..first+n-1 da grade (os mesmos t de plot_generate_samples)
+ * num PlotData do chamador, reaproveitando a arena, e a concatenação dos
+ * blocos é a geração inteira. adaptive, interval e incremental são
+ * ignorados e curvas implícitas são recusadas; `plot` precisa viver até o
+ * close. Cada sampler é usado por uma
+ * thread de cada vez. Retornam NULL/0 com a mensagem em *errmsg, ou 0 se
+ * faltou memória para o bloco. */
+typedef struct PlotSampler PlotSampler;
+
+PlotSampler *plot_sampler_open(const Plot *plot, char **errmsg);
+int plot_sampler_block(PlotSampler *s, int first, int n, PlotData *data);
+void plot_sampler_close(PlotSampler *s);
+
+/* Varredura dos parâmetros livres: `frames` gerações da curva, a k-ésima com
+ * cada parâmetro valendo plot_param_value(param, k, frames), em data[k]
+ * (PlotData do chamador, zerados ou de gerações anteriores). O programa sai
+ * do cache (ou é compilado) uma vez; cada quadro só troca os parâmetros por
+ * constantes numa cópia dele. Os quadros são gerados em paralelo, cada um
+ * inteiro numa das plot_thread_count(plot->threads) threads, e saem iguais
+ * aos de plot_generate_samples com os mesmos valores fixos. Retorna 1 se
+ * gerou todos; senão 0 com a mensagem em *errmsg. plot_generate_samples e o
+ * sampler usam o valor `from` de cada parâmetro. */
+int plot_generate_frames(const Plot *plot, int frames, PlotData *data, char **errmsg);
+
+/* Só a compilação de plot_generate_samples: deixa o programa da curva no
+ * cache de programas (não faz nada se já estiver lá). Com o cache desligado,
+ * compila e descarta. Retorna 1 se compilou, senão 0 com a mensagem em
+ * *errmsg. */
+int plot_compile(const Plot *plot, char **errmsg);
+
+/* Número de threads que plot_generate_samples usará para `threads`
+ * (PLOT_THREADS_AUTO vira o número de CPUs), entre 1 e PLOT_MAX_THREADS. */
+int plot_thread_count(int threads);
+
 /* Libera um PlotData retornado por plot_generate_samples. */
 void plot_data_free(PlotData *data);
 
+/* Libera só a arena de um PlotData do chamador e o deixa zerado. */
+void plot_data_release(PlotData *data);
+
+/* Cache de programas compilados, global ao processo e compartilhado pelas
+ * threads. O programa guardado não depende de intervalo, amostras, opções
+ * adaptativas nem do canvas; o código JIT vai junto quando o motor JIT está
+ * ativo na primeira compilação da curva. max_bytes == 0 desliga o cache. */
+void plot_cache_set_limits(size_t max_bytes, int max_entries);
+
+/* Descarta os programas guardados (os contadores continuam). */
+void plot_cache_clear(void);
+
+/* Acertos, faltas, descartes e ocupação do cache. */
+void plot_cache_stats(ExprCacheStats *stats);
+
+/* Cache de amostras das gerações com Plot.incremental, global ao processo.
+ * Cada curva (programa + motor) guarda (t, x, y, status) das suas gerações;
+ * uma geração nova só avalia os t que não estão lá. Na grade uniforme,
+ * `incremental` troca os `samples` pontos por uma grade diádica: C, os
+ * múltiplos k*h de uma potência de 2 h <= (D-C)/(samples-1) e D (de samples a
+ * 2*samples pontos), que pan e zoom reencontram. Na adaptativa a grade não
+ * muda; repetir o mesmo pedido reaproveita tudo. Uma curva que passaria de
+ * max_bytes fica só com a última geração. max_bytes == 0 desliga. */
+void plot_sample_cache_set_limits(size_t max_bytes, int max_curves);
+
+void plot_sample_cache_clear(void);
+
+typedef struct {
+    ExprCacheStats curves;      /* Entradas: uma por curva e motor */
+    unsigned long reused;       /* Amostras que vieram prontas do cache */
+    unsigned long evaluated;    /* Amostras avaliadas */
+} PlotSampleCacheStats;
+
+void plot_sample_cache_stats(PlotSampleCacheStats *stats);
+
+/* Imprime o bytecode do avaliador em lote de cada expressão, antes e depois
+ * das otimizações (depuração). */
+void plot_dump_bytecode(const Plot *plot, FILE *out);
+
 #endif /* MULTICURVAS_PLOT_H */
@@ -0,0 +1,72 @@
+/* Camada de saída com buffer grande e formatação própria de números.
+ *
+ * Os renderizadores escrevem num OutBuf em vez de chamar printf por ponto:
+ * os bytes se acumulam num buffer em espaço de usuário (OUTBUF_CAPACITY por
+ * padrão) e só vão para o destino quando ele enche ou em outbuf_flush(). O
+ * destino é um file descriptor (write(2) direto), um FILE* (um fwrite por
+ * buffer cheio) ou uma função do chamador.
+ *
+ * outbuf_fixed(ob, v, casas) escreve v com `casas` casas decimais sem passar
+ * pelo printf e dá exatamente os mesmos bytes que printf("%.*f", casas, v)
+ * da glibc: o arredondamento usa o valor exato do double (produto exato
+ * v * 10^casas via Dekker) e empates vão para o par, como o printf no modo de
+ * arredondamento padrão. NaN, Inf e valores grandes demais para 53 bits
+ * depois da vírgula caem no snprintf.
+ */
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define OUTBUF_CAPACITY      (256 * 1024)
+#define OUTBUF_MAX_DECIMALS  9
+#define OUTBUF_FIXED_MAX     352  /* Maior saída de outbuf_format_fixed (%.9f de DBL_MAX) */
+
+/* Destino fornecido pelo chamador: recebe `n` bytes e retorna 1 se gravou
+ * tudo, 0 em caso de erro. */
+typedef int (*OutBufSink)(void *ctx, const char *data, size_t n);
+
+typedef struct OutBuf {
+    char *buf;
+    size_t size;        /* Bytes pendentes em buf */
+    size_t capacity;
+    OutBufSink sink;
+    void *ctx;
+    int fd;             /* Destino quando sink == NULL */
+    int error;          /* 1 depois de qualquer falha de escrita ou alocação */
+    size_t written;     /* Total de bytes já entregues ao destino */
+} OutBuf;
+
+/* Inicializa com destino num file descriptor, num FILE* ou numa função.
+ * capacity 0 usa OUTBUF_CAPACITY. Retornam 1 se sucesso, 0 se faltou memória. */
+int outbuf_init_fd(OutBuf *ob, int fd, size_t capacity);
+int outbuf_init_file(OutBuf *ob, FILE *file, size_t capacity);
+int outbuf_init_sink(OutBuf *ob, OutBufSink sink, void *ctx, size_t capacity);
+
+/* Entrega o que está pendente. Retorna 1 se nenhuma escrita falhou até aqui. */
+int outbuf_flush(OutBuf *ob);
+
+/* outbuf_flush() e libera o buffer (não fecha o fd/FILE). */
+int outbuf_close(OutBuf *ob);
+
+/* Descarta o que está pendente, zera error/written e troca o `ctx` do
+ * destino, mantendo o buffer: um OutBuf de função serve vários destinos
+ * seguidos (os pedidos do servidor) sem realocar. */
+void outbuf_reset(OutBuf *ob, void *ctx);
+
+void outbuf_write(OutBuf *ob, const char *data, size_t n);
+void outbuf_puts(OutBuf *ob, const char *s);
+void outbuf_char(OutBuf *ob, char c);
+
+/* Inteiro em decimal, como printf("%d"). */
+void outbuf_int(OutBuf *ob, long v);
+
+/* v com `decimals` casas (0 a OUTBUF_MAX_DECIMALS), como printf("%.*f"). */
+void outbuf_fixed(OutBuf *ob, double v, int decimals);
+
+/* Formata em dst (pelo menos OUTBUF_FIXED_MAX bytes, sem '\0') e retorna o
+ * número de bytes. É o formatador usado por outbuf_fixed. */
+size_t outbuf_format_fixed(char *dst, double v, int decimals);
+
+#endif /* OUTBUF_H */
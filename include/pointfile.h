@@ -0,0 +1,67 @@
+/* Arquivo binário de pontos: a saída de plot_generate_samples() sem passar
+ * por texto.
+ *
+ * O CSV formata cada ponto com %.6f (perde precisão) e o consumidor ainda
+ * precisa de strtod para ler de volta. Aqui as colunas são os próprios
+ * doubles em little-endian: gravar é copiar memória e ler é mapear o
+ * arquivo com mmap(2) e apontar um PlotData para dentro dele, sem cópia.
+ *
+ * Layout (inteiros e doubles em little-endian):
+ *
+ *   0  char[8]  "MCURVPTS"
+ *   8  u32      versão (POINTFILE_VERSION)
+ *  12  u32      PlotType
+ *  16  f64      C  \  intervalo amostrado (plot_interval: polar em
+ *  24  f64      D  /  radianos, na escala da coluna t)
+ *  32  u64      count        pontos válidos (tamanho das colunas)
+ *  40  u64      evaluations  amostras avaliadas (bits do mapa de status)
+ *  48  u32      tamanho da expressão, sem o '\0'
+ *  52  u32      flags (POINTFILE_FLAG_*; os demais bits são 0)
+ *  56  u64      início das colunas (múltiplo de 8)
+ *  64  expressão + '\0', mapa de status, zeros até o início das colunas
+ *      x[count], y[count], t[count]
+ *
+ * O mapa de status é a máscara PlotData.valid: um bit por amostra avaliada,
+ * em ordem de t (bit i no byte i/8, menos significativo primeiro), 1 se a
+ * amostra virou ponto, 0 se deu erro. Há exatamente `count` bits 1 e os bits
+ * depois de `evaluations` são 0. Com POINTFILE_FLAG_SEGMENTED (PlotData.segmented),
+ * uma amostra 0 também separa trechos da curva: o traço não passa por ela.
+ */
+#ifndef POINTFILE_H
+#define POINTFILE_H
+
+#include "multicurvas_plot.h"
+#include "outbuf.h"
+
+#define POINTFILE_MAGIC        "MCURVPTS"
+#define POINTFILE_VERSION      1
+#define POINTFILE_HEADER_SIZE  64
+
+/* Bits do campo de flags */
+#define POINTFILE_FLAG_SEGMENTED  0x1   /* PlotData.segmented */
+
+/* Arquivo aberto por pointfile_open(). Tudo aponta para o mapeamento e vale
+ * até pointfile_close(). */
+typedef struct {
+    PlotType type;
+    const char *expression;         /* Expressão como foi digitada */
+    double C, D;
+    PlotData data;                  /* Visão somente leitura: x, y, t e valid
+                                       apontam para dentro do arquivo */
+    void *map;
+    size_t map_size;
+    double *copy;                   /* Colunas convertidas em host big-endian */
+} PointFile;
+
+/* Grava o cabeçalho, o mapa de status e as colunas de `data`, gerado a
+ * partir de `plot` (tipo e intervalo) e de `expression`. Retorna 0 se a
+ * expressão é longa demais ou a escrita falhou (out->error). */
+int pointfile_write(OutBuf *out, const char *expression, const Plot *plot, const PlotData *data);
+
+/* Mapeia `path` e confere o cabeçalho, os tamanhos e o mapa de status.
+ * Retorna NULL em caso de erro (mensagem em *errmsg, que o chamador libera). */
+PointFile *pointfile_open(const char *path, char **errmsg);
+
+void pointfile_close(PointFile *pf);
+
+#endif /* POINTFILE_H */
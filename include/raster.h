@@ -0,0 +1,47 @@
+/* Framebuffer em memória para saída raster (PPM, PBM e PNG).
+ *
+ * Imagem RGB de 8 bits por canal. Os traços são antialiasados por cobertura:
+ * raster_stroke() acumula numa máscara a cobertura de cada pixel pelo
+ * segmento (distância do centro do pixel ao segmento, pontas redondas) e
+ * raster_fill() pinta a máscara com uma cor só. Como a máscara guarda o
+ * máximo, segmentos seguidos de uma polilinha não escurecem nas junções.
+ *
+ * Os codificadores escrevem num OutBuf. O PNG usa deflate sem compressão
+ * (blocos "store" do zlib), sem bibliotecas externas: o arquivo fica do
+ * tamanho do PPM, mas é gerado numa passada só.
+ */
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "outbuf.h"
+
+#define RASTER_MAX_DIM 16384
+
+typedef struct {
+    int width, height;
+    unsigned char *rgb;         /* width * height * 3, linha a linha de cima para baixo */
+    unsigned char *coverage;    /* Máscara do traço em andamento (0..255) */
+} Raster;
+
+/* Cria a imagem preenchida com `background` (0xRRGGBB). Retorna NULL se as
+ * dimensões são inválidas (0 ou acima de RASTER_MAX_DIM) ou faltou memória. */
+Raster *raster_create(int width, int height, unsigned int background);
+void raster_free(Raster *r);
+
+/* Acumula na máscara o segmento (x0,y0)-(x1,y1), em pixels, com `width`
+ * pixels de espessura. Traços mais finos que 1 pixel viram 1 pixel com
+ * intensidade proporcional. */
+void raster_stroke(Raster *r, double x0, double y0, double x1, double y1, double width);
+
+/* Pinta o que foi acumulado na máscara com `color` e limpa a máscara. */
+void raster_fill(Raster *r, unsigned int color);
+
+/* Retângulo sólido de pixels inteiros (recortado à imagem). */
+void raster_rect(Raster *r, int x, int y, int w, int h, unsigned int color);
+
+/* Codificadores. Retornam 0 se o OutBuf já está em erro. */
+int raster_write_ppm(OutBuf *out, const Raster *r);     /* P6 binário */
+int raster_write_pbm(OutBuf *out, const Raster *r);     /* P4, preto onde luminância < 50% */
+int raster_write_png(OutBuf *out, const Raster *r);     /* RGB 8 bits, zlib store */
+
+#endif /* RASTER_H */
@@ -3,12 +3,110 @@
 #define RENDER_H
 
 #include "multicurvas_plot.h"
+#include "outbuf.h"
 #include <stdio.h>
 
+/* Tolerância padrão, em pixels, da simplificação da curva no SVG
+ * (ver simplify.h). Com o traço de 2 px não há diferença visível. */
+#define RENDER_SIMPLIFY_TOLERANCE 0.25
+
+/* Formatos de saída */
+typedef enum {
+    RENDER_CSV,
+    RENDER_SVG,
+    RENDER_PPM,     /* Raster RGB, P6 */
+    RENDER_PBM,     /* Raster preto e branco, P4 */
+    RENDER_PNG,     /* Raster RGB, deflate sem compressão */
+    RENDER_BIN      /* Pontos em binário (pointfile.h), gravados por quem tem o Plot */
+} RenderFormat;
+
+/* Pontos da curva antes e depois da simplificação */
+typedef struct {
+    int points_in;      /* Pontos válidos (finitos, dentro dos limites) */
+    int points_out;     /* Vértices escritos na <polyline> (ou traçados no raster) */
+} RenderStats;
+
+/* Caixa dos dados no SVG/raster: a escala, a grade e o filtro da curva (só
+ * pontos dentro dela são desenhados) saem daqui. */
+typedef struct {
+    double minx, maxx, miny, maxy;
+} RenderBounds;
+
+/* Bounding box de `data` (count > 0), ignorando coordenadas não finitas ou
+ * acima de 1e6 em módulo. */
+void render_bounds(const PlotData *data, RenderBounds *b);
+
 /* Renderiza dados em formato CSV para stdout */
 void render_csv(const PlotData *data);
 
-/* Renderiza dados em formato SVG para stdout com canvas ajustável */
+/* Renderiza dados em formato SVG para stdout com canvas ajustável (curva
+ * simplificada com RENDER_SIMPLIFY_TOLERANCE) */
 void render_svg(const PlotData *data, const char *title, int canvas_w, int canvas_h);
 
+/* Mesmos renderizadores, escrevendo num OutBuf (sem flush no final; falhas
+ * de escrita ficam em out->error). No SVG, `tolerance` é a tolerância da
+ * simplificação em pixels (0 escreve todos os pontos) e `stats`, se não
+ * NULL, recebe a contagem de pontos. */
+void render_csv_out(OutBuf *out, const PlotData *data);
+void render_svg_out(OutBuf *out, const PlotData *data, const char *title, int canvas_w, int canvas_h,
+                    double tolerance, RenderStats *stats);
+
+/* Raster em memória (include/raster.h) com o mesmo layout, cores e
+ * espessuras do SVG, traços antialiasados, gravado como PPM, PBM ou PNG.
+ * Com zx81 = 1, desenha a tela de 64x44 blocos do Referencia/CURVAS.bas
+ * (PLOT com escala isotrópica e os "+" de referência), ampliada pelo maior
+ * fator inteiro que cabe no canvas; `stats` conta os blocos plotados.
+ * Retorna 0 se faltou memória, o formato não é raster ou a escrita falhou. */
+int render_raster_out(OutBuf *out, const PlotData *data, RenderFormat format, int canvas_w, int canvas_h,
+                      double tolerance, int zx81, RenderStats *stats);
+
+/* Renderização em fluxo: a curva chega em blocos de pontos (PlotData em
+ * ordem de t, um depois do outro) e sai com os mesmos bytes que o
+ * renderizador de uma vez só daria para a concatenação dos blocos, sem
+ * guardar os pontos: a simplificação é a de simplify_stream_push(). Os
+ * renderizadores acima passam por aqui com um bloco só.
+ *
+ * begin escreve o cabeçalho (SVG: até a grade e os eixos; raster: cria a
+ * imagem e desenha a grade) com a escala de `bounds` (ignorado no CSV);
+ * `segmented` é o PlotData.segmented dos blocos. Retorna NULL se o formato é
+ * bin ou faltou memória (o raster grande demais também). end escreve o fim
+ * (o raster inteiro, nos formatos de imagem), preenche `stats` se não NULL,
+ * libera o RenderStream e retorna 0 se a imagem não pôde ser gravada. */
+typedef struct RenderStream RenderStream;
+
+RenderStream *render_stream_begin(OutBuf *out, RenderFormat format, const RenderBounds *bounds,
+                                  const char *title, int canvas_w, int canvas_h, double tolerance,
+                                  int segmented);
+void render_stream_points(RenderStream *rs, const PlotData *block);
+int render_stream_end(RenderStream *rs, RenderStats *stats);
+
+/* Quadros de uma varredura (plot_generate_frames): todos na mesma caixa,
+ * para que a escala e a grade não pulem de um quadro para o outro.
+ * render_bounds_frames() dá a união das caixas dos quadros com pontos e
+ * retorna 0 se nenhum tem. render_frame_out() desenha um quadro nessa caixa
+ * em svg, ppm, pbm ou png (como render_svg_out / render_raster_out sem zx81,
+ * mas um quadro vazio sai só com a grade); retorna 0 como
+ * render_raster_out, ou se o formato não é um desses. */
+int render_bounds_frames(const PlotData *frames, int count, RenderBounds *b);
+int render_frame_out(OutBuf *out, const PlotData *data, RenderFormat format, const RenderBounds *bounds,
+                     const char *title, int canvas_w, int canvas_h, double tolerance, RenderStats *stats);
+
+/* Quadros por segundo do SVG animado */
+#define RENDER_ANIMATION_FPS 12
+
+/* SVG animado (SMIL) com os `count` quadros na caixa `bounds`: a grade e os
+ * eixos uma vez só e cada quadro num <g> que um <animate> discreto deixa
+ * visível por 1/fps segundo, em ciclo (sem SMIL, aparece o primeiro).
+ * `stats` soma os pontos de todos os quadros. */
+void render_svg_animation_out(OutBuf *out, const PlotData *frames, int count, const RenderBounds *bounds,
+                              const char *title, int canvas_w, int canvas_h, double tolerance, double fps,
+                              RenderStats *stats);
+
+/* "csv", "svg", "ppm", "pbm", "png" ou "bin". Retorna 1 se reconheceu. */
+int render_format_parse(const char *name, RenderFormat *format);
+
+/* Mesmos renderizadores, escrevendo em `out` */
+void render_csv_file(FILE *out, const PlotData *data);
+void render_svg_file(FILE *out, const PlotData *data, const char *title, int canvas_w, int canvas_h);
+
 #endif /* RENDER_H */
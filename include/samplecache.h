@@ -0,0 +1,48 @@
+/* Amostras já avaliadas de uma curva, para reaproveitar entre gerações.
+ *
+ * Guarda (t, x, y, status) em ordem crescente de t. Uma nova geração procura
+ * cada um dos seus valores de t; os que estão aqui saem prontos e só as
+ * faltas são avaliadas. A comparação é exata (mesmos bits de t): como cada
+ * ponto é avaliado sozinho, sem depender dos vizinhos do lote (ver
+ * amostrar_paralelo em multicurvas_plot.c), um ponto reaproveitado é
+ * idêntico a um recalculado pelo mesmo motor.
+ *
+ * Com a grade diádica de Plot.incremental, pan e zoom caem nos mesmos t:
+ * num pan só a faixa nova falta, num zoom in só os pontos do meio.
+ *
+ * Thread-safe: cada SampleCache tem o seu mutex.
+ */
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <stddef.h>
+
+typedef struct SampleCache SampleCache;
+
+/* Retorna NULL se faltou memória. */
+SampleCache *samplecache_create(void);
+
+/* Libera (assinatura de liberar do exprcache_create). */
+void samplecache_free(void *cache);
+
+/* Preenche x[i], y[i] e ok[i] dos ts[i] guardados e grava em `faltas` os
+ * índices dos que não estão, em ordem. Retorna quantos faltaram. ts em
+ * ordem crescente é o caso rápido (uma passada); fora de ordem funciona,
+ * com uma busca binária a cada volta. */
+int samplecache_lookup(SampleCache *cache, const double *ts, int n, double *x, double *y,
+                       unsigned char *ok, int *faltas);
+
+/* Junta n amostras (ts estritamente crescente; senão nada é guardado) às
+ * que já estão, sem repetir t. Se o total passaria de `max_bytes`, o cache
+ * fica só com estas; se nem elas cabem, fica vazio. Retorna os bytes
+ * ocupados depois. */
+size_t samplecache_insert(SampleCache *cache, const double *ts, const double *x, const double *y,
+                          const unsigned char *ok, int n, size_t max_bytes);
+
+/* Memória ocupada (estrutura e capacidade dos arrays) */
+size_t samplecache_bytes(SampleCache *cache);
+
+/* Bytes para guardar n amostras */
+#define SAMPLECACHE_BYTES(n) ((size_t)(n) * (3 * sizeof(double) + 1))
+
+#endif /* SAMPLECACHE_H */
@@ -0,0 +1,76 @@
+/* Servidor de renderização num socket local (--serve).
+ *
+ * Cada execução de `multicurvas` paga exec, ligação dinâmica, inicialização
+ * e compilação para uma curva só. O servidor paga isso uma vez: um laço
+ * epoll aceita conexões num socket Unix (ou TCP em 127.0.0.1) e lê os
+ * pedidos; um grupo de workers os atende, cada um com o seu PlotData e o
+ * seu OutBuf reaproveitados de um pedido para o outro (e o cache de
+ * programas, compartilhado pelo processo).
+ *
+ * PROTOCOLO (texto, uma linha por pedido, respostas na mesma ordem):
+ *
+ *   pedido:   <linha>\n               interpretada pelo ServerHandler
+ *   resposta: <n>\n<n bytes>          zero ou mais pedaços da saída
+ *             0\n                     fim, deu certo
+ *          ou ERRO <mensagem>\n       fim, deu errado (pode vir depois de
+ *                                     alguns pedaços)
+ *
+ * A saída vai sendo enviada à medida que o OutBuf do worker enche, sem
+ * montar a resposta inteira na memória. Um cliente pode mandar vários
+ * pedidos seguidos sem esperar as respostas.
+ *
+ * Uma conexão é atendida por uma thread de cada vez (EPOLLONESHOT): o laço
+ * lê até ter uma linha completa e entrega a conexão a um worker, que
+ * responde todas as linhas completas e devolve a conexão ao epoll.
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "multicurvas_plot.h"
+#include "outbuf.h"
+
+#define SERVER_MAX_LINE        4096    /* Tamanho máximo de um pedido */
+#define SERVER_MAX_CONNECTIONS 1024    /* Conexões simultâneas (padrão) */
+#define SERVER_TIMEOUT_MS      10000   /* Prazo de um pedido (padrão) */
+
+/* Atende um pedido: interpreta `request` (a linha, sem o '\n'; pode ser
+ * alterada), gera as amostras em `data` (reaproveitado entre os pedidos do
+ * worker) e escreve a saída em `out`. `deadline` é o prazo do pedido no
+ * relógio de server_now(). Retorna 1 se deu certo, senão 0 com a mensagem
+ * em *errmsg (strdup). */
+typedef int (*ServerHandler)(void *ctx, char *request, PlotData *data, OutBuf *out, double deadline,
+                             char **errmsg);
+
+typedef struct {
+    const char *address;    /* Caminho do socket Unix, ou "tcp:<porta>" (só 127.0.0.1) */
+    int threads;            /* Workers (PLOT_THREADS_AUTO = um por CPU) */
+    int max_connections;    /* 0 = SERVER_MAX_CONNECTIONS */
+    double timeout_ms;      /* Prazo de cada pedido, da chegada ao último byte (0 = padrão) */
+    ServerHandler handler;
+    void *ctx;
+} ServerConfig;
+
+typedef struct {
+    unsigned long connections;   /* Conexões aceitas */
+    unsigned long rejected;      /* Recusadas por max_connections */
+    unsigned long requests;      /* Pedidos respondidos */
+    unsigned long errors;        /* Respondidos com ERRO */
+    unsigned long timeouts;      /* Estouraram o prazo */
+    unsigned long bytes;         /* Bytes de saída (sem o enquadramento) */
+    double max_ms;               /* Pedido mais demorado */
+} ServerStats;
+
+/* Escuta em config->address e atende até SIGINT, SIGTERM ou server_stop().
+ * Com um socket Unix, um arquivo de socket antigo no caminho é substituído e
+ * removido no fim. Retorna 1 se encerrou normalmente (com os contadores em
+ * *stats, se não NULL), 0 se não conseguiu escutar (mensagem em *errmsg). */
+int server_run(const ServerConfig *config, ServerStats *stats, char **errmsg);
+
+/* Pede o encerramento de server_run() (pode ser chamada de um tratador de
+ * sinal). Os pedidos em andamento terminam; os da fila são descartados. */
+void server_stop(void);
+
+/* Relógio dos prazos (CLOCK_MONOTONIC, em segundos) */
+double server_now(void);
+
+#endif /* SERVER_H */
@@ -0,0 +1,50 @@
+/* Simplificação de polilinhas com tolerância em pixels.
+ *
+ * Antes de escrever a <polyline> do SVG, o renderizador já conhece a
+ * transformação dados → pixels; a essa altura centenas de amostras seguidas
+ * caem no mesmo pixel ou numa mesma reta. simplify_polyline() escolhe um
+ * subconjunto dos vértices tal que todo ponto original fica a no máximo
+ * `tol` pixels do traçado simplificado.
+ *
+ * Algoritmo: "sleeve fitting" guloso (Zhao & Saalfeld), O(n) e uma passada
+ * só — em vez do Douglas–Peucker, que é O(n²) no pior caso (espirais), ou do
+ * Visvalingam, cuja tolerância é de área e não de distância. A partir de uma
+ * âncora A, cada ponto P a distância d > tol restringe a direção do segmento
+ * ao cone [θ_P − asin(tol/d), θ_P + asin(tol/d)]; o segmento A→P_j é aceito
+ * enquanto a direção de P_j está dentro da interseção dos cones dos pontos
+ * intermediários e P_j é pelo menos tão distante de A quanto eles (então
+ * nenhum ponto se projeta além do fim do segmento). No primeiro P_j que não
+ * serve, o vértice anterior vira a nova âncora.
+ */
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+/* Grava em keep[] (n posições) os índices dos vértices mantidos, em ordem,
+ * sempre com o primeiro e o último, e retorna quantos são. Com tol <= 0 ou
+ * n <= 2 mantém todos. Os pontos precisam ser finitos. */
+int simplify_polyline(const double *x, const double *y, int n, double tol, int *keep);
+
+/* O mesmo algoritmo ponto a ponto, para polilinhas que chegam em partes (a
+ * renderização em fluxo): só guarda a âncora, o cone e o último ponto. */
+typedef struct {
+    double tol;
+    double ax, ay;          /* Âncora */
+    double px, py;          /* Ponto anterior: fim do segmento em teste */
+    double lo, hi, ref;     /* Cone de direções aceitas */
+    double max_d;
+    int tem_ref;
+    long pontos;            /* Pontos recebidos */
+} SimplifyStream;
+
+void simplify_stream_init(SimplifyStream *s, double tol);
+
+/* Recebe o próximo ponto. Retorna 1 se um vértice ficou decidido, gravado
+ * em (*vx, *vy): no primeiro ponto, ele mesmo; depois, sempre o ponto
+ * anterior. A sequência de vértices é a de simplify_polyline(). */
+int simplify_stream_push(SimplifyStream *s, double x, double y, double *vx, double *vy);
+
+/* Fim da polilinha: retorna 1 com o último ponto se ele ainda não saiu
+ * (mais de um ponto recebido). Deixa `s` pronto para outra polilinha. */
+int simplify_stream_finish(SimplifyStream *s, double *vx, double *vy);
+
+#endif /* SIMPLIFY_H */
@@ -0,0 +1,110 @@
+/* Instrumentação do pipeline (--stats).
+ *
+ * Conta, para uma curva ou um lote delas, o tempo de cada etapa (parse,
+ * compilação, avaliação, controle da amostragem, bounding box, formatação
+ * da saída e escrita), as avaliações feitas, os erros de avaliação por tipo
+ * de EvalError, os pontos gerados e escritos e os bytes de saída.
+ *
+ * A coleta é por thread: stats_attach() liga um Stats do chamador à thread
+ * atual e as etapas instrumentadas (stats_enter/stats_leave) passam a somar
+ * nele. O relógio é trocado de etapa a cada entrada e saída, então uma etapa
+ * aninhada (a escrita dentro da formatação, a compilação dentro da
+ * amostragem) não é contada duas vezes: os tempos são exclusivos e somam
+ * no máximo o total. Sem Stats ligado, cada gancho é uma leitura da variável
+ * da thread; nada é feito por amostra.
+ *
+ * Compilado com -DMULTICURVAS_NO_STATS, os ganchos viram macros vazias
+ * (STATS_ENABLED = 0) e a instrumentação some do código.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+typedef enum {
+    STATS_PARSE,     /* plot_parse_text */
+    STATS_COMPILE,   /* Tokens, RPN, BatchProgram, otimizador e JIT (faltas do cache de programas) */
+    STATS_EVAL,      /* Avaliação das amostras e conversão para (x,y) */
+    STATS_SAMPLE,    /* Resto da geração: grade, rodadas da adaptativa, cache de amostras, compactação */
+    STATS_BOUNDS,    /* Bounding box e layout do SVG/raster */
+    STATS_RENDER,    /* Formatação da saída (CSV, SVG, raster, bin), com a simplificação */
+    STATS_WRITE,     /* Entrega dos buffers do OutBuf (write, fwrite, socket) */
+    STATS_STAGES
+} StatsStage;
+
+/* Erros de avaliação, pelo EvalError da saída que falhou */
+typedef enum {
+    STATS_ERROR_DIVISION_BY_ZERO,
+    STATS_ERROR_DOMAIN,     /* Inclui R**2=f(t) com f(t) < 0 */
+    STATS_ERROR_MATH,
+    STATS_ERROR_STACK,
+    STATS_ERROR_OTHER,
+    STATS_ERRORS
+} StatsError;
+
+typedef struct {
+    double seconds[STATS_STAGES];       /* Tempo exclusivo de cada etapa */
+    unsigned long calls[STATS_STAGES];  /* Entradas em cada etapa */
+    double total;                       /* Tempo com o Stats ligado (stats_attach a stats_detach) */
+    unsigned long curves;
+    unsigned long evaluations;          /* Valores de t avaliados (sem os do cache de amostras) */
+    unsigned long errors[STATS_ERRORS]; /* Avaliações com erro */
+    unsigned long points;               /* Pontos válidos gerados (PlotData.count) */
+    unsigned long emitted;              /* Pontos escritos depois da filtragem e da simplificação */
+    unsigned long bytes;                /* Bytes de saída entregues */
+} Stats;
+
+/* Formato de stats_print() */
+typedef enum {
+    STATS_FORMAT_TEXT,
+    STATS_FORMAT_JSON
+} StatsFormat;
+
+#ifndef MULTICURVAS_NO_STATS
+
+#define STATS_ENABLED 1
+
+/* Liga `st` à thread atual (NULL desliga), sem zerar o que já tem. */
+void stats_attach(Stats *st);
+
+/* Soma em st->total o tempo desde stats_attach() e desliga a thread. */
+void stats_detach(void);
+
+/* Stats ligado à thread atual, ou NULL. */
+Stats *stats_current(void);
+
+/* Entra numa etapa e retorna a anterior, para stats_leave(). */
+int stats_enter(StatsStage stage);
+void stats_leave(int previous);
+
+#else
+
+#define STATS_ENABLED 0
+#define stats_attach(st) ((void)(st))
+#define stats_detach() ((void)0)
+#define stats_current() ((Stats *)0)
+#define stats_enter(stage) ((void)(stage), -1)
+#define stats_leave(previous) ((void)(previous))
+
+#endif /* MULTICURVAS_NO_STATS */
+
+/* Índice em Stats.errors de um EvalError diferente de EVAL_OK. */
+int stats_error_kind(int eval_error);
+
+/* Soma `src` em `dst`. */
+void stats_merge(Stats *dst, const Stats *src);
+
+/* Nome curto da etapa ("parse", "eval"...), usado no texto e no JSON. */
+const char *stats_stage_name(StatsStage stage);
+
+/* "text" ou "json". Retorna 1 se reconheceu. */
+int stats_format_parse(const char *name, StatsFormat *format);
+
+/* Tabela por etapa e contadores, em texto (com o título na primeira linha),
+ * ou um objeto JSON numa linha só (sem o título). */
+void stats_print(FILE *out, const Stats *st, StatsFormat format, const char *title);
+
+/* `s` como string JSON, com aspas e escapes. */
+void stats_print_json_string(FILE *out, const char *s);
+
+#endif /* STATS_H */
@@ -0,0 +1,48 @@
+/* Renderização em fluxo (--stream): amostrador e renderizador em threads
+ * separadas, ligados por um anel de blocos.
+ *
+ * plot_generate_samples() monta a curva inteira antes de renderizar (25
+ * bytes por amostra: 2,5 GB para 10^8 amostras) e o SVG ainda percorre os
+ * pontos duas vezes (limites, depois a escrita). Aqui uma thread produtora
+ * avalia a grade uniforme em blocos (plot_sampler_block) e os publica num
+ * anel de PlotData; a thread que chamou consome os blocos em ordem com
+ * render_stream_points(). Com o anel cheio a produtora espera, com o anel
+ * vazio a consumidora. A memória fica em `slots` blocos, qualquer que seja o
+ * número de amostras, e a avaliação do bloco seguinte corre junto com a
+ * formatação e a escrita do anterior.
+ *
+ * O SVG e o raster precisam da escala antes do primeiro ponto: ela vem do
+ * `viewport` do chamador ou de uma pré-passada de STREAM_PREPASS_SAMPLES
+ * pontos no mesmo intervalo (render_bounds da pré-passada). Pontos fora da
+ * caixa são cortados, como os além de 1e6. Com o viewport igual à caixa da
+ * curva inteira a saída é idêntica à de render_svg_out/render_raster_out; o
+ * CSV não depende da caixa e é sempre idêntico.
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "multicurvas_plot.h"
+#include "render.h"
+
+#define STREAM_BLOCK_SAMPLES   65536   /* Amostras por bloco do anel (~1,6 MB) */
+#define STREAM_SLOTS           4       /* Blocos no anel */
+#define STREAM_PREPASS_SAMPLES 4097    /* Grade da pré-passada que estima a caixa */
+
+typedef struct {
+    int block;                      /* Amostras por bloco (0 = STREAM_BLOCK_SAMPLES) */
+    int slots;                      /* Blocos no anel, pelo menos 2 (0 = STREAM_SLOTS) */
+    const RenderBounds *viewport;   /* Caixa do SVG/raster; NULL = pré-passada */
+    double tolerance;               /* Simplificação em pixels (SVG e raster) */
+} StreamOptions;
+
+/* Renderiza em `out` os plot->samples pontos da grade uniforme de `plot`
+ * (adaptive, interval e incremental são ignorados) em csv, svg, ppm, pbm ou
+ * png. Retorna 1 se deu certo; senão 0 com a mensagem em *errmsg (uma
+ * falha de escrita também: fica em out->error e para a produção). Com um Stats ligado à
+ * thread, a produtora soma nele as avaliações, os erros, os pontos e os
+ * tempos de eval/sample; as duas threads correm juntas, então as etapas
+ * podem somar mais que o total. */
+int stream_render(OutBuf *out, const Plot *plot, RenderFormat format, const char *title, int canvas_w,
+                  int canvas_h, const StreamOptions *opts, RenderStats *stats, char **errmsg);
+
+#endif /* STREAM_H */
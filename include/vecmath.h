@@ -0,0 +1,75 @@
+/* Kernels matemáticos vetoriais (SSE2/AVX2) para o avaliador em lote.
+ *
+ * Cada função processa um array de n doubles, 2 (SSE2) ou 4 (AVX2) lanes
+ * por vez, escolhendo o conjunto de instruções em tempo de execução pela
+ * detecção de CPU. Fora de x86 (ou sem GCC/Clang) tudo cai nos laços
+ * escalares com a libm.
+ *
+ * Os algoritmos são os do fdlibm (redução de Cody-Waite + polinômios
+ * minimax) e usam só +, -, *, / e sqrt do IEEE, sem FMA: um mesmo kernel dá
+ * exatamente os mesmos bits em SSE2 e em AVX2. No nível SSE2, exp e log
+ * ficam com a libm (o kernel de 2 lanes é mais lento que a glibc).
+ *
+ * Erro máximo, medido contra a glibc em 10^7 pontos aleatórios por função:
+ *   vecmath_sin / vecmath_sincos (seno)         ≤ 1 ULP   (|x| ≤ 2^19·π/2;
+ *   vecmath_cos / vecmath_sincos (cosseno)      ≤ 2 ULP    acima disso, libm)
+ *   vecmath_exp                                 ≤ 1 ULP
+ *   vecmath_log                                 ≤ 1 ULP
+ *   vecmath_sqrt                                0 ULP (IEEE, arredondamento correto)
+ *   vecmath_pow                                 libm por lane
+ *
+ * Erros por lane: `bad[i]` (se não NULL) recebe 1 quando a entrada está fora
+ * do domínio (sqrt de negativo, log ≤ 0, pow de base negativa com expoente
+ * não inteiro ou 0 elevado a negativo) ou o resultado não é finito. O
+ * avaliador em lote reavalia essas lanes com `evaluator_eval_rpn`, que
+ * devolve o mesmo EVAL_DOMAIN_ERROR / EVAL_DIVISION_BY_ZERO do caminho
+ * escalar. `bad` só é escrito com 1 (nunca zerado).
+ *
+ * `x` e `y` podem ser o mesmo array (operação in-place).
+ */
+#ifndef VECMATH_H
+#define VECMATH_H
+
+typedef enum {
+    VECMATH_SCALAR = 0,  /* laços com a libm */
+    VECMATH_SSE2,        /* 2 lanes */
+    VECMATH_AVX2         /* 4 lanes */
+} VecMathLevel;
+
+/* Nível em uso (detectado na primeira chamada). */
+VecMathLevel vecmath_level(void);
+
+/* Força um nível (benchmarks/comparações). Níveis que a CPU não suporta são
+ * rebaixados para o melhor disponível. Retorna o nível efetivo. */
+VecMathLevel vecmath_set_level(VecMathLevel level);
+
+/* Nome do nível ("scalar", "sse2", "avx2"). */
+const char *vecmath_level_name(VecMathLevel level);
+
+void vecmath_sin(const double *x, double *y, unsigned char *bad, int n);
+void vecmath_cos(const double *x, double *y, unsigned char *bad, int n);
+void vecmath_exp(const double *x, double *y, unsigned char *bad, int n);
+void vecmath_log(const double *x, double *y, unsigned char *bad, int n);
+void vecmath_sqrt(const double *x, double *y, unsigned char *bad, int n);
+void vecmath_pow(const double *x, const double *e, double *y, unsigned char *bad, int n);
+
+/* sin e cos do mesmo argumento com uma única redução de faixa (usado na
+ * conversão polar → cartesiana). */
+void vecmath_sincos(const double *x, double *s, double *c, int n);
+
+/* Prévia em float (batch_eval_preview): o dobro de lanes por vetor (4 no
+ * SSE2, 8 no AVX2), polinômios do Cephes, ~4x mais rápidos que os kernels
+ * em double. Erro máximo contra a libm em double, medido em 10^7 pontos por
+ * função (com a entrada já em float): sin/cos 8e-8 absoluto (|x| ≤ 8192),
+ * exp e log 8e-8 relativo (log perto de 1: 2.5e-8 absoluto), ~1.3 ULP do
+ * float. Sem `bad` e sem caminho lento:
+ * o que os kernels não cobrem (sin/cos com |x| > 8192, log de subnormal)
+ * sai NaN, como os erros de domínio, e o chamador refaz a lane em double.
+ * No nível escalar, sinf/cosf/expf/logf da libm. */
+void vecmath_sin_f(const float *x, float *y, int n);
+void vecmath_cos_f(const float *x, float *y, int n);
+void vecmath_exp_f(const float *x, float *y, int n);
+void vecmath_log_f(const float *x, float *y, int n);
+void vecmath_sincos_f(const float *x, float *s, float *c, int n);
+
+#endif /* VECMATH_H */
@@ -0,0 +1,611 @@
+/* Avaliador em lote: executa uma RPN do Abaco sobre blocos de amostras.
+ *
+ * A RPN é percorrida uma vez por bloco (não uma vez por amostra). Cada
+ * instrução opera sobre colunas inteiras de BATCH_BLOCK_SIZE doubles, então
+ * o custo do `switch` é dividido pelo bloco e os laços internos são
+ * vetorizáveis.
+ *
+ * Para manter a semântica de erro do avaliador escalar sem replicar suas
+ * regras de domínio, o caminho rápido calcula tudo em IEEE puro e marca as
+ * lanes que passaram por algum valor não finito. Só essas são refeitas com
+ * `evaluator_eval_rpn` — em curvas típicas são poucos pontos (polos,
+ * bordas de domínio).
+ *
+ * sin, cos, exp, log e sqrt usam os kernels SIMD de vecmath.c, que já
+ * marcam as lanes problemáticas; as demais funções usam a libm por lane.
+ */
+
+#include "batch_internal.h"
+#include "../include/vecmath.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef MAX_EVAL_STACK_SIZE
+#define MAX_EVAL_STACK_SIZE 64
+#endif
+
+/* Ranges de tokens do Abaco (ver DOCUMENTATION.md, "Sistema de ranges") */
+#define BATCH_CONST_FIRST     140
+#define BATCH_CONST_LAST      159
+#define BATCH_FUNCTION_FIRST  160
+#define BATCH_FUNCTION_LAST   199
+
+/* Funções calculadas diretamente pela libm, sem passar pelo avaliador. */
+static int is_libm_function(int type) {
+    switch (type) {
+        case TOKEN_SIN: case TOKEN_COS: case TOKEN_TAN:
+        case TOKEN_ABS: case TOKEN_SQRT: case TOKEN_EXP:
+        case TOKEN_LOG: case TOKEN_LOG10:
+        case TOKEN_SINH: case TOKEN_COSH: case TOKEN_TANH:
+        case TOKEN_ASIN: case TOKEN_ACOS: case TOKEN_ATAN:
+        case TOKEN_ASINH: case TOKEN_ACOSH: case TOKEN_ATANH:
+        case TOKEN_CEIL: case TOKEN_FLOOR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Monta a mini-RPN [t, f] (unary=1) ou [c] (unary=0, constante) para que o
+ * próprio avaliador escalar calcule aquele único token. */
+static int build_call(TokenBuffer *buf, int type, int unary) {
+    parser_init_buffer(buf);
+    Token tk;
+    memset(&tk, 0, sizeof(tk));
+    if (unary) {
+        tk.type = TOKEN_VARIABLE;
+        tk.value_index = 0;
+        if (!parser_add_token(buf, tk)) return 0;
+    }
+    tk.type = (uint8_t)type;
+    tk.value_index = 0;
+    if (!parser_add_token(buf, tk)) return 0;
+    tk.type = TOKEN_END;
+    return parser_add_token(buf, tk);
+}
+
+static int push_op(BatchProgram *prog, int *cap, int op, int slot, int arg) {
+    if (prog->size == *cap) {
+        int ncap = *cap ? *cap * 2 : 32;
+        BatchOp *tmp = realloc(prog->ops, ncap * sizeof(BatchOp));
+        if (!tmp) return 0;
+        prog->ops = tmp;
+        *cap = ncap;
+    }
+    BatchOp *o = &prog->ops[prog->size++];
+    o->op = (uint8_t)op;
+    o->slot = (uint8_t)slot;
+    o->arg = (uint16_t)arg;
+    return 1;
+}
+
+static int push_value(BatchProgram *prog, int *cap, double v) {
+    if (prog->values_size == *cap) {
+        int ncap = *cap ? *cap * 2 : 16;
+        double *tmp = realloc(prog->values, ncap * sizeof(double));
+        if (!tmp) return -1;
+        prog->values = tmp;
+        *cap = ncap;
+    }
+    prog->values[prog->values_size] = v;
+    return prog->values_size++;
+}
+
+/* Baixa uma RPN para o fim de prog->ops, com a pilha começando no slot 0. */
+static int lower_rpn(BatchProgram *prog, const TokenBuffer *rpn, int *ops_cap, int *values_cap) {
+    const AbacoContext *ctx = prog->ctx;
+    if (!rpn || !rpn->tokens) return 0;
+
+    int top = -1;  // índice do topo da pilha simulada
+
+    for (int i = 0; i < rpn->size; i++) {
+        Token tk = rpn->tokens[i];
+        int type = tk.type;
+        int ok = 1;
+
+        if (type == TOKEN_END) break;
+
+        if (type == TOKEN_NUMBER) {
+            int idx = push_value(prog, values_cap, rpn->values[tk.value_index]);
+            ok = idx >= 0 && push_op(prog, ops_cap, BATCH_OP_CONST, ++top, idx);
+        } else if (type == TOKEN_VARIABLE) {
+            ok = push_op(prog, ops_cap, BATCH_OP_VAR, ++top, tk.value_index);
+        } else if (type >= BATCH_CONST_FIRST && type <= BATCH_CONST_LAST) {
+            // Constantes são resolvidas agora, pelo próprio avaliador
+            TokenBuffer tmp;
+            if (!build_call(&tmp, type, 0)) {
+                parser_free_buffer(&tmp);
+                return 0;
+            }
+            EvalResult r = batch_eval_at(ctx, &tmp, 0.0);
+            parser_free_buffer(&tmp);
+            int idx = (r.error == EVAL_OK) ? push_value(prog, values_cap, r.value) : -1;
+            ok = idx >= 0 && push_op(prog, ops_cap, BATCH_OP_CONST, ++top, idx);
+        } else if (type == TOKEN_NEG) {
+            ok = top >= 0 && push_op(prog, ops_cap, BATCH_OP_NEG, top, 0);
+        } else if (type == TOKEN_PLUS || type == TOKEN_MINUS || type == TOKEN_MULT ||
+                   type == TOKEN_DIV || type == TOKEN_POW) {
+            int op = (type == TOKEN_PLUS)  ? BATCH_OP_ADD :
+                     (type == TOKEN_MINUS) ? BATCH_OP_SUB :
+                     (type == TOKEN_MULT)  ? BATCH_OP_MUL :
+                     (type == TOKEN_DIV)   ? BATCH_OP_DIV : BATCH_OP_POW;
+            ok = top >= 1 && push_op(prog, ops_cap, op, --top, 0);
+        } else if (type >= BATCH_FUNCTION_FIRST && type <= BATCH_FUNCTION_LAST) {
+            if (top < 0) {
+                ok = 0;
+            } else if (is_libm_function(type)) {
+                ok = push_op(prog, ops_cap, BATCH_OP_FUNC, top, type);
+            } else {
+                // Função sem kernel próprio (ex.: frac): delega ao avaliador
+                TokenBuffer *tmp = realloc(prog->calls, (prog->calls_size + 1) * sizeof(TokenBuffer));
+                ok = tmp != NULL;
+                if (ok) {
+                    prog->calls = tmp;
+                    ok = build_call(&prog->calls[prog->calls_size], type, 1);
+                    prog->calls_size++;
+                    ok = ok && push_op(prog, ops_cap, BATCH_OP_CALL, top, prog->calls_size - 1);
+                }
+            }
+        } else {
+            ok = 0;  // token desconhecido: fica com o avaliador escalar
+        }
+
+        if (!ok || top >= MAX_EVAL_STACK_SIZE) return 0;
+        if (top + 1 > prog->depth) prog->depth = top + 1;
+    }
+
+    // RPN bem formada deixa exatamente um valor na pilha
+    return top == 0;
+}
+
+int batch_compile_multi(const AbacoContext *ctx, const TokenBuffer *const *rpns, int count,
+                        BatchProgram *prog) {
+    memset(prog, 0, sizeof(*prog));
+    prog->ctx = ctx;
+    if (count < 1 || count > BATCH_MAX_OUTPUTS) return 0;
+
+    int ops_cap = 0, values_cap = 0;
+    for (int k = 0; k < count; k++) {
+        prog->rpn[k] = rpns[k];
+        if (!lower_rpn(prog, rpns[k], &ops_cap, &values_cap)) {
+            batch_free(prog);
+            return 0;
+        }
+        // Todas as saídas menos a última são guardadas em colunas temporárias
+        if (k < count - 1) {
+            if (!push_op(prog, &ops_cap, BATCH_OP_STORE, 0, prog->temps)) {
+                batch_free(prog);
+                return 0;
+            }
+            prog->result[k] = prog->temps++;
+        } else {
+            prog->result[k] = -1;
+        }
+    }
+    prog->outputs = count;
+    return 1;
+}
+
+int batch_compile(const AbacoContext *ctx, const TokenBuffer *rpn, BatchProgram *prog) {
+    return batch_compile_multi(ctx, &rpn, 1, prog);
+}
+
+void batch_free(BatchProgram *prog) {
+    if (!prog) return;
+    for (int k = 0; k < prog->calls_size; k++) {
+        parser_free_buffer(&prog->calls[k]);
+    }
+    free(prog->calls);
+    free(prog->ops);
+    free(prog->values);
+    prog->calls = NULL;
+    prog->ops = NULL;
+    prog->values = NULL;
+    prog->size = prog->values_size = prog->calls_size = prog->depth = prog->temps = 0;
+    prog->outputs = 0;
+}
+
+/* Cópia de um TokenBuffer (tokens e constantes) */
+static int copy_buffer(const TokenBuffer *src, TokenBuffer *dst) {
+    parser_init_buffer(dst);
+    for (int i = 0; i < src->size; i++) {
+        if (!parser_add_token(dst, src->tokens[i])) return 0;
+    }
+    if (src->values_size > 0) {
+        free(dst->values);
+        dst->values = malloc(src->values_size * sizeof(double));
+        if (!dst->values) return 0;
+        memcpy(dst->values, src->values, src->values_size * sizeof(double));
+        dst->values_size = dst->values_capacity = src->values_size;
+    }
+    return 1;
+}
+
+int batch_bind_rpn(const TokenBuffer *rpn, int first, const double *values, int count, TokenBuffer *out) {
+    if (!copy_buffer(rpn, out)) {
+        parser_free_buffer(out);
+        return 0;
+    }
+
+    // Constantes da RPN e, depois delas, os valores dos parâmetros
+    const int base = rpn->values_size;
+    double *tmp = realloc(out->values, (base + count > 0 ? base + count : 1) * sizeof(double));
+    if (!tmp) {
+        parser_free_buffer(out);
+        return 0;
+    }
+    if (count > 0) memcpy(tmp + base, values, count * sizeof(double));
+    out->values = tmp;
+    out->values_size = out->values_capacity = base + count;
+
+    for (int i = 0; i < out->size; i++) {
+        Token *tk = &out->tokens[i];
+        if (tk->type == TOKEN_VARIABLE && tk->value_index >= first && tk->value_index < first + count) {
+            tk->value_index = (uint16_t)(base + tk->value_index - first);
+            tk->type = TOKEN_NUMBER;
+        }
+    }
+    return 1;
+}
+
+int batch_bind(const BatchProgram *prog, int first, const double *values, int count,
+               const TokenBuffer *const *rpns, BatchProgram *out) {
+    *out = *prog;
+    out->ops = malloc((prog->size > 0 ? prog->size : 1) * sizeof(BatchOp));
+    out->values = malloc((prog->values_size + count > 0 ? prog->values_size + count : 1) * sizeof(double));
+    out->calls = (prog->calls_size > 0) ? calloc(prog->calls_size, sizeof(TokenBuffer)) : NULL;
+    out->calls_size = 0;
+    int ok = out->ops && out->values && (out->calls || prog->calls_size == 0);
+    for (int k = 0; ok && k < prog->calls_size; k++) {
+        ok = copy_buffer(&prog->calls[k], &out->calls[k]);
+        out->calls_size = k + 1;
+    }
+    if (!ok) {
+        batch_free(out);
+        return 0;
+    }
+
+    memcpy(out->ops, prog->ops, prog->size * sizeof(BatchOp));
+    if (prog->values_size > 0) memcpy(out->values, prog->values, prog->values_size * sizeof(double));
+    if (count > 0) memcpy(out->values + prog->values_size, values, count * sizeof(double));
+    out->values_size = prog->values_size + count;
+    for (int k = 0; k < out->size; k++) {
+        BatchOp *op = &out->ops[k];
+        if (op->op == BATCH_OP_VAR && op->arg >= first && op->arg < first + count) {
+            op->op = BATCH_OP_CONST;
+            op->arg = (uint16_t)(prog->values_size + op->arg - first);
+        }
+    }
+    for (int k = 0; k < prog->outputs; k++) out->rpn[k] = rpns[k];
+    return 1;
+}
+
+/* Aplica uma função da libm a uma coluna. O `switch` fica fora do laço para
+ * que cada caso seja um laço simples sobre o bloco. */
+#define MAP_COLUMN(fn) for (int i = 0; i < m; i++) a[i] = fn(a[i]); break
+
+static void apply_libm(int type, double *a, int m) {
+    switch (type) {
+        case TOKEN_SIN:   MAP_COLUMN(sin);
+        case TOKEN_COS:   MAP_COLUMN(cos);
+        case TOKEN_TAN:   MAP_COLUMN(tan);
+        case TOKEN_ABS:   MAP_COLUMN(fabs);
+        case TOKEN_SQRT:  MAP_COLUMN(sqrt);
+        case TOKEN_EXP:   MAP_COLUMN(exp);
+        case TOKEN_LOG:   MAP_COLUMN(log);
+        case TOKEN_LOG10: MAP_COLUMN(log10);
+        case TOKEN_SINH:  MAP_COLUMN(sinh);
+        case TOKEN_COSH:  MAP_COLUMN(cosh);
+        case TOKEN_TANH:  MAP_COLUMN(tanh);
+        case TOKEN_ASIN:  MAP_COLUMN(asin);
+        case TOKEN_ACOS:  MAP_COLUMN(acos);
+        case TOKEN_ATAN:  MAP_COLUMN(atan);
+        case TOKEN_ASINH: MAP_COLUMN(asinh);
+        case TOKEN_ACOSH: MAP_COLUMN(acosh);
+        case TOKEN_ATANH: MAP_COLUMN(atanh);
+        case TOKEN_CEIL:  MAP_COLUMN(ceil);
+        case TOKEN_FLOOR: MAP_COLUMN(floor);
+        default:
+            for (int i = 0; i < m; i++) a[i] = NAN;
+            break;
+    }
+}
+
+#undef MAP_COLUMN
+
+/* Marca lanes cujo valor deixou de ser finito (x - x é NaN para Inf/NaN). */
+static inline void mark_bad(const double *v, unsigned char *bad, int m) {
+    for (int i = 0; i < m; i++) {
+        bad[i] |= (v[i] - v[i]) != 0.0;
+    }
+}
+
+/* Executa o programa sobre um bloco de m <= BATCH_BLOCK_SIZE amostras.
+ * vars[k] é a coluna da variável k do contexto, já no início do bloco. */
+static void run_block(const BatchProgram *prog, double *cols, const double *const *vars,
+                      unsigned char *bad, int m) {
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        double *a = cols + (size_t)op.slot * BATCH_BLOCK_SIZE;
+        const double *b = a + BATCH_BLOCK_SIZE;
+
+        switch (op.op) {
+            case BATCH_OP_CONST: {
+                const double v = prog->values[op.arg];
+                for (int i = 0; i < m; i++) a[i] = v;
+                break;
+            }
+            case BATCH_OP_VAR:
+                memcpy(a, vars[op.arg], m * sizeof(double));
+                break;
+            case BATCH_OP_NEG:
+                for (int i = 0; i < m; i++) a[i] = -a[i];
+                break;
+            case BATCH_OP_ADD:
+                for (int i = 0; i < m; i++) a[i] = a[i] + b[i];
+                mark_bad(a, bad, m);
+                break;
+            case BATCH_OP_SUB:
+                for (int i = 0; i < m; i++) a[i] = a[i] - b[i];
+                mark_bad(a, bad, m);
+                break;
+            case BATCH_OP_MUL:
+                for (int i = 0; i < m; i++) a[i] = a[i] * b[i];
+                mark_bad(a, bad, m);
+                break;
+            case BATCH_OP_DIV:
+                for (int i = 0; i < m; i++) a[i] = a[i] / b[i];
+                mark_bad(a, bad, m);
+                break;
+            case BATCH_OP_POW:
+                vecmath_pow(a, b, a, bad, m);
+                break;
+            case BATCH_OP_FUNC:
+                switch (op.arg) {
+                    case TOKEN_SIN:  vecmath_sin(a, a, bad, m); break;
+                    case TOKEN_COS:  vecmath_cos(a, a, bad, m); break;
+                    case TOKEN_EXP:  vecmath_exp(a, a, bad, m); break;
+                    case TOKEN_LOG:  vecmath_log(a, a, bad, m); break;
+                    case TOKEN_SQRT: vecmath_sqrt(a, a, bad, m); break;
+                    default:
+                        apply_libm(op.arg, a, m);
+                        mark_bad(a, bad, m);
+                }
+                break;
+            case BATCH_OP_CALL: {
+                const TokenBuffer *call = &prog->calls[op.arg];
+                for (int i = 0; i < m; i++) {
+                    if (bad[i]) continue;
+                    EvalResult r = batch_eval_at(prog->ctx, call, a[i]);
+                    if (r.error != EVAL_OK) bad[i] = 1;
+                    else a[i] = r.value;
+                }
+                break;
+            }
+            case BATCH_OP_SINCOS: {
+                double *c = cols + (size_t)(prog->depth + op.arg) * BATCH_BLOCK_SIZE;
+                vecmath_sincos(a, a, c, m);
+                mark_bad(a, bad, m);
+                break;
+            }
+            case BATCH_OP_COSSIN: {
+                double *s = cols + (size_t)(prog->depth + op.arg) * BATCH_BLOCK_SIZE;
+                vecmath_sincos(a, s, a, m);
+                mark_bad(a, bad, m);
+                break;
+            }
+            case BATCH_OP_LOAD:
+                memcpy(a, cols + (size_t)(prog->depth + op.arg) * BATCH_BLOCK_SIZE, m * sizeof(double));
+                break;
+            case BATCH_OP_STORE:
+                memcpy(cols + (size_t)(prog->depth + op.arg) * BATCH_BLOCK_SIZE, a, m * sizeof(double));
+                break;
+        }
+    }
+}
+
+static void eval_scalar(const AbacoContext *ctx, const TokenBuffer *rpn,
+                        const double *t, double *values, EvalError *errors, int n) {
+    for (int i = 0; i < n; i++) {
+        EvalResult r = batch_eval_at(ctx, rpn, t[i]);
+        values[i] = r.value;
+        errors[i] = r.error;
+    }
+}
+
+/* Coluna onde fica o resultado da saída k depois de run_block(). */
+static double *result_column(const BatchProgram *prog, double *cols, int k) {
+    const int r = prog->result[k];
+    return (r < 0) ? cols : cols + (size_t)(prog->depth + r) * BATCH_BLOCK_SIZE;
+}
+
+static BatchEngine current_engine = BATCH_ENGINE_BLOCK;
+
+void batch_set_engine(BatchEngine engine) {
+    current_engine = engine;
+}
+
+BatchEngine batch_engine(void) {
+    return current_engine;
+}
+
+const char *batch_engine_name(BatchEngine engine) {
+    switch (engine) {
+        case BATCH_ENGINE_THREADED: return "threaded";
+        case BATCH_ENGINE_SCALAR:   return "scalar";
+        case BATCH_ENGINE_JIT:      return "jit";
+        default:                    return "block";
+    }
+}
+
+int batch_engine_parse(const char *name, BatchEngine *engine) {
+    static const BatchEngine all[] = {
+        BATCH_ENGINE_BLOCK, BATCH_ENGINE_THREADED, BATCH_ENGINE_SCALAR, BATCH_ENGINE_JIT
+    };
+    for (size_t k = 0; k < sizeof(all) / sizeof(all[0]); k++) {
+        if (strcmp(name, batch_engine_name(all[k])) == 0) {
+            *engine = all[k];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void batch_eval_multi(const BatchProgram *prog, const double *t,
+                      double *const *values, EvalError *const *errors, int n) {
+    const int outputs = prog->outputs;
+
+    if (current_engine == BATCH_ENGINE_SCALAR) {
+        for (int k = 0; k < outputs; k++) {
+            eval_scalar(prog->ctx, prog->rpn[k], t, values[k], errors[k], n);
+        }
+        return;
+    }
+    if (current_engine == BATCH_ENGINE_THREADED && batch_run_threaded(prog, t, values, errors, n)) {
+        return;
+    }
+    if (current_engine == BATCH_ENGINE_JIT && batch_run_jit(prog, t, values, errors, n)) {
+        return;
+    }
+
+    double *cols = malloc((size_t)(prog->depth + prog->temps) * BATCH_BLOCK_SIZE * sizeof(double));
+    if (!cols) {
+        for (int k = 0; k < outputs; k++) {
+            eval_scalar(prog->ctx, prog->rpn[k], t, values[k], errors[k], n);
+        }
+        return;
+    }
+
+    unsigned char bad[BATCH_BLOCK_SIZE];
+    const double *vars[BATCH_MAX_VARIABLES];
+    for (int start = 0; start < n; start += BATCH_BLOCK_SIZE) {
+        int m = n - start;
+        if (m > BATCH_BLOCK_SIZE) m = BATCH_BLOCK_SIZE;
+
+        // x, theta e t são aliases: todas as variáveis leem t
+        for (int k = 0; k < BATCH_MAX_VARIABLES; k++) vars[k] = t + start;
+        memset(bad, 0, m);
+        run_block(prog, cols, vars, bad, m);
+
+        for (int k = 0; k < outputs; k++) {
+            const double *res = result_column(prog, cols, k);
+            double *v = values[k] + start;
+            EvalError *e = errors[k] + start;
+            for (int i = 0; i < m; i++) {
+                if (bad[i]) {
+                    // Caminho lento: o avaliador escalar decide valor e erro.
+                    // Com saídas fundidas, `bad` é comum a todas: a lane é
+                    // refeita em cada uma (cada uma com a sua RPN).
+                    EvalResult r = batch_eval_at(prog->ctx, prog->rpn[k], t[start + i]);
+                    v[i] = r.value;
+                    e[i] = r.error;
+                } else {
+                    v[i] = res[i];
+                    e[i] = EVAL_OK;
+                }
+            }
+        }
+    }
+
+    free(cols);
+}
+
+/* Uma amostra de batch_eval_vars() pelo avaliador escalar. */
+static EvalResult eval_vars_at(const AbacoContext *ctx, const TokenBuffer *rpn, const double *const *vars,
+                               int nvars, int i) {
+    double v[BATCH_MAX_VARIABLES] = { 0.0 };
+    for (int k = 0; k < nvars; k++) v[k] = vars[k][i];
+    return evaluator_eval_rpn(ctx, rpn, v);
+}
+
+void batch_eval_vars(const BatchProgram *prog, const double *const *vars, int nvars,
+                     double *values, EvalError *errors, int n) {
+    double *cols = (current_engine == BATCH_ENGINE_SCALAR)
+                       ? NULL
+                       : malloc((size_t)(prog->depth + prog->temps) * BATCH_BLOCK_SIZE * sizeof(double));
+    if (!cols) {
+        for (int i = 0; i < n; i++) {
+            EvalResult r = eval_vars_at(prog->ctx, prog->rpn[0], vars, nvars, i);
+            values[i] = r.value;
+            errors[i] = r.error;
+        }
+        return;
+    }
+
+    unsigned char bad[BATCH_BLOCK_SIZE];
+    const double *bloco[BATCH_MAX_VARIABLES];
+    for (int start = 0; start < n; start += BATCH_BLOCK_SIZE) {
+        int m = n - start;
+        if (m > BATCH_BLOCK_SIZE) m = BATCH_BLOCK_SIZE;
+
+        for (int k = 0; k < BATCH_MAX_VARIABLES; k++) bloco[k] = vars[k < nvars ? k : 0] + start;
+        memset(bad, 0, m);
+        run_block(prog, cols, bloco, bad, m);
+
+        const double *res = result_column(prog, cols, 0);
+        for (int i = 0; i < m; i++) {
+            if (bad[i]) {
+                EvalResult r = eval_vars_at(prog->ctx, prog->rpn[0], vars, nvars, start + i);
+                values[start + i] = r.value;
+                errors[start + i] = r.error;
+            } else {
+                values[start + i] = res[i];
+                errors[start + i] = EVAL_OK;
+            }
+        }
+    }
+
+    free(cols);
+}
+
+void batch_eval(const BatchProgram *prog, const double *t, double *values, EvalError *errors, int n) {
+    if (prog->outputs == 1) {
+        batch_eval_multi(prog, t, &values, &errors, n);
+        return;
+    }
+    // Programa fundido: só a primeira saída interessa, descarta as demais
+    double *vs[BATCH_MAX_OUTPUTS];
+    EvalError *es[BATCH_MAX_OUTPUTS];
+    int ok = 1;
+    vs[0] = values;
+    es[0] = errors;
+    for (int k = 1; k < prog->outputs; k++) {
+        vs[k] = malloc(n * sizeof(double));
+        es[k] = malloc(n * sizeof(EvalError));
+        ok = ok && vs[k] && es[k];
+    }
+    if (ok) batch_eval_multi(prog, t, vs, es, n);
+    else eval_scalar(prog->ctx, prog->rpn[0], t, values, errors, n);
+    for (int k = 1; k < prog->outputs; k++) {
+        free(vs[k]);
+        free(es[k]);
+    }
+}
+
+void batch_eval_rpn(const AbacoContext *ctx, const TokenBuffer *rpn,
+                    const double *t, double *values, EvalError *errors, int n) {
+    BatchProgram prog;
+    if (!batch_compile(ctx, rpn, &prog)) {
+        eval_scalar(ctx, rpn, t, values, errors, n);
+        return;
+    }
+    batch_optimize(&prog, BATCH_OPT_ALL);  // se falhar, segue com o programa original
+    batch_eval(&prog, t, values, errors, n);
+    batch_free(&prog);
+}
+
+void batch_eval_rpn_multi(const AbacoContext *ctx, const TokenBuffer *const *rpns, int count,
+                          const double *t, double *const *values, EvalError *const *errors, int n) {
+    BatchProgram prog;
+    if (!batch_compile_multi(ctx, rpns, count, &prog)) {
+        // Alguma RPN não baixa (ou count inválido): avalia uma a uma
+        for (int k = 0; k < count; k++) {
+            batch_eval_rpn(ctx, rpns[k], t, values[k], errors[k], n);
+        }
+        return;
+    }
+    batch_optimize(&prog, BATCH_OPT_ALL);
+    batch_eval_multi(&prog, t, values, errors, n);
+    batch_free(&prog);
+}
@@ -0,0 +1,54 @@
+/* Partes internas do avaliador em lote compartilhadas entre batch_eval.c e
+ * os motores alternativos (batch_threaded.c). Não faz parte da API pública.
+ */
+#ifndef BATCH_INTERNAL_H
+#define BATCH_INTERNAL_H
+
+#include "../include/batch_eval.h"
+#include <math.h>
+
+/* Avalia a RPN com todas as variáveis valendo t (x, theta e t são aliases). */
+static inline EvalResult batch_eval_at(const AbacoContext *ctx, const TokenBuffer *rpn, double t) {
+    double vars[BATCH_MAX_VARIABLES];
+    for (int k = 0; k < BATCH_MAX_VARIABLES; k++) vars[k] = t;
+    return evaluator_eval_rpn(ctx, rpn, vars);
+}
+
+/* Função da libm correspondente a um token de função, ou NULL se não houver
+ * (usada pelos motores que avaliam ponto a ponto). */
+static inline double (*batch_libm_function(int type))(double) {
+    switch (type) {
+        case TOKEN_SIN:   return sin;
+        case TOKEN_COS:   return cos;
+        case TOKEN_TAN:   return tan;
+        case TOKEN_ABS:   return fabs;
+        case TOKEN_SQRT:  return sqrt;
+        case TOKEN_EXP:   return exp;
+        case TOKEN_LOG:   return log;
+        case TOKEN_LOG10: return log10;
+        case TOKEN_SINH:  return sinh;
+        case TOKEN_COSH:  return cosh;
+        case TOKEN_TANH:  return tanh;
+        case TOKEN_ASIN:  return asin;
+        case TOKEN_ACOS:  return acos;
+        case TOKEN_ATAN:  return atan;
+        case TOKEN_ASINH: return asinh;
+        case TOKEN_ACOSH: return acosh;
+        case TOKEN_ATANH: return atanh;
+        case TOKEN_CEIL:  return ceil;
+        case TOKEN_FLOOR: return floor;
+        default:          return NULL;
+    }
+}
+
+/* Motor BATCH_ENGINE_THREADED (mesma semântica de batch_eval_multi).
+ * Retorna 0 se faltou memória (nada foi escrito). */
+int batch_run_threaded(const BatchProgram *prog, const double *t,
+                       double *const *values, EvalError *const *errors, int n);
+
+/* Motor BATCH_ENGINE_JIT (batch_jit.c). Retorna 0 se o JIT não está
+ * disponível ou faltou memória (nada foi escrito). */
+int batch_run_jit(const BatchProgram *prog, const double *t,
+                  double *const *values, EvalError *const *errors, int n);
+
+#endif /* BATCH_INTERNAL_H */
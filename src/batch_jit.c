@@ -0,0 +1,373 @@
+/* JIT x86-64 do avaliador em lote (ver include/batch_jit.h).
+ *
+ * A função gerada tem a assinatura `double f(double *bank)` (System V):
+ * rbx aponta para o banco durante toda a execução e cada operando é
+ * [rbx + disp32]. Layout do banco (em doubles):
+ *
+ *   [0, nregs)        slots da pilha e temporários (depth + temps)
+ *   nregs             t corrente (escrito por quem chama)
+ *   nregs + 1         acumulador de checagem (zerado no prólogo, devolvido em xmm0)
+ *   nregs + 2         rascunho (argumento de sincos)
+ *   nregs + 3 + k     constante prog->values[k]
+ *
+ * O código é o mais direto possível (load, op, store por instrução): o ganho
+ * sobre o interpretador vem de não haver despacho nenhum, não de alocação de
+ * registradores.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "../include/batch_jit.h"
+#include "batch_internal.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(MULTICURVAS_NO_JIT)
+#define JIT_ENABLED 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define JIT_ENABLED 0
+#endif
+
+struct BatchJitCall {
+    const AbacoContext *ctx;
+    const TokenBuffer *rpn;
+};
+
+typedef double (*JitFn)(double *bank);
+
+/* Índices fixos do banco (relativos a nregs). */
+#define JIT_T(nregs)       ((nregs) + 0)
+#define JIT_CHK(nregs)     ((nregs) + 1)
+#define JIT_SCRATCH(nregs) ((nregs) + 2)
+#define JIT_CONST(nregs)   ((nregs) + 3)
+
+#if JIT_ENABLED
+
+/* Chamado pelo código gerado para BATCH_OP_CALL (funções sem kernel). */
+static double jit_call(const BatchJitCall *call, double x, double *chk) {
+    EvalResult r = batch_eval_at(call->ctx, call->rpn, x);
+    if (r.error != EVAL_OK) *chk = NAN;
+    return r.value;
+}
+
+typedef struct {
+    unsigned char *buf;
+    size_t size, capacity;
+    int ok;
+} JitEmit;
+
+static void emit(JitEmit *e, const unsigned char *bytes, size_t n) {
+    if (!e->ok) return;
+    if (e->size + n > e->capacity) {
+        size_t ncap = e->capacity ? e->capacity * 2 : 1024;
+        while (ncap < e->size + n) ncap *= 2;
+        unsigned char *tmp = realloc(e->buf, ncap);
+        if (!tmp) {
+            e->ok = 0;
+            return;
+        }
+        e->buf = tmp;
+        e->capacity = ncap;
+    }
+    memcpy(e->buf + e->size, bytes, n);
+    e->size += n;
+}
+
+static void emit_u64(JitEmit *e, uint64_t v) {
+    unsigned char b[8];
+    for (int k = 0; k < 8; k++) b[k] = (unsigned char)(v >> (8 * k));
+    emit(e, b, 8);
+}
+
+/* modrm [rbx + disp32] com o registrador `reg` + disp32 do índice no banco. */
+static void emit_mem(JitEmit *e, int reg, int index) {
+    const uint32_t disp = (uint32_t)index * 8u;
+    unsigned char b[5] = {
+        (unsigned char)(0x80 | (reg << 3) | 3),
+        (unsigned char)disp, (unsigned char)(disp >> 8),
+        (unsigned char)(disp >> 16), (unsigned char)(disp >> 24)
+    };
+    emit(e, b, 5);
+}
+
+/* F2 0F op /r: movsd (0x10 load, 0x11 store), addsd 0x58, mulsd 0x59,
+ * subsd 0x5C, divsd 0x5E — xmm`reg` com [rbx + 8*index]. */
+static void emit_sd(JitEmit *e, unsigned char op, int reg, int index) {
+    const unsigned char b[3] = { 0xF2, 0x0F, op };
+    emit(e, b, 3);
+    emit_mem(e, reg, index);
+}
+
+#define SD_LOAD  0x10
+#define SD_STORE 0x11
+#define SD_ADD   0x58
+#define SD_MUL   0x59
+#define SD_SUB   0x5C
+#define SD_DIV   0x5E
+
+/* mov rax, imm64; call rax */
+static void emit_call(JitEmit *e, uint64_t target) {
+    static const unsigned char mov_rax[] = { 0x48, 0xB8 };
+    static const unsigned char call_rax[] = { 0xFF, 0xD0 };
+    emit(e, mov_rax, 2);
+    emit_u64(e, target);
+    emit(e, call_rax, 2);
+}
+
+/* chk += xmm0 - xmm0 */
+static void emit_check(JitEmit *e, int nregs) {
+    static const unsigned char movapd_x1_x0[] = { 0x66, 0x0F, 0x28, 0xC8 };
+    static const unsigned char subsd_x1_x0[] = { 0xF2, 0x0F, 0x5C, 0xC8 };
+    emit(e, movapd_x1_x0, 4);
+    emit(e, subsd_x1_x0, 4);
+    emit_sd(e, SD_ADD, 1, JIT_CHK(nregs));
+    emit_sd(e, SD_STORE, 1, JIT_CHK(nregs));
+}
+
+static uint64_t fn_address(double (*fn)(double)) {
+    return (uint64_t)(uintptr_t)fn;
+}
+
+/* xmm0 ← f(xmm0) pela libm, resultado em [index], com checagem. */
+static void emit_libm(JitEmit *e, double (*fn)(double), int index, int nregs) {
+    emit_call(e, fn_address(fn));
+    emit_sd(e, SD_STORE, 0, index);
+    emit_check(e, nregs);
+}
+
+static int generate(const BatchProgram *prog, const BatchJitCall *calls, JitEmit *e) {
+    const int nregs = prog->depth + prog->temps;
+
+    // Prólogo: push rbx; mov rbx, rdi; chk = 0
+    static const unsigned char prologue[] = {
+        0x53,                   /* push rbx */
+        0x48, 0x89, 0xFB,       /* mov rbx, rdi */
+        0x66, 0x0F, 0x57, 0xC0  /* xorpd xmm0, xmm0 */
+    };
+    emit(e, prologue, sizeof(prologue));
+    emit_sd(e, SD_STORE, 0, JIT_CHK(nregs));
+
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        const int a = op.slot;
+        const int b = op.slot + 1;
+        const int temp = prog->depth + op.arg;
+
+        switch (op.op) {
+            case BATCH_OP_CONST:
+                emit_sd(e, SD_LOAD, 0, JIT_CONST(nregs) + op.arg);
+                emit_sd(e, SD_STORE, 0, a);
+                break;
+            case BATCH_OP_VAR:
+                emit_sd(e, SD_LOAD, 0, JIT_T(nregs));
+                emit_sd(e, SD_STORE, 0, a);
+                break;
+            case BATCH_OP_NEG: {
+                // Troca o bit de sinal: movq rax, xmm0; btc rax, 63; movq xmm0, rax
+                static const unsigned char neg[] = {
+                    0x66, 0x48, 0x0F, 0x7E, 0xC0,
+                    0x48, 0x0F, 0xBA, 0xF8, 0x3F,
+                    0x66, 0x48, 0x0F, 0x6E, 0xC0
+                };
+                emit_sd(e, SD_LOAD, 0, a);
+                emit(e, neg, sizeof(neg));
+                emit_sd(e, SD_STORE, 0, a);
+                break;
+            }
+            case BATCH_OP_ADD: case BATCH_OP_SUB: case BATCH_OP_MUL: case BATCH_OP_DIV: {
+                unsigned char sd = (op.op == BATCH_OP_ADD) ? SD_ADD :
+                                   (op.op == BATCH_OP_SUB) ? SD_SUB :
+                                   (op.op == BATCH_OP_MUL) ? SD_MUL : SD_DIV;
+                emit_sd(e, SD_LOAD, 0, a);
+                emit_sd(e, sd, 0, b);
+                emit_sd(e, SD_STORE, 0, a);
+                emit_check(e, nregs);
+                break;
+            }
+            case BATCH_OP_POW:
+                emit_sd(e, SD_LOAD, 0, a);
+                emit_sd(e, SD_LOAD, 1, b);
+                emit_call(e, (uint64_t)(uintptr_t)pow);
+                emit_sd(e, SD_STORE, 0, a);
+                emit_check(e, nregs);
+                break;
+            case BATCH_OP_FUNC: {
+                double (*fn)(double) = batch_libm_function(op.arg);
+                if (!fn) return 0;
+                emit_sd(e, SD_LOAD, 0, a);
+                emit_libm(e, fn, a, nregs);
+                break;
+            }
+            case BATCH_OP_CALL: {
+                // jit_call(&calls[arg], x, &chk)
+                static const unsigned char mov_rdi[] = { 0x48, 0xBF };
+                static const unsigned char lea_rsi[] = { 0x48, 0x8D };
+                emit_sd(e, SD_LOAD, 0, a);
+                emit(e, mov_rdi, 2);
+                emit_u64(e, (uint64_t)(uintptr_t)&calls[op.arg]);
+                emit(e, lea_rsi, 2);
+                emit_mem(e, 6, JIT_CHK(nregs));
+                emit_call(e, (uint64_t)(uintptr_t)jit_call);
+                emit_sd(e, SD_STORE, 0, a);
+                break;
+            }
+            case BATCH_OP_LOAD:
+                emit_sd(e, SD_LOAD, 0, temp);
+                emit_sd(e, SD_STORE, 0, a);
+                break;
+            case BATCH_OP_STORE:
+                emit_sd(e, SD_LOAD, 0, a);
+                emit_sd(e, SD_STORE, 0, temp);
+                break;
+            case BATCH_OP_SINCOS: case BATCH_OP_COSSIN: {
+                const int sin_first = (op.op == BATCH_OP_SINCOS);
+                emit_sd(e, SD_LOAD, 0, a);
+                emit_sd(e, SD_STORE, 0, JIT_SCRATCH(nregs));
+                emit_libm(e, sin_first ? sin : cos, a, nregs);
+                emit_sd(e, SD_LOAD, 0, JIT_SCRATCH(nregs));
+                emit_call(e, fn_address(sin_first ? cos : sin));
+                emit_sd(e, SD_STORE, 0, temp);
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    // Epílogo: return chk
+    static const unsigned char epilogue[] = { 0x5B, 0xC3 };  /* pop rbx; ret */
+    emit_sd(e, SD_LOAD, 0, JIT_CHK(nregs));
+    emit(e, epilogue, sizeof(epilogue));
+    return e->ok;
+}
+
+#endif /* JIT_ENABLED */
+
+int batch_jit_available(void) {
+    return JIT_ENABLED;
+}
+
+void batch_jit_free(BatchJit *jit) {
+    if (!jit) return;
+#if JIT_ENABLED
+    if (jit->code) munmap(jit->code, jit->code_size);
+#endif
+    free(jit->bank);
+    free(jit->calls);
+    memset(jit, 0, sizeof(*jit));
+}
+
+int batch_jit_compile(const BatchProgram *prog, BatchJit *jit) {
+    memset(jit, 0, sizeof(*jit));
+#if JIT_ENABLED
+    jit->prog = prog;
+    const int nregs = prog->depth + prog->temps;
+    jit->bank_size = JIT_CONST(nregs) + prog->values_size;
+    jit->bank = calloc(jit->bank_size, sizeof(double));
+    jit->calls = malloc((prog->calls_size + 1) * sizeof(BatchJitCall));
+    if (!jit->bank || !jit->calls) {
+        batch_jit_free(jit);
+        return 0;
+    }
+    for (int k = 0; k < prog->values_size; k++) {
+        jit->bank[JIT_CONST(nregs) + k] = prog->values[k];
+    }
+    for (int k = 0; k < prog->calls_size; k++) {
+        jit->calls[k].ctx = prog->ctx;
+        jit->calls[k].rpn = &prog->calls[k];
+    }
+
+    JitEmit e = { NULL, 0, 0, 1 };
+    if (!generate(prog, jit->calls, &e)) {
+        free(e.buf);
+        batch_jit_free(jit);
+        return 0;
+    }
+
+    // Grava numa página RW e só depois a torna RX
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    jit->code_size = (e.size + page - 1) / page * page;
+    void *mem = mmap(NULL, jit->code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        free(e.buf);
+        jit->code_size = 0;
+        batch_jit_free(jit);
+        return 0;
+    }
+    memcpy(mem, e.buf, e.size);
+    free(e.buf);
+    jit->code = mem;
+    if (mprotect(mem, jit->code_size, PROT_READ | PROT_EXEC) != 0) {
+        batch_jit_free(jit);
+        return 0;
+    }
+    return 1;
+#else
+    (void)prog;
+    return 0;
+#endif
+}
+
+static JitFn jit_function(const BatchJit *jit) {
+    JitFn fn;
+    memcpy(&fn, &jit->code, sizeof(fn));
+    return fn;
+}
+
+int batch_jit_eval_multi(const BatchJit *jit, const double *t,
+                         double *const *values, EvalError *const *errors, int n) {
+    if (!jit->code) return 0;
+    const BatchProgram *prog = jit->prog;
+    const int nregs = prog->depth + prog->temps;
+
+    // Cópia local do banco: várias threads podem usar o mesmo BatchJit
+    double *bank = malloc(jit->bank_size * sizeof(double));
+    if (!bank) return 0;
+    memcpy(bank, jit->bank, jit->bank_size * sizeof(double));
+
+    const JitFn fn = jit_function(jit);
+    for (int i = 0; i < n; i++) {
+        bank[JIT_T(nregs)] = t[i];
+        const double chk = fn(bank);
+        for (int k = 0; k < prog->outputs; k++) {
+            if (chk == 0.0) {
+                values[k][i] = (prog->result[k] < 0) ? bank[0] : bank[prog->depth + prog->result[k]];
+                errors[k][i] = EVAL_OK;
+            } else {
+                EvalResult r = batch_eval_at(prog->ctx, prog->rpn[k], t[i]);
+                values[k][i] = r.value;
+                errors[k][i] = r.error;
+            }
+        }
+    }
+
+    free(bank);
+    return 1;
+}
+
+void batch_jit_eval_array(const BatchJit *jit, const double *t, double *values,
+                          EvalError *errors, int n) {
+    if (jit->prog->outputs == 1 && batch_jit_eval_multi(jit, t, &values, &errors, n)) return;
+    batch_eval(jit->prog, t, values, errors, n);
+}
+
+double batch_jit_eval(const BatchJit *jit, double t, EvalError *error) {
+    double value;
+    EvalError err;
+    batch_jit_eval_array(jit, &t, &value, &err, 1);
+    if (error) *error = err;
+    return value;
+}
+
+int batch_run_jit(const BatchProgram *prog, const double *t,
+                  double *const *values, EvalError *const *errors, int n) {
+    BatchJit jit;
+    if (!batch_jit_compile(prog, &jit)) return 0;
+    int ok = batch_jit_eval_multi(&jit, t, values, errors, n);
+    batch_jit_free(&jit);
+    return ok;
+}
@@ -0,0 +1,475 @@
+/* Otimizador do programa em lote (entre parser_to_rpn() e a avaliação).
+ *
+ * O BatchProgram é convertido num DAG de expressões: cada nó é uma operação
+ * com até dois filhos. Na construção os nós passam por dobra de constantes,
+ * troca de x^2 por x*x e de e^x por exp(x); com CSE ligado,
+ * nós idênticos são reaproveitados (hash-consing por busca linear: as
+ * expressões das curvas têm poucas dezenas de nós). No fim o DAG é emitido de
+ * volta como programa de pilha, e nós usados mais de uma vez ficam em
+ * colunas temporárias (BATCH_OP_STORE / BATCH_OP_LOAD).
+ *
+ * Programas fundidos (batch_compile_multi) viram um único DAG com uma raiz
+ * por saída, então o CSE também enxerga termos comuns entre X e Y.
+ */
+
+#include "../include/batch_eval.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define OPT_E 2.718281828459045235360287  /* constante e, como o Abaco a usa */
+
+typedef struct {
+    uint8_t op;       /* BatchOpCode */
+    uint16_t arg;     /* token da função / índice de call */
+    double value;     /* BATCH_OP_CONST */
+    int a, b;         /* filhos (-1 = nenhum) */
+    int uses;         /* referências a partir de nós alcançáveis */
+    int temp;         /* coluna temporária (-1 = nenhuma) */
+    int pair;         /* sin/cos do mesmo argumento (-1 = nenhum) */
+    int emitted;      /* já calculado e guardado em `temp` */
+} OptNode;
+
+typedef struct {
+    const BatchProgram *src;
+    unsigned flags;
+    OptNode *nodes;
+    int size, capacity;
+} OptDag;
+
+typedef struct {
+    BatchOp *ops;
+    int size, capacity;
+    double *values;
+    int values_size, values_capacity;
+    int depth;
+    int temps;
+} OptEmit;
+
+static int op_arity(int op) {
+    switch (op) {
+        case BATCH_OP_CONST: case BATCH_OP_VAR:
+            return 0;
+        case BATCH_OP_NEG: case BATCH_OP_FUNC: case BATCH_OP_CALL:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+/* Token do Abaco equivalente a um nó (para dobrar pelo avaliador escalar). */
+static int node_token(const OptDag *dag, const OptNode *n) {
+    switch (n->op) {
+        case BATCH_OP_NEG:  return TOKEN_NEG;
+        case BATCH_OP_ADD:  return TOKEN_PLUS;
+        case BATCH_OP_SUB:  return TOKEN_MINUS;
+        case BATCH_OP_MUL:  return TOKEN_MULT;
+        case BATCH_OP_DIV:  return TOKEN_DIV;
+        case BATCH_OP_POW:  return TOKEN_POW;
+        case BATCH_OP_FUNC: return n->arg;
+        case BATCH_OP_CALL: {
+            // Mini-RPN do call é [var, f, END]
+            const TokenBuffer *call = &dag->src->calls[n->arg];
+            return call->size > 1 ? call->tokens[1].type : -1;
+        }
+        default:            return -1;
+    }
+}
+
+/* Calcula `token` aplicado a (a[, b]) com evaluator_eval_rpn, montando a
+ * mini-RPN [v0, v1, op] com as duas primeiras variáveis do contexto. */
+static int fold_with_evaluator(const OptDag *dag, int token, int arity, double a, double b, double *out) {
+    TokenBuffer buf;
+    parser_init_buffer(&buf);
+    Token tk;
+    memset(&tk, 0, sizeof(tk));
+    int ok = 1;
+    for (int k = 0; k < arity && ok; k++) {
+        tk.type = TOKEN_VARIABLE;
+        tk.value_index = (uint16_t)k;
+        ok = parser_add_token(&buf, tk);
+    }
+    tk.type = (uint8_t)token;
+    tk.value_index = 0;
+    ok = ok && parser_add_token(&buf, tk);
+    tk.type = TOKEN_END;
+    ok = ok && parser_add_token(&buf, tk);
+
+    if (ok) {
+        double vars[BATCH_MAX_VARIABLES];
+        for (int k = 0; k < BATCH_MAX_VARIABLES; k++) vars[k] = b;
+        vars[0] = a;
+        EvalResult r = evaluator_eval_rpn(dag->src->ctx, &buf, vars);
+        ok = (r.error == EVAL_OK && isfinite(r.value));
+        if (ok) *out = r.value;
+    }
+    parser_free_buffer(&buf);
+    return ok;
+}
+
+static int same_node(const OptNode *n, int op, int arg, double value, int a, int b) {
+    if (n->op != op || n->a != a || n->b != b) return 0;
+    if (op == BATCH_OP_CONST) return memcmp(&n->value, &value, sizeof(double)) == 0;
+    return n->arg == arg;
+}
+
+/* Cria (ou reaproveita, com CSE) um nó. Retorna o índice ou -1. */
+static int node_raw(OptDag *dag, int op, int arg, double value, int a, int b) {
+    if (dag->flags & BATCH_OPT_CSE) {
+        for (int k = 0; k < dag->size; k++) {
+            if (same_node(&dag->nodes[k], op, arg, value, a, b)) return k;
+        }
+    }
+    if (dag->size == dag->capacity) {
+        int ncap = dag->capacity ? dag->capacity * 2 : 32;
+        OptNode *tmp = realloc(dag->nodes, ncap * sizeof(OptNode));
+        if (!tmp) return -1;
+        dag->nodes = tmp;
+        dag->capacity = ncap;
+    }
+    OptNode *n = &dag->nodes[dag->size];
+    memset(n, 0, sizeof(*n));
+    n->op = (uint8_t)op;
+    n->arg = (uint16_t)arg;
+    n->value = value;
+    n->a = a;
+    n->b = b;
+    n->temp = -1;
+    n->pair = -1;
+    return dag->size++;
+}
+
+static int node_const(OptDag *dag, double v) {
+    return node_raw(dag, BATCH_OP_CONST, 0, v, -1, -1);
+}
+
+static int is_const(const OptDag *dag, int k) {
+    return k >= 0 && dag->nodes[k].op == BATCH_OP_CONST;
+}
+
+/* Cria um nó aplicando as reescritas locais habilitadas. */
+static int node_make(OptDag *dag, int op, int arg, int a, int b) {
+    int arity = op_arity(op);
+
+    if ((dag->flags & BATCH_OPT_FOLD) && arity > 0 &&
+        is_const(dag, a) && (arity == 1 || is_const(dag, b))) {
+        OptNode tmp = { 0 };
+        tmp.op = (uint8_t)op;
+        tmp.arg = (uint16_t)arg;
+        int token = node_token(dag, &tmp);
+        double v;
+        double va = dag->nodes[a].value;
+        double vb = (arity == 2) ? dag->nodes[b].value : 0.0;
+        if (token >= 0 && fold_with_evaluator(dag, token, arity, va, vb, &v)) {
+            return node_const(dag, v);
+        }
+    }
+
+    if (op == BATCH_OP_POW) {
+        if ((dag->flags & BATCH_OPT_EXP) && is_const(dag, a) && dag->nodes[a].value == OPT_E) {
+            return node_make(dag, BATCH_OP_FUNC, TOKEN_EXP, b, -1);
+        }
+        // Só x^2: cadeias maiores (x^3 = x*x*x, x^-2 = 1/(x*x)) arredondam
+        // mais de uma vez. Mesmo x*x pode diferir de pow(x, 2) em 1 ULP, por
+        // isso POW fica fora de BATCH_OPT_ALL
+        if ((dag->flags & BATCH_OPT_POW) && is_const(dag, b) && dag->nodes[b].value == 2.0) {
+            return node_make(dag, BATCH_OP_MUL, 0, a, a);
+        }
+    }
+
+    return node_raw(dag, op, arg, 0.0, a, b);
+}
+
+/* Constrói o DAG a partir do programa de pilha e devolve em `roots` o nó
+ * de cada saída. Retorna 1 se sucesso, 0 se faltou memória. */
+static int build_dag(OptDag *dag, int *roots) {
+    const BatchProgram *prog = dag->src;
+    int *stack = malloc((prog->depth + 1) * sizeof(int));
+    int *temp = malloc((prog->temps + 1) * sizeof(int));
+    if (!stack || !temp) {
+        free(stack);
+        free(temp);
+        return 0;
+    }
+
+    int ok = 1;
+    for (int k = 0; k < prog->size && ok; k++) {
+        const BatchOp op = prog->ops[k];
+        int s = op.slot;
+        int node;
+        switch (op.op) {
+            case BATCH_OP_CONST:
+                node = node_const(dag, prog->values[op.arg]);
+                break;
+            case BATCH_OP_VAR:
+                node = node_raw(dag, BATCH_OP_VAR, op.arg, 0.0, -1, -1);
+                break;
+            case BATCH_OP_NEG: case BATCH_OP_FUNC: case BATCH_OP_CALL:
+                node = node_make(dag, op.op, op.arg, stack[s], -1);
+                break;
+            case BATCH_OP_ADD: case BATCH_OP_SUB: case BATCH_OP_MUL:
+            case BATCH_OP_DIV: case BATCH_OP_POW:
+                node = node_make(dag, op.op, 0, stack[s], stack[s + 1]);
+                break;
+            case BATCH_OP_LOAD:
+                node = temp[op.arg];
+                break;
+            case BATCH_OP_STORE:
+                node = temp[op.arg] = stack[s];
+                break;
+            case BATCH_OP_SINCOS: case BATCH_OP_COSSIN: {
+                int sin_node = node_make(dag, BATCH_OP_FUNC, TOKEN_SIN, stack[s], -1);
+                int cos_node = node_make(dag, BATCH_OP_FUNC, TOKEN_COS, stack[s], -1);
+                node = (op.op == BATCH_OP_SINCOS) ? sin_node : cos_node;
+                temp[op.arg] = (op.op == BATCH_OP_SINCOS) ? cos_node : sin_node;
+                if (sin_node < 0 || cos_node < 0) node = -1;
+                break;
+            }
+            default:
+                node = -1;
+        }
+        ok = node >= 0;
+        stack[s] = node;
+    }
+
+    for (int k = 0; k < prog->outputs && ok; k++) {
+        roots[k] = (prog->result[k] < 0) ? stack[0] : temp[prog->result[k]];
+    }
+    free(stack);
+    free(temp);
+    return ok;
+}
+
+/* sin(u) e cos(u) do mesmo u, ambos usados, são calculados juntos
+ * (BATCH_OP_SINCOS): uma única redução de faixa. */
+static void pair_sincos(OptDag *dag) {
+    for (int k = 0; k < dag->size; k++) {
+        OptNode *n = &dag->nodes[k];
+        if (n->op != BATCH_OP_FUNC || n->arg != TOKEN_SIN || n->uses == 0) continue;
+        for (int j = 0; j < dag->size; j++) {
+            OptNode *c = &dag->nodes[j];
+            if (c->op == BATCH_OP_FUNC && c->arg == TOKEN_COS && c->a == n->a && c->uses > 0) {
+                n->pair = j;
+                c->pair = k;
+                dag->nodes[n->a].uses--;  // o argumento é calculado uma vez só
+                break;
+            }
+        }
+    }
+}
+
+static void count_uses(OptDag *dag, int k) {
+    OptNode *n = &dag->nodes[k];
+    if (n->uses++ > 0) return;  // filhos já contados na primeira visita
+    if (n->a >= 0) count_uses(dag, n->a);
+    if (n->b >= 0) count_uses(dag, n->b);
+}
+
+static int emit_op(OptEmit *em, int op, int slot, int arg) {
+    if (slot > 255) return 0;
+    if (em->size == em->capacity) {
+        int ncap = em->capacity ? em->capacity * 2 : 32;
+        BatchOp *tmp = realloc(em->ops, ncap * sizeof(BatchOp));
+        if (!tmp) return 0;
+        em->ops = tmp;
+        em->capacity = ncap;
+    }
+    BatchOp *o = &em->ops[em->size++];
+    o->op = (uint8_t)op;
+    o->slot = (uint8_t)slot;
+    o->arg = (uint16_t)arg;
+    if (slot + 1 > em->depth) em->depth = slot + 1;
+    return 1;
+}
+
+static int emit_value(OptEmit *em, double v) {
+    for (int k = 0; k < em->values_size; k++) {
+        if (memcmp(&em->values[k], &v, sizeof(double)) == 0) return k;
+    }
+    if (em->values_size == em->values_capacity) {
+        int ncap = em->values_capacity ? em->values_capacity * 2 : 16;
+        double *tmp = realloc(em->values, ncap * sizeof(double));
+        if (!tmp) return -1;
+        em->values = tmp;
+        em->values_capacity = ncap;
+    }
+    em->values[em->values_size] = v;
+    return em->values_size++;
+}
+
+/* Emite o nó `k` deixando o resultado em `slot`. */
+static int emit_node(OptDag *dag, OptEmit *em, int k, int slot) {
+    OptNode *n = &dag->nodes[k];
+
+    if (n->emitted) return emit_op(em, BATCH_OP_LOAD, slot, n->temp);
+
+    int ok = 1;
+    if (n->op == BATCH_OP_CONST) {
+        int idx = emit_value(em, n->value);
+        ok = idx >= 0 && emit_op(em, BATCH_OP_CONST, slot, idx);
+    } else if (n->pair >= 0 && !dag->nodes[n->pair].emitted) {
+        // Calcula o par sin/cos de uma vez; o parceiro vai para um temporário
+        OptNode *p = &dag->nodes[n->pair];
+        if (p->temp < 0) p->temp = em->temps++;
+        ok = emit_node(dag, em, n->a, slot) &&
+             emit_op(em, n->arg == TOKEN_SIN ? BATCH_OP_SINCOS : BATCH_OP_COSSIN, slot, p->temp);
+        p->emitted = 1;
+    } else {
+        if (n->a >= 0) ok = emit_node(dag, em, n->a, slot);
+        if (ok && n->b >= 0) ok = emit_node(dag, em, n->b, slot + 1);
+        ok = ok && emit_op(em, n->op, slot, n->arg);
+    }
+
+    if (ok && n->temp >= 0) {
+        ok = emit_op(em, BATCH_OP_STORE, slot, n->temp);
+        n->emitted = 1;
+    }
+    return ok;
+}
+
+int batch_optimize(BatchProgram *prog, unsigned flags) {
+    OptDag dag = { prog, flags, NULL, 0, 0 };
+    OptEmit em;
+    memset(&em, 0, sizeof(em));
+
+    int roots[BATCH_MAX_OUTPUTS];
+    int result[BATCH_MAX_OUTPUTS];
+    if (!build_dag(&dag, roots)) {
+        free(dag.nodes);
+        return 0;
+    }
+
+    // Nós não folha usados mais de uma vez ganham coluna temporária
+    for (int k = 0; k < prog->outputs; k++) {
+        count_uses(&dag, roots[k]);
+    }
+    if (flags & BATCH_OPT_CSE) pair_sincos(&dag);
+    for (int k = 0; k < dag.size; k++) {
+        OptNode *n = &dag.nodes[k];
+        if (n->uses > 1 && op_arity(n->op) > 0) n->temp = em.temps++;
+    }
+
+    // Cada saída, menos a última, termina numa coluna temporária
+    int ok = 1;
+    for (int k = 0; k < prog->outputs && ok; k++) {
+        OptNode *n = &dag.nodes[roots[k]];
+        int last = (k == prog->outputs - 1);
+        if (n->emitted) {
+            result[k] = n->temp;
+        } else {
+            if (!last && n->temp < 0) n->temp = em.temps++;
+            ok = emit_node(&dag, &em, roots[k], 0);
+            result[k] = last ? -1 : n->temp;
+        }
+    }
+    free(dag.nodes);
+
+    if (!ok) {
+        free(em.ops);
+        free(em.values);
+        return 0;
+    }
+
+    free(prog->ops);
+    free(prog->values);
+    prog->ops = em.ops;
+    prog->size = em.size;
+    prog->values = em.values;
+    prog->values_size = em.values_size;
+    prog->depth = em.depth;
+    prog->temps = em.temps;
+    memcpy(prog->result, result, sizeof(result));
+    return 1;
+}
+
+static const char *op_symbol(int op) {
+    switch (op) {
+        case BATCH_OP_ADD: return "+";
+        case BATCH_OP_SUB: return "-";
+        case BATCH_OP_MUL: return "*";
+        case BATCH_OP_DIV: return "/";
+        case BATCH_OP_POW: return "^";
+        default:           return "?";
+    }
+}
+
+static const char *func_name(int type) {
+    switch (type) {
+        case TOKEN_SIN:   return "sin";
+        case TOKEN_COS:   return "cos";
+        case TOKEN_TAN:   return "tan";
+        case TOKEN_ABS:   return "abs";
+        case TOKEN_SQRT:  return "sqrt";
+        case TOKEN_EXP:   return "exp";
+        case TOKEN_LOG:   return "log";
+        case TOKEN_LOG10: return "log10";
+        case TOKEN_SINH:  return "sinh";
+        case TOKEN_COSH:  return "cosh";
+        case TOKEN_TANH:  return "tanh";
+        case TOKEN_ASIN:  return "asin";
+        case TOKEN_ACOS:  return "acos";
+        case TOKEN_ATAN:  return "atan";
+        case TOKEN_ASINH: return "asinh";
+        case TOKEN_ACOSH: return "acosh";
+        case TOKEN_ATANH: return "atanh";
+        case TOKEN_CEIL:  return "ceil";
+        case TOKEN_FLOOR: return "floor";
+        case TOKEN_FRAC:  return "frac";
+        default:          return NULL;
+    }
+}
+
+void batch_dump(const BatchProgram *prog, FILE *out) {
+    fprintf(out, "--- BATCH PROGRAM (%d ops, pilha %d, temporários %d) ---\n",
+            prog->size, prog->depth, prog->temps);
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        int s = op.slot;
+        fprintf(out, "[%2d] ", k);
+        switch (op.op) {
+            case BATCH_OP_CONST:
+                fprintf(out, "s%d = %.17g\n", s, prog->values[op.arg]);
+                break;
+            case BATCH_OP_VAR:
+                // vK = variável K do contexto: nas curvas todas valem t; com
+                // batch_eval_vars cada uma tem a sua coluna (v1 = y na implícita)
+                if (op.arg == 0) fprintf(out, "s%d = t\n", s);
+                else fprintf(out, "s%d = v%d\n", s, op.arg);
+                break;
+            case BATCH_OP_NEG:
+                fprintf(out, "s%d = -s%d\n", s, s);
+                break;
+            case BATCH_OP_FUNC:
+            case BATCH_OP_CALL: {
+                int type = (op.op == BATCH_OP_FUNC) ? op.arg
+                         : (prog->calls[op.arg].size > 1 ? prog->calls[op.arg].tokens[1].type : -1);
+                const char *name = func_name(type);
+                if (name) fprintf(out, "s%d = %s(s%d)%s\n", s, name, s, op.op == BATCH_OP_CALL ? "  [escalar]" : "");
+                else fprintf(out, "s%d = f%d(s%d)\n", s, type, s);
+                break;
+            }
+            case BATCH_OP_SINCOS:
+                fprintf(out, "s%d = sin(s%d), r%d = cos(s%d)\n", s, s, op.arg, s);
+                break;
+            case BATCH_OP_COSSIN:
+                fprintf(out, "s%d = cos(s%d), r%d = sin(s%d)\n", s, s, op.arg, s);
+                break;
+            case BATCH_OP_LOAD:
+                fprintf(out, "s%d = r%d\n", s, op.arg);
+                break;
+            case BATCH_OP_STORE:
+                fprintf(out, "r%d = s%d\n", op.arg, s);
+                break;
+            default:
+                fprintf(out, "s%d = s%d %s s%d\n", s, s, op_symbol(op.op), s + 1);
+        }
+    }
+    if (prog->outputs > 1) {
+        fprintf(out, "saídas:");
+        for (int k = 0; k < prog->outputs; k++) {
+            if (prog->result[k] < 0) fprintf(out, " s0");
+            else fprintf(out, " r%d", prog->result[k]);
+        }
+        fprintf(out, "\n");
+    }
+}
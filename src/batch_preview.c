@@ -0,0 +1,210 @@
+/* Avaliador da prévia: o mesmo BatchProgram do motor BLOCK, com as colunas
+ * em float.
+ *
+ * Cada coluna de BATCH_BLOCK_SIZE floats cabe em metade do espaço da de
+ * doubles e cada vetor SIMD leva o dobro de lanes; sin, cos, exp e log vão
+ * para os kernels em float de vecmath.h. Os laços rodam sempre sobre o bloco
+ * inteiro (tamanho constante, ponteiros restrict), o que deixa o compilador
+ * vetorizá-los; as lanes depois de m num bloco parcial são lixo ignorado.
+ *
+ * Erros como nos outros motores: um acumulador soma v - v de cada resultado
+ * (0 para valores finitos, NaN para Inf/NaN) e as lanes marcadas são refeitas
+ * em double com `evaluator_eval_rpn`. Isso inclui o que só o float não
+ * representa (overflow acima de ~3.4e38, argumento de sin/cos acima da faixa
+ * dos kernels), que sai então com o valor exato.
+ */
+
+#include "batch_internal.h"
+#include "../include/vecmath.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCO BATCH_BLOCK_SIZE
+
+/* Função da libm em float para um token de função, ou NULL (mesma lista de
+ * batch_libm_function(), sem as de vecmath.h) */
+static float (*libm_float(int type))(float) {
+    switch (type) {
+        case TOKEN_TAN:   return tanf;
+        case TOKEN_ABS:   return fabsf;
+        case TOKEN_SQRT:  return sqrtf;
+        case TOKEN_LOG10: return log10f;
+        case TOKEN_SINH:  return sinhf;
+        case TOKEN_COSH:  return coshf;
+        case TOKEN_TANH:  return tanhf;
+        case TOKEN_ASIN:  return asinf;
+        case TOKEN_ACOS:  return acosf;
+        case TOKEN_ATAN:  return atanf;
+        case TOKEN_ASINH: return asinhf;
+        case TOKEN_ACOSH: return acoshf;
+        case TOKEN_ATANH: return atanhf;
+        case TOKEN_CEIL:  return ceilf;
+        case TOKEN_FLOOR: return floorf;
+        default:          return NULL;
+    }
+}
+
+static void somar(float *restrict a, const float *restrict b) {
+    for (int i = 0; i < BLOCO; i++) a[i] = a[i] + b[i];
+}
+
+static void subtrair(float *restrict a, const float *restrict b) {
+    for (int i = 0; i < BLOCO; i++) a[i] = a[i] - b[i];
+}
+
+static void multiplicar(float *restrict a, const float *restrict b) {
+    for (int i = 0; i < BLOCO; i++) a[i] = a[i] * b[i];
+}
+
+static void dividir(float *restrict a, const float *restrict b) {
+    for (int i = 0; i < BLOCO; i++) a[i] = a[i] / b[i];
+}
+
+/* Acumula v - v de cada lane (0 se finito, NaN se não) */
+static void marcar(float *restrict acc, const float *restrict v) {
+    for (int i = 0; i < BLOCO; i++) acc[i] += v[i] - v[i];
+}
+
+/* 1 se nenhuma lane do bloco foi marcada */
+static int limpo_bloco(const float *restrict acc) {
+    int marcadas = 0;
+    for (int i = 0; i < BLOCO; i++) marcadas |= (acc[i] != 0.0f);
+    return !marcadas;
+}
+
+static void converter(double *restrict v, EvalError *restrict e, const float *restrict res) {
+    for (int i = 0; i < BLOCO; i++) v[i] = res[i];
+    for (int i = 0; i < BLOCO; i++) e[i] = EVAL_OK;
+}
+
+/* Executa o programa sobre um bloco de m <= BLOCO valores de t. */
+static void run_block_float(const BatchProgram *prog, float *cols, const double *t, float *acc, int m) {
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        float *a = cols + (size_t)op.slot * BLOCO;
+        const float *b = a + BLOCO;
+
+        switch (op.op) {
+            case BATCH_OP_CONST: {
+                const float v = (float)prog->values[op.arg];
+                for (int i = 0; i < BLOCO; i++) a[i] = v;
+                marcar(acc, a);
+                break;
+            }
+            case BATCH_OP_VAR:
+                for (int i = 0; i < m; i++) a[i] = (float)t[i];
+                for (int i = m; i < BLOCO; i++) a[i] = 0.0f;
+                break;
+            case BATCH_OP_NEG:
+                for (int i = 0; i < BLOCO; i++) a[i] = -a[i];
+                break;
+            case BATCH_OP_ADD:
+                somar(a, b);
+                marcar(acc, a);
+                break;
+            case BATCH_OP_SUB:
+                subtrair(a, b);
+                marcar(acc, a);
+                break;
+            case BATCH_OP_MUL:
+                multiplicar(a, b);
+                marcar(acc, a);
+                break;
+            case BATCH_OP_DIV:
+                dividir(a, b);
+                marcar(acc, a);
+                break;
+            case BATCH_OP_POW:
+                for (int i = 0; i < m; i++) a[i] = powf(a[i], b[i]);
+                marcar(acc, a);
+                break;
+            case BATCH_OP_FUNC: {
+                float (*f)(float) = libm_float(op.arg);
+                switch (op.arg) {
+                    case TOKEN_SIN: vecmath_sin_f(a, a, BLOCO); break;
+                    case TOKEN_COS: vecmath_cos_f(a, a, BLOCO); break;
+                    case TOKEN_EXP: vecmath_exp_f(a, a, BLOCO); break;
+                    case TOKEN_LOG: vecmath_log_f(a, a, BLOCO); break;
+                    default:
+                        for (int i = 0; i < m; i++) a[i] = f ? f(a[i]) : NAN;
+                }
+                marcar(acc, a);
+                break;
+            }
+            case BATCH_OP_CALL: {
+                const TokenBuffer *call = &prog->calls[op.arg];
+                for (int i = 0; i < m; i++) {
+                    if (acc[i] != 0.0f) continue;
+                    EvalResult r = batch_eval_at(prog->ctx, call, a[i]);
+                    a[i] = (r.error == EVAL_OK) ? (float)r.value : NAN;
+                }
+                marcar(acc, a);
+                break;
+            }
+            case BATCH_OP_SINCOS: {
+                float *c = cols + (size_t)(prog->depth + op.arg) * BLOCO;
+                vecmath_sincos_f(a, a, c, BLOCO);
+                marcar(acc, a);
+                break;
+            }
+            case BATCH_OP_COSSIN: {
+                float *s = cols + (size_t)(prog->depth + op.arg) * BLOCO;
+                vecmath_sincos_f(a, s, a, BLOCO);
+                marcar(acc, a);
+                break;
+            }
+            case BATCH_OP_LOAD:
+                memcpy(a, cols + (size_t)(prog->depth + op.arg) * BLOCO, BLOCO * sizeof(float));
+                break;
+            case BATCH_OP_STORE:
+                memcpy(cols + (size_t)(prog->depth + op.arg) * BLOCO, a, BLOCO * sizeof(float));
+                break;
+        }
+    }
+}
+
+void batch_eval_preview(const BatchProgram *prog, const double *t,
+                        double *const *values, EvalError *const *errors, int n) {
+    float *cols = malloc((size_t)(prog->depth + prog->temps + 1) * BLOCO * sizeof(float));
+    if (!cols) {
+        batch_eval_multi(prog, t, values, errors, n);
+        return;
+    }
+    float *acc = cols + (size_t)(prog->depth + prog->temps) * BLOCO;
+
+    for (int start = 0; start < n; start += BLOCO) {
+        int m = n - start;
+        if (m > BLOCO) m = BLOCO;
+
+        memset(acc, 0, BLOCO * sizeof(float));
+        run_block_float(prog, cols, t + start, acc, m);
+
+        // Bloco inteiro sem lanes marcadas (o caso comum): só converte, com
+        // laços de tamanho constante
+        const int limpo = (m == BLOCO) && limpo_bloco(acc);
+
+        for (int k = 0; k < prog->outputs; k++) {
+            const int r = prog->result[k];
+            const float *res = (r < 0) ? cols : cols + (size_t)(prog->depth + r) * BLOCO;
+            double *v = values[k] + start;
+            EvalError *e = errors[k] + start;
+            if (limpo) {
+                converter(v, e, res);
+                continue;
+            }
+            for (int i = 0; i < m; i++) {
+                if (acc[i] != 0.0f) {
+                    // Caminho lento em double, como nos outros motores
+                    EvalResult ev = batch_eval_at(prog->ctx, prog->rpn[k], t[start + i]);
+                    v[i] = ev.value;
+                    e[i] = ev.error;
+                } else {
+                    v[i] = res[i];
+                    e[i] = EVAL_OK;
+                }
+            }
+        }
+    }
+
+    free(cols);
+}
@@ -0,0 +1,294 @@
+/* Motor "threaded" do avaliador em lote (BATCH_ENGINE_THREADED).
+ *
+ * Em vez de percorrer o programa uma vez por bloco de colunas, avalia ponto a
+ * ponto sobre um banco de registradores (um double por slot da pilha e por
+ * temporário). O BatchProgram é traduzido, uma vez por chamada, para uma
+ * lista de instruções que já carregam o endereço do handler (computed goto
+ * do GCC/Clang: `goto *ip->label`) e ponteiros diretos para os registradores.
+ * Como a profundidade da pilha é conhecida na compilação, o laço quente não
+ * tem checagem de limites nem ponteiro de pilha.
+ *
+ * Semântica de erro igual à dos outros motores: cada operação que pode gerar
+ * Inf/NaN soma (v - v) num acumulador; se ele terminar diferente de zero, o
+ * ponto é refeito com evaluator_eval_rpn. Funções usam a libm diretamente.
+ *
+ * Sem computed goto (outros compiladores) o mesmo corpo vira um `switch`.
+ *
+ * batch_threaded_eval_rpn() expõe o mesmo motor com a assinatura de
+ * evaluator_eval_rpn (um ponto, uma variável por índice), para rodar a suíte
+ * de testes da lib Abaco contra ele (make run-tests-threaded).
+ */
+
+#include "batch_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_GOTO 1
+#else
+#define THREADED_GOTO 0
+#endif
+
+/* Fim do programa (não existe no BatchProgram, só no código traduzido). */
+#define THREADED_OP_END (BATCH_OP_COSSIN + 1)
+
+typedef struct {
+#if THREADED_GOTO
+    const void *label;       /* handler */
+#endif
+    int op;
+    double *a;               /* destino (slot) */
+    const double *b;         /* segundo operando / origem (VAR: a variável) */
+    double *c;               /* segundo destino (sincos) */
+    double k;                /* constante */
+    double (*fn)(double);    /* função da libm */
+    const TokenBuffer *call; /* mini-RPN de BATCH_OP_CALL */
+} ThreadedInsn;
+
+/* Traduz o programa para instruções sobre o banco `reg`. BATCH_OP_VAR lê de
+ * vars[arg * stride] (arg é o índice da variável na RPN; stride 0 faz todas
+ * as variáveis lerem o mesmo t). */
+static int translate(const BatchProgram *prog, double *reg, const double *vars, int stride,
+                     const void *const *labels, ThreadedInsn *code) {
+    double *temps = reg + prog->depth;
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        ThreadedInsn *in = &code[k];
+        memset(in, 0, sizeof(*in));
+        in->op = op.op;
+        in->a = reg + op.slot;
+        in->b = reg + op.slot + 1;
+        switch (op.op) {
+            case BATCH_OP_CONST:
+                in->k = prog->values[op.arg];
+                break;
+            case BATCH_OP_VAR:
+                in->b = vars + op.arg * stride;
+                break;
+            case BATCH_OP_FUNC:
+                in->fn = batch_libm_function(op.arg);
+                if (!in->fn) return 0;
+                break;
+            case BATCH_OP_CALL:
+                in->call = &prog->calls[op.arg];
+                break;
+            case BATCH_OP_LOAD:
+                in->b = temps + op.arg;
+                break;
+            case BATCH_OP_STORE:
+                // temp ← slot: vira uma cópia com destino no temporário
+                in->a = temps + op.arg;
+                in->b = reg + op.slot;
+                break;
+            case BATCH_OP_SINCOS:
+            case BATCH_OP_COSSIN:
+                in->c = temps + op.arg;
+                break;
+        }
+    }
+    memset(&code[prog->size], 0, sizeof(ThreadedInsn));
+    code[prog->size].op = THREADED_OP_END;
+#if THREADED_GOTO
+    for (int k = 0; k <= prog->size; k++) {
+        code[k].label = labels[code[k].op];
+    }
+#else
+    (void)labels;
+#endif
+    return 1;
+}
+
+#if THREADED_GOTO
+#define VM_BEGIN()     goto *ip->label;
+#define VM_CASE(name)  L_##name:
+#define VM_NEXT()      do { ip++; goto *ip->label; } while (0)
+#define VM_END()
+#else
+#define VM_BEGIN()     for (;;) switch (ip->op) {
+#define VM_CASE(name)  case name:
+#define VM_NEXT()      do { ip++; continue; } while (0)
+#define VM_END()       }
+#endif
+
+/* Soma (v - v) ao acumulador: 0 para valores finitos, NaN para Inf/NaN. */
+#define VM_CHECK(v) (chk += (v) - (v))
+
+/* Executa o código traduzido para um ponto. Retorna o acumulador de checagem
+ * (0 se nenhum valor intermediário foi Inf/NaN). Chamada com code == NULL só
+ * devolve em *labels a tabela de handlers (endereços de labels só existem
+ * dentro da função). */
+static double run_point(const ThreadedInsn *code, const AbacoContext *ctx,
+                        const void *const **labels) {
+#if THREADED_GOTO
+    static const void *const table[] = {
+        [BATCH_OP_CONST]  = &&L_BATCH_OP_CONST,
+        [BATCH_OP_VAR]    = &&L_BATCH_OP_VAR,
+        [BATCH_OP_NEG]    = &&L_BATCH_OP_NEG,
+        [BATCH_OP_ADD]    = &&L_BATCH_OP_ADD,
+        [BATCH_OP_SUB]    = &&L_BATCH_OP_SUB,
+        [BATCH_OP_MUL]    = &&L_BATCH_OP_MUL,
+        [BATCH_OP_DIV]    = &&L_BATCH_OP_DIV,
+        [BATCH_OP_POW]    = &&L_BATCH_OP_POW,
+        [BATCH_OP_FUNC]   = &&L_BATCH_OP_FUNC,
+        [BATCH_OP_CALL]   = &&L_BATCH_OP_CALL,
+        [BATCH_OP_LOAD]   = &&L_BATCH_OP_LOAD,
+        [BATCH_OP_STORE]  = &&L_BATCH_OP_STORE,
+        [BATCH_OP_SINCOS] = &&L_BATCH_OP_SINCOS,
+        [BATCH_OP_COSSIN] = &&L_BATCH_OP_COSSIN,
+        [THREADED_OP_END] = &&L_THREADED_OP_END
+    };
+    if (labels) *labels = table;
+#else
+    if (labels) *labels = NULL;
+#endif
+    if (!code) return 0.0;
+
+    double chk = 0.0;
+    const ThreadedInsn *ip = code;
+
+    VM_BEGIN()
+    VM_CASE(BATCH_OP_CONST)
+        *ip->a = ip->k;
+        VM_NEXT();
+    VM_CASE(BATCH_OP_VAR)
+    VM_CASE(BATCH_OP_LOAD)
+    VM_CASE(BATCH_OP_STORE)
+        *ip->a = *ip->b;
+        VM_NEXT();
+    VM_CASE(BATCH_OP_NEG)
+        *ip->a = -*ip->a;
+        VM_NEXT();
+    VM_CASE(BATCH_OP_ADD)
+        *ip->a = *ip->a + *ip->b;
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_SUB)
+        *ip->a = *ip->a - *ip->b;
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_MUL)
+        *ip->a = *ip->a * *ip->b;
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_DIV)
+        *ip->a = *ip->a / *ip->b;
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_POW)
+        *ip->a = pow(*ip->a, *ip->b);
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_FUNC)
+        *ip->a = ip->fn(*ip->a);
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    VM_CASE(BATCH_OP_CALL) {
+        EvalResult r = batch_eval_at(ctx, ip->call, *ip->a);
+        *ip->a = r.value;
+        if (r.error != EVAL_OK) chk = NAN;
+        VM_NEXT();
+    }
+    VM_CASE(BATCH_OP_SINCOS) {
+        const double x = *ip->a;
+        *ip->a = sin(x);
+        *ip->c = cos(x);
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    }
+    VM_CASE(BATCH_OP_COSSIN) {
+        const double x = *ip->a;
+        *ip->a = cos(x);
+        *ip->c = sin(x);
+        VM_CHECK(*ip->a);
+        VM_NEXT();
+    }
+    VM_CASE(THREADED_OP_END)
+        return chk;
+#if !THREADED_GOTO
+    default:
+        return chk;
+#endif
+    VM_END()
+}
+
+/* Aloca registradores e código traduzido para `prog`. Com var_values NULL
+ * (modo lote), todas as variáveis leem o registrador extra reg[depth+temps],
+ * onde fica o t corrente. */
+static int prepare(const BatchProgram *prog, const double *var_values,
+                   double **reg, ThreadedInsn **code) {
+    const int nregs = prog->depth + prog->temps;
+    *reg = malloc((nregs + 1) * sizeof(double));
+    *code = malloc((prog->size + 1) * sizeof(ThreadedInsn));
+    const void *const *labels;
+    run_point(NULL, NULL, &labels);
+    if (!*reg || !*code ||
+        !translate(prog, *reg, var_values ? var_values : *reg + nregs, var_values ? 1 : 0,
+                   labels, *code)) {
+        free(*reg);
+        free(*code);
+        return 0;
+    }
+    return 1;
+}
+
+int batch_run_threaded(const BatchProgram *prog, const double *t,
+                       double *const *values, EvalError *const *errors, int n) {
+    double *reg;
+    ThreadedInsn *code;
+    if (!prepare(prog, NULL, &reg, &code)) return 0;
+
+    double *tv = reg + prog->depth + prog->temps;
+
+    // Registradores de onde sai cada resultado
+    const double *result[BATCH_MAX_OUTPUTS];
+    for (int k = 0; k < prog->outputs; k++) {
+        result[k] = (prog->result[k] < 0) ? reg : reg + prog->depth + prog->result[k];
+    }
+
+    for (int i = 0; i < n; i++) {
+        *tv = t[i];
+        const double chk = run_point(code, prog->ctx, NULL);
+        for (int k = 0; k < prog->outputs; k++) {
+            if (chk == 0.0) {
+                values[k][i] = *result[k];
+                errors[k][i] = EVAL_OK;
+            } else {
+                EvalResult r = batch_eval_at(prog->ctx, prog->rpn[k], t[i]);
+                values[k][i] = r.value;
+                errors[k][i] = r.error;
+            }
+        }
+    }
+
+    free(reg);
+    free(code);
+    return 1;
+}
+
+EvalResult batch_threaded_eval_rpn(const AbacoContext *ctx, const TokenBuffer *rpn,
+                                   const double *var_values) {
+    BatchProgram prog;
+    double *reg;
+    ThreadedInsn *code;
+    if (!batch_compile(ctx, rpn, &prog)) {
+        batch_free(&prog);
+        return evaluator_eval_rpn(ctx, rpn, var_values);
+    }
+    if (!prepare(&prog, var_values, &reg, &code)) {
+        batch_free(&prog);
+        return evaluator_eval_rpn(ctx, rpn, var_values);
+    }
+
+    EvalResult r;
+    if (run_point(code, ctx, NULL) == 0.0) {
+        r.error = EVAL_OK;
+        r.value = reg[0];
+    } else {
+        r = evaluator_eval_rpn(ctx, rpn, var_values);
+    }
+    free(reg);
+    free(code);
+    batch_free(&prog);
+    return r;
+}
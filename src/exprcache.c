@@ -0,0 +1,242 @@
+/* Cache LRU de expressões compiladas (ver include/exprcache.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/exprcache.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ExprCacheEntry {
+    ExprCacheEntry *prox_hash;      /* Lista do balde */
+    ExprCacheEntry *ant, *prox;     /* Lista LRU: cabeça = mais recente */
+    void *value;
+    size_t bytes;                   /* Valor + esta estrutura + chave */
+    unsigned hash;
+    int refs;
+    int guardada;                   /* 1 enquanto está na tabela e na LRU */
+    char key[];
+};
+
+struct ExprCache {
+    pthread_mutex_t lock;
+    void (*liberar)(void *value);
+    ExprCacheEntry *baldes[EXPRCACHE_BUCKETS];
+    ExprCacheEntry *recente, *antiga;
+    ExprCacheStats stats;
+};
+
+/* FNV-1a */
+static unsigned hash_chave(const char *s) {
+    unsigned h = 2166136261u;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static void destruir(ExprCache *c, ExprCacheEntry *e) {
+    c->liberar(e->value);
+    free(e);
+}
+
+/* Tira a entrada da tabela e da LRU (chamado com o lock). Se ninguém a usa,
+ * destrói na hora; senão o último release destrói. */
+static void remover(ExprCache *c, ExprCacheEntry *e) {
+    ExprCacheEntry **p = &c->baldes[e->hash % EXPRCACHE_BUCKETS];
+    while (*p != e) p = &(*p)->prox_hash;
+    *p = e->prox_hash;
+
+    if (e->ant) e->ant->prox = e->prox;
+    else c->recente = e->prox;
+    if (e->prox) e->prox->ant = e->ant;
+    else c->antiga = e->ant;
+
+    e->guardada = 0;
+    c->stats.entries--;
+    c->stats.bytes -= e->bytes;
+    if (e->refs == 0) destruir(c, e);
+}
+
+/* Descarta as menos usadas até caber `bytes` a mais numa entrada nova. */
+static void abrir_espaco(ExprCache *c, size_t bytes, int entradas) {
+    while (c->antiga && (c->stats.bytes + bytes > c->stats.max_bytes ||
+                         c->stats.entries + entradas > c->stats.max_entries)) {
+        remover(c, c->antiga);
+        c->stats.evictions++;
+    }
+}
+
+static void para_frente(ExprCache *c, ExprCacheEntry *e) {
+    if (c->recente == e) return;
+    e->ant->prox = e->prox;
+    if (e->prox) e->prox->ant = e->ant;
+    else c->antiga = e->ant;
+    e->ant = NULL;
+    e->prox = c->recente;
+    c->recente->ant = e;
+    c->recente = e;
+}
+
+static ExprCacheEntry *procurar(ExprCache *c, const char *key, unsigned h) {
+    for (ExprCacheEntry *e = c->baldes[h % EXPRCACHE_BUCKETS]; e; e = e->prox_hash) {
+        if (e->hash == h && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+ExprCache *exprcache_create(size_t max_bytes, int max_entries, void (*liberar)(void *value)) {
+    ExprCache *c = calloc(1, sizeof(ExprCache));
+    if (!c) return NULL;
+    if (pthread_mutex_init(&c->lock, NULL) != 0) {
+        free(c);
+        return NULL;
+    }
+    c->liberar = liberar;
+    c->stats.max_bytes = max_bytes;
+    c->stats.max_entries = max_entries > 0 ? max_entries : 0;
+    return c;
+}
+
+void exprcache_destroy(ExprCache *cache) {
+    if (!cache) return;
+    exprcache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+ExprCacheEntry *exprcache_get(ExprCache *cache, const char *key) {
+    const unsigned h = hash_chave(key);
+    pthread_mutex_lock(&cache->lock);
+    ExprCacheEntry *e = procurar(cache, key, h);
+    if (e) {
+        e->refs++;
+        para_frente(cache, e);
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return e;
+}
+
+ExprCacheEntry *exprcache_put(ExprCache *cache, const char *key, void *value, size_t bytes) {
+    const size_t len = strlen(key);
+    ExprCacheEntry *nova = malloc(sizeof(ExprCacheEntry) + len + 1);
+    if (!nova) {
+        cache->liberar(value);
+        return NULL;
+    }
+    memset(nova, 0, sizeof(ExprCacheEntry));
+    memcpy(nova->key, key, len + 1);
+    nova->value = value;
+    nova->bytes = bytes + sizeof(ExprCacheEntry) + len + 1;
+    nova->hash = hash_chave(key);
+    nova->refs = 1;
+
+    pthread_mutex_lock(&cache->lock);
+    ExprCacheEntry *e = procurar(cache, key, nova->hash);
+    if (e) {
+        // Outra thread compilou a mesma chave enquanto esta compilava
+        e->refs++;
+        para_frente(cache, e);
+        pthread_mutex_unlock(&cache->lock);
+        destruir(cache, nova);
+        return e;
+    }
+
+    if (nova->bytes <= cache->stats.max_bytes && cache->stats.max_entries > 0) {
+        abrir_espaco(cache, nova->bytes, 1);
+        ExprCacheEntry **balde = &cache->baldes[nova->hash % EXPRCACHE_BUCKETS];
+        nova->prox_hash = *balde;
+        *balde = nova;
+        nova->prox = cache->recente;
+        if (cache->recente) cache->recente->ant = nova;
+        else cache->antiga = nova;
+        cache->recente = nova;
+        nova->guardada = 1;
+        cache->stats.entries++;
+        cache->stats.bytes += nova->bytes;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return nova;
+}
+
+void *exprcache_value(const ExprCacheEntry *entry) {
+    return entry->value;
+}
+
+void exprcache_resize(ExprCache *cache, ExprCacheEntry *entry, size_t bytes) {
+    const size_t novo = bytes + sizeof(ExprCacheEntry) + strlen(entry->key) + 1;
+    pthread_mutex_lock(&cache->lock);
+    if (entry->guardada) {
+        cache->stats.bytes = cache->stats.bytes - entry->bytes + novo;
+        entry->bytes = novo;
+        if (novo > cache->stats.max_bytes) {
+            remover(cache, entry);
+            cache->stats.evictions++;
+        } else {
+            // A entrada em uso é a mais recente: saem as outras primeiro
+            para_frente(cache, entry);
+            abrir_espaco(cache, 0, 0);
+        }
+    } else {
+        entry->bytes = novo;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void exprcache_release(ExprCache *cache, ExprCacheEntry *entry) {
+    if (!entry) return;
+    pthread_mutex_lock(&cache->lock);
+    int destruir_agora = (--entry->refs == 0 && !entry->guardada);
+    pthread_mutex_unlock(&cache->lock);
+    if (destruir_agora) destruir(cache, entry);
+}
+
+void exprcache_set_limits(ExprCache *cache, size_t max_bytes, int max_entries) {
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.max_bytes = max_bytes;
+    cache->stats.max_entries = max_entries > 0 ? max_entries : 0;
+    abrir_espaco(cache, 0, 0);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void exprcache_clear(ExprCache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    while (cache->antiga) remover(cache, cache->antiga);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void exprcache_stats(ExprCache *cache, ExprCacheStats *stats) {
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* Caractere que pode fazer parte de um nome ou de um número */
+static int de_nome(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+/* Caractere que pode fazer parte de um operador de mais de um símbolo
+ * ("**"): tudo o que não é nome, espaço, parêntese nem vírgula */
+static int de_operador(char c) {
+    return c && !de_nome(c) && !isspace((unsigned char)c) && !strchr("(),", c);
+}
+
+size_t exprcache_normalize(const char *expr, char *out) {
+    size_t n = 0;
+    for (const char *p = expr; *p;) {
+        if (!isspace((unsigned char)*p)) {
+            out[n++] = *p++;
+            continue;
+        }
+        while (isspace((unsigned char)*p)) p++;
+        // Um espaço só onde juntar os vizinhos formaria outro token
+        if (n > 0 && *p && ((de_nome(out[n - 1]) && de_nome(*p)) ||
+                            (de_operador(out[n - 1]) && de_operador(*p)))) {
+            out[n++] = ' ';
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
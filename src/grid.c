@@ -0,0 +1,38 @@
+/* Grade 1-2-5 do SVG (ver include/grid.h) */
+#include "../include/grid.h"
+#include <math.h>
+
+int grid_axis(double min, double max, double pixels, GridAxis *axis) {
+    double range = max - min;
+    if (!isfinite(min) || !isfinite(max) || !(range > 0.0) || !(pixels > 0.0)) return 0;
+
+    // Menor passo 1-2-5 com pelo menos GRID_MIN_MAJOR_PX pixels entre linhas
+    double bruto = range * GRID_MIN_MAJOR_PX / pixels;
+    double p10 = pow(10.0, floor(log10(bruto)));
+    double f = bruto / p10;
+    int mantissa;
+    if (f <= 1.0) {
+        mantissa = 1;
+    } else if (f <= 2.0) {
+        mantissa = 2;
+    } else if (f <= 5.0) {
+        mantissa = 5;
+    } else {
+        mantissa = 1;
+        p10 *= 10.0;
+    }
+
+    axis->major = mantissa * p10;
+    axis->subdivisions = (mantissa == 2) ? 4 : 5;
+    axis->minor = axis->major / axis->subdivisions;
+
+    // Tics nas bordas contam, com folga para o arredondamento de min/minor
+    const double folga = 0.01 * axis->minor;
+    double a = ceil((min - folga) / axis->minor);
+    double b = floor((max + folga) / axis->minor);
+    // Faixa estreita longe da origem: k * minor perderia precisão
+    if (!(b - a < GRID_MAX_TICKS) || fabs(a) > 1e15 || fabs(b) > 1e15) return 0;
+    axis->first = (long)a;
+    axis->last = (long)b;
+    return 1;
+}
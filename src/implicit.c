@@ -0,0 +1,419 @@
+/* Contorno de curvas implícitas (ver include/implicit.h) */
+#include "../include/implicit.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Cantos de uma célula: v0 = (i,j), v1 = (i+s,j), v2 = (i+s,j+s), v3 = (i,j+s),
+ * em unidades da grade fina. */
+typedef struct {
+    int i, j;
+    double f[4];
+    unsigned char ok;   /* Bit k: canto k avaliado sem erro */
+    double mae;         /* Variação de F nos cantos da célula mãe (INFINITY na base) */
+} Celula;
+
+/* Ponto da grade fina já avaliado, para as consultas das células filhas */
+typedef struct {
+    uint64_t chave;
+    double f;
+    unsigned char ok;
+} Amostra;
+
+/* Uma ponta de segmento: a aresta da grade fina que ela corta e o ponto */
+typedef struct {
+    uint64_t aresta;
+    double x, y;
+} Ponta;
+
+typedef struct {
+    const ImplicitGrid *g;
+    int n;              /* Células por lado da grade fina */
+    double hx, hy;
+    ImplicitEval eval;
+    void *ctx;
+    long avaliacoes;
+    long teto;          /* ImplicitGrid.max_evaluations */
+    double *x;          /* Lote: x, y e F, n de cada */
+    unsigned char *ok;
+    int capacidade;
+} Grade;
+
+static uint64_t chave(const Grade *g, int i, int j) {
+    return (uint64_t)j * (uint64_t)(g->n + 1) + (uint64_t)i;
+}
+
+static double coord_x(const Grade *g, int i) {
+    return g->g->x0 + i * g->hx;
+}
+
+static double coord_y(const Grade *g, int j) {
+    return g->g->y0 + j * g->hy;
+}
+
+/* Valor aceito: avaliado sem erro e finito */
+static int valido(double f, unsigned char ok) {
+    return ok && isfinite(f);
+}
+
+/* Variação (max - min) de F nos cantos válidos */
+static double variacao(const Celula *c) {
+    double lo = INFINITY, hi = -INFINITY;
+    for (int k = 0; k < 4; k++) {
+        if (!((c->ok >> k) & 1)) continue;
+        lo = fmin(lo, c->f[k]);
+        hi = fmax(hi, c->f[k]);
+    }
+    return hi - lo;
+}
+
+/* A célula pode conter a curva: F troca de sinal entre os cantos, ou parte
+ * deles deu erro (a curva pode acabar numa fronteira de domínio). */
+static int ativa(const Celula *c) {
+    if (c->ok == 0) return 0;
+    if (c->ok != 0xF) return 1;
+    const int s = c->f[0] > 0.0;
+    return (c->f[1] > 0.0) != s || (c->f[2] > 0.0) != s || (c->f[3] > 0.0) != s;
+}
+
+/* Avalia os pontos de `a` (chaves já preenchidas) pelo callback, nos
+ * buffers da grade (crescem com o maior lote) */
+static int avaliar(Grade *g, Amostra *a, int n) {
+    if (n > g->capacidade) {
+        free(g->x);
+        free(g->ok);
+        g->x = malloc((size_t)n * 3 * sizeof(double));
+        g->ok = malloc((size_t)n);
+        g->capacidade = (g->x && g->ok) ? n : 0;
+        if (!g->capacidade) return 0;
+    }
+
+    double *x = g->x, *y = x + n, *f = y + n;
+    const uint64_t lado = (uint64_t)(g->n + 1);
+    for (int k = 0; k < n; k++) {
+        x[k] = coord_x(g, (int)(a[k].chave % lado));
+        y[k] = coord_y(g, (int)(a[k].chave / lado));
+    }
+    g->avaliacoes += n;
+    if (!g->eval(g->ctx, x, y, n, f, g->ok)) return 0;
+    for (int k = 0; k < n; k++) {
+        a[k].f = f[k];
+        a[k].ok = (unsigned char)valido(f[k], g->ok[k]);
+    }
+    return 1;
+}
+
+/* Grade da base inteira num lote; devolve as células ativas em *saida */
+static int nivel_base(Grade *g, Celula **saida, int *ativas) {
+    const int base = g->g->base, passo = g->n / base;
+    const int lado = base + 1;
+    Amostra *a = malloc((size_t)lado * lado * sizeof(Amostra));
+    Celula *c = malloc((size_t)base * base * sizeof(Celula));
+    if (!a || !c) {
+        free(a);
+        free(c);
+        return 0;
+    }
+    for (int j = 0; j < lado; j++) {
+        for (int i = 0; i < lado; i++) a[j * lado + i].chave = chave(g, i * passo, j * passo);
+    }
+    if (!avaliar(g, a, lado * lado)) {
+        free(a);
+        free(c);
+        return 0;
+    }
+
+    int m = 0;
+    for (int j = 0; j < base; j++) {
+        for (int i = 0; i < base; i++) {
+            const Amostra *v[4] = { &a[j * lado + i], &a[j * lado + i + 1], &a[(j + 1) * lado + i + 1],
+                                    &a[(j + 1) * lado + i] };
+            Celula *cel = &c[m];
+            cel->i = i * passo;
+            cel->j = j * passo;
+            cel->ok = 0;
+            cel->mae = INFINITY;
+            for (int k = 0; k < 4; k++) {
+                cel->f[k] = v[k]->f;
+                cel->ok |= (unsigned char)(v[k]->ok << k);
+            }
+            m += ativa(cel);
+        }
+    }
+    free(a);
+    *saida = c;
+    *ativas = m;
+    return 1;
+}
+
+static int comparar_amostra(const void *a, const void *b) {
+    const uint64_t ca = ((const Amostra *)a)->chave, cb = ((const Amostra *)b)->chave;
+    return (ca > cb) - (ca < cb);
+}
+
+static const Amostra *buscar(const Amostra *a, int n, uint64_t k) {
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        const int meio = lo + (hi - lo) / 2;
+        if (a[meio].chave == k) return &a[meio];
+        if (a[meio].chave < k) lo = meio + 1;
+        else hi = meio - 1;
+    }
+    return NULL;
+}
+
+/* Divide as células ativas de lado `s` em quatro (lado s/2): os cinco
+ * pontos novos de cada uma (meios das arestas e centro) vão num lote só,
+ * sem repetições, e só as filhas ativas ficam. Se o lote passaria do teto
+ * de avaliações, não avalia nada e devolve 1 com *saida = NULL. */
+static int refinar(Grade *g, const Celula *pais, int n, int s, Celula **saida, int *ativas) {
+    const int h = s / 2;
+    Amostra *a = malloc((size_t)n * 5 * sizeof(Amostra));
+    Celula *c = malloc((size_t)n * 4 * sizeof(Celula));
+    if (!a || !c) {
+        free(a);
+        free(c);
+        return 0;
+    }
+
+    int m = 0;
+    for (int k = 0; k < n; k++) {
+        const int i = pais[k].i, j = pais[k].j;
+        a[m++].chave = chave(g, i + h, j);
+        a[m++].chave = chave(g, i + s, j + h);
+        a[m++].chave = chave(g, i + h, j + s);
+        a[m++].chave = chave(g, i, j + h);
+        a[m++].chave = chave(g, i + h, j + h);
+    }
+    qsort(a, m, sizeof(Amostra), comparar_amostra);
+    int u = 0;
+    for (int k = 0; k < m; k++) {
+        if (u == 0 || a[k].chave != a[u - 1].chave) a[u++] = a[k];
+    }
+    if (g->teto > 0 && g->avaliacoes + u > g->teto) {
+        free(a);
+        free(c);
+        *saida = NULL;
+        return 1;
+    }
+    if (!avaliar(g, a, u)) {
+        free(a);
+        free(c);
+        return 0;
+    }
+
+    int q = 0;
+    for (int k = 0; k < n; k++) {
+        const Celula *p = &pais[k];
+        const int i = p->i, j = p->j;
+        // Grade 3x3 da mãe, f3[linha][coluna]: os cantos vêm dela, o resto do lote
+        double f3[3][3];
+        unsigned char ok3[3][3];
+        const int di[3] = { 0, h, s }, dj[3] = { 0, h, s };
+        f3[0][0] = p->f[0], ok3[0][0] = p->ok & 1;
+        f3[0][2] = p->f[1], ok3[0][2] = (p->ok >> 1) & 1;
+        f3[2][2] = p->f[2], ok3[2][2] = (p->ok >> 2) & 1;
+        f3[2][0] = p->f[3], ok3[2][0] = (p->ok >> 3) & 1;
+        for (int r = 0; r < 3; r++) {
+            for (int col = 0; col < 3; col++) {
+                if ((r == 0 || r == 2) && (col == 0 || col == 2)) continue;
+                const Amostra *v = buscar(a, u, chave(g, i + di[col], j + dj[r]));
+                f3[r][col] = v->f;
+                ok3[r][col] = v->ok;
+            }
+        }
+
+        const double var = variacao(p);
+        for (int r = 0; r < 2; r++) {
+            for (int col = 0; col < 2; col++) {
+                Celula *f = &c[q];
+                f->i = i + di[col];
+                f->j = j + dj[r];
+                f->mae = var;
+                f->f[0] = f3[r][col];
+                f->f[1] = f3[r][col + 1];
+                f->f[2] = f3[r + 1][col + 1];
+                f->f[3] = f3[r + 1][col];
+                f->ok = (unsigned char)(ok3[r][col] | ok3[r][col + 1] << 1 | ok3[r + 1][col + 1] << 2 |
+                                        ok3[r + 1][col] << 3);
+                q += ativa(f);
+            }
+        }
+    }
+    free(a);
+    *saida = c;
+    *ativas = q;
+    return 1;
+}
+
+/* Ponto onde F = 0 na aresta do canto a ao b (a é o de menor índice) de
+ * uma célula de lado s */
+static void cortar(const Grade *g, const Celula *c, int s, int ka, int kb, Ponta *p) {
+    static const int di[4] = { 0, 1, 1, 0 }, dj[4] = { 0, 0, 1, 1 };
+    const int ia = c->i + di[ka] * s, ja = c->j + dj[ka] * s;
+    const int horizontal = (dj[ka] == dj[kb]);
+    const double u = c->f[ka] / (c->f[ka] - c->f[kb]);
+    const double xa = coord_x(g, ia), ya = coord_y(g, ja);
+    p->aresta = 2 * chave(g, ia, ja) + (uint64_t)!horizontal;
+    if (horizontal) {
+        p->x = xa + u * (coord_x(g, ia + s) - xa);
+        p->y = ya;
+    } else {
+        p->x = xa;
+        p->y = ya + u * (coord_y(g, ja + s) - ya);
+    }
+}
+
+/* Segmentos (pares de pontas) de uma célula de lado s (1 na grade fina);
+ * retorna quantos */
+static int marchar(const Grade *g, const Celula *c, int s, Ponta *seg) {
+    if (c->ok != 0xF || !ativa(c)) return 0;
+    // Perto de um polo a variação não cai com o refinamento
+    if (!(variacao(c) <= c->mae)) return 0;
+
+    // Arestas: 0 = v0-v1, 1 = v1-v2, 2 = v3-v2, 3 = v0-v3
+    static const int ka[4] = { 0, 1, 3, 0 }, kb[4] = { 1, 2, 2, 3 };
+    int cortadas[4], n = 0;
+    for (int e = 0; e < 4; e++) {
+        if ((c->f[ka[e]] > 0.0) != (c->f[kb[e]] > 0.0)) cortadas[n++] = e;
+    }
+    if (n == 2) {
+        cortar(g, c, s, ka[cortadas[0]], kb[cortadas[0]], &seg[0]);
+        cortar(g, c, s, ka[cortadas[1]], kb[cortadas[1]], &seg[1]);
+        return 1;
+    }
+    if (n != 4) return 0;
+
+    // Sela: se o centro tem o sinal de v0, as regiões de v0 e v2 se ligam e
+    // os segmentos isolam v1 e v3; senão isolam v0 e v2
+    const double centro = 0.25 * (c->f[0] + c->f[1] + c->f[2] + c->f[3]);
+    static const int ligar_v0[4] = { 0, 1, 2, 3 }, isolar_v0[4] = { 3, 0, 1, 2 };
+    const int *par = ((centro > 0.0) == (c->f[0] > 0.0)) ? ligar_v0 : isolar_v0;
+    for (int k = 0; k < 4; k++) cortar(g, c, s, ka[par[k]], kb[par[k]], &seg[k]);
+    return 2;
+}
+
+/* Ponta k (segmento k/2) ordenada pela aresta, para achar a vizinha */
+typedef struct {
+    uint64_t aresta;
+    int ponta;
+} Indice;
+
+static int comparar_indice(const void *a, const void *b) {
+    const Indice *ia = a, *ib = b;
+    if (ia->aresta != ib->aresta) return (ia->aresta > ib->aresta) - (ia->aresta < ib->aresta);
+    return (ia->ponta > ib->ponta) - (ia->ponta < ib->ponta);
+}
+
+/* Encadeia os segmentos em polylines: cada aresta cortada é de no máximo
+ * duas células, então cada ponta tem no máximo uma vizinha. Primeiro as
+ * cadeias abertas, a partir das pontas sem vizinha; o que sobra são ciclos. */
+static int encadear(const Ponta *pontas, int segmentos, ImplicitContour *out) {
+    const int np = 2 * segmentos;
+    Indice *idx = malloc(((size_t)np + 1) * sizeof(Indice));
+    int *vizinha = malloc(((size_t)np + 1) * sizeof(int));
+    unsigned char *usado = calloc((size_t)segmentos + 1, 1);
+    out->x = malloc(((size_t)np + 1) * sizeof(double));
+    out->y = malloc(((size_t)np + 1) * sizeof(double));
+    out->start = malloc(((size_t)segmentos + 1) * sizeof(int));
+    if (!idx || !vizinha || !usado || !out->x || !out->y || !out->start) {
+        free(idx);
+        free(vizinha);
+        free(usado);
+        return 0;
+    }
+
+    for (int k = 0; k < np; k++) {
+        idx[k].aresta = pontas[k].aresta;
+        idx[k].ponta = k;
+        vizinha[k] = -1;
+    }
+    qsort(idx, np, sizeof(Indice), comparar_indice);
+    for (int k = 0; k + 1 < np; k++) {
+        if (idx[k].aresta == idx[k + 1].aresta) {
+            vizinha[idx[k].ponta] = idx[k + 1].ponta;
+            vizinha[idx[k + 1].ponta] = idx[k].ponta;
+        }
+    }
+    free(idx);
+
+    for (int passada = 0; passada < 2; passada++) {
+        for (int k = 0; k < np; k++) {
+            if (usado[k / 2] || (passada == 0 && vizinha[k] >= 0)) continue;
+            out->start[out->lines++] = out->count;
+            out->x[out->count] = pontas[k].x;
+            out->y[out->count++] = pontas[k].y;
+            // Entra no segmento pela ponta k, sai pela outra e passa à vizinha
+            for (int p = k; p >= 0 && !usado[p / 2]; p = vizinha[p ^ 1]) {
+                usado[p / 2] = 1;
+                out->x[out->count] = pontas[p ^ 1].x;
+                out->y[out->count++] = pontas[p ^ 1].y;
+            }
+        }
+    }
+    out->start[out->lines] = out->count;
+    free(vizinha);
+    free(usado);
+    return 1;
+}
+
+void implicit_contour_free(ImplicitContour *c) {
+    free(c->x);
+    free(c->y);
+    free(c->start);
+    memset(c, 0, sizeof(*c));
+}
+
+int implicit_contour(const ImplicitGrid *grid, ImplicitEval eval, void *ctx, ImplicitContour *out) {
+    memset(out, 0, sizeof(*out));
+    const int depth = grid->depth < 0 ? 0 : grid->depth > IMPLICIT_MAX_DEPTH ? IMPLICIT_MAX_DEPTH : grid->depth;
+    Grade g;
+    g.g = grid;
+    g.n = grid->base << depth;
+    g.hx = (grid->x1 - grid->x0) / g.n;
+    g.hy = (grid->y1 - grid->y0) / g.n;
+    g.eval = eval;
+    g.ctx = ctx;
+    g.avaliacoes = 0;
+    g.teto = grid->max_evaluations;
+    g.x = NULL;
+    g.ok = NULL;
+    g.capacidade = 0;
+    if (grid->base < 1 || !(g.hx > 0.0) || !(g.hy > 0.0)) return 0;
+
+    Celula *celulas = NULL;
+    int n = 0;
+    int lado = g.n / grid->base;
+    int resultado = nivel_base(&g, &celulas, &n);
+    for (; resultado && lado > 1 && n > 0; lado /= 2) {
+        Celula *filhas = NULL;
+        int m = 0;
+        resultado = refinar(&g, celulas, n, lado, &filhas, &m);
+        // Teto de avaliações: o contorno sai das células de lado `lado`
+        if (resultado && !filhas) break;
+        free(celulas);
+        celulas = filhas;
+        n = m;
+    }
+    free(g.x);
+    free(g.ok);
+
+    Ponta *pontas = resultado ? malloc(((size_t)n * 4 + 1) * sizeof(Ponta)) : NULL;
+    int segmentos = 0;
+    if (pontas) {
+        for (int k = 0; k < n; k++) segmentos += marchar(&g, &celulas[k], lado, &pontas[2 * segmentos]);
+        resultado = encadear(pontas, segmentos, out);
+    }
+    resultado = resultado && pontas;
+    free(pontas);
+    free(celulas);
+
+    if (!resultado) {
+        implicit_contour_free(out);
+        return 0;
+    }
+    out->evaluations = g.avaliacoes;
+    out->cells = n;
+    return 1;
+}
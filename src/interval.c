@@ -0,0 +1,271 @@
+/* Aritmética intervalar sobre um BatchProgram (ver include/interval.h) */
+#include "../include/interval.h"
+#include <float.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Folga de cada limite, em ULPs: arredondamento da operação mais o erro dos
+ * kernels de vecmath.h (até 2 ULP) e da libm */
+#define INTERVAL_FOLGA_ULPS 4.0
+
+/* Acima disto a redução de faixa de sin/cos/tan perde a fase: a caixa vira
+ * [-1, 1] (e tan, singular) */
+#define INTERVAL_MAX_FASE 1e9
+
+static double abaixo(double v) {
+    return v - (fabs(v) * (INTERVAL_FOLGA_ULPS * DBL_EPSILON) + DBL_MIN);
+}
+
+static double acima(double v) {
+    return v + (fabs(v) * (INTERVAL_FOLGA_ULPS * DBL_EPSILON) + DBL_MIN);
+}
+
+/* [min(a,b), max(a,b)] alargado para fora */
+static Interval entre(double a, double b) {
+    Interval r;
+    r.lo = abaixo(fmin(a, b));
+    r.hi = acima(fmax(a, b));
+    return r;
+}
+
+/* Menor e maior de quatro valores, alargados (cantos de a×b) */
+static Interval cantos(double p, double q, double r, double s) {
+    Interval v;
+    v.lo = abaixo(fmin(fmin(p, q), fmin(r, s)));
+    v.hi = acima(fmax(fmax(p, q), fmax(r, s)));
+    return v;
+}
+
+/* 1 se algum fase + k*periodo (k inteiro) cai em [lo, hi], com folga: na
+ * dúvida, responde que sim */
+static int contem_fase(double lo, double hi, double fase, double periodo) {
+    const double folga = INTERVAL_FOLGA_ULPS * DBL_EPSILON * (fabs(lo) + fabs(hi) + 1.0);
+    const double k = ceil((lo - folga - fase) / periodo);
+    return fase + k * periodo <= hi + folga;
+}
+
+/* sin ou cos (fase do máximo 0 para cos, π/2 para sin) */
+static Interval trig(Interval a, double fase_max, double (*f)(double)) {
+    Interval r = { -1.0, 1.0 };
+    if (a.hi - a.lo >= 2.0 * M_PI || fabs(a.lo) > INTERVAL_MAX_FASE || fabs(a.hi) > INTERVAL_MAX_FASE) {
+        return r;
+    }
+    r = entre(f(a.lo), f(a.hi));
+    if (contem_fase(a.lo, a.hi, fase_max, 2.0 * M_PI)) r.hi = 1.0;
+    if (contem_fase(a.lo, a.hi, fase_max + M_PI, 2.0 * M_PI)) r.lo = -1.0;
+    if (r.lo < -1.0) r.lo = -1.0;
+    if (r.hi > 1.0) r.hi = 1.0;
+    return r;
+}
+
+static int contem_zero(Interval a) {
+    return a.lo <= 0.0 && a.hi >= 0.0;
+}
+
+/* x^b. Expoente inteiro exato: x^n é monótona em cada lado do 0 (x^-n
+ * precisa de x sem o 0). Senão, só para base positiva (ou >= 0 com expoente
+ * positivo), onde x^y é monótona em cada argumento e os extremos ficam nos
+ * cantos. Retorna 0 se o intervalo pode ser singular. */
+static int potencia(Interval a, Interval b, Interval *r) {
+    if (b.lo == b.hi && b.lo == floor(b.lo) && fabs(b.lo) <= 1024.0) {
+        const double n = b.lo;
+        if (n == 0.0) {
+            r->lo = r->hi = 1.0;
+            return 1;
+        }
+        const double p = pow(a.lo, n), q = pow(a.hi, n);
+        if (!contem_zero(a)) {
+            *r = entre(p, q);
+        } else if (n < 0.0) {
+            return 0;
+        } else if (fmod(n, 2.0) == 0.0) {
+            r->lo = 0.0;
+            r->hi = acima(fmax(p, q));
+        } else {
+            *r = entre(p, q);
+        }
+        return 1;
+    }
+    if (!(a.lo > 0.0 || (a.lo >= 0.0 && b.lo > 0.0))) return 0;
+    *r = cantos(pow(a.lo, b.lo), pow(a.lo, b.hi), pow(a.hi, b.lo), pow(a.hi, b.hi));
+    if (r->lo < 0.0) r->lo = 0.0;
+    return 1;
+}
+
+/* f(a) para uma função de BATCH_OP_FUNC. Retorna 0 se pode ser singular
+ * (fora do domínio, polo, salto) e -1 se a função não é conhecida. */
+static int funcao(int token, Interval a, Interval *r) {
+    switch (token) {
+    case TOKEN_SIN:
+        *r = trig(a, 0.5 * M_PI, sin);
+        return 1;
+    case TOKEN_COS:
+        *r = trig(a, 0.0, cos);
+        return 1;
+    case TOKEN_TAN:
+        if (a.hi - a.lo >= M_PI || fabs(a.lo) > INTERVAL_MAX_FASE || fabs(a.hi) > INTERVAL_MAX_FASE ||
+            contem_fase(a.lo, a.hi, 0.5 * M_PI, M_PI)) {
+            return 0;
+        }
+        *r = entre(tan(a.lo), tan(a.hi));
+        return 1;
+    case TOKEN_ABS:
+        if (contem_zero(a)) {
+            r->lo = 0.0;
+            r->hi = fmax(-a.lo, a.hi);
+        } else {
+            *r = entre(fabs(a.lo), fabs(a.hi));
+        }
+        return 1;
+    case TOKEN_SQRT:
+        if (a.lo < 0.0) return 0;
+        *r = entre(sqrt(a.lo), sqrt(a.hi));
+        if (r->lo < 0.0) r->lo = 0.0;
+        return 1;
+    case TOKEN_EXP:
+        *r = entre(exp(a.lo), exp(a.hi));
+        if (r->lo < 0.0) r->lo = 0.0;
+        return 1;
+    case TOKEN_LOG:
+        if (!(a.lo > 0.0)) return 0;
+        *r = entre(log(a.lo), log(a.hi));
+        return 1;
+    case TOKEN_LOG10:
+        if (!(a.lo > 0.0)) return 0;
+        *r = entre(log10(a.lo), log10(a.hi));
+        return 1;
+    case TOKEN_SINH:
+        *r = entre(sinh(a.lo), sinh(a.hi));
+        return 1;
+    case TOKEN_COSH:
+        *r = entre(cosh(a.lo), cosh(a.hi));
+        if (contem_zero(a)) r->lo = 1.0;
+        return 1;
+    case TOKEN_TANH:
+        *r = entre(tanh(a.lo), tanh(a.hi));
+        return 1;
+    case TOKEN_ASIN:
+        if (a.lo < -1.0 || a.hi > 1.0) return 0;
+        *r = entre(asin(a.lo), asin(a.hi));
+        return 1;
+    case TOKEN_ACOS:
+        if (a.lo < -1.0 || a.hi > 1.0) return 0;
+        *r = entre(acos(a.lo), acos(a.hi));
+        return 1;
+    case TOKEN_ATAN:
+        *r = entre(atan(a.lo), atan(a.hi));
+        return 1;
+    case TOKEN_ASINH:
+        *r = entre(asinh(a.lo), asinh(a.hi));
+        return 1;
+    case TOKEN_ACOSH:
+        if (a.lo < 1.0) return 0;
+        *r = entre(acosh(a.lo), acosh(a.hi));
+        return 1;
+    case TOKEN_ATANH:
+        if (!(a.lo > -1.0 && a.hi < 1.0)) return 0;
+        *r = entre(atanh(a.lo), atanh(a.hi));
+        return 1;
+    case TOKEN_CEIL:
+        // Salta nos inteiros: contínua só se não há inteiro em [lo, hi)
+        if (ceil(a.lo) != ceil(a.hi)) return 0;
+        r->lo = r->hi = ceil(a.lo);
+        return 1;
+    case TOKEN_FLOOR:
+        // Salta nos inteiros: contínua só se não há inteiro em (lo, hi]
+        if (floor(a.lo) != floor(a.hi)) return 0;
+        r->lo = r->hi = floor(a.lo);
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+int interval_supported(const BatchProgram *prog) {
+    Interval a = { 0.5, 0.5 }, r;
+    for (int k = 0; k < prog->size; k++) {
+        if (prog->ops[k].op == BATCH_OP_CALL) return 0;
+        if (prog->ops[k].op == BATCH_OP_FUNC && funcao(prog->ops[k].arg, a, &r) < 0) return 0;
+    }
+    return 1;
+}
+
+int interval_stack_size(const BatchProgram *prog) {
+    return prog->depth + prog->temps;
+}
+
+int interval_eval(const BatchProgram *prog, double t0, double t1, Interval *stack, Interval *out) {
+    Interval *temp = stack + prog->depth;
+    for (int k = 0; k < prog->size; k++) {
+        const BatchOp op = prog->ops[k];
+        Interval *a = stack + op.slot;
+        const Interval *b = a + 1;  // Segundo operando (só nas binárias)
+
+        switch (op.op) {
+        case BATCH_OP_CONST:
+            a->lo = a->hi = prog->values[op.arg];
+            break;
+        case BATCH_OP_VAR:
+            a->lo = t0;
+            a->hi = t1;
+            break;
+        case BATCH_OP_NEG: {
+            const double lo = a->lo;
+            a->lo = -a->hi;
+            a->hi = -lo;
+            break;
+        }
+        case BATCH_OP_ADD:
+            a->lo = abaixo(a->lo + b->lo);
+            a->hi = acima(a->hi + b->hi);
+            break;
+        case BATCH_OP_SUB:
+            a->lo = abaixo(a->lo - b->hi);
+            a->hi = acima(a->hi - b->lo);
+            break;
+        case BATCH_OP_MUL:
+            *a = cantos(a->lo * b->lo, a->lo * b->hi, a->hi * b->lo, a->hi * b->hi);
+            break;
+        case BATCH_OP_DIV:
+            if (contem_zero(*b)) return INTERVAL_SINGULAR;
+            *a = cantos(a->lo / b->lo, a->lo / b->hi, a->hi / b->lo, a->hi / b->hi);
+            break;
+        case BATCH_OP_POW:
+            if (!potencia(*a, *b, a)) return INTERVAL_SINGULAR;
+            break;
+        case BATCH_OP_FUNC: {
+            const int r = funcao(op.arg, *a, a);
+            if (r < 0) return INTERVAL_UNSUPPORTED;
+            if (r == 0) return INTERVAL_SINGULAR;
+            break;
+        }
+        case BATCH_OP_SINCOS:
+            temp[op.arg] = trig(*a, 0.0, cos);
+            *a = trig(*a, 0.5 * M_PI, sin);
+            break;
+        case BATCH_OP_COSSIN:
+            temp[op.arg] = trig(*a, 0.5 * M_PI, sin);
+            *a = trig(*a, 0.0, cos);
+            break;
+        case BATCH_OP_LOAD:
+            *a = temp[op.arg];
+            break;
+        case BATCH_OP_STORE:
+            temp[op.arg] = *a;
+            break;
+        default:
+            return INTERVAL_UNSUPPORTED;
+        }
+
+        // Infinito (ou NaN) em algum passo: o avaliador daria erro
+        if (!isfinite(a->lo) || !isfinite(a->hi)) return INTERVAL_SINGULAR;
+    }
+
+    for (int k = 0; k < prog->outputs; k++) {
+        out[k] = (prog->result[k] < 0) ? stack[0] : temp[prog->result[k]];
+    }
+    return INTERVAL_REGULAR;
+}
@@ -1,94 +1,1175 @@
 /* Multicurvas - Gerador de curvas via linha de comando */
+#define _POSIX_C_SOURCE 200809L
+
 #include "../include/multicurvas_plot.h"
 #include "../include/render.h"
+#include "../include/pointfile.h"
+#include "../include/batch_eval.h"
+#include "../include/server.h"
+#include "../include/stream.h"
+#include "../include/stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Opções de amostragem da linha de comando, aplicadas a cada Plot. */
+typedef struct {
+    int adaptativa;
+    double tolerancia;
+    int amostras;
+    int threads;
+    int max_avaliacoes;     /* 0 = sem limite */
+    double simplificacao;   /* Tolerância em pixels da curva no SVG (0 = todos os pontos) */
+    int zx81;               /* Raster no modo de blocos 64x44 do ZX81 */
+    int incremental;        /* Grade diádica e cache de amostras */
+    int intervalar;         /* --interval: adaptativa com aritmética intervalar, curva em trechos */
+    PlotQuality qualidade;  /* --quality: exata ou prévia em float */
+    int estatisticas;       /* --stats: instrumentação ligada */
+    StatsFormat formato_estatisticas;
+} Opcoes;
+
+/* Aplica as opções ao plot. Retorna 1 se o orçamento de avaliações
+ * reduziu o número de amostras. Numa curva implícita as amostras são
+ * células por lado, não avaliações: o orçamento só limita as avaliações da
+ * quadtree (Plot.max_samples). */
+static int aplicar_opcoes(Plot *plot, const Opcoes *op) {
+    int limitado = 0;
+    plot->adaptive = op->adaptativa;
+    plot->tolerance = op->tolerancia;
+    plot->threads = op->threads;
+    plot->samples = op->amostras;
+    plot->incremental = op->incremental;
+    plot->interval = op->intervalar;
+    plot->quality = op->qualidade;
+    if (op->max_avaliacoes > 0) {
+        plot->max_samples = op->max_avaliacoes;
+        if (plot->type != PLOT_IMPLICIT && plot->samples > op->max_avaliacoes) {
+            plot->samples = op->max_avaliacoes;
+            limitado = !op->adaptativa && !op->intervalar;
+        }
+    }
+    return limitado;
+}
+
+/* Renderiza `data`, gerado de `plot` e `titulo`, no formato pedido, e conta
+ * a curva no Stats da thread (--stats). Com `caixa`, SVG e raster (sem
+ * --zx81) usam essa caixa em vez da dos pontos (quadros de uma varredura).
+ * Retorna 0 se não foi possível montar a imagem raster (canvas grande demais
+ * ou falta de memória). */
+static int renderizar(OutBuf *out, const Plot *plot, const PlotData *data, RenderFormat formato,
+                      const char *titulo, int largura, int altura, const RenderBounds *caixa, const Opcoes *op,
+                      RenderStats *stats) {
+    const int anterior = stats_enter(STATS_RENDER);
+    int ok = 1;
+    switch (formato) {
+    case RENDER_CSV:
+        render_csv_out(out, data);
+        stats->points_in = stats->points_out = data->count;
+        break;
+    case RENDER_SVG:
+        if (caixa) {
+            render_frame_out(out, data, formato, caixa, titulo, largura, altura, op->simplificacao, stats);
+        } else {
+            render_svg_out(out, data, titulo, largura, altura, op->simplificacao, stats);
+        }
+        break;
+    case RENDER_BIN:
+        stats->points_in = stats->points_out = data->count;
+        ok = pointfile_write(out, titulo, plot, data) || out->error;
+        break;
+    default:
+        // Falhas de escrita ficam em out->error; 0 aqui só se a imagem não foi montada
+        if (caixa && !op->zx81) {
+            ok = render_frame_out(out, data, formato, caixa, NULL, largura, altura, op->simplificacao, stats) ||
+                 out->error;
+        } else {
+            ok = render_raster_out(out, data, formato, largura, altura, op->simplificacao, op->zx81, stats) ||
+                 out->error;
+        }
+        break;
+    }
+    stats_leave(anterior);
+
+    Stats *st = stats_current();
+    if (st) {
+        st->curves++;
+        st->points += (unsigned long)data->count;
+        st->emitted += (unsigned long)stats->points_out;
+    }
+    return ok;
+}
+
+/* ---- Modo --batch: várias curvas de um manifesto num processo só ---- */
+
+#define MANIFESTO_MAX_LINHA 2048
+
+/* Uma linha do manifesto e o resultado da sua renderização. */
+typedef struct {
+    int linha;
+    char *expressao;
+    char *saida;
+    RenderFormat formato;
+    int largura, altura;
+    double ms;           /* Tempo da curva (parse, amostragem e escrita) */
+    int avaliacoes;
+    int pontos;
+    int vertices;        /* Pontos escritos depois da simplificação (SVG e raster) */
+    int limitada;        /* Amostras cortadas pelo orçamento */
+    char *erro;          /* NULL se deu certo */
+    Stats stats;         /* Com --stats */
+} EntradaLote;
+
+typedef struct {
+    EntradaLote *entradas;
+    int count;
+    int proxima;             /* Próxima entrada a pegar (protegida por mutex) */
+    pthread_mutex_t mutex;
+    const Opcoes *opcoes;
+} Lote;
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Próximo campo da linha (separado por espaços; aspas agrupam). Termina o
+ * campo com '\0' no próprio buffer. Retorna NULL no fim da linha. */
+static char *proximo_campo(char **cursor) {
+    char *p = *cursor;
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p) return NULL;
+
+    char *inicio;
+    if (*p == '"') {
+        inicio = ++p;
+        while (*p && *p != '"') p++;
+    } else {
+        inicio = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+    }
+    if (*p) *p++ = '\0';
+    *cursor = p;
+    return inicio;
+}
+
+static void liberar_lote(EntradaLote *entradas, int count) {
+    for (int k = 0; k < count; k++) {
+        free(entradas[k].expressao);
+        free(entradas[k].saida);
+        free(entradas[k].erro);
+    }
+    free(entradas);
+}
+
+/* Lê o manifesto: "expressão formato LARGURAxALTURA arquivo" por linha,
+ * linhas vazias e começando com '#' ignoradas. Retorna as entradas ou NULL
+ * (com a mensagem em stderr). */
+static EntradaLote *ler_manifesto(const char *caminho, int *count) {
+    FILE *f = fopen(caminho, "r");
+    if (!f) {
+        fprintf(stderr, "Erro: não foi possível abrir o manifesto '%s'\n", caminho);
+        return NULL;
+    }
+
+    EntradaLote *entradas = NULL;
+    int n = 0, capacidade = 0, num_linha = 0, ok = 1;
+    char linha[MANIFESTO_MAX_LINHA];
+
+    while (ok && fgets(linha, sizeof(linha), f)) {
+        num_linha++;
+        linha[strcspn(linha, "\r\n")] = '\0';
+
+        char *cursor = linha;
+        char *expressao = proximo_campo(&cursor);
+        if (!expressao || expressao[0] == '#') continue;
+        char *formato = proximo_campo(&cursor);
+        char *tamanho = proximo_campo(&cursor);
+        char *saida = proximo_campo(&cursor);
+
+        int largura = 0, altura = 0;
+        char extra;
+        RenderFormat fmt;
+        if (!saida || proximo_campo(&cursor) || !render_format_parse(formato, &fmt) ||
+            sscanf(tamanho, "%dx%d%c", &largura, &altura, &extra) != 2 ||
+            largura <= 0 || altura <= 0) {
+            fprintf(stderr, "Erro: %s:%d: esperado \"expressão formato LARGURAxALTURA arquivo\"\n",
+                    caminho, num_linha);
+            ok = 0;
+            break;
+        }
+
+        if (n == capacidade) {
+            capacidade = capacidade ? capacidade * 2 : 64;
+            EntradaLote *tmp = realloc(entradas, capacidade * sizeof(EntradaLote));
+            if (!tmp) {
+                ok = 0;
+                break;
+            }
+            entradas = tmp;
+        }
+        EntradaLote *e = &entradas[n];
+        memset(e, 0, sizeof(*e));
+        e->linha = num_linha;
+        e->expressao = strdup(expressao);
+        e->saida = strdup(saida);
+        e->formato = fmt;
+        e->largura = largura;
+        e->altura = altura;
+        n++;
+        if (!e->expressao || !e->saida) ok = 0;
+    }
+    fclose(f);
+
+    if (!ok) {
+        liberar_lote(entradas, n);
+        return NULL;
+    }
+    *count = n;
+    return entradas;
+}
+
+/* Renderiza uma entrada gerando as amostras em `dados`, o PlotData da
+ * thread, reaproveitado de uma curva para a outra. */
+static void renderizar_entrada(EntradaLote *e, const Opcoes *opcoes, PlotData *dados) {
+    char *errmsg = NULL;
+    double inicio = agora();
+    if (opcoes->estatisticas) stats_attach(&e->stats);
+
+    Plot *plot = plot_parse_text(e->expressao, &errmsg);
+    PlotData *data = NULL;
+    if (plot) {
+        e->limitada = aplicar_opcoes(plot, opcoes);
+        if (plot_generate_samples_into(plot, dados, &errmsg)) data = dados;
+    }
+
+    if (data) {
+        OutBuf out;
+        // Criar e fechar o arquivo contam como escrita
+        int anterior = stats_enter(STATS_WRITE);
+        int fd = open(e->saida, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        stats_leave(anterior);
+        if (fd < 0) {
+            errmsg = strdup("não foi possível criar o arquivo de saída");
+        } else if (!outbuf_init_fd(&out, fd, 0)) {
+            errmsg = strdup("memória insuficiente");
+            close(fd);
+        } else {
+            RenderStats stats;
+            int imagem = renderizar(&out, plot, data, e->formato, e->expressao, e->largura, e->altura, NULL,
+                                    opcoes, &stats);
+            e->vertices = stats.points_out;
+            int ok = outbuf_close(&out);
+            anterior = stats_enter(STATS_WRITE);
+            if (close(fd) != 0) ok = 0;
+            stats_leave(anterior);
+            if (!imagem) {
+                errmsg = strdup("canvas grande demais ou memória insuficiente para a imagem");
+            } else if (!ok) {
+                errmsg = strdup("erro ao gravar o arquivo de saída");
+            }
+        }
+        e->avaliacoes = data->evaluations;
+        e->pontos = data->count;
+    }
+
+    stats_detach();
+    e->ms = (agora() - inicio) * 1e3;
+    if (!data && !errmsg) errmsg = strdup("desconhecido");
+    e->erro = errmsg;
+    plot_free(plot);
+}
+
+static void *lote_worker(void *arg) {
+    Lote *lote = arg;
+    PlotData dados;
+    memset(&dados, 0, sizeof(dados));
+    for (;;) {
+        pthread_mutex_lock(&lote->mutex);
+        int k = lote->proxima++;
+        pthread_mutex_unlock(&lote->mutex);
+        if (k >= lote->count) break;
+        renderizar_entrada(&lote->entradas[k], lote->opcoes, &dados);
+    }
+    plot_data_release(&dados);
+    return NULL;
+}
+
+/* Resumo dos caches de programas e de amostras, em stderr */
+static void mostrar_caches(const Opcoes *opcoes) {
+    ExprCacheStats cache;
+    plot_cache_stats(&cache);
+    fprintf(stderr, "cache de programas: %lu acertos, %lu faltas, %lu descartes, %d programas "
+            "(%.1f KB de %.1f KB)\n", cache.hits, cache.misses, cache.evictions, cache.entries,
+            cache.bytes / 1024.0, cache.max_bytes / 1024.0);
+    if (opcoes->incremental) {
+        PlotSampleCacheStats amostras;
+        plot_sample_cache_stats(&amostras);
+        fprintf(stderr, "cache de amostras: %lu reaproveitadas, %lu avaliadas, %d curvas (%.1f MB de %.1f MB)\n",
+                amostras.reused, amostras.evaluated, amostras.curves.entries,
+                amostras.curves.bytes / 1048576.0, amostras.curves.max_bytes / 1048576.0);
+    }
+}
+
+/* Curvas com a maior fração de avaliações com erro, no texto de --stats */
+#define LOTE_MAX_ERROS_LISTADAS 5
+
+static double fracao_erros(const Stats *st) {
+    unsigned long n = 0;
+    for (int k = 0; k < STATS_ERRORS; k++) n += st->errors[k];
+    return st->evaluations ? (double)n / st->evaluations : 0.0;
+}
+
+/* --stats do lote, em stderr: em texto, a soma das curvas e as que mais
+ * erraram avaliações; em JSON, a soma e cada curva. */
+static void mostrar_estatisticas_lote(const EntradaLote *entradas, int count, StatsFormat formato) {
+    Stats total;
+    memset(&total, 0, sizeof(total));
+    for (int k = 0; k < count; k++) stats_merge(&total, &entradas[k].stats);
+
+    if (formato == STATS_FORMAT_JSON) {
+        fprintf(stderr, "{\"total\": ");
+        stats_print(stderr, &total, STATS_FORMAT_JSON, NULL);
+        fprintf(stderr, ",\n \"curvas\": [");
+        for (int k = 0; k < count; k++) {
+            const EntradaLote *e = &entradas[k];
+            fprintf(stderr, "%s\n  {\"linha\": %d, \"expressao\": ", k ? "," : "", e->linha);
+            stats_print_json_string(stderr, e->expressao);
+            fprintf(stderr, ", \"saida\": ");
+            stats_print_json_string(stderr, e->saida);
+            fprintf(stderr, ", \"erro\": ");
+            if (e->erro) {
+                stats_print_json_string(stderr, e->erro);
+            } else {
+                fprintf(stderr, "null");
+            }
+            fprintf(stderr, ", \"stats\": ");
+            stats_print(stderr, &e->stats, STATS_FORMAT_JSON, NULL);
+            fprintf(stderr, "}");
+        }
+        fprintf(stderr, "\n]}\n");
+        return;
+    }
+
+    stats_print(stderr, &total, STATS_FORMAT_TEXT, "estatísticas do lote (somando as curvas)");
+    int listadas[LOTE_MAX_ERROS_LISTADAS];
+    int n = 0;
+    for (int k = 0; k < count; k++) {
+        const double f = fracao_erros(&entradas[k].stats);
+        if (f <= 0.0) continue;
+        int pos = n < LOTE_MAX_ERROS_LISTADAS ? n++ : LOTE_MAX_ERROS_LISTADAS;
+        while (pos > 0 && fracao_erros(&entradas[listadas[pos - 1]].stats) < f) {
+            if (pos < LOTE_MAX_ERROS_LISTADAS) listadas[pos] = listadas[pos - 1];
+            pos--;
+        }
+        if (pos < LOTE_MAX_ERROS_LISTADAS) listadas[pos] = k;
+    }
+    if (n > 0) fprintf(stderr, "  curvas com mais avaliações com erro:\n");
+    for (int k = 0; k < n; k++) {
+        const EntradaLote *e = &entradas[listadas[k]];
+        fprintf(stderr, "  %6.1f%% de %9lu  %s\n", 100.0 * fracao_erros(&e->stats), e->stats.evaluations,
+                e->expressao);
+    }
+}
+
+/* Renderiza todas as curvas do manifesto, em paralelo entre `threads`
+ * threads (cada curva roda numa thread só), e imprime em stderr o resumo por
+ * curva. Retorna o código de saída do processo. */
+static int executar_lote(const char *caminho, const Opcoes *opcoes, int threads) {
+    int count = 0;
+    EntradaLote *entradas = ler_manifesto(caminho, &count);
+    if (!entradas) return 1;
+
+    Opcoes por_curva = *opcoes;
+    por_curva.threads = 1;
+
+    Lote lote = { entradas, count, 0, PTHREAD_MUTEX_INITIALIZER, &por_curva };
+    int n_threads = plot_thread_count(threads);
+    if (n_threads > count) n_threads = count > 0 ? count : 1;
+
+    double inicio = agora();
+    pthread_t th[PLOT_MAX_THREADS];
+    int criadas = 0;
+    for (int k = 1; k < n_threads; k++) {
+        if (pthread_create(&th[criadas], NULL, lote_worker, &lote) == 0) criadas++;
+    }
+    lote_worker(&lote);
+    for (int k = 0; k < criadas; k++) {
+        pthread_join(th[k], NULL);
+    }
+    double total_ms = (agora() - inicio) * 1e3;
+
+    int erros = 0;
+    double soma_ms = 0.0;
+    long avaliacoes = 0, pontos = 0, vertices = 0;
+    for (int k = 0; k < count; k++) {
+        EntradaLote *e = &entradas[k];
+        soma_ms += e->ms;
+        avaliacoes += e->avaliacoes;
+        pontos += e->pontos;
+        vertices += e->vertices;
+        if (e->erro) {
+            erros++;
+            fprintf(stderr, "[%3d/%d] %9.2f ms  ERRO (linha %d): %s: %s\n", k + 1, count, e->ms,
+                    e->linha, e->expressao, e->erro);
+        } else {
+            fprintf(stderr, "[%3d/%d] %9.2f ms %9d aval. %9d pontos %9d escritos%s  %s\n", k + 1,
+                    count, e->ms, e->avaliacoes, e->pontos, e->vertices,
+                    e->limitada ? " (orçamento)" : "", e->saida);
+        }
+    }
+    fprintf(stderr, "%d curvas, %d com erro, %ld avaliações, %ld pontos, %ld escritos; "
+            "%.2f ms somando as curvas, %.2f ms no total (%d threads)\n", count, erros, avaliacoes,
+            pontos, vertices, soma_ms, total_ms, n_threads);
+
+    mostrar_caches(opcoes);
+    if (opcoes->estatisticas) mostrar_estatisticas_lote(entradas, count, opcoes->formato_estatisticas);
+
+    liberar_lote(entradas, count);
+    return erros ? 1 : 0;
+}
+
+/* ---- Modo --serve: servidor de renderização (server.h) ---- */
+
+/* Teto de avaliações por pedido quando o servidor sobe sem --max-evals */
+#define SERVIDOR_MAX_AVALIACOES 1000000
+
+/* --stats do servidor: soma dos pedidos de todos os workers */
+static Stats estatisticas_servidor;
+static pthread_mutex_t estatisticas_servidor_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Uma opção "chave=valor" do pedido sobre `op`. O orçamento de avaliações
+ * do servidor (`teto`) não pode ser ultrapassado. Retorna 0 se inválida. */
+static int opcao_pedido(const char *campo, Opcoes *op, int teto) {
+    char *fim;
+    if (strncmp(campo, "samples=", 8) == 0) {
+        long n = strtol(campo + 8, &fim, 10);
+        if (fim == campo + 8 || *fim || n < 2 || n > 100000000L) return 0;
+        op->amostras = (int)n;
+    } else if (strcmp(campo, "adaptive") == 0) {
+        op->adaptativa = 1;
+    } else if (strncmp(campo, "adaptive=", 9) == 0) {
+        op->adaptativa = 1;
+        op->tolerancia = strtod(campo + 9, &fim);
+        if (fim == campo + 9 || *fim || !(op->tolerancia > 0.0)) return 0;
+    } else if (strncmp(campo, "max-evals=", 10) == 0) {
+        long n = strtol(campo + 10, &fim, 10);
+        if (fim == campo + 10 || *fim || n < 2) return 0;
+        op->max_avaliacoes = (n < teto) ? (int)n : teto;
+    } else if (strncmp(campo, "simplify=", 9) == 0) {
+        op->simplificacao = strtod(campo + 9, &fim);
+        if (fim == campo + 9 || *fim || !(op->simplificacao >= 0.0)) return 0;
+    } else if (strcmp(campo, "zx81") == 0) {
+        op->zx81 = 1;
+    } else if (strcmp(campo, "interval") == 0) {
+        op->intervalar = 1;
+    } else if (strncmp(campo, "quality=", 8) == 0) {
+        if (!plot_quality_parse(campo + 8, &op->qualidade)) return 0;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* ServerHandler do modo --serve. O pedido é uma linha como as do manifesto,
+ * sem o arquivo: "expressão [formato] [LARGURAxALTURA] [opção...]", com as
+ * opções samples=<n>, adaptive[=tol], interval, quality=<q>, max-evals=<n>, simplify=<px>
+ * e zx81;
+ * o que faltar vem da linha de comando do servidor (`ctx`). */
+static int atender_pedido(void *ctx, char *pedido, PlotData *dados, OutBuf *out, double prazo,
+                          char **errmsg) {
+    const Opcoes *servidor = ctx;
+    Opcoes op = *servidor;
+    RenderFormat fmt = RENDER_SVG;
+    int largura = 800, altura = 600;
+
+    char *cursor = pedido;
+    char *expressao = proximo_campo(&cursor);
+    if (!expressao) {
+        *errmsg = strdup("pedido vazio");
+        return 0;
+    }
+    char *campo;
+    while ((campo = proximo_campo(&cursor))) {
+        int l, a;
+        char extra;
+        if (render_format_parse(campo, &fmt)) continue;
+        if (sscanf(campo, "%dx%d%c", &l, &a, &extra) == 2 && l > 0 && a > 0) {
+            largura = l;
+            altura = a;
+            continue;
+        }
+        if (!opcao_pedido(campo, &op, servidor->max_avaliacoes)) {
+            char msg[160];
+            snprintf(msg, sizeof(msg), "campo '%.100s' inválido", campo);
+            *errmsg = strdup(msg);
+            return 0;
+        }
+    }
+    if (op.zx81 && (fmt == RENDER_CSV || fmt == RENDER_SVG || fmt == RENDER_BIN)) {
+        *errmsg = strdup("zx81 só vale para ppm, pbm e png");
+        return 0;
+    }
+
+    Stats st;
+    if (op.estatisticas) {
+        memset(&st, 0, sizeof(st));
+        stats_attach(&st);
+    }
+    Plot *plot = plot_parse_text(expressao, errmsg);
+    int ok = plot != NULL;
+    if (ok) {
+        aplicar_opcoes(plot, &op);
+        ok = plot_generate_samples_into(plot, dados, errmsg);
+    }
+    if (ok && server_now() > prazo) {
+        // A amostragem não é interrompida; o prazo é conferido depois dela
+        *errmsg = strdup("tempo esgotado");
+        ok = 0;
+    }
+    if (ok) {
+        RenderStats stats;
+        if (!renderizar(out, plot, dados, fmt, expressao, largura, altura, NULL, &op, &stats)) {
+            *errmsg = strdup("canvas grande demais ou memória insuficiente para a imagem");
+            ok = 0;
+        }
+    }
+    plot_free(plot);
+    if (op.estatisticas) {
+        // O último pedaço também conta na escrita (o servidor só o repetiria vazio)
+        if (ok) outbuf_flush(out);
+        stats_detach();
+        pthread_mutex_lock(&estatisticas_servidor_lock);
+        stats_merge(&estatisticas_servidor, &st);
+        pthread_mutex_unlock(&estatisticas_servidor_lock);
+    }
+    return ok;
+}
+
+/* Atende pedidos em `endereco` até SIGINT/SIGTERM, com `threads` workers
+ * (cada pedido roda numa thread só) e imprime o resumo em stderr. */
+static int executar_servidor(const char *endereco, const Opcoes *opcoes, int threads, double prazo_ms) {
+    Opcoes por_pedido = *opcoes;
+    por_pedido.threads = 1;
+    if (por_pedido.max_avaliacoes == 0) por_pedido.max_avaliacoes = SERVIDOR_MAX_AVALIACOES;
+
+    ServerConfig config = { endereco, threads, 0, prazo_ms, atender_pedido, &por_pedido };
+    fprintf(stderr, "Servindo em %s: %d workers, prazo de %.0f ms, até %d avaliações por pedido\n",
+            endereco, plot_thread_count(threads), prazo_ms, por_pedido.max_avaliacoes);
+
+    ServerStats stats;
+    char *errmsg = NULL;
+    if (!server_run(&config, &stats, &errmsg)) {
+        fprintf(stderr, "Erro: %s\n", errmsg ? errmsg : "desconhecido");
+        free(errmsg);
+        return 1;
+    }
+    fprintf(stderr, "%lu conexões (%lu recusadas), %lu pedidos, %lu com erro (%lu por prazo), "
+            "%.1f MB enviados; pedido mais lento: %.2f ms\n", stats.connections, stats.rejected,
+            stats.requests, stats.errors, stats.timeouts, stats.bytes / 1048576.0, stats.max_ms);
+    mostrar_caches(opcoes);
+    if (opcoes->estatisticas) {
+        stats_print(stderr, &estatisticas_servidor, opcoes->formato_estatisticas,
+                    "estatísticas dos pedidos (somando os workers)");
+        if (opcoes->formato_estatisticas == STATS_FORMAT_JSON) fputc('\n', stderr);
+    }
+    return 0;
+}
+
+/* --stream: amostra e renderiza `plot` em fluxo direto no fd 1, imprime as
+ * estatísticas (se ligadas em `estatisticas`) e libera o plot. Retorna o
+ * código de saída do processo. */
+static int executar_fluxo(Plot *plot, RenderFormat formato, const char *titulo, int largura, int altura,
+                          const Opcoes *op, int bloco, const RenderBounds *viewport, Stats *estatisticas) {
+    StreamOptions opcoes = { bloco, 0, viewport, op->simplificacao };
+    OutBuf out;
+    char *errmsg = NULL;
+    int ok = 0;
+    if (!outbuf_init_fd(&out, STDOUT_FILENO, 0)) {
+        fprintf(stderr, "Erro: memória insuficiente\n");
+    } else {
+        RenderStats stats;
+        ok = stream_render(&out, plot, formato, titulo, largura, altura, &opcoes, &stats, &errmsg);
+        ok = outbuf_close(&out) && ok;
+        if (!ok) fprintf(stderr, "Erro ao gerar dados: %s\n", errmsg ? errmsg : "erro ao gravar a saída");
+        free(errmsg);
+
+        Stats *st = stats_current();
+        if (st && ok) {
+            st->curves++;
+            st->emitted += (unsigned long)stats.points_out;
+        }
+    }
+    stats_detach();
+    if (op->estatisticas) {
+        stats_print(stderr, estatisticas, op->formato_estatisticas, "estatísticas");
+        if (op->formato_estatisticas == STATS_FORMAT_JSON) fputc('\n', stderr);
+    }
+    plot_free(plot);
+    return ok ? 0 : 1;
+}
+
+/* ---- Varredura de parâmetros livres (--param=nome=de,até) ---- */
+
+#define QUADROS_PADRAO 60        /* --frames de uma varredura sem a opção */
+#define QUADROS_MAXIMO 10000
+#define QUADROS_MAX_NOME 4096    /* Nome de arquivo de --frames-out */
+
+/* 1 se `padrao` tem exatamente um %d (ou %0Nd, com zeros à esquerda) e
+ * nenhum outro '%' além de "%%" */
+static int padrao_de_quadros_valido(const char *padrao) {
+    int campos = 0;
+    for (const char *c = padrao; *c; c++) {
+        if (*c != '%') continue;
+        c++;
+        if (*c == '%') continue;
+        if (*c == '0') {
+            c++;
+            for (int digitos = 0; isdigit((unsigned char)*c); c++) {
+                if (++digitos > 2) return 0;
+            }
+        }
+        if (*c != 'd') return 0;
+        campos++;
+    }
+    return campos == 1;
+}
+
+/* Título de um quadro: a expressão e os valores dos parâmetros, ex.
+ * "R=sin(k*t) [k=2.5]" */
+static void titulo_do_quadro(char *buf, size_t n, const char *expressao, const Plot *plot, int quadro,
+                             int quadros) {
+    size_t usado = (size_t)snprintf(buf, n, "%s [", expressao);
+    for (int k = 0; k < plot->n_params && usado < n; k++) {
+        usado += (size_t)snprintf(buf + usado, n - usado, "%s%s=%g", k ? " " : "", plot->params[k].name,
+                                  plot_param_value(&plot->params[k], quadro, quadros));
+    }
+    if (usado < n) snprintf(buf + usado, n - usado, "]");
+}
+
+/* Grava os quadros, na caixa comum a todos: num SVG animado em stdout ou,
+ * com `padrao`, um arquivo por quadro. Retorna 0 (com a mensagem em stderr)
+ * se algum não pôde ser gravado. */
+static int gravar_quadros(const Plot *plot, const PlotData *dados, int quadros, RenderFormat formato,
+                          const char *expressao, int largura, int altura, const Opcoes *op, const char *padrao) {
+    RenderBounds caixa;
+    if (!render_bounds_frames(dados, quadros, &caixa)) {
+        fprintf(stderr, "Erro: nenhum quadro tem pontos\n");
+        return 0;
+    }
+
+    if (!padrao) {
+        OutBuf out;
+        if (!outbuf_init_fd(&out, STDOUT_FILENO, 0)) {
+            fprintf(stderr, "Erro: memória insuficiente\n");
+            return 0;
+        }
+        RenderStats stats;
+        const int anterior = stats_enter(STATS_RENDER);
+        render_svg_animation_out(&out, dados, quadros, &caixa, expressao, largura, altura, op->simplificacao,
+                                 RENDER_ANIMATION_FPS, &stats);
+        stats_leave(anterior);
+        const int ok = outbuf_close(&out);
+
+        Stats *st = stats_current();
+        if (st) {
+            st->curves += (unsigned long)quadros;
+            for (int f = 0; f < quadros; f++) st->points += (unsigned long)dados[f].count;
+            st->emitted += (unsigned long)stats.points_out;
+        }
+        return ok;
+    }
+
+    for (int f = 0; f < quadros; f++) {
+        char nome[QUADROS_MAX_NOME], titulo[MANIFESTO_MAX_LINHA];
+        const int n = snprintf(nome, sizeof(nome), padrao, f);
+        if (n < 0 || n >= (int)sizeof(nome)) {
+            fprintf(stderr, "Erro: nome do quadro %d grande demais\n", f);
+            return 0;
+        }
+        titulo_do_quadro(titulo, sizeof(titulo), expressao, plot, f, quadros);
+
+        OutBuf out;
+        int anterior = stats_enter(STATS_WRITE);
+        int fd = open(nome, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        stats_leave(anterior);
+        if (fd < 0) {
+            fprintf(stderr, "Erro: não foi possível criar '%s'\n", nome);
+            return 0;
+        }
+        if (!outbuf_init_fd(&out, fd, 0)) {
+            fprintf(stderr, "Erro: memória insuficiente\n");
+            close(fd);
+            return 0;
+        }
+        RenderStats stats;
+        int ok = renderizar(&out, plot, &dados[f], formato, titulo, largura, altura, &caixa, op, &stats);
+        ok = outbuf_close(&out) && ok;
+        anterior = stats_enter(STATS_WRITE);
+        if (close(fd) != 0) ok = 0;
+        stats_leave(anterior);
+        if (!ok) {
+            fprintf(stderr, "Erro ao gravar '%s'\n", nome);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Varredura: os quadros saem de plot_generate_frames() (uma compilação, os
+ * parâmetros trocados por constantes a cada quadro, quadros em paralelo) e
+ * vão para gravar_quadros(). Imprime as estatísticas (se ligadas), libera o
+ * plot e retorna o código de saída do processo. */
+static int executar_varredura(Plot *plot, RenderFormat formato, const char *expressao, int largura, int altura,
+                              const Opcoes *op, int quadros, const char *padrao, Stats *estatisticas) {
+    char *errmsg = NULL;
+    int ok = 0;
+    PlotData *dados = calloc((size_t)quadros, sizeof(PlotData));
+    if (!dados) {
+        fprintf(stderr, "Erro: memória insuficiente\n");
+    } else if (!plot_generate_frames(plot, quadros, dados, &errmsg)) {
+        fprintf(stderr, "Erro ao gerar dados: %s\n", errmsg ? errmsg : "desconhecido");
+        free(errmsg);
+    } else {
+        ok = gravar_quadros(plot, dados, quadros, formato, expressao, largura, altura, op, padrao);
+    }
+    stats_detach();
+    if (op->estatisticas) {
+        stats_print(stderr, estatisticas, op->formato_estatisticas, "estatísticas");
+        if (op->formato_estatisticas == STATS_FORMAT_JSON) fputc('\n', stderr);
+    }
+    for (int f = 0; dados && f < quadros; f++) plot_data_release(&dados[f]);
+    free(dados);
+    plot_free(plot);
+    return ok ? 0 : 1;
+}
 
 static void mostrar_uso(const char *prog) {
-    fprintf(stderr, "Uso: %s <expressão> [formato] [largura] [altura]\n", prog);
+    fprintf(stderr, "Uso: %s [opções] <expressão> [formato] [largura] [altura]\n", prog);
+    fprintf(stderr, "     %s [opções] --points=<arquivo.bin> [formato] [largura] [altura]\n", prog);
+    fprintf(stderr, "     %s [opções] --batch=<manifesto>\n", prog);
+    fprintf(stderr, "     %s [opções] --serve=<socket | tcp:porta>\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --bytecode        - imprime em stderr o bytecode antes/depois da otimização\n");
+    fprintf(stderr, "  --engine=<motor>  - block (padrão), threaded, scalar ou jit\n");
+    fprintf(stderr, "  --adaptive[=tol]  - amostragem adaptativa (tolerância em pixels, padrão %.1f)\n",
+            PLOT_ADAPTIVE_TOLERANCE);
+    fprintf(stderr, "  --interval        - adaptativa guiada por aritmética intervalar: acha polos e\n"
+                    "                      saltos e desenha a curva em trechos (sem traço entre eles)\n");
+    fprintf(stderr, "  --samples=<n>     - número de amostras da grade uniforme (padrão %d)\n",
+            PLOT_DEFAULT_SAMPLES);
+    fprintf(stderr, "  --quality=<q>     - exact (padrão) ou preview: avalia em float com funções\n"
+                    "                      aproximadas, conferido a %.1f px no modo exato\n",
+            PLOT_PREVIEW_TOLERANCE);
+    fprintf(stderr, "  --threads=<n>     - avalia as amostras em n threads (0 = uma por CPU)\n");
+    fprintf(stderr, "  --max-evals=<n>   - limite de avaliações por curva\n");
+    fprintf(stderr, "  --simplify=<px>   - tolerância da simplificação da curva no SVG (padrão %.2f,\n"
+                    "                      0 = todos os pontos)\n", RENDER_SIMPLIFY_TOLERANCE);
+    fprintf(stderr, "  --zx81            - ppm/pbm/png na tela de 64x44 blocos do CURVAS.bas\n");
+    fprintf(stderr, "  --incremental     - grade diádica (t = k*2^-n) e cache de amostras: com\n"
+                    "                      --batch, pan/zoom da mesma curva só avaliam os t novos\n");
+    fprintf(stderr, "  --stream[=bloco]  - amostra e renderiza em fluxo, em blocos de `bloco` amostras\n"
+                    "                      (padrão %d): memória fixa para qualquer --samples\n",
+            STREAM_BLOCK_SAMPLES);
+    fprintf(stderr, "  --viewport=x0,x1,y0,y1 - com --stream, caixa do svg/raster (senão vem de uma\n"
+                    "                      pré-passada de %d amostras)\n", STREAM_PREPASS_SAMPLES);
+    fprintf(stderr, "  --param=k=v       - parâmetro livre k nas expressões, fixo em v (ex.: \"R=sin(k*t)\");\n"
+                    "                      até %d, compilados uma vez e trocados por constantes\n", PLOT_MAX_PARAMS);
+    fprintf(stderr, "  --param=k=a,b     - varre k de a até b: SVG animado (SMIL, %d quadros/s) em\n"
+                    "                      stdout, ou um arquivo por quadro com --frames-out\n",
+            RENDER_ANIMATION_FPS);
+    fprintf(stderr, "  --frames=<n>      - quadros da varredura (padrão %d; em paralelo com --threads)\n",
+            QUADROS_PADRAO);
+    fprintf(stderr, "  --frames-out=<p>  - um arquivo por quadro, no formato pedido: p com um %%d\n"
+                    "                      (ou %%03d) para o número do quadro, a partir de 0\n");
+    fprintf(stderr, "  --points=<bin>    - renderiza os pontos de um arquivo bin, sem expressão\n");
+    fprintf(stderr, "  --batch=<arquivo> - renderiza as curvas de um manifesto, uma por linha:\n");
+    fprintf(stderr, "                      expressão formato LARGURAxALTURA arquivo\n");
+    fprintf(stderr, "                      (curvas em paralelo; --threads = curvas simultâneas)\n");
+    fprintf(stderr, "  --serve=<end>     - servidor de renderização num socket Unix (caminho) ou em\n"
+                    "                      tcp:<porta> (127.0.0.1); um pedido por linha:\n"
+                    "                      expressão [formato] [LxA] [samples=n adaptive[=tol]\n"
+                    "                      interval quality=q max-evals=n simplify=px zx81];\n"
+                    "                      --threads = workers\n");
+    fprintf(stderr, "  --timeout=<ms>    - prazo de cada pedido no servidor (padrão %d)\n", SERVER_TIMEOUT_MS);
+    fprintf(stderr, "  --stats[=json]    - tempo por etapa, avaliações, erros por tipo, pontos e bytes\n"
+                    "                      em stderr (texto ou JSON; no lote, por curva)\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Argumentos:\n");
-    fprintf(stderr, "  formato  - csv ou svg (padrão: svg)\n");
-    fprintf(stderr, "  largura  - largura do canvas SVG (padrão: 800)\n");
-    fprintf(stderr, "  altura   - altura do canvas SVG (padrão: 600)\n");
+    fprintf(stderr, "  formato  - csv, svg, ppm, pbm, png ou bin (padrão: svg)\n");
+    fprintf(stderr, "             bin: pontos em binário (double little-endian) para outras ferramentas\n");
+    fprintf(stderr, "  largura  - largura do canvas SVG/imagem (padrão: 800)\n");
+    fprintf(stderr, "  altura   - altura do canvas SVG/imagem (padrão: 600)\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Exemplos:\n");
     fprintf(stderr, "  %s \"Y=sin(x)\" svg > sin.svg\n", prog);
     fprintf(stderr, "  %s \"Y=sin(x)\" svg 1600 1200 > sin_hd.svg\n", prog);
     fprintf(stderr, "  %s \"R=6\" csv > circulo.csv\n", prog);
+    fprintf(stderr, "  %s --samples=1000000 \"Y=sin(x)\" bin > sin.bin\n", prog);
+    fprintf(stderr, "  %s --points=sin.bin png > sin.png\n", prog);
+    fprintf(stderr, "  %s --stream --samples=100000000 \"Y=sin(x)\" svg > sin.svg\n", prog);
     fprintf(stderr, "  %s \"X=cos(t);Y=sin(t)\" > parametrica.svg\n", prog);
+    fprintf(stderr, "  %s \"x^3+y^3=6*x*y:-5,5:\" > folium.svg\n", prog);
+    fprintf(stderr, "  %s --param=k=1,8 --frames=100 \"R=sin(k*t):0,2*pi:\" > rosas.svg\n", prog);
+    fprintf(stderr, "  %s --param=k=1,8 --frames-out=rosa_%%03d.png \"R=sin(k*t)\" png\n", prog);
     fprintf(stderr, "\n");
     fprintf(stderr, "Tipos suportados:\n");
     fprintf(stderr, "  Y=f(x)         - Cartesiano\n");
     fprintf(stderr, "  R=f(t)         - Polar\n");
     fprintf(stderr, "  R**2=f(t)      - Polar (raio ao quadrado)\n");
     fprintf(stderr, "  X=f(t);Y=g(t)  - Paramétrico\n");
+    fprintf(stderr, "  F=f(x,y)       - Implícita f(x,y) = 0, na caixa [C,D]x[C,D] (padrão [-10,10]);\n"
+                    "                   também \"lado=lado\" se o lado esquerdo não é só um nome\n"
+                    "                   (\"Y =x\" é erro); --samples = células por lado\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Intervalo opcional: :C,D:\n");
     fprintf(stderr, "  Exemplo: \"Y=1/(x*x):-3,3:\"\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Nota: Os limites do gráfico são automáticos (bounding box dos dados).\n");
-    fprintf(stderr, "      A grade se ajusta aos dados, com linhas a cada 1.0 unidade.\n");
+    fprintf(stderr, "      A grade se ajusta aos dados, com passo 1, 2 ou 5 × 10^k.\n");
 }
 
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        mostrar_uso(argv[0]);
+    const char *prog = argv[0];
+    int mostrar_bytecode = 0;
+    const char *manifesto = NULL;
+    const char *servir = NULL;
+    double prazo_ms = SERVER_TIMEOUT_MS;
+    const char *pontos = NULL;
+    int threads_definidas = 0;
+    int fluxo = 0;
+    int bloco_fluxo = 0;
+    int tem_viewport = 0;
+    RenderBounds viewport;
+    PlotParam parametros[PLOT_MAX_PARAMS];
+    int n_parametros = 0;
+    int quadros = 0;
+    const char *padrao_quadros = NULL;
+    Opcoes opcoes = { 0, PLOT_ADAPTIVE_TOLERANCE, PLOT_DEFAULT_SAMPLES, 1, 0, RENDER_SIMPLIFY_TOLERANCE, 0, 0,
+                      0, PLOT_QUALITY_EXACT, 0, STATS_FORMAT_TEXT };
+
+    // Opções "--xxx" antes dos argumentos posicionais
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--bytecode") == 0) {
+            mostrar_bytecode = 1;
+        } else if (strncmp(argv[1], "--engine=", 9) == 0) {
+            BatchEngine engine;
+            if (!batch_engine_parse(argv[1] + 9, &engine)) {
+                fprintf(stderr, "Erro: motor '%s' inválido. Use block, threaded, scalar ou jit\n", argv[1] + 9);
+                return 1;
+            }
+            batch_set_engine(engine);
+        } else if (strcmp(argv[1], "--adaptive") == 0) {
+            opcoes.adaptativa = 1;
+        } else if (strncmp(argv[1], "--adaptive=", 11) == 0) {
+            opcoes.adaptativa = 1;
+            opcoes.tolerancia = atof(argv[1] + 11);
+            if (opcoes.tolerancia <= 0.0) {
+                fprintf(stderr, "Erro: tolerância '%s' inválida\n", argv[1] + 11);
+                return 1;
+            }
+        } else if (strncmp(argv[1], "--samples=", 10) == 0) {
+            char *fim;
+            long n = strtol(argv[1] + 10, &fim, 10);
+            if (fim == argv[1] + 10 || *fim || n < 2 || n > 100000000L) {
+                fprintf(stderr, "Erro: número de amostras '%s' inválido\n", argv[1] + 10);
+                return 1;
+            }
+            opcoes.amostras = (int)n;
+        } else if (strncmp(argv[1], "--max-evals=", 12) == 0) {
+            char *fim;
+            long n = strtol(argv[1] + 12, &fim, 10);
+            if (fim == argv[1] + 12 || *fim || n < 2 || n > 100000000L) {
+                fprintf(stderr, "Erro: orçamento de avaliações '%s' inválido\n", argv[1] + 12);
+                return 1;
+            }
+            opcoes.max_avaliacoes = (int)n;
+        } else if (strncmp(argv[1], "--simplify=", 11) == 0) {
+            char *fim;
+            opcoes.simplificacao = strtod(argv[1] + 11, &fim);
+            if (fim == argv[1] + 11 || *fim || !(opcoes.simplificacao >= 0.0)) {
+                fprintf(stderr, "Erro: tolerância de simplificação '%s' inválida\n", argv[1] + 11);
+                return 1;
+            }
+        } else if (strcmp(argv[1], "--zx81") == 0) {
+            opcoes.zx81 = 1;
+        } else if (strcmp(argv[1], "--incremental") == 0) {
+            opcoes.incremental = 1;
+        } else if (strcmp(argv[1], "--interval") == 0) {
+            opcoes.intervalar = 1;
+        } else if (strncmp(argv[1], "--quality=", 10) == 0) {
+            if (!plot_quality_parse(argv[1] + 10, &opcoes.qualidade)) {
+                fprintf(stderr, "Erro: qualidade '%s' inválida. Use exact ou preview\n", argv[1] + 10);
+                return 1;
+            }
+        } else if (strcmp(argv[1], "--stats") == 0 || strncmp(argv[1], "--stats=", 8) == 0) {
+            if (argv[1][7] && !stats_format_parse(argv[1] + 8, &opcoes.formato_estatisticas)) {
+                fprintf(stderr, "Erro: formato de estatísticas '%s' inválido. Use text ou json\n", argv[1] + 8);
+                return 1;
+            }
+            if (!STATS_ENABLED) {
+                fprintf(stderr, "Erro: --stats indisponível (compilado com -DMULTICURVAS_NO_STATS)\n");
+                return 1;
+            }
+            opcoes.estatisticas = 1;
+        } else if (strcmp(argv[1], "--stream") == 0) {
+            fluxo = 1;
+        } else if (strncmp(argv[1], "--stream=", 9) == 0) {
+            char *fim;
+            long n = strtol(argv[1] + 9, &fim, 10);
+            if (fim == argv[1] + 9 || *fim || n < 1 || n > 100000000L) {
+                fprintf(stderr, "Erro: tamanho de bloco '%s' inválido\n", argv[1] + 9);
+                return 1;
+            }
+            fluxo = 1;
+            bloco_fluxo = (int)n;
+        } else if (strncmp(argv[1], "--viewport=", 11) == 0) {
+            char extra;
+            if (sscanf(argv[1] + 11, "%lf,%lf,%lf,%lf%c", &viewport.minx, &viewport.maxx, &viewport.miny,
+                       &viewport.maxy, &extra) != 4 ||
+                !(viewport.maxx > viewport.minx) || !(viewport.maxy > viewport.miny)) {
+                fprintf(stderr, "Erro: viewport '%s' inválido (x0,x1,y0,y1 com x0 < x1 e y0 < y1)\n",
+                        argv[1] + 11);
+                return 1;
+            }
+            tem_viewport = 1;
+        } else if (strncmp(argv[1], "--param=", 8) == 0) {
+            PlotParam param;
+            char *errmsg = NULL;
+            if (!plot_param_parse(argv[1] + 8, &param, &errmsg)) {
+                fprintf(stderr, "Erro: --param '%s': %s\n", argv[1] + 8, errmsg ? errmsg : "inválido");
+                free(errmsg);
+                return 1;
+            }
+            for (int k = 0; k < n_parametros; k++) {
+                if (strcmp(parametros[k].name, param.name) == 0) {
+                    fprintf(stderr, "Erro: parâmetro '%s' repetido\n", param.name);
+                    return 1;
+                }
+            }
+            if (n_parametros == PLOT_MAX_PARAMS) {
+                fprintf(stderr, "Erro: no máximo %d parâmetros\n", PLOT_MAX_PARAMS);
+                return 1;
+            }
+            parametros[n_parametros++] = param;
+        } else if (strncmp(argv[1], "--frames=", 9) == 0) {
+            char *fim;
+            long n = strtol(argv[1] + 9, &fim, 10);
+            if (fim == argv[1] + 9 || *fim || n < 2 || n > QUADROS_MAXIMO) {
+                fprintf(stderr, "Erro: número de quadros '%s' inválido (2 a %d)\n", argv[1] + 9, QUADROS_MAXIMO);
+                return 1;
+            }
+            quadros = (int)n;
+        } else if (strncmp(argv[1], "--frames-out=", 13) == 0) {
+            if (!padrao_de_quadros_valido(argv[1] + 13)) {
+                fprintf(stderr, "Erro: padrão '%s' inválido: use um %%d (ou %%03d) para o número do quadro\n",
+                        argv[1] + 13);
+                return 1;
+            }
+            padrao_quadros = argv[1] + 13;
+        } else if (strncmp(argv[1], "--points=", 9) == 0 && argv[1][9]) {
+            pontos = argv[1] + 9;
+        } else if (strncmp(argv[1], "--batch=", 8) == 0 && argv[1][8]) {
+            manifesto = argv[1] + 8;
+        } else if (strncmp(argv[1], "--serve=", 8) == 0 && argv[1][8]) {
+            servir = argv[1] + 8;
+        } else if (strncmp(argv[1], "--timeout=", 10) == 0) {
+            char *fim;
+            prazo_ms = strtod(argv[1] + 10, &fim);
+            if (fim == argv[1] + 10 || *fim || !(prazo_ms > 0.0)) {
+                fprintf(stderr, "Erro: prazo '%s' inválido\n", argv[1] + 10);
+                return 1;
+            }
+        } else if (strncmp(argv[1], "--threads=", 10) == 0) {
+            char *fim;
+            long n = strtol(argv[1] + 10, &fim, 10);
+            if (fim == argv[1] + 10 || *fim || n < 0 || n > PLOT_MAX_THREADS) {
+                fprintf(stderr, "Erro: número de threads '%s' inválido (0 a %d)\n",
+                        argv[1] + 10, PLOT_MAX_THREADS);
+                return 1;
+            }
+            opcoes.threads = (n == 0) ? PLOT_THREADS_AUTO : (int)n;
+            threads_definidas = 1;
+        } else {
+            fprintf(stderr, "Erro: opção '%s' desconhecida\n", argv[1]);
+            return 1;
+        }
+        argv++;
+        argc--;
+    }
+
+    if (tem_viewport && !fluxo) {
+        fprintf(stderr, "Erro: --viewport só vale com --stream\n");
+        return 1;
+    }
+    if (fluxo && (manifesto || servir || pontos)) {
+        fprintf(stderr, "Erro: --stream é para uma expressão só (sem --batch, --serve ou --points)\n");
+        return 1;
+    }
+    if (fluxo && (opcoes.adaptativa || opcoes.intervalar || opcoes.incremental)) {
+        fprintf(stderr, "Erro: --stream usa a grade uniforme (sem --adaptive, --interval ou --incremental)\n");
+        return 1;
+    }
+
+    int varrido = 0;
+    for (int k = 0; k < n_parametros; k++) varrido |= (parametros[k].from != parametros[k].to);
+    if (n_parametros && (manifesto || servir || pontos)) {
+        fprintf(stderr, "Erro: --param é para uma expressão só (sem --batch, --serve ou --points)\n");
+        return 1;
+    }
+    if ((quadros || padrao_quadros) && !varrido) {
+        fprintf(stderr, "Erro: --frames e --frames-out precisam de um parâmetro varrido (--param=nome=de,até)\n");
+        return 1;
+    }
+    if (varrido && fluxo) {
+        fprintf(stderr, "Erro: --stream não faz varredura (use --param=nome=valor)\n");
+        return 1;
+    }
+    if (varrido && !quadros) quadros = QUADROS_PADRAO;
+
+    if (manifesto) {
+        // Sem --threads, uma curva por CPU ao mesmo tempo
+        return executar_lote(manifesto, &opcoes, threads_definidas ? opcoes.threads : PLOT_THREADS_AUTO);
+    }
+
+    if (servir) {
+        // Sem --threads, um worker por CPU
+        return executar_servidor(servir, &opcoes, threads_definidas ? opcoes.threads : PLOT_THREADS_AUTO,
+                                 prazo_ms);
+    }
+
+    // Com --points não há expressão: os argumentos começam no formato
+    const int base = pontos ? 1 : 2;
+    if (argc < base) {
+        mostrar_uso(prog);
         return 1;
     }
     
-    const char *expressao = argv[1];
-    const char *formato = (argc > 2) ? argv[2] : "svg";
+    const char *expressao = pontos ? NULL : argv[1];
+    const char *formato = (argc > base) ? argv[base] : "svg";
     int canvas_w = 800;
     int canvas_h = 600;
     
     // Parse dimensões do canvas (opcionais)
-    if (argc > 3) {
-        canvas_w = atoi(argv[3]);
+    if (argc > base + 1) {
+        canvas_w = atoi(argv[base + 1]);
         if (canvas_w <= 0) canvas_w = 800;
     }
-    if (argc > 4) {
-        canvas_h = atoi(argv[4]);
+    if (argc > base + 2) {
+        canvas_h = atoi(argv[base + 2]);
         if (canvas_h <= 0) canvas_h = 600;
     }
     
     // Valida formato
-    int is_csv = (strcmp(formato, "csv") == 0);
-    int is_svg = (strcmp(formato, "svg") == 0);
-    if (!is_csv && !is_svg) {
-        fprintf(stderr, "Erro: formato '%s' inválido. Use 'csv' ou 'svg'\n", formato);
+    RenderFormat fmt;
+    if (!render_format_parse(formato, &fmt)) {
+        fprintf(stderr, "Erro: formato '%s' inválido. Use csv, svg, ppm, pbm, png ou bin\n", formato);
         return 1;
     }
-    
-    // Parse da expressão
-    char *errmsg = NULL;
-    Plot *plot = plot_parse_text(expressao, &errmsg);
-    if (!plot) {
-        fprintf(stderr, "Erro ao interpretar expressão: %s\n", errmsg ? errmsg : "desconhecido");
-        free(errmsg);
+    if (opcoes.zx81 && (fmt == RENDER_CSV || fmt == RENDER_SVG || fmt == RENDER_BIN)) {
+        fprintf(stderr, "Erro: --zx81 só vale para ppm, pbm e png\n");
         return 1;
     }
-    
-    // Gera dados
-    PlotData *data = plot_generate_samples(plot, &errmsg);
-    if (!data) {
-        fprintf(stderr, "Erro ao gerar dados: %s\n", errmsg ? errmsg : "desconhecido");
-        free(errmsg);
-        plot_free(plot);
+    if (fluxo && (fmt == RENDER_BIN || opcoes.zx81)) {
+        fprintf(stderr, "Erro: --stream gera csv, svg, ppm, pbm ou png (sem bin e --zx81)\n");
+        return 1;
+    }
+    if (varrido && !padrao_quadros && fmt != RENDER_SVG) {
+        fprintf(stderr, "Erro: sem --frames-out a varredura sai num SVG animado: use svg ou --frames-out\n");
+        return 1;
+    }
+    if (pontos && fmt == RENDER_BIN) {
+        fprintf(stderr, "Erro: --points já lê um arquivo bin; escolha csv, svg, ppm, pbm ou png\n");
         return 1;
     }
     
-    // Renderiza
-    if (is_csv) {
-        render_csv(data);
+    char *errmsg = NULL;
+    Plot *plot = NULL;
+    PlotData *data = NULL;
+    PointFile *arquivo = NULL;
+    Stats estatisticas;
+    memset(&estatisticas, 0, sizeof(estatisticas));
+    if (opcoes.estatisticas) stats_attach(&estatisticas);
+    if (pontos) {
+        // Pontos já amostrados: renderiza direto do arquivo mapeado
+        arquivo = pointfile_open(pontos, &errmsg);
+        if (!arquivo) {
+            fprintf(stderr, "Erro ao ler '%s': %s\n", pontos, errmsg ? errmsg : "desconhecido");
+            free(errmsg);
+            return 1;
+        }
+        expressao = arquivo->expression;
+        data = &arquivo->data;
     } else {
-        render_svg(data, expressao, canvas_w, canvas_h);
+        // Parse da expressão
+        plot = plot_parse_text(expressao, &errmsg);
+        if (!plot) {
+            fprintf(stderr, "Erro ao interpretar expressão: %s\n", errmsg ? errmsg : "desconhecido");
+            free(errmsg);
+            return 1;
+        }
+        aplicar_opcoes(plot, &opcoes);
+        memcpy(plot->params, parametros, (size_t)n_parametros * sizeof(PlotParam));
+        plot->n_params = n_parametros;
+        
+        if (mostrar_bytecode) {
+            plot_dump_bytecode(plot, stderr);
+        }
+        
+        if (fluxo) {
+            return executar_fluxo(plot, fmt, expressao, canvas_w, canvas_h, &opcoes, bloco_fluxo,
+                                  tem_viewport ? &viewport : NULL, &estatisticas);
+        }
+        if (quadros) {
+            return executar_varredura(plot, fmt, expressao, canvas_w, canvas_h, &opcoes, quadros, padrao_quadros,
+                                      &estatisticas);
+        }
+        
+        // Gera dados
+        data = plot_generate_samples(plot, &errmsg);
+        if (!data) {
+            fprintf(stderr, "Erro ao gerar dados: %s\n", errmsg ? errmsg : "desconhecido");
+            free(errmsg);
+            plot_free(plot);
+            return 1;
+        }
+    }
+    
+    // Renderiza direto no fd 1
+    OutBuf out;
+    int imagem = 0;
+    if (!outbuf_init_fd(&out, STDOUT_FILENO, 0)) {
+        fprintf(stderr, "Erro: memória insuficiente\n");
+    } else {
+        RenderStats stats;
+        imagem = renderizar(&out, plot, data, fmt, expressao, canvas_w, canvas_h, NULL, &opcoes, &stats);
+        const int gravou = outbuf_close(&out);
+        if (!gravou) {
+            fprintf(stderr, "Erro ao gravar a saída\n");
+        } else if (!imagem) {
+            fprintf(stderr, "Erro: canvas grande demais ou memória insuficiente para a imagem\n");
+        }
+        imagem = gravou && imagem;
+    }
+    stats_detach();
+    if (opcoes.estatisticas) {
+        stats_print(stderr, &estatisticas, opcoes.formato_estatisticas, "estatísticas");
+        if (opcoes.formato_estatisticas == STATS_FORMAT_JSON) fputc('\n', stderr);
     }
     
     // Cleanup
-    plot_data_free(data);
+    if (arquivo) {
+        pointfile_close(arquivo);
+    } else {
+        plot_data_free(data);
+    }
     plot_free(plot);
     
-    return 0;
+    return imagem ? 0 : 1;
 }
@@ -8,6 +8,14 @@
 #define _DEFAULT_SOURCE
 
 #include "../include/multicurvas_plot.h"
+#include "../include/batch_eval.h"
+#include "../include/batch_jit.h"
+#include "../include/exprcache.h"
+#include "../include/implicit.h"
+#include "../include/interval.h"
+#include "../include/samplecache.h"
+#include "../include/stats.h"
+#include "../include/vecmath.h"
 #include "parser.h"
 #include "evaluator.h"
 #include <stdlib.h>
@@ -16,6 +24,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -27,12 +37,102 @@
 static const char *const MULTICURVAS_VARIABLES[] = { "x", "theta", "t" };
 #define MULTICURVAS_VARIABLE_COUNT 3
 
-/* Detecta se a expressão tokenizada referencia mais de um dos nomes de
- * parâmetro (ex.: "x + theta"), o que o Multicurvas não permite. */
-static int usa_variaveis_misturadas(const TokenBuffer *tokens) {
+/* Contexto Abaco único do processo: iniciado uma vez e depois só lido,
+ * inclusive por várias threads (modo --batch, fatias paralelas). */
+static AbacoContext contexto;
+static pthread_once_t contexto_once = PTHREAD_ONCE_INIT;
+
+static void contexto_iniciar(void) {
+    abaco_context_init(&contexto, MULTICURVAS_VARIABLES, MULTICURVAS_VARIABLE_COUNT);
+}
+
+static const AbacoContext *contexto_multicurvas(void) {
+    pthread_once(&contexto_once, contexto_iniciar);
+    return &contexto;
+}
+
+/* Curvas implícitas F(x,y) = 0: x e y são duas variáveis de verdade, cada
+ * uma com a sua coluna (batch_eval_vars), num contexto próprio. */
+static const char *const MULTICURVAS_VARIABLES_XY[] = { "x", "y" };
+#define MULTICURVAS_VARIABLE_COUNT_XY 2
+
+static AbacoContext contexto_xy;
+static pthread_once_t contexto_xy_once = PTHREAD_ONCE_INIT;
+
+static void contexto_xy_iniciar(void) {
+    abaco_context_init(&contexto_xy, MULTICURVAS_VARIABLES_XY, MULTICURVAS_VARIABLE_COUNT_XY);
+}
+
+static const AbacoContext *contexto_implicito(void) {
+    pthread_once(&contexto_xy_once, contexto_xy_iniciar);
+    return &contexto_xy;
+}
+
+/* Índice do primeiro parâmetro livre no contexto da curva: depois de x,
+ * theta e t, ou de x e y na implícita */
+static int primeiro_parametro(const Plot *plot) {
+    return (plot->type == PLOT_IMPLICIT) ? MULTICURVAS_VARIABLE_COUNT_XY : MULTICURVAS_VARIABLE_COUNT;
+}
+
+/* Curvas com parâmetros livres (Plot.params): os nomes vêm depois das
+ * variáveis da curva, num contexto por combinação de tipo e nomes. O
+ * AbacoContext só guarda o ponteiro dos nomes, então os contextos ficam numa
+ * lista do processo, criados sob demanda e nunca liberados (são poucas
+ * combinações, e os programas do cache apontam para eles). */
+typedef struct ContextoParametros {
+    struct ContextoParametros *proximo;
+    AbacoContext ctx;
+    int implicita;
+    int n;
+    char nomes[PLOT_MAX_PARAMS][PLOT_PARAM_NAME_MAX];
+    const char *variaveis[MULTICURVAS_VARIABLE_COUNT + PLOT_MAX_PARAMS];
+} ContextoParametros;
+
+static ContextoParametros *contextos_parametros;
+static pthread_mutex_t contextos_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int mesmos_parametros(const ContextoParametros *c, const Plot *plot) {
+    if (c->implicita != (plot->type == PLOT_IMPLICIT) || c->n != plot->n_params) return 0;
+    for (int k = 0; k < c->n; k++) {
+        if (strcmp(c->nomes[k], plot->params[k].name) != 0) return 0;
+    }
+    return 1;
+}
+
+/* Contexto em que as expressões de `plot` são compiladas (parâmetros já
+ * validados), ou NULL se faltou memória */
+static const AbacoContext *contexto_da_curva(const Plot *plot) {
+    const int implicita = (plot->type == PLOT_IMPLICIT);
+    if (plot->n_params == 0) return implicita ? contexto_implicito() : contexto_multicurvas();
+
+    pthread_mutex_lock(&contextos_lock);
+    ContextoParametros *c = contextos_parametros;
+    while (c && !mesmos_parametros(c, plot)) c = c->proximo;
+    if (!c && (c = calloc(1, sizeof(ContextoParametros))) != NULL) {
+        const char *const *base = implicita ? MULTICURVAS_VARIABLES_XY : MULTICURVAS_VARIABLES;
+        const int primeiro = primeiro_parametro(plot);
+        for (int k = 0; k < primeiro; k++) c->variaveis[k] = base[k];
+        for (int k = 0; k < plot->n_params; k++) {
+            memcpy(c->nomes[k], plot->params[k].name, PLOT_PARAM_NAME_MAX);
+            c->variaveis[primeiro + k] = c->nomes[k];
+        }
+        c->implicita = implicita;
+        c->n = plot->n_params;
+        abaco_context_init(&c->ctx, c->variaveis, primeiro + c->n);
+        c->proximo = contextos_parametros;
+        contextos_parametros = c;
+    }
+    pthread_mutex_unlock(&contextos_lock);
+    return c ? &c->ctx : NULL;
+}
+
+/* Detecta se a expressão tokenizada referencia mais de um dos `aliases`
+ * primeiros nomes do contexto (ex.: "x + theta"), o que o Multicurvas não
+ * permite. Os parâmetros livres, depois deles, podem aparecer à vontade. */
+static int usa_variaveis_misturadas(const TokenBuffer *tokens, int aliases) {
     int found = -1;
     for (int i = 0; i < tokens->size; i++) {
-        if (tokens->tokens[i].type == TOKEN_VARIABLE) {
+        if (tokens->tokens[i].type == TOKEN_VARIABLE && tokens->tokens[i].value_index < aliases) {
             int idx = tokens->tokens[i].value_index;
             if (found == -1) found = idx;
             else if (found != idx) return 1;
@@ -148,8 +248,29 @@ static int parse_interval(char *buf, double *C, double *D) {
     return 0;
 }
 
-/* Detecta o tipo de curva olhando o prefixo (case-insensitive) */
-static PlotType detectar_tipo(char *expr, char **expr_limpa) {
+/* Lado esquerdo expr[0..n) de um "=" sem prefixo que é um prefixo mal
+ * escrito, e não o lado de uma equação: só um nome ("Y =", "yy=", "r2=") ou
+ * R**2 / R^2 com espaços */
+static int prefixo_mal_escrito(const char *expr, int n) {
+    char lado[16];
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (isspace((unsigned char)expr[i])) continue;
+        if (m == (int)sizeof(lado) - 1) return 0;
+        lado[m++] = (char)tolower((unsigned char)expr[i]);
+    }
+    lado[m] = '\0';
+    if (strcmp(lado, "r**2") == 0 || strcmp(lado, "r^2") == 0) return 1;
+    for (int i = 0; i < m; i++) {
+        if (!isalnum((unsigned char)lado[i])) return 0;
+    }
+    return 1;
+}
+
+/* Detecta o tipo de curva olhando o prefixo (case-insensitive). Sem prefixo,
+ * "A=B" é a equação implícita A - B = 0 se A não parece um prefixo mal
+ * escrito; nesse caso *expr_limpa fica NULL e a mensagem vai em *errmsg. */
+static PlotType detectar_tipo(char *expr, char **expr_limpa, char **errmsg) {
     // Pula espaços iniciais
     while (*expr && isspace(*expr)) expr++;
     
@@ -170,13 +291,37 @@ static PlotType detectar_tipo(char *expr, char **expr_limpa) {
         *expr_limpa = strdup(expr + 2);
         return PLOT_PARAMETRIC;
     }
-    
+    if (strncasecmp(expr, "F=", 2) == 0) {
+        *expr_limpa = strdup(expr + 2);
+        return PLOT_IMPLICIT;
+    }
+
+    // Sem prefixo, com "=": equação implícita, F = (lado esquerdo) - (direito)
+    const char *igual = strchr(expr, '=');
+    if (igual) {
+        const int n = (int)(igual - expr);
+        if (prefixo_mal_escrito(expr, n)) {
+            *expr_limpa = NULL;
+            if (errmsg && !*errmsg) {
+                *errmsg = malloc((size_t)n + 128);
+                if (*errmsg) {
+                    sprintf(*errmsg, "'%.*s=' não é um prefixo (Y=, R=, R**2=, X=, F=) nem o lado de uma "
+                            "equação; use F= para uma curva implícita", n, expr);
+                }
+            }
+            return PLOT_CARTESIAN;
+        }
+        *expr_limpa = malloc(strlen(expr) + 6);
+        if (*expr_limpa) sprintf(*expr_limpa, "(%.*s)-(%s)", n, expr, igual + 1);
+        return PLOT_IMPLICIT;
+    }
+
     // Sem prefixo: assume cartesiano
     *expr_limpa = strdup(expr);
     return PLOT_CARTESIAN;
 }
 
-Plot *plot_parse_text(const char *input, char **errmsg) {
+static Plot *interpretar_texto(const char *input, char **errmsg) {
     if (errmsg) *errmsg = NULL;
     if (!input || !*input) {
         if (errmsg) *errmsg = strdup("entrada vazia");
@@ -211,6 +356,8 @@ Plot *plot_parse_text(const char *input, char **errmsg) {
     }
     
     plot->samples = PLOT_DEFAULT_SAMPLES;
+    plot->tolerance = PLOT_ADAPTIVE_TOLERANCE;
+    plot->max_samples = PLOT_ADAPTIVE_MAX_SAMPLES;
     plot->C = C;
     plot->D = D;
     plot->has_interval = tem_intervalo;
@@ -218,11 +365,11 @@ Plot *plot_parse_text(const char *input, char **errmsg) {
     // Detecta tipo e processa
     if (!e2) {
         // Uma expressão
-        plot->type = detectar_tipo(e1, &plot->expr1);
+        plot->type = detectar_tipo(e1, &plot->expr1, errmsg);
     } else {
         // Duas expressões: modo paramétrico
-        PlotType t1 = detectar_tipo(e1, &plot->expr1);
-        PlotType t2 = detectar_tipo(e2, &plot->expr2);
+        PlotType t1 = detectar_tipo(e1, &plot->expr1, errmsg);
+        PlotType t2 = detectar_tipo(e2, &plot->expr2, errmsg);
         
         // Se temos X= e Y=, ordena corretamente
         if (t1 == PLOT_PARAMETRIC) {
@@ -240,9 +387,10 @@ Plot *plot_parse_text(const char *input, char **errmsg) {
     }
     
     free(buf);
+    if (plot->type == PLOT_IMPLICIT) plot->max_samples = PLOT_IMPLICIT_MAX_SAMPLES;
     
-    if (!plot->expr1) {
-        if (errmsg) *errmsg = strdup("não foi possível interpretar a entrada");
+    if (!plot->expr1 || (e2 && !plot->expr2)) {
+        if (errmsg && !*errmsg) *errmsg = strdup("não foi possível interpretar a entrada");
         plot_free(plot);
         return NULL;
     }
@@ -250,6 +398,13 @@ Plot *plot_parse_text(const char *input, char **errmsg) {
     return plot;
 }
 
+Plot *plot_parse_text(const char *input, char **errmsg) {
+    const int anterior = stats_enter(STATS_PARSE);
+    Plot *plot = interpretar_texto(input, errmsg);
+    stats_leave(anterior);
+    return plot;
+}
+
 void plot_free(Plot *p) {
     if (!p) return;
     free(p->expr1);
@@ -257,14 +412,148 @@ void plot_free(Plot *p) {
     free(p);
 }
 
-void plot_data_free(PlotData *data) {
+/* 1 se `nome` pode ser um parâmetro livre: letras e dígitos, começando por
+ * letra, e desconhecido para o parser nos dois contextos de curva (não é
+ * x, theta, t, y, função nem constante como pi e e). */
+static int nome_de_parametro_valido(const char *nome) {
+    if (!isalpha((unsigned char)nome[0])) return 0;
+    for (const char *c = nome; *c; c++) {
+        if (!isalnum((unsigned char)*c)) return 0;
+    }
+    const AbacoContext *contextos[2] = { contexto_multicurvas(), contexto_implicito() };
+    for (int k = 0; k < 2; k++) {
+        TokenBuffer tokens;
+        parser_init_buffer(&tokens);
+        ParserError perr = parser_tokenize(contextos[k], nome, &tokens, NULL);
+        parser_free_buffer(&tokens);
+        if (perr != PARSER_UNKNOWN_VARIABLE) return 0;
+    }
+    return 1;
+}
+
+/* Confere Plot.params (quantidade, nomes válidos e distintos) antes de
+ * montar o contexto da curva */
+static int parametros_validos(const Plot *plot, char **errmsg) {
+    int ok = plot->n_params >= 0 && plot->n_params <= PLOT_MAX_PARAMS;
+    for (int k = 0; ok && k < plot->n_params; k++) {
+        const char *nome = plot->params[k].name;
+        ok = memchr(nome, '\0', PLOT_PARAM_NAME_MAX) && nome_de_parametro_valido(nome);
+        for (int j = 0; ok && j < k; j++) ok = strcmp(nome, plot->params[j].name) != 0;
+    }
+    if (!ok && errmsg) *errmsg = strdup("parâmetros livres inválidos");
+    return ok;
+}
+
+int plot_param_parse(const char *text, PlotParam *param, char **errmsg) {
+    char msg[96];
+    if (errmsg) *errmsg = NULL;
+    const char *igual = strchr(text, '=');
+    const size_t n = igual ? (size_t)(igual - text) : 0;
+    if (n == 0 || n >= PLOT_PARAM_NAME_MAX) {
+        snprintf(msg, sizeof(msg), "esperado nome=valor ou nome=de,até (nome com até %d caracteres)",
+                 PLOT_PARAM_NAME_MAX - 1);
+        if (errmsg) *errmsg = strdup(msg);
+        return 0;
+    }
+    memset(param, 0, sizeof(*param));
+    memcpy(param->name, text, n);
+    if (!nome_de_parametro_valido(param->name)) {
+        snprintf(msg, sizeof(msg), "'%s' não serve de parâmetro (variável, função ou constante)",
+                 param->name);
+        if (errmsg) *errmsg = strdup(msg);
+        return 0;
+    }
+
+    const char *valor = igual + 1;
+    const char *virgula = strchr(valor, ',');
+    int ok = eval_simple_expr(valor, &param->from);
+    param->to = param->from;
+    if (ok && virgula) ok = !strchr(virgula + 1, ',') && eval_simple_expr(virgula + 1, &param->to);
+    if (!ok || !isfinite(param->from) || !isfinite(param->to)) {
+        snprintf(msg, sizeof(msg), "valor do parâmetro '%s' inválido", param->name);
+        if (errmsg) *errmsg = strdup(msg);
+        return 0;
+    }
+    return 1;
+}
+
+double plot_param_value(const PlotParam *param, int frame, int frames) {
+    if (frames < 2 || frame <= 0) return param->from;
+    if (frame >= frames - 1) return param->to;
+    return param->from + (param->to - param->from) * frame / (frames - 1);
+}
+
+void plot_data_release(PlotData *data) {
     if (!data) return;
-    free(data->x);
-    free(data->y);
-    free(data->status);
+    free(data->arena);
+    memset(data, 0, sizeof(*data));
+}
+
+void plot_data_free(PlotData *data) {
+    plot_data_release(data);
     free(data);
 }
 
+static size_t alinhar(size_t n) {
+    return (n + PLOT_DATA_ALIGN - 1) / PLOT_DATA_ALIGN * PLOT_DATA_ALIGN;
+}
+
+/* Garante arena para n amostras: colunas x, y e t e, no lugar da máscara,
+ * um byte por amostra (os "ok" da avaliação, empacotados em bits por
+ * compactar()). Só aloca se a arena atual não cabe. Retorna 0 se faltou
+ * memória (a arena antiga é liberada). */
+static int reservar(PlotData *d, int n) {
+    d->count = 0;
+    d->evaluations = 0;
+    if (n <= d->capacity) return 1;
+
+    const size_t coluna = alinhar((size_t)n * sizeof(double));
+    const size_t tam = 3 * coluna + alinhar((size_t)n);
+    void *arena = NULL;
+    if (posix_memalign(&arena, PLOT_DATA_ALIGN, tam) != 0) arena = NULL;
+    free(d->arena);
+    if (!arena) {
+        memset(d, 0, sizeof(*d));
+        return 0;
+    }
+
+    char *p = arena;
+    d->arena = arena;
+    d->arena_size = tam;
+    d->capacity = n;
+    d->x = (double *)(void *)p;
+    d->y = (double *)(void *)(p + coluna);
+    d->t = (double *)(void *)(p + 2 * coluna);
+    d->valid = (unsigned char *)(p + 3 * coluna);
+    return 1;
+}
+
+/* Com x, y, t e valid[] (um byte por amostra) preenchidos para n amostras,
+ * move os pontos válidos para o início das colunas e empacota valid em bits.
+ * Tudo no lugar: o destino nunca passa da posição lida. */
+static void compactar(PlotData *d, int n) {
+    unsigned char *ok = d->valid;
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (!ok[i]) continue;
+        d->x[count] = d->x[i];
+        d->y[count] = d->y[i];
+        d->t[count] = d->t[i];
+        count++;
+    }
+
+    // O byte j recebe ok[8j..8j+7], já lidos quando é escrito (j <= 8j)
+    for (int j = 0; j < (n + 7) / 8; j++) {
+        unsigned char byte = 0;
+        for (int b = 0; b < 8 && 8 * j + b < n; b++) {
+            if (ok[8 * j + b]) byte |= (unsigned char)(1u << b);
+        }
+        ok[j] = byte;
+    }
+    d->count = count;
+    d->evaluations = n;
+}
+
 /* Define intervalos padrão conforme programa original ZX81 */
 static void definir_intervalo_padrao(PlotType type, double *C, double *D) {
     switch (type) {
@@ -283,176 +572,1589 @@ static void definir_intervalo_padrao(PlotType type, double *C, double *D) {
     }
 }
 
-PlotData *plot_generate_samples(const Plot *plot, char **errmsg) {
+/* Variáveis do contexto de `plot` que são aliases (ver usa_variaveis_misturadas) */
+static int aliases_da_curva(const Plot *plot) {
+    return (plot->type == PLOT_IMPLICIT) ? 0 : MULTICURVAS_VARIABLE_COUNT;
+}
+
+/* Tokeniza e converte uma expressão para RPN. `qual` ("primeira"/"segunda")
+ * entra na mensagem de erro e `aliases` vem de aliases_da_curva(). Em caso
+ * de erro os buffers já vêm liberados. */
+static int compilar_expressao(const AbacoContext *ctx, int aliases, const char *expr, const char *qual,
+                              TokenBuffer *tokens, TokenBuffer *rpn, char **errmsg) {
+    char msg[96];
+    parser_init_buffer(tokens);
+    parser_init_buffer(rpn);
+
+    ParserError perr = parser_tokenize(ctx, expr, tokens, NULL);
+    if (perr != PARSER_OK) {
+        snprintf(msg, sizeof(msg), "erro ao compilar %s expressão", qual);
+    } else if (usa_variaveis_misturadas(tokens, aliases)) {
+        // Só entre os aliases x, theta e t; na implícita x e y são distintas
+        snprintf(msg, sizeof(msg), "não misture x, theta e t na mesma expressão");
+    } else if ((perr = parser_to_rpn(ctx, tokens, rpn)) != PARSER_OK) {
+        snprintf(msg, sizeof(msg), "erro ao converter %s expressão para RPN", qual);
+    } else {
+        return 1;
+    }
+
+    if (errmsg) *errmsg = strdup(msg);
+    parser_free_buffer(tokens);
+    parser_free_buffer(rpn);
+    return 0;
+}
+
+/* Monta a RPN de uma coordenada polar a partir da RPN de R:
+ * [R] [sqrt] t trig *  →  r*cos(t) ou r*sin(t) (quadrado: R**2=f(t), r = sqrt(f)).
+ * As constantes numéricas de R são copiadas junto. */
+static int montar_rpn_polar(const TokenBuffer *rpn, int quadrado, int trig, TokenBuffer *out) {
+    Token tk;
+    memset(&tk, 0, sizeof(tk));
+    for (int i = 0; i < rpn->size && rpn->tokens[i].type != TOKEN_END; i++) {
+        if (!parser_add_token(out, rpn->tokens[i])) return 0;
+    }
+    if (quadrado) {
+        tk.type = TOKEN_SQRT;
+        if (!parser_add_token(out, tk)) return 0;
+    }
+    const uint8_t cauda[] = { TOKEN_VARIABLE, (uint8_t)trig, TOKEN_MULT, TOKEN_END };
+    for (size_t k = 0; k < sizeof(cauda); k++) {
+        tk.type = cauda[k];
+        if (!parser_add_token(out, tk)) return 0;
+    }
+
+    if (rpn->values_size > 0) {
+        free(out->values);
+        out->values = malloc(rpn->values_size * sizeof(double));
+        if (!out->values) return 0;
+        memcpy(out->values, rpn->values, rpn->values_size * sizeof(double));
+        out->values_size = out->values_capacity = rpn->values_size;
+    }
+    return 1;
+}
+
+/* Define as RPNs avaliadas juntas num programa fundido: paramétrico dá X e Y
+ * direto; polar dá X = r*cos(t) e Y = r*sin(t) montados sobre a RPN de R
+ * (com CSE, sin e cos de t saem de uma só redução de faixa); cartesiano só Y.
+ * `polar` (2 buffers) é sempre inicializado e deve ser liberado pelo caller.
+ * Retorna o número de saídas, ou 0 se faltou memória. */
+static int montar_saidas(const Plot *plot, const TokenBuffer *rpn1, const TokenBuffer *rpn2,
+                         TokenBuffer *polar, const TokenBuffer **saidas) {
+    parser_init_buffer(&polar[0]);
+    parser_init_buffer(&polar[1]);
+    saidas[0] = rpn1;
+    saidas[1] = NULL;
+
+    if (plot->type == PLOT_PARAMETRIC && rpn2) {
+        saidas[1] = rpn2;
+        return 2;
+    }
+    if (plot->type == PLOT_POLAR_R || plot->type == PLOT_POLAR_R2) {
+        int quadrado = (plot->type == PLOT_POLAR_R2);
+        if (!montar_rpn_polar(rpn1, quadrado, TOKEN_COS, &polar[0]) ||
+            !montar_rpn_polar(rpn1, quadrado, TOKEN_SIN, &polar[1])) {
+            return 0;
+        }
+        saidas[0] = &polar[0];
+        saidas[1] = &polar[1];
+        return 2;
+    }
+    return 1;
+}
+
+/* Programa compilado de uma curva: tudo o que a frente (tokenizar, checar as
+ * variáveis, RPN, montar_saidas, batch_compile_multi, batch_optimize e, com o
+ * motor JIT, batch_jit_compile) produz e que não depende de intervalo,
+ * amostras nem canvas. Fica no cache de programas e, depois de pronto, é só
+ * lido (inclusive por várias threads). Os ponteiros apontam para dentro da
+ * própria estrutura, que por isso nunca muda de endereço. */
+typedef struct {
+    TokenBuffer tokens[2], rpn[2], polar[2];
+    int expressoes;     /* Expressões compiladas (tokens/rpn iniciados) */
+    const TokenBuffer *saidas[2];   /* NULL até montar_saidas (que inicia polar) */
+    int n_saidas;
+    BatchProgram prog;
+    int compilado;      /* 0: alguma RPN não baixa, usa batch_eval_rpn_multi */
+    BatchJit jit;
+    int tem_jit;        /* jit compilado (motor JIT ativo na compilação) */
+} Programa;
+
+/* Saídas compiladas de um Plot, prontas para avaliar em qualquer t. O
+ * programa é compilado uma vez (ou vem do cache) e reaproveitado pelas
+ * rodadas da amostragem adaptativa e pelas threads. */
+typedef struct {
+    const Plot *plot;
+    const AbacoContext *ctx;
+    const Programa *prog;
+    const BatchJit *jit;    /* NULL se o motor atual não é o JIT */
+    ExprCache *cache;       /* Cache de amostras (Plot.incremental) */
+    ExprCacheEntry *amostras;   /* SampleCache desta curva; NULL sem cache */
+    size_t limite;          /* Bytes máximos do cache de amostras */
+    long reusadas, avaliadas;
+    int previa;             /* Plot.quality = prévia e ainda não caiu para o modo exato */
+    double caixa[4];        /* Prévia: caixa (x0, x1, y0, y1) dos pontos conferidos */
+    int tem_caixa;
+} Amostrador;
+
+/* F(x,y) de uma curva implícita nos pontos (xs[i], ys[i]), com os mesmos
+ * códigos de erro por ponto. */
+static void avaliar_xy(const Amostrador *a, const double *xs, const double *ys, int n, double *f,
+                       EvalError *e) {
+    const Programa *p = a->prog;
+    if (p->compilado) {
+        const double *vars[MULTICURVAS_VARIABLE_COUNT_XY] = { xs, ys };
+        batch_eval_vars(&p->prog, vars, MULTICURVAS_VARIABLE_COUNT_XY, f, e, n);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        const double v[MULTICURVAS_VARIABLE_COUNT_XY] = { xs[i], ys[i] };
+        EvalResult r = evaluator_eval_rpn(a->ctx, p->saidas[0], v);
+        f[i] = r.value;
+        e[i] = r.error;
+    }
+}
+
+/* Avalia as saídas em ts[0..n) e converte para pontos (x,y); ok[i] = 0 marca
+ * erro de avaliação (x/y indefinidos). Os valores vão direto para x/y (no
+ * cartesiano, y = f(x) e x = t); só os códigos de erro usam buffer próprio.
+ * Numa curva implícita, ts e ys são as coordenadas e F vai para x.
+ * Se `erros` não é NULL, conta nele os erros por tipo (stats.h).
+ * Retorna 0 se faltou memória. Pode rodar em várias threads ao mesmo tempo. */
+static int amostrar(const Amostrador *a, const double *ts, const double *ys, int n, double *x, double *y,
+                    unsigned char *ok, unsigned long *erros) {
+    const int cartesiano = (a->plot->type == PLOT_CARTESIAN);
+    const Programa *p = a->prog;
+    EvalError *e1 = malloc((size_t)n * p->n_saidas * sizeof(EvalError));
+    if (!e1) return 0;
+    EvalError *e2 = e1 + n;
+
+    if (a->plot->type == PLOT_IMPLICIT) {
+        avaliar_xy(a, ts, ys, n, x, e1);
+        for (int i = 0; i < n; i++) {
+            ok[i] = (e1[i] == EVAL_OK);
+            if (!ok[i] && erros) erros[stats_error_kind(e1[i])]++;
+        }
+        free(e1);
+        return 1;
+    }
+
+    double *vs[2] = { cartesiano ? y : x, y };
+    EvalError *es[2] = { e1, e2 };
+    if (a->previa) {
+        batch_eval_preview(&p->prog, ts, vs, es, n);
+    } else if (!a->jit || !batch_jit_eval_multi(a->jit, ts, vs, es, n)) {
+        // Com o JIT do programa, sem recompilar a cada chamada (batch_eval_multi
+        // compilaria de novo a cada fatia e a cada rodada)
+        if (p->compilado) {
+            batch_eval_multi(&p->prog, ts, vs, es, n);
+        } else {
+            batch_eval_rpn_multi(a->ctx, p->saidas, p->n_saidas, ts, vs, es, n);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        ok[i] = 0;
+        if (e1[i] != EVAL_OK) {
+            if (erros) erros[stats_error_kind(e1[i])]++;
+            continue;
+        }
+
+        // Converte para coordenadas cartesianas
+        if (cartesiano) {
+            x[i] = ts[i];
+        } else if (p->n_saidas < 2 || e2[i] != EVAL_OK) {
+            // Polar: R**2 = f(t) com f(t) < 0 já deu EVAL_DOMAIN_ERROR nas saídas.
+            // Paramétrico sem a expressão de Y não tem ponto.
+            if (erros && p->n_saidas == 2) erros[stats_error_kind(e2[i])]++;
+            continue;
+        }
+        ok[i] = 1;
+    }
+
+    free(e1);
+    return 1;
+}
+
+const char *plot_quality_name(PlotQuality quality) {
+    return (quality == PLOT_QUALITY_PREVIEW) ? "preview" : "exact";
+}
+
+int plot_quality_parse(const char *name, PlotQuality *quality) {
+    if (strcmp(name, "exact") == 0) {
+        *quality = PLOT_QUALITY_EXACT;
+    } else if (strcmp(name, "preview") == 0) {
+        *quality = PLOT_QUALITY_PREVIEW;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int plot_thread_count(int threads) {
+    if (threads == PLOT_THREADS_AUTO) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > PLOT_MAX_THREADS) threads = PLOT_MAX_THREADS;
+    return threads;
+}
+
+/* Fatia [ts, ts+n) avaliada por uma thread, escrevendo direto nas posições
+ * correspondentes de x/y/ok (fatias disjuntas: a ordem final é a de t). */
+typedef struct {
+    const Amostrador *a;
+    const double *ts, *ys;
+    double *x, *y;
+    unsigned char *ok;
+    int n;
+    int resultado;
+    unsigned long erros[STATS_ERRORS];
+} Fatia;
+
+static void *amostrar_fatia(void *arg) {
+    Fatia *f = arg;
+    f->resultado = amostrar(f->a, f->ts, f->ys, f->n, f->x, f->y, f->ok, f->erros);
+    return NULL;
+}
+
+/* amostrar() dividido em fatias contíguas entre plot->threads threads (a
+ * thread atual fica com a primeira). Cada ponto é avaliado exatamente como
+ * numa chamada só, então o resultado não depende do número de threads.
+ * Avaliações e erros vão para o Stats da thread atual, se houver. `ys` só
+ * nas curvas implícitas (ver amostrar()); senão NULL. */
+static int amostrar_paralelo(const Amostrador *a, const double *ts, const double *ys, int n, double *x,
+                             double *y, unsigned char *ok) {
+    int fatias = plot_thread_count(a->plot->threads);
+    if (fatias > n / PLOT_PARALLEL_MIN_CHUNK) fatias = n / PLOT_PARALLEL_MIN_CHUNK;
+
+    Stats *st = stats_current();
+    const int anterior = stats_enter(STATS_EVAL);
+    int resultado = 1;
+    if (fatias < 2) {
+        resultado = amostrar(a, ts, ys, n, x, y, ok, st ? st->errors : NULL);
+    } else {
+        // Fatias múltiplas de BATCH_BLOCK_SIZE (blocos cheios no avaliador)
+        int tam = (n + fatias - 1) / fatias;
+        tam = (tam + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE * BATCH_BLOCK_SIZE;
+
+        // O despacho de vecmath é escolhido na primeira chamada: faz aqui,
+        // antes de haver outras threads
+        vecmath_level();
+
+        Fatia f[PLOT_MAX_THREADS];
+        pthread_t th[PLOT_MAX_THREADS];
+        int criada[PLOT_MAX_THREADS];
+        int usadas = 0;
+        for (int inicio = 0; inicio < n; inicio += tam, usadas++) {
+            Fatia *fk = &f[usadas];
+            fk->a = a;
+            fk->ts = ts + inicio;
+            fk->ys = ys ? ys + inicio : NULL;
+            fk->x = x + inicio;
+            fk->y = y ? y + inicio : NULL;
+            fk->ok = ok + inicio;
+            fk->n = (n - inicio < tam) ? n - inicio : tam;
+            fk->resultado = 0;
+            memset(fk->erros, 0, sizeof(fk->erros));
+            criada[usadas] = (usadas > 0 && pthread_create(&th[usadas], NULL, amostrar_fatia, fk) == 0);
+        }
+
+        // Primeira fatia, e as que não ganharam thread, na thread atual
+        for (int k = 0; k < usadas; k++) {
+            if (!criada[k]) amostrar_fatia(&f[k]);
+        }
+        for (int k = 0; k < usadas; k++) {
+            if (criada[k]) pthread_join(th[k], NULL);
+            resultado = resultado && f[k].resultado;
+            for (int j = 0; st && j < STATS_ERRORS; j++) st->errors[j] += f[k].erros[j];
+        }
+    }
+    stats_leave(anterior);
+    if (st) st->evaluations += (unsigned long)n;
+
+    return resultado;
+}
+
+/* Como MAX_COORD de render.c: pontos além disso não entram na caixa do SVG */
+#define PREVIA_MAX_COORD 1e6
+
+/* Confere um lote avaliado na prévia: uma amostra a cada
+ * PLOT_PREVIEW_CHECK_STRIDE, a última e as dos extremos de x e y da prévia
+ * (são elas que dão a escala do desenho, e o erro relativo do float pesa
+ * mais onde o valor é grande, perto de um polo), de novo no modo exato.
+ * Retorna 1 se todas ficaram a até PLOT_PREVIEW_TOLERANCE pixels (na escala
+ * da caixa dos pontos exatos conferidos desde o início da geração), 0 se
+ * não, -1 se faltou memória. Roda na thread atual, depois do lote: o
+ * resultado não depende do número de threads. */
+static int conferir_previa(Amostrador *a, const double *ts, int n, const double *x, const double *y,
+                           const unsigned char *ok) {
+    const int grade = (n + PLOT_PREVIEW_CHECK_STRIDE - 1) / PLOT_PREVIEW_CHECK_STRIDE;
+    const int m = grade + 5;
+    double *tc = malloc((size_t)m * 3 * sizeof(double));
+    int *indice = malloc((size_t)m * sizeof(int));
+    unsigned char *okc = malloc(m);
+    if (!tc || !indice || !okc) {
+        free(tc);
+        free(indice);
+        free(okc);
+        return -1;
+    }
+    double *xc = tc + m, *yc = xc + m;
+    for (int k = 0; k < grade; k++) indice[k] = k * PLOT_PREVIEW_CHECK_STRIDE;
+    indice[grade] = n - 1;
+
+    // Extremos da prévia: menor e maior x, menor e maior y (em locais: ok é
+    // unsigned char e poderia apontar para indice)
+    int e0 = n - 1, e1 = n - 1, e2 = n - 1, e3 = n - 1;
+    double x0 = INFINITY, x1 = -INFINITY, y0 = INFINITY, y1 = -INFINITY;
+    for (int i = 0; i < n; i++) {
+        const double xi = x[i], yi = y[i];
+        if (!ok[i] || !(fabs(xi) <= PREVIA_MAX_COORD) || !(fabs(yi) <= PREVIA_MAX_COORD)) continue;
+        if (xi < x0) { x0 = xi; e0 = i; }
+        if (xi > x1) { x1 = xi; e1 = i; }
+        if (yi < y0) { y0 = yi; e2 = i; }
+        if (yi > y1) { y1 = yi; e3 = i; }
+    }
+    indice[grade + 1] = e0;
+    indice[grade + 2] = e1;
+    indice[grade + 3] = e2;
+    indice[grade + 4] = e3;
+    for (int k = 0; k < m; k++) tc[k] = ts[indice[k]];
+
+    Amostrador exato = *a;
+    exato.previa = 0;
+    const int anterior = stats_enter(STATS_EVAL);
+    int resultado = amostrar(&exato, tc, NULL, m, xc, yc, okc, NULL) ? 1 : -1;
+    stats_leave(anterior);
+
+    for (int k = 0; resultado > 0 && k < m; k++) {
+        const double xk = xc[k], yk = yc[k];
+        if (!okc[k] || !isfinite(xk) || !isfinite(yk) || fabs(xk) > PREVIA_MAX_COORD ||
+            fabs(yk) > PREVIA_MAX_COORD) {
+            continue;
+        }
+        if (!a->tem_caixa) {
+            a->caixa[0] = a->caixa[1] = xk;
+            a->caixa[2] = a->caixa[3] = yk;
+            a->tem_caixa = 1;
+        }
+        a->caixa[0] = fmin(a->caixa[0], xk);
+        a->caixa[1] = fmax(a->caixa[1], xk);
+        a->caixa[2] = fmin(a->caixa[2], yk);
+        a->caixa[3] = fmax(a->caixa[3], yk);
+    }
+
+    const double lx = PLOT_PREVIEW_TOLERANCE * (a->caixa[1] - a->caixa[0]);
+    const double ly = PLOT_PREVIEW_TOLERANCE * (a->caixa[3] - a->caixa[2]);
+    for (int k = 0; resultado > 0 && k < m; k++) {
+        const int i = indice[k];
+        if (okc[k] != ok[i]) {
+            resultado = 0;
+        } else if (okc[k]) {
+            // Em pixels: |dx| * VIEW_W / largura > tolerância, sem dividir
+            const double dx = fabs(x[i] - xc[k]), dy = fabs(y[i] - yc[k]);
+            if (!(dx * PLOT_ADAPTIVE_VIEW_W <= lx) || !(dy * PLOT_ADAPTIVE_VIEW_H <= ly)) resultado = 0;
+        }
+    }
+    free(tc);
+    free(indice);
+    free(okc);
+    return resultado;
+}
+
+/* Amostras por trecho conferido da prévia: o trecho ainda está no cache
+ * quando é conferido, e uma curva reprovada perde no máximo um trecho. */
+#define PREVIA_TRECHO 65536
+
+/* amostrar_paralelo() com a conferência da prévia, trecho a trecho: um
+ * trecho reprovado é refeito no modo exato, e a curva segue nele até o fim
+ * da geração. Os trechos não dependem do número de threads. */
+static int amostrar_lote(Amostrador *a, const double *ts, int n, double *x, double *y, unsigned char *ok) {
+    for (int inicio = 0; inicio < n; inicio += PREVIA_TRECHO) {
+        if (!a->previa) {
+            return amostrar_paralelo(a, ts + inicio, NULL, n - inicio, x + inicio, y + inicio, ok + inicio);
+        }
+        const int m = (n - inicio < PREVIA_TRECHO) ? n - inicio : PREVIA_TRECHO;
+        if (!amostrar_paralelo(a, ts + inicio, NULL, m, x + inicio, y + inicio, ok + inicio)) return 0;
+        const int conferido = conferir_previa(a, ts + inicio, m, x + inicio, y + inicio, ok + inicio);
+        if (conferido < 0) return 0;
+        if (conferido == 0) {
+            a->previa = 0;
+            if (!amostrar_paralelo(a, ts + inicio, NULL, m, x + inicio, y + inicio, ok + inicio)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* amostrar_lote() passando antes pelo cache de amostras da curva, se
+ * houver: os t já guardados saem prontos, só as faltas são avaliadas (num
+ * lote só) e a geração inteira volta para o cache. */
+static int avaliar(Amostrador *a, const double *ts, int n, double *x, double *y, unsigned char *ok) {
+    if (!a->amostras) {
+        a->avaliadas += n;
+        return amostrar_lote(a, ts, n, x, y, ok);
+    }
+    SampleCache *sc = exprcache_value(a->amostras);
+    int *faltas = malloc((size_t)n * sizeof(int));
+    if (!faltas) return 0;
+
+    const int m = samplecache_lookup(sc, ts, n, x, y, ok, faltas);
+    int resultado = 1;
+    if (m == n) {
+        resultado = amostrar_lote(a, ts, n, x, y, ok);
+    } else if (m > 0) {
+        double *tm = malloc((size_t)m * 3 * sizeof(double));
+        unsigned char *okm = malloc(m);
+        resultado = tm && okm;
+        if (resultado) {
+            double *xm = tm + m, *ym = xm + m;
+            for (int k = 0; k < m; k++) tm[k] = ts[faltas[k]];
+            resultado = amostrar_lote(a, tm, m, xm, ym, okm);
+            for (int k = 0; resultado && k < m; k++) {
+                x[faltas[k]] = xm[k];
+                y[faltas[k]] = ym[k];
+                ok[faltas[k]] = okm[k];
+            }
+        }
+        free(tm);
+        free(okm);
+    }
+    free(faltas);
+
+    if (resultado && m > 0) {
+        exprcache_resize(a->cache, a->amostras, samplecache_insert(sc, ts, x, y, ok, n, a->limite));
+    }
+    a->reusadas += n - m;
+    a->avaliadas += m;
+    return resultado;
+}
+
+/* Grade diádica de Plot.incremental: C, os múltiplos k*h dentro de (C,D) e
+ * D, com h a maior potência de 2 que não passa do passo da grade uniforme de
+ * n pontos (a densidade nunca fica abaixo da pedida; são de n a 2n pontos).
+ * k*h é exato, então pan e zoom reencontram os mesmos t no cache: h só muda
+ * por fatores de 2 e os pontos de um h estão entre os de h/2. Grava em t (se
+ * não for NULL) e retorna quantos pontos; 0 se o intervalo não comporta a
+ * grade (aí vale a grade uniforme). */
+static int grade_diadica(double C, double D, int n, double *t) {
+    const double passo = (D - C) / (n - 1);
+    if (!(passo > 0.0) || !isfinite(passo)) return 0;
+    int e;
+    frexp(passo, &e);
+    const double h = ldexp(1.0, e - 1);
+    if (fabs(C / h) > 0x1p52 || fabs(D / h) > 0x1p52) return 0;
+
+    const double k0 = floor(C / h) + 1.0, k1 = ceil(D / h) - 1.0;
+    const int count = (int)(k1 - k0) + 3;
+    if (t) {
+        t[0] = C;
+        for (int i = 1; i < count - 1; i++) t[i] = (k0 + (i - 1)) * h;
+        t[count - 1] = D;
+    }
+    return count;
+}
+
+/* Grade uniforme de n pontos em [C,D] (ou a diádica, com plot->incremental),
+ * avaliada direto nas colunas de data. */
+static int amostrar_uniforme(Amostrador *a, double C, double D, int n, PlotData *data) {
+    const int diadica = a->plot->incremental ? grade_diadica(C, D, n, NULL) : 0;
+    const int total = diadica ? diadica : n;
+    if (!reservar(data, total)) return 0;
+
+    if (diadica) {
+        grade_diadica(C, D, n, data->t);
+    } else {
+        double step = (D - C) / (n - 1);
+        for (int i = 0; i < n; i++) {
+            data->t[i] = C + i * step;
+        }
+    }
+    if (!avaliar(a, data->t, total, data->x, data->y, data->valid)) return 0;
+    compactar(data, total);
+    return 1;
+}
+
+/* Callback de implicit_contour(): cada lote do quadtree vai inteiro para
+ * amostrar_paralelo(), que o divide entre as threads. */
+static int avaliar_implicita(void *ctx, const double *x, const double *y, int n, double *f,
+                             unsigned char *ok) {
+    return amostrar_paralelo(ctx, x, y, n, f, NULL, ok);
+}
+
+/* Contorno de F(x,y) = 0 em [C,D]x[C,D], com as polylines em trechos: uma
+ * amostra marcadora (bit 0) entre duas polylines e t = posição na sequência. */
+static int amostrar_implicita(Amostrador *a, double C, double D, PlotData *data) {
+    const int max = (a->plot->max_samples > 0) ? a->plot->max_samples : PLOT_IMPLICIT_MAX_SAMPLES;
+    ImplicitGrid grade = { C, D, C, D, PLOT_IMPLICIT_BASE, 0, max };
+    // A grade da base é sempre avaliada: diminui até caber no teto
+    while (grade.base > 1 && (long)(grade.base + 1) * (grade.base + 1) > max) grade.base /= 2;
+    while (grade.depth < IMPLICIT_MAX_DEPTH && (grade.base << grade.depth) < a->plot->samples) {
+        grade.depth++;
+    }
+    if (D < C) {
+        grade.x0 = grade.y0 = D;
+        grade.x1 = grade.y1 = C;
+    }
+
+    ImplicitContour contorno;
+    if (!implicit_contour(&grade, avaliar_implicita, a, &contorno)) return 0;
+    const int total = contorno.lines ? contorno.count + contorno.lines - 1 : 0;
+    if (!reservar(data, total)) {
+        implicit_contour_free(&contorno);
+        return 0;
+    }
+
+    int i = 0;
+    for (int k = 0; k < contorno.lines; k++) {
+        if (k > 0) {
+            data->t[i] = i;
+            data->valid[i++] = 0;
+        }
+        for (int p = contorno.start[k]; p < contorno.start[k + 1]; p++, i++) {
+            data->x[i] = contorno.x[p];
+            data->y[i] = contorno.y[p];
+            data->t[i] = i;
+            data->valid[i] = 1;
+        }
+    }
+    compactar(data, total);
+    implicit_contour_free(&contorno);
+    return 1;
+}
+
+/* Pontos da amostragem adaptativa, sempre em ordem de t. nivel[i] é quantas
+ * vezes o intervalo (i, i+1) já foi dividido desde a grade inicial; com
+ * Plot.interval, classe[i] é o que a aritmética intervalar disse dele. */
+typedef struct {
+    double *t, *x, *y;
+    unsigned char *ok;
+    int *nivel;
+    unsigned char *classe;
+    int count;
+} Curva;
+
+static int curva_alocar(Curva *c, int capacidade) {
+    c->t = malloc(capacidade * sizeof(double));
+    c->x = malloc(capacidade * sizeof(double));
+    c->y = malloc(capacidade * sizeof(double));
+    c->ok = malloc(capacidade);
+    c->nivel = calloc(capacidade, sizeof(int));
+    c->classe = malloc(capacidade);
+    c->count = 0;
+    return c->t && c->x && c->y && c->ok && c->nivel && c->classe;
+}
+
+static void curva_liberar(Curva *c) {
+    free(c->t);
+    free(c->x);
+    free(c->y);
+    free(c->ok);
+    free(c->nivel);
+    free(c->classe);
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* Faixa "da tela" de um eixo: percentis 2%..98% dos valores (polos e
+ * assíntotas não esticam a escala), com uma faixa de folga de cada lado.
+ * Retorna 0 se faltou memória. */
+static int faixa_visivel(const double *v, const unsigned char *ok, int n, double *lo, double *hi) {
+    double *tmp = malloc(n * sizeof(double));
+    if (!tmp) return 0;
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (ok[i] && isfinite(v[i])) tmp[m++] = v[i];
+    }
+    if (m == 0) {
+        *lo = -1.0;
+        *hi = 1.0;
+    } else {
+        qsort(tmp, m, sizeof(double), comparar_double);
+        *lo = tmp[m * 2 / 100];
+        *hi = tmp[m - 1 - m * 2 / 100];
+    }
+    free(tmp);
+
+    double faixa = *hi - *lo;
+    if (!(faixa > 1e-12 * fmax(1.0, fabs(*hi)))) faixa = 1.0;
+    *lo -= faixa;
+    *hi += faixa;
+    return 1;
+}
+
+/* Classe de um intervalo (i, i+1) na amostragem com Plot.interval */
+#define CLASSE_SEM_PROVA 0  /* Sem aritmética intervalar: só os critérios da adaptativa */
+#define CLASSE_LISA      1  /* Regular e a caixa cabe na tolerância (ou fora da tela): não divide */
+#define CLASSE_REGULAR   2  /* Regular: só os critérios da adaptativa */
+#define CLASSE_SINGULAR  3  /* Pode ter polo, fronteira de domínio ou salto */
+#define CLASSE_PENDENTE  4  /* Intervalo novo, ainda não classificado */
+
+#define VISIVEL(k) (c->ok[k] && c->x[k] >= lo[0] && c->x[k] <= hi[0] && \
+                    c->y[k] >= lo[1] && c->y[k] <= hi[1])
+
+/* Avaliação intervalar da amostragem com Plot.interval: o programa da curva
+ * e as colunas de trabalho de interval_eval(). */
+typedef struct {
+    const BatchProgram *prog;
+    int cartesiano;         /* Uma saída (Y), com X = t */
+    Interval *pilha;
+} Intervalar;
+
+/* Classifica o intervalo (i, i+1) com a caixa de interval_eval(): liso se
+ * ela cabe na tolerância ou fica fora da tela, singular se a prova falhou
+ * ou um extremo deu erro. */
+static void classificar(const Intervalar *ia, Curva *c, int i, double tol, const double *lo,
+                        const double *hi, double sx, double sy) {
+    Interval saida[BATCH_MAX_OUTPUTS];
+    const int r = interval_eval(ia->prog, c->t[i], c->t[i + 1], ia->pilha, saida);
+    if (r == INTERVAL_UNSUPPORTED) {
+        c->classe[i] = CLASSE_SEM_PROVA;
+        return;
+    }
+    if (r == INTERVAL_SINGULAR || !c->ok[i] || !c->ok[i + 1]) {
+        c->classe[i] = CLASSE_SINGULAR;
+        return;
+    }
+
+    Interval bx, by;
+    if (ia->cartesiano) {
+        bx.lo = c->t[i];
+        bx.hi = c->t[i + 1];
+        by = saida[0];
+    } else {
+        bx = saida[0];
+        by = saida[1];
+    }
+    if (bx.hi < lo[0] || bx.lo > hi[0] || by.hi < lo[1] || by.lo > hi[1] ||
+        hypot((bx.hi - bx.lo) * sx, (by.hi - by.lo) * sy) <= tol) {
+        c->classe[i] = CLASSE_LISA;
+    } else {
+        c->classe[i] = CLASSE_REGULAR;
+    }
+}
+
+/* 1 se o intervalo singular (i, i+1), com os dois extremos definidos, deve
+ * virar uma quebra da curva: um dos extremos está fora da tela (polo) ou
+ * eles estão a mais de `tol` pixels um do outro (salto). Extremos visíveis e
+ * colados são uma singularidade removível (sin(x)/x) ou só folga da caixa
+ * (perto de uma fronteira de domínio, como em R**2=cos(2*t)). */
+static int quebra(const Curva *c, int i, double tol, const double *lo, const double *hi,
+                  double sx, double sy) {
+    if (c->classe[i] != CLASSE_SINGULAR || !c->ok[i] || !c->ok[i + 1]) return 0;
+    if (!VISIVEL(i) || !VISIVEL(i + 1)) return 1;
+    return hypot((c->x[i + 1] - c->x[i]) * sx, (c->y[i + 1] - c->y[i]) * sy) > tol;
+}
+
+/* Prioridade de cada intervalo (i, i+1) para a próxima rodada (0 = não
+ * divide). Em pixels: desvio do ponto do meio em relação à corda dos
+ * vizinhos, mudança de direção em segmentos longos, e fronteira com erro.
+ * Com a classe da aritmética intervalar: intervalos lisos não são divididos
+ * e os singulares com os dois
+ * extremos definidos até PLOT_INTERVAL_MAX_DEPTH ou, depois de
+ * PLOT_INTERVAL_MIN_DEPTH divisões, até o desfecho ficar claro: os dois
+ * extremos fora da tela, ou visíveis e colados (ver quebra). */
+#define PLOT_ADAPTIVE_MAX_ANGLE 0.35   /* ~20 graus */
+#define PLOT_ADAPTIVE_LONG_SEGMENT 4.0 /* Segmento "longo", em tolerâncias */
+
+static void priorizar(const Curva *c, int intervalar, double tol, const double *lo, const double *hi,
+                      double sx, double sy, double *prio) {
+    const int n = c->count;
+    for (int i = 0; i + 1 < n; i++) prio[i] = 0.0;
+
+    // Entrada/saída de região com erro: localiza a borda (polo, domínio)
+    for (int i = 0; i + 1 < n; i++) {
+        if (c->ok[i] != c->ok[i + 1] && (VISIVEL(i) || VISIVEL(i + 1))) {
+            prio[i] = HUGE_VAL;
+        }
+    }
+
+    for (int j = 1; j + 1 < n; j++) {
+        if (!c->ok[j - 1] || !c->ok[j] || !c->ok[j + 1]) continue;
+        if (!VISIVEL(j - 1) && !VISIVEL(j) && !VISIVEL(j + 1)) continue;
+
+        const double ax = c->x[j - 1] * sx, ay = c->y[j - 1] * sy;
+        const double bx = c->x[j] * sx,     by = c->y[j] * sy;
+        const double cx = c->x[j + 1] * sx, cy = c->y[j + 1] * sy;
+        const double ux = bx - ax, uy = by - ay;
+        const double vx = cx - bx, vy = cy - by;
+        const double l1 = sqrt(ux * ux + uy * uy), l2 = sqrt(vx * vx + vy * vy);
+        const double corda = sqrt((cx - ax) * (cx - ax) + (cy - ay) * (cy - ay));
+
+        // Distância de B à corda AC (ou a A, se A e C coincidem)
+        double desvio = (corda > 0.0) ? fabs((cx - ax) * (ay - by) - (ax - bx) * (cy - ay)) / corda : l1;
+        if (!isfinite(desvio)) desvio = HUGE_VAL;
+
+        double p = 0.0;
+        if (desvio > tol) {
+            p = desvio;
+        } else if (fmax(l1, l2) > PLOT_ADAPTIVE_LONG_SEGMENT * tol && l1 > 0.0 && l2 > 0.0) {
+            double angulo = atan2(fabs(ux * vy - uy * vx), ux * vx + uy * vy);
+            if (angulo > PLOT_ADAPTIVE_MAX_ANGLE) p = angulo * fmax(l1, l2);
+        }
+        if (p > 0.0) {
+            if (l1 > tol && p > prio[j - 1]) prio[j - 1] = p;
+            if (l2 > tol && p > prio[j]) prio[j] = p;
+        }
+    }
+
+    for (int i = 0; i + 1 < n; i++) {
+        int limite = PLOT_ADAPTIVE_MAX_DEPTH;
+        if (intervalar && c->classe[i] == CLASSE_LISA) {
+            prio[i] = 0.0;
+        } else if (intervalar && c->classe[i] == CLASSE_SINGULAR && c->ok[i] && c->ok[i + 1]) {
+            const int decidido = (!VISIVEL(i) && !VISIVEL(i + 1)) || !quebra(c, i, tol, lo, hi, sx, sy);
+            if (c->nivel[i] < PLOT_INTERVAL_MIN_DEPTH || !decidido) prio[i] = HUGE_VAL;
+            limite = PLOT_INTERVAL_MAX_DEPTH;
+        }
+        if (c->nivel[i] >= limite) prio[i] = 0.0;
+    }
+}
+
+/* Intervalo (i, i+1) candidato a ser dividido. */
+typedef struct {
+    double prio;
+    int i;
+} Candidato;
+
+/* Prioridade decrescente (empate: menor t). */
+static int comparar_prioridade(const void *a, const void *b) {
+    const Candidato *ca = a, *cb = b;
+    if (ca->prio != cb->prio) return (ca->prio < cb->prio) ? 1 : -1;
+    return (ca->i > cb->i) - (ca->i < cb->i);
+}
+
+static int comparar_indice(const void *a, const void *b) {
+    const Candidato *ca = a, *cb = b;
+    return (ca->i > cb->i) - (ca->i < cb->i);
+}
+
+/* Amostragem adaptativa: grade inicial de PLOT_ADAPTIVE_INITIAL pontos e
+ * rodadas de subdivisão, cada uma avaliando em lote os pontos médios dos
+ * intervalos de maior prioridade, até nenhum passar do critério ou acabar o
+ * orçamento de avaliações. Com Plot.interval, cada intervalo novo é
+ * classificado pela aritmética intervalar e cada intervalo singular que
+ * terminou como quebra (polo, salto) ganha no meio uma amostra com status 0,
+ * que levanta a caneta. */
+static int amostrar_adaptativo(Amostrador *a, double C, double D, PlotData *data) {
+    const Plot *plot = a->plot;
+    const Programa *p = a->prog;
+    const double tol = (plot->tolerance > 0.0) ? plot->tolerance : PLOT_ADAPTIVE_TOLERANCE;
+    int max = (plot->max_samples > 0) ? plot->max_samples : PLOT_ADAPTIVE_MAX_SAMPLES;
+    const int n0 = (max < PLOT_ADAPTIVE_INITIAL) ? (max < 2 ? 2 : max) : PLOT_ADAPTIVE_INITIAL;
+    if (max < n0) max = n0;
+
+    Curva c, prox;
+    double *prio = malloc(max * sizeof(double));
+    Candidato *cand = malloc(max * sizeof(Candidato));
+    double *tm = malloc(max * sizeof(double));
+    double *xm = malloc(max * sizeof(double));
+    double *ym = malloc(max * sizeof(double));
+    unsigned char *okm = malloc(max);
+    int alocou = curva_alocar(&c, max);
+    alocou = curva_alocar(&prox, max) && alocou;
+    int resultado = 0;
+
+    // Aritmética intervalar, se o programa da curva tem versão intervalar
+    Intervalar ia = { NULL, plot->type == PLOT_CARTESIAN, NULL };
+    if (plot->interval && p->compilado && interval_supported(&p->prog)) {
+        ia.prog = &p->prog;
+        ia.pilha = malloc(interval_stack_size(&p->prog) * sizeof(Interval));
+        alocou = alocou && ia.pilha;
+    }
+
+    if (!alocou || !prio || !cand || !tm || !xm || !ym || !okm) goto fim;
+
+    // Grade inicial
+    const double step = (D - C) / (n0 - 1);
+    for (int i = 0; i < n0; i++) {
+        c.t[i] = C + i * step;
+    }
+    c.count = n0;
+    if (!avaliar(a, c.t, n0, c.x, c.y, c.ok)) goto fim;
+
+    // Escala de pixels a partir da grade inicial
+    double lo[2], hi[2];
+    if (!faixa_visivel(c.x, c.ok, n0, &lo[0], &hi[0]) ||
+        !faixa_visivel(c.y, c.ok, n0, &lo[1], &hi[1])) {
+        goto fim;
+    }
+    // lo/hi incluem uma faixa de folga de cada lado: a tela é o terço do meio
+    const double sx = 3.0 * PLOT_ADAPTIVE_VIEW_W / (hi[0] - lo[0]);
+    const double sy = 3.0 * PLOT_ADAPTIVE_VIEW_H / (hi[1] - lo[1]);
+    memset(c.classe, CLASSE_PENDENTE, n0);
+
+    while (c.count < max) {
+        for (int i = 0; ia.prog && i + 1 < c.count; i++) {
+            if (c.classe[i] == CLASSE_PENDENTE) classificar(&ia, &c, i, tol, lo, hi, sx, sy);
+        }
+        priorizar(&c, ia.prog != NULL, tol, lo, hi, sx, sy, prio);
+
+        int m = 0;
+        for (int i = 0; i + 1 < c.count; i++) {
+            if (prio[i] > 0.0) {
+                cand[m].prio = prio[i];
+                cand[m].i = i;
+                m++;
+            }
+        }
+        if (m == 0) break;
+
+        // Orçamento: ficam os intervalos de maior prioridade
+        if (m > max - c.count) {
+            qsort(cand, m, sizeof(Candidato), comparar_prioridade);
+            m = max - c.count;
+            qsort(cand, m, sizeof(Candidato), comparar_indice);
+        }
+
+        for (int k = 0; k < m; k++) {
+            tm[k] = 0.5 * (c.t[cand[k].i] + c.t[cand[k].i + 1]);
+        }
+        if (!avaliar(a, tm, m, xm, ym, okm)) goto fim;
+
+        // Intercala os pontos médios (cand está em ordem crescente de i)
+        int out = 0, k = 0;
+        for (int i = 0; i < c.count; i++) {
+            prox.t[out] = c.t[i];
+            prox.x[out] = c.x[i];
+            prox.y[out] = c.y[i];
+            prox.ok[out] = c.ok[i];
+            prox.nivel[out] = c.nivel[i];
+            prox.classe[out] = c.classe[i];
+            out++;
+            if (k < m && cand[k].i == i) {
+                prox.nivel[out - 1] = c.nivel[i] + 1;
+                prox.classe[out - 1] = CLASSE_PENDENTE;
+                prox.t[out] = tm[k];
+                prox.x[out] = xm[k];
+                prox.y[out] = ym[k];
+                prox.ok[out] = okm[k];
+                prox.nivel[out] = c.nivel[i] + 1;
+                prox.classe[out] = CLASSE_PENDENTE;
+                out++;
+                k++;
+            }
+        }
+        prox.count = out;
+
+        Curva tmp = c;
+        c = prox;
+        prox = tmp;
+    }
+
+    // O último intervalo pode ter saído da última rodada sem classe
+    for (int i = 0; ia.prog && i + 1 < c.count; i++) {
+        if (c.classe[i] == CLASSE_PENDENTE) classificar(&ia, &c, i, tol, lo, hi, sx, sy);
+    }
+
+    int quebras = 0;
+    for (int i = 0; ia.prog && i + 1 < c.count; i++) {
+        c.classe[i] = quebra(&c, i, tol, lo, hi, sx, sy);
+        quebras += c.classe[i];
+    }
+
+    if (reservar(data, c.count + quebras)) {
+        if (quebras == 0) {
+            memcpy(data->x, c.x, c.count * sizeof(double));
+            memcpy(data->y, c.y, c.count * sizeof(double));
+            memcpy(data->t, c.t, c.count * sizeof(double));
+            memcpy(data->valid, c.ok, c.count);
+        } else {
+            // Cada quebra vira uma amostra sem ponto entre os extremos
+            int out = 0;
+            for (int i = 0; i < c.count; i++) {
+                data->x[out] = c.x[i];
+                data->y[out] = c.y[i];
+                data->t[out] = c.t[i];
+                data->valid[out++] = c.ok[i];
+                if (i + 1 < c.count && c.classe[i]) {
+                    data->x[out] = data->y[out] = NAN;
+                    data->t[out] = 0.5 * (c.t[i] + c.t[i + 1]);
+                    data->valid[out++] = 0;
+                }
+            }
+        }
+        compactar(data, c.count + quebras);
+        resultado = 1;
+    }
+
+fim:
+    curva_liberar(&c);
+    curva_liberar(&prox);
+    free(prio);
+    free(cand);
+    free(tm);
+    free(xm);
+    free(ym);
+    free(okm);
+    free(ia.pilha);
+    return resultado;
+}
+#undef VISIVEL
+
+void plot_interval(const Plot *plot, double *C, double *D) {
+    *C = plot->C;
+    *D = plot->D;
+    if (!plot->has_interval) {
+        definir_intervalo_padrao(plot->type, C, D);
+    }
+
+    // Para polar, converte para radianos
+    if (plot->type == PLOT_POLAR_R || plot->type == PLOT_POLAR_R2) {
+        *C *= M_PI;
+        *D *= M_PI;
+    }
+}
+
+/* ---- Cache de programas compilados ---- */
+
+static void liberar_programa(void *valor) {
+    Programa *p = valor;
+    if (p->tem_jit) batch_jit_free(&p->jit);
+    if (p->compilado) batch_free(&p->prog);
+    for (int k = 0; k < p->expressoes; k++) {
+        parser_free_buffer(&p->tokens[k]);
+        parser_free_buffer(&p->rpn[k]);
+    }
+    if (p->saidas[0]) {
+        parser_free_buffer(&p->polar[0]);
+        parser_free_buffer(&p->polar[1]);
+    }
+    free(p);
+}
+
+static size_t tamanho_buffer(const TokenBuffer *b) {
+    return (size_t)b->capacity * sizeof(Token) + (size_t)b->values_capacity * sizeof(double);
+}
+
+/* Memória de um Programa, para o limite do cache */
+static size_t tamanho_programa(const Programa *p) {
+    size_t bytes = sizeof(Programa);
+    for (int k = 0; k < 2; k++) {
+        bytes += tamanho_buffer(&p->tokens[k]) + tamanho_buffer(&p->rpn[k]) + tamanho_buffer(&p->polar[k]);
+    }
+    if (p->compilado) {
+        bytes += (size_t)p->prog.size * sizeof(BatchOp) + (size_t)p->prog.values_size * sizeof(double);
+        for (int k = 0; k < p->prog.calls_size; k++) {
+            bytes += sizeof(TokenBuffer) + tamanho_buffer(&p->prog.calls[k]);
+        }
+    }
+    if (p->tem_jit) bytes += p->jit.code_size + (size_t)p->jit.bank_size * sizeof(double);
+    return bytes;
+}
+
+/* Roda a frente inteira para `plot`. Retorna NULL em caso de erro (mensagem
+ * em *errmsg). */
+static Programa *compilar_programa(const AbacoContext *ctx, const Plot *plot, char **errmsg) {
+    const int aliases = aliases_da_curva(plot);
+    Programa *p = calloc(1, sizeof(Programa));
+    if (!p) {
+        if (errmsg) *errmsg = strdup("memória insuficiente");
+        return NULL;
+    }
+    if (!compilar_expressao(ctx, aliases, plot->expr1, "primeira", &p->tokens[0], &p->rpn[0], errmsg)) {
+        liberar_programa(p);
+        return NULL;
+    }
+    p->expressoes = 1;
+
+    // Segunda expressão (paramétrico)
+    int tem_expr2 = (plot->type == PLOT_PARAMETRIC && plot->expr2);
+    if (tem_expr2) {
+        if (!compilar_expressao(ctx, aliases, plot->expr2, "segunda", &p->tokens[1], &p->rpn[1], errmsg)) {
+            liberar_programa(p);
+            return NULL;
+        }
+        p->expressoes = 2;
+    }
+
+    // Saídas avaliadas num único programa fundido (ver montar_saidas)
+    p->n_saidas = montar_saidas(plot, &p->rpn[0], tem_expr2 ? &p->rpn[1] : NULL, p->polar, p->saidas);
+    if (!p->n_saidas) {
+        if (errmsg) *errmsg = strdup("memória insuficiente");
+        liberar_programa(p);
+        return NULL;
+    }
+    p->compilado = batch_compile_multi(ctx, p->saidas, p->n_saidas, &p->prog);
+    if (p->compilado) {
+        batch_optimize(&p->prog, BATCH_OPT_ALL);
+        // O JIT só lê t: a implícita vai pelo batch_eval_vars. Tem que bater
+        // com o "j" de chave_programa
+        if (batch_engine() == BATCH_ENGINE_JIT && plot->type != PLOT_IMPLICIT) {
+            p->tem_jit = batch_jit_compile(&p->prog, &p->jit);
+        }
+    }
+    return p;
+}
+
+/* Cópia de `p` com os parâmetros livres de `plot` trocados pelas constantes
+ * `valores` (batch_bind), para uma geração: sem parser nem compilador, só uma
+ * passada do otimizador sobre o bytecode. Com o motor JIT, o código de
+ * máquina da cópia é gerado de novo (uma tradução das instruções). Liberar
+ * com liberar_programa(). Retorna NULL se faltou memória. */
+static Programa *vincular_programa(const Programa *p, const Plot *plot, const double *valores) {
+    const int primeiro = primeiro_parametro(plot);
+    Programa *q = calloc(1, sizeof(Programa));
+    if (!q) return NULL;
+    int ok = 1;
+    for (int k = 0; ok && k < p->n_saidas; k++) {
+        ok = batch_bind_rpn(p->saidas[k], primeiro, valores, plot->n_params, &q->rpn[k]);
+        if (ok) q->expressoes = k + 1;
+        q->saidas[k] = &q->rpn[k];
+    }
+    q->n_saidas = p->n_saidas;
+    if (ok && p->compilado) {
+        ok = q->compilado = batch_bind(&p->prog, primeiro, valores, plot->n_params, q->saidas, &q->prog);
+        // Dobra as subárvores que ficaram constantes ((k+1)*t, t^k com k
+        // inteiro): o mesmo programa da curva escrita com os valores
+        if (ok) batch_optimize(&q->prog, BATCH_OPT_ALL);
+    }
+    if (ok && p->tem_jit) q->tem_jit = batch_jit_compile(&q->prog, &q->jit);
+    if (!ok) {
+        liberar_programa(q);
+        return NULL;
+    }
+    return q;
+}
+
+/* Chave do cache: o tipo (que decide as saídas), se o programa tem JIT
+ * (compilar_programa só o gera com o motor JIT; sem isso, um programa
+ * compilado em outro motor seria reusado no JIT sem código de máquina e
+ * batch_eval_multi recompilaria a cada chamada), as expressões normalizadas e
+ * os nomes dos parâmetros livres (que decidem os índices das variáveis; os
+ * valores não entram). Retorna NULL se faltou memória. */
+static char *chave_programa(const Plot *plot) {
+    const char *expr2 = (plot->type == PLOT_PARAMETRIC && plot->expr2) ? plot->expr2 : "";
+    const size_t nomes = (size_t)plot->n_params * PLOT_PARAM_NAME_MAX;
+    char *chave = malloc(16 + strlen(plot->expr1) + strlen(expr2) + nomes);
+    if (!chave) return NULL;
+    const int jit = batch_engine() == BATCH_ENGINE_JIT && plot->type != PLOT_IMPLICIT;
+    size_t n = (size_t)sprintf(chave, "%d%s:", (int)plot->type, jit ? "j" : "");
+    n += exprcache_normalize(plot->expr1, chave + n);
+    chave[n++] = '\n';
+    n += exprcache_normalize(expr2, chave + n);
+    for (int k = 0; k < plot->n_params; k++) {
+        n += (size_t)sprintf(chave + n, "%c%s", k ? ',' : '\n', plot->params[k].name);
+    }
+    return chave;
+}
+
+static ExprCache *cache_programas;
+static ExprCache *cache_amostras;       /* SampleCache por curva e motor */
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+/* Amostras reaproveitadas e avaliadas pelas gerações com Plot.incremental */
+static pthread_mutex_t contadores_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long amostras_reusadas, amostras_avaliadas;
+
+static void cache_iniciar(void) {
+    cache_programas = exprcache_create(PLOT_CACHE_MAX_BYTES, PLOT_CACHE_MAX_ENTRIES, liberar_programa);
+    cache_amostras = exprcache_create(PLOT_SAMPLE_CACHE_MAX_BYTES, PLOT_SAMPLE_CACHE_MAX_CURVES,
+                                      samplecache_free);
+    // O nível de vecmath entra na chave das amostras: detecta aqui, uma vez,
+    // antes que gerações em threads diferentes o consultem
+    vecmath_level();
+}
+
+static ExprCache *cache_multicurvas(void) {
+    pthread_once(&cache_once, cache_iniciar);
+    return cache_programas;
+}
+
+static ExprCache *cache_amostras_multicurvas(void) {
+    pthread_once(&cache_once, cache_iniciar);
+    return cache_amostras;
+}
+
+void plot_cache_set_limits(size_t max_bytes, int max_entries) {
+    ExprCache *cache = cache_multicurvas();
+    if (cache) exprcache_set_limits(cache, max_bytes, max_entries);
+}
+
+void plot_cache_clear(void) {
+    ExprCache *cache = cache_multicurvas();
+    if (cache) exprcache_clear(cache);
+}
+
+void plot_cache_stats(ExprCacheStats *stats) {
+    ExprCache *cache = cache_multicurvas();
+    if (cache) {
+        exprcache_stats(cache, stats);
+    } else {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void plot_sample_cache_set_limits(size_t max_bytes, int max_curves) {
+    ExprCache *cache = cache_amostras_multicurvas();
+    if (cache) exprcache_set_limits(cache, max_bytes, max_curves);
+}
+
+void plot_sample_cache_clear(void) {
+    ExprCache *cache = cache_amostras_multicurvas();
+    if (cache) exprcache_clear(cache);
+}
+
+void plot_sample_cache_stats(PlotSampleCacheStats *stats) {
+    ExprCache *cache = cache_amostras_multicurvas();
+    memset(stats, 0, sizeof(*stats));
+    if (cache) exprcache_stats(cache, &stats->curves);
+    pthread_mutex_lock(&contadores_lock);
+    stats->reused = amostras_reusadas;
+    stats->evaluated = amostras_avaliadas;
+    pthread_mutex_unlock(&contadores_lock);
+}
+
+/* Programa de `plot` (chave de chave_programa), do cache ou recém-compilado
+ * (e guardado). Devolver com exprcache_release(). Erros de compilação não
+ * ficam no cache. */
+static ExprCacheEntry *obter_programa(const AbacoContext *ctx, const Plot *plot, const char *chave,
+                                      char **errmsg) {
+    ExprCache *cache = cache_multicurvas();
+    if (!cache) {
+        if (errmsg) *errmsg = strdup("memória insuficiente");
+        return NULL;
+    }
+
+    ExprCacheEntry *e = exprcache_get(cache, chave);
+    if (!e) {
+        const int anterior = stats_enter(STATS_COMPILE);
+        Programa *p = compilar_programa(ctx, plot, errmsg);
+        stats_leave(anterior);
+        if (p) {
+            e = exprcache_put(cache, chave, p, tamanho_programa(p));
+            if (!e && errmsg) *errmsg = strdup("memória insuficiente");
+        }
+    }
+    return e;
+}
+
+/* Liga o cache de amostras da curva no amostrador. Os valores dependem do
+ * motor e do nível de vecmath (último bit), que entram na chave. Sem
+ * memória, a geração segue sem cache. */
+static void ligar_amostras(Amostrador *a, const char *chave) {
+    ExprCache *cache = cache_amostras_multicurvas();
+    char *chave_motor = cache ? malloc(strlen(chave) + 32) : NULL;
+    if (!chave_motor) return;
+    sprintf(chave_motor, "%s:%d:%s", a->previa ? "preview" : batch_engine_name(batch_engine()),
+            (int)vecmath_level(), chave);
+
+    ExprCacheEntry *e = exprcache_get(cache, chave_motor);
+    if (!e) {
+        SampleCache *sc = samplecache_create();
+        if (sc) e = exprcache_put(cache, chave_motor, sc, samplecache_bytes(sc));
+    }
+    free(chave_motor);
+    if (!e) return;
+
+    ExprCacheStats stats;
+    exprcache_stats(cache, &stats);
+    a->cache = cache;
+    a->amostras = e;
+    a->limite = stats.max_bytes;
+}
+
+int plot_compile(const Plot *plot, char **errmsg) {
     if (errmsg) *errmsg = NULL;
     if (!plot || !plot->expr1) {
         if (errmsg) *errmsg = strdup("plot inválido");
-        return NULL;
+        return 0;
     }
-    
-    // Define intervalo [C,D]
-    double C = plot->C, D = plot->D;
-    if (!plot->has_interval) {
-        definir_intervalo_padrao(plot->type, &C, &D);
+    if (!parametros_validos(plot, errmsg)) return 0;
+    const AbacoContext *ctx = contexto_da_curva(plot);
+    char *chave = ctx ? chave_programa(plot) : NULL;
+    ExprCacheEntry *entrada = chave ? obter_programa(ctx, plot, chave, errmsg) : NULL;
+    if (!chave && errmsg) *errmsg = strdup("memória insuficiente");
+    free(chave);
+    if (!entrada) return 0;
+    exprcache_release(cache_multicurvas(), entrada);
+    return 1;
+}
+
+/* Programa de `plot` no cache (chave em *chave), compilado se preciso. NULL
+ * com a mensagem em *errmsg se não compilou ou faltou memória. */
+static ExprCacheEntry *programa_da_curva(const Plot *plot, const AbacoContext **ctx, char **chave,
+                                         char **errmsg) {
+    *ctx = contexto_da_curva(plot);
+    *chave = *ctx ? chave_programa(plot) : NULL;
+    ExprCacheEntry *entrada = *chave ? obter_programa(*ctx, plot, *chave, errmsg) : NULL;
+    if (!*chave && errmsg) *errmsg = strdup("memória insuficiente");
+    if (!entrada) {
+        free(*chave);
+        *chave = NULL;
     }
-    
-    // Para polar, converte para radianos
-    int is_polar = (plot->type == PLOT_POLAR_R || plot->type == PLOT_POLAR_R2);
-    if (is_polar) {
-        C = C * M_PI;
-        D = D * M_PI;
+    return entrada;
+}
+
+/* Uma geração de `plot` em [C,D] com o programa `p` do cache (chave
+ * `chave`) e, se a curva tem parâmetros livres, os valores `valores` (numa
+ * cópia vinculada do programa; as amostras guardadas com Plot.incremental
+ * ficam numa chave com os valores). Retorna 0 se faltou memória. */
+static int gerar(const Plot *plot, const AbacoContext *ctx, const Programa *p, const char *chave,
+                 const double *valores, PlotData *data) {
+    double C, D;
+    plot_interval(plot, &C, &D);
+
+    Programa *vinculado = NULL;
+    char *chave_valores = NULL;
+    if (plot->n_params > 0) {
+        vinculado = vincular_programa(p, plot, valores);
+        if (!vinculado) return 0;
+        p = vinculado;
+        chave_valores = malloc(strlen(chave) + (size_t)plot->n_params * 32);
+        if (chave_valores) {
+            size_t n = (size_t)sprintf(chave_valores, "%s", chave);
+            for (int k = 0; k < plot->n_params; k++) {
+                n += (size_t)sprintf(chave_valores + n, "=%.17g", valores[k]);
+            }
+        }
+        chave = chave_valores;
     }
-    
-    // Aloca estrutura de dados
+
+    Amostrador amostrador;
+    memset(&amostrador, 0, sizeof(amostrador));
+    amostrador.plot = plot;
+    amostrador.ctx = ctx;
+    amostrador.prog = p;
+    if (p->tem_jit && batch_engine() == BATCH_ENGINE_JIT) amostrador.jit = &p->jit;
+    const int implicita = (plot->type == PLOT_IMPLICIT);
+    amostrador.previa = plot->quality == PLOT_QUALITY_PREVIEW && p->compilado && !implicita;
+    if (plot->incremental && !implicita && chave) ligar_amostras(&amostrador, chave);
+
+    int resultado;
+    if (implicita) {
+        resultado = amostrar_implicita(&amostrador, C, D, data);
+    } else if (plot->adaptive || plot->interval) {
+        resultado = amostrar_adaptativo(&amostrador, C, D, data);
+    } else {
+        resultado = amostrar_uniforme(&amostrador, C, D, plot->samples, data);
+    }
+    data->segmented = resultado && (plot->interval || implicita);
+
+    if (amostrador.amostras) {
+        exprcache_release(amostrador.cache, amostrador.amostras);
+        pthread_mutex_lock(&contadores_lock);
+        amostras_reusadas += amostrador.reusadas;
+        amostras_avaliadas += amostrador.avaliadas;
+        pthread_mutex_unlock(&contadores_lock);
+    }
+    if (vinculado) liberar_programa(vinculado);
+    free(chave_valores);
+    return resultado;
+}
+
+int plot_generate_samples_into(const Plot *plot, PlotData *data, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+    data->count = data->evaluations = 0;
+    if (!plot || !plot->expr1) {
+        if (errmsg) *errmsg = strdup("plot inválido");
+        return 0;
+    }
+    if (!parametros_validos(plot, errmsg)) return 0;
+
+    const int anterior = stats_enter(STATS_SAMPLE);
+    // Compila expressão(ões), ou pega o programa pronto no cache
+    const AbacoContext *ctx;
+    char *chave;
+    ExprCacheEntry *entrada = programa_da_curva(plot, &ctx, &chave, errmsg);
+    if (!entrada) {
+        stats_leave(anterior);
+        return 0;
+    }
+
+    double valores[PLOT_MAX_PARAMS];
+    for (int k = 0; k < plot->n_params; k++) valores[k] = plot->params[k].from;
+    int resultado = gerar(plot, ctx, exprcache_value(entrada), chave, valores, data);
+    if (!resultado && errmsg) *errmsg = strdup("memória insuficiente");
+
+    free(chave);
+    exprcache_release(cache_multicurvas(), entrada);
+    stats_leave(anterior);
+    return resultado;
+}
+
+/* Varredura em andamento (plot_generate_frames): as threads pegam o próximo
+ * quadro até acabar ou algum falhar. */
+typedef struct {
+    const Plot *plot;
+    const AbacoContext *ctx;
+    const Programa *prog;
+    const char *chave;
+    PlotData *data;
+    int frames;
+    int proximo;            /* Protegido por lock */
+    int falhou;
+    pthread_mutex_t lock;
+} Varredura;
+
+/* Uma thread da varredura, com o próprio Stats se a thread que chamou tem um */
+typedef struct {
+    Varredura *v;
+    int com_stats;
+    Stats stats;
+} TrabalhoVarredura;
+
+static void gerar_quadros(Varredura *v) {
+    for (;;) {
+        pthread_mutex_lock(&v->lock);
+        const int f = v->falhou ? v->frames : v->proximo++;
+        pthread_mutex_unlock(&v->lock);
+        if (f >= v->frames) return;
+
+        double valores[PLOT_MAX_PARAMS];
+        for (int k = 0; k < v->plot->n_params; k++) {
+            valores[k] = plot_param_value(&v->plot->params[k], f, v->frames);
+        }
+        if (!gerar(v->plot, v->ctx, v->prog, v->chave, valores, &v->data[f])) {
+            pthread_mutex_lock(&v->lock);
+            v->falhou = 1;
+            pthread_mutex_unlock(&v->lock);
+        }
+    }
+}
+
+static void *gerar_quadros_thread(void *arg) {
+    TrabalhoVarredura *t = arg;
+    if (t->com_stats) stats_attach(&t->stats);
+    gerar_quadros(t->v);
+    if (t->com_stats) stats_detach();
+    return NULL;
+}
+
+int plot_generate_frames(const Plot *plot, int frames, PlotData *data, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+    for (int f = 0; f < frames; f++) data[f].count = data[f].evaluations = 0;
+    if (!plot || !plot->expr1 || frames < 1) {
+        if (errmsg) *errmsg = strdup("plot inválido");
+        return 0;
+    }
+    if (!parametros_validos(plot, errmsg)) return 0;
+
+    const int anterior = stats_enter(STATS_SAMPLE);
+    const AbacoContext *ctx;
+    char *chave;
+    ExprCacheEntry *entrada = programa_da_curva(plot, &ctx, &chave, errmsg);
+    if (!entrada) {
+        stats_leave(anterior);
+        return 0;
+    }
+
+    // O paralelismo é entre quadros: cada um é gerado inteiro numa thread
+    int threads = plot_thread_count(plot->threads);
+    if (threads > frames) threads = frames;
+    Plot quadro = *plot;
+    if (threads > 1) quadro.threads = 1;
+
+    Varredura v;
+    memset(&v, 0, sizeof(v));
+    v.plot = &quadro;
+    v.ctx = ctx;
+    v.prog = exprcache_value(entrada);
+    v.chave = chave;
+    v.data = data;
+    v.frames = frames;
+    pthread_mutex_init(&v.lock, NULL);
+
+    // Despacho de vecmath escolhido antes de haver outras threads
+    vecmath_level();
+
+    Stats *st = stats_current();
+    TrabalhoVarredura t[PLOT_MAX_THREADS];
+    pthread_t th[PLOT_MAX_THREADS];
+    int criada[PLOT_MAX_THREADS];
+    for (int k = 1; k < threads; k++) {
+        memset(&t[k], 0, sizeof(t[k]));
+        t[k].v = &v;
+        t[k].com_stats = (st != NULL);
+        criada[k] = pthread_create(&th[k], NULL, gerar_quadros_thread, &t[k]) == 0;
+    }
+    // A thread atual também gera quadros (e os de threads que não subiram)
+    gerar_quadros(&v);
+    for (int k = 1; k < threads; k++) {
+        if (!criada[k]) continue;
+        pthread_join(th[k], NULL);
+        if (!st) continue;
+        st->evaluations += t[k].stats.evaluations;
+        for (int j = 0; j < STATS_ERRORS; j++) st->errors[j] += t[k].stats.errors[j];
+    }
+    pthread_mutex_destroy(&v.lock);
+
+    if (v.falhou && errmsg) *errmsg = strdup("memória insuficiente");
+    free(chave);
+    exprcache_release(cache_multicurvas(), entrada);
+    stats_leave(anterior);
+    return !v.falhou;
+}
+
+PlotData *plot_generate_samples(const Plot *plot, char **errmsg) {
     PlotData *data = calloc(1, sizeof(PlotData));
     if (!data) {
         if (errmsg) *errmsg = strdup("memória insuficiente");
         return NULL;
     }
-    
-    int n = plot->samples;
-    data->x = malloc(n * sizeof(double));
-    data->y = malloc(n * sizeof(double));
-    data->status = calloc(n, sizeof(int));
-    data->capacity = n;
-    
-    if (!data->x || !data->y || !data->status) {
-        if (errmsg) *errmsg = strdup("memória insuficiente");
+    if (!plot_generate_samples_into(plot, data, errmsg)) {
         plot_data_free(data);
         return NULL;
     }
-    
-    // Compila expressão(ões)
-    AbacoContext ctx;
-    abaco_context_init(&ctx, MULTICURVAS_VARIABLES, MULTICURVAS_VARIABLE_COUNT);
+    return data;
+}
 
-    TokenBuffer tokens1, rpn1;
-    parser_init_buffer(&tokens1);
-    parser_init_buffer(&rpn1);
+/* Grade uniforme em blocos (plot_sampler_*): o amostrador fica montado
+ * entre um bloco e outro, com a entrada do cache de programas presa. */
+struct PlotSampler {
+    Amostrador a;
+    ExprCacheEntry *entrada;
+    Programa *vinculado;    /* Cópia com os parâmetros livres, se houver */
+    double C, passo;
+};
 
-    ParserError perr = parser_tokenize(&ctx, plot->expr1, &tokens1, NULL);
-    if (perr != PARSER_OK) {
-        if (errmsg) *errmsg = strdup("erro ao compilar primeira expressão");
-        parser_free_buffer(&tokens1);
-        parser_free_buffer(&rpn1);
-        plot_data_free(data);
+PlotSampler *plot_sampler_open(const Plot *plot, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+    if (!plot || !plot->expr1 || plot->samples < 2) {
+        if (errmsg) *errmsg = strdup("plot inválido");
         return NULL;
     }
-
-    if (usa_variaveis_misturadas(&tokens1)) {
-        if (errmsg) *errmsg = strdup("não misture x, theta e t na mesma expressão");
-        parser_free_buffer(&tokens1);
-        parser_free_buffer(&rpn1);
-        plot_data_free(data);
+    if (plot->type == PLOT_IMPLICIT) {
+        if (errmsg) *errmsg = strdup("curva implícita não é gerada em fluxo");
+        return NULL;
+    }
+    if (!parametros_validos(plot, errmsg)) return NULL;
+    PlotSampler *s = calloc(1, sizeof(PlotSampler));
+    if (!s) {
+        if (errmsg) *errmsg = strdup("memória insuficiente");
         return NULL;
     }
 
-    perr = parser_to_rpn(&ctx, &tokens1, &rpn1);
-    if (perr != PARSER_OK) {
-        if (errmsg) *errmsg = strdup("erro ao converter primeira expressão para RPN");
-        parser_free_buffer(&tokens1);
-        parser_free_buffer(&rpn1);
-        plot_data_free(data);
+    const AbacoContext *ctx;
+    char *chave;
+    s->entrada = programa_da_curva(plot, &ctx, &chave, errmsg);
+    free(chave);
+    if (!s->entrada) {
+        free(s);
         return NULL;
     }
 
-    // Segunda expressão (paramétrico)
-    TokenBuffer tokens2, rpn2;
-    int tem_expr2 = (plot->type == PLOT_PARAMETRIC && plot->expr2);
-    if (tem_expr2) {
-        parser_init_buffer(&tokens2);
-        parser_init_buffer(&rpn2);
-
-        perr = parser_tokenize(&ctx, plot->expr2, &tokens2, NULL);
-        if (perr != PARSER_OK) {
-            if (errmsg) *errmsg = strdup("erro ao compilar segunda expressão");
-            parser_free_buffer(&tokens1);
-            parser_free_buffer(&rpn1);
-            parser_free_buffer(&tokens2);
-            parser_free_buffer(&rpn2);
-            plot_data_free(data);
+    const Programa *p = exprcache_value(s->entrada);
+    if (plot->n_params > 0) {
+        // Parâmetros livres no valor `from`, vinculados uma vez para todos os blocos
+        double valores[PLOT_MAX_PARAMS];
+        for (int k = 0; k < plot->n_params; k++) valores[k] = plot->params[k].from;
+        s->vinculado = vincular_programa(p, plot, valores);
+        if (!s->vinculado) {
+            if (errmsg) *errmsg = strdup("memória insuficiente");
+            plot_sampler_close(s);
             return NULL;
         }
+        p = s->vinculado;
+    }
+    s->a.plot = plot;
+    s->a.ctx = ctx;
+    s->a.prog = p;
+    if (p->tem_jit && batch_engine() == BATCH_ENGINE_JIT) s->a.jit = &p->jit;
+    s->a.previa = plot->quality == PLOT_QUALITY_PREVIEW && p->compilado;
+    double D;
+    plot_interval(plot, &s->C, &D);
+    s->passo = (D - s->C) / (plot->samples - 1);
+    return s;
+}
 
-        if (usa_variaveis_misturadas(&tokens2)) {
-            if (errmsg) *errmsg = strdup("não misture x, theta e t na mesma expressão");
-            parser_free_buffer(&tokens1);
-            parser_free_buffer(&rpn1);
-            parser_free_buffer(&tokens2);
-            parser_free_buffer(&rpn2);
-            plot_data_free(data);
-            return NULL;
+int plot_sampler_block(PlotSampler *s, int first, int n, PlotData *data) {
+    const int anterior = stats_enter(STATS_SAMPLE);
+    int resultado = reservar(data, n);
+    if (resultado) {
+        // Mesma conta de amostrar_uniforme: t_i = C + i*passo
+        for (int i = 0; i < n; i++) {
+            data->t[i] = s->C + (first + i) * s->passo;
         }
+        resultado = avaliar(&s->a, data->t, n, data->x, data->y, data->valid);
+        if (resultado) compactar(data, n);
+    }
+    data->segmented = 0;
+    stats_leave(anterior);
+    return resultado;
+}
 
-        perr = parser_to_rpn(&ctx, &tokens2, &rpn2);
-        if (perr != PARSER_OK) {
-            if (errmsg) *errmsg = strdup("erro ao converter segunda expressão para RPN");
-            parser_free_buffer(&tokens1);
-            parser_free_buffer(&rpn1);
-            parser_free_buffer(&tokens2);
-            parser_free_buffer(&rpn2);
-            plot_data_free(data);
-            return NULL;
-        }
+void plot_sampler_close(PlotSampler *s) {
+    if (!s) return;
+    if (s->vinculado) liberar_programa(s->vinculado);
+    exprcache_release(cache_multicurvas(), s->entrada);
+    free(s);
+}
+
+/* Imprime o bytecode de uma expressão antes e depois de batch_optimize(). */
+static void dump_expressao(const AbacoContext *ctx, int aliases, const char *nome, const char *expr,
+                           FILE *out) {
+    TokenBuffer tokens, rpn;
+    char *errmsg = NULL;
+    if (!compilar_expressao(ctx, aliases, expr, "a", &tokens, &rpn, &errmsg)) {
+        fprintf(out, "%s = %s: %s\n", nome, expr, errmsg ? errmsg : "erro");
+        free(errmsg);
+        return;
     }
-    
-    // Gera e avalia amostras
-    double step = (D - C) / (n - 1);
-    int count = 0;
-    
-    for (int i = 0; i < n; i++) {
-        double t = C + i * step;
-        double var_values[MULTICURVAS_VARIABLE_COUNT] = { t, t, t }; /* x, theta, t são aliases do mesmo parâmetro */
-        EvalResult res1 = evaluator_eval_rpn(&ctx, &rpn1, var_values);
 
-        if (res1.error != EVAL_OK) {
-            data->status[i] = 1;
-            continue;
+    BatchProgram prog;
+    fprintf(out, "%s = %s\n", nome, expr);
+    if (!batch_compile(ctx, &rpn, &prog)) {
+        fprintf(out, "(RPN não suportada pelo avaliador em lote: usa o escalar)\n");
+    } else {
+        batch_dump(&prog, out);
+        if (batch_optimize(&prog, BATCH_OPT_ALL)) {
+            fprintf(out, "otimizado:\n");
+            batch_dump(&prog, out);
         }
-        
-        // Converte para coordenadas cartesianas
-        if (plot->type == PLOT_CARTESIAN) {
-            data->x[count] = t;
-            data->y[count] = res1.value;
-        } else if (plot->type == PLOT_POLAR_R) {
-            double r = res1.value;
-            data->x[count] = r * cos(t);
-            data->y[count] = r * sin(t);
-        } else if (plot->type == PLOT_POLAR_R2) {
-            // R**2 = f(t) → R = sqrt(f(t)) se f(t) >= 0
-            if (res1.value < 0) {
-                data->status[i] = 1;
-                continue;
-            }
-            double r = sqrt(res1.value);
-            data->x[count] = r * cos(t);
-            data->y[count] = r * sin(t);
-        } else if (plot->type == PLOT_PARAMETRIC) {
-            if (!tem_expr2) {
-                data->status[i] = 1;
-                continue;
-            }
-            EvalResult res2 = evaluator_eval_rpn(&ctx, &rpn2, var_values);
-            if (res2.error != EVAL_OK) {
-                data->status[i] = 1;
-                continue;
-            }
-            data->x[count] = res1.value;
-            data->y[count] = res2.value;
+        batch_free(&prog);
+    }
+    parser_free_buffer(&tokens);
+    parser_free_buffer(&rpn);
+}
+
+void plot_dump_bytecode(const Plot *plot, FILE *out) {
+    if (!plot || !plot->expr1 || !parametros_validos(plot, NULL)) return;
+
+    const AbacoContext *ctx = contexto_da_curva(plot);
+    const int aliases = aliases_da_curva(plot);
+    if (!ctx) return;
+
+    const char *nome1 = (plot->type == PLOT_PARAMETRIC) ? "X" :
+                        (plot->type == PLOT_POLAR_R)    ? "R" :
+                        (plot->type == PLOT_POLAR_R2)   ? "R**2" :
+                        (plot->type == PLOT_IMPLICIT)   ? "F" : "Y";
+    dump_expressao(ctx, aliases, nome1, plot->expr1, out);
+    int tem_expr2 = (plot->type == PLOT_PARAMETRIC && plot->expr2);
+    if (tem_expr2) {
+        dump_expressao(ctx, aliases, "Y", plot->expr2, out);
+    }
+    if (plot->type == PLOT_CARTESIAN || plot->type == PLOT_IMPLICIT) return;
+
+    // Programa fundido que plot_generate_samples() realmente executa
+    TokenBuffer tokens1, rpn1, tokens2, rpn2, polar[2];
+    const TokenBuffer *saidas[2];
+    if (!compilar_expressao(ctx, aliases, plot->expr1, "primeira", &tokens1, &rpn1, NULL)) return;
+    if (tem_expr2 && !compilar_expressao(ctx, aliases, plot->expr2, "segunda", &tokens2, &rpn2, NULL)) {
+        parser_free_buffer(&tokens1);
+        parser_free_buffer(&rpn1);
+        return;
+    }
+
+    int n_saidas = montar_saidas(plot, &rpn1, tem_expr2 ? &rpn2 : NULL, polar, saidas);
+    BatchProgram prog;
+    if (n_saidas > 1 && batch_compile_multi(ctx, saidas, n_saidas, &prog)) {
+        if (batch_optimize(&prog, BATCH_OPT_ALL)) {
+            fprintf(out, "fundido (X, Y) otimizado:\n");
+            batch_dump(&prog, out);
         }
-        
-        count++;
+        batch_free(&prog);
     }
-    
-    data->count = count;
-    
-    // Libera buffers
+
+    parser_free_buffer(&polar[0]);
+    parser_free_buffer(&polar[1]);
     parser_free_buffer(&tokens1);
     parser_free_buffer(&rpn1);
     if (tem_expr2) {
         parser_free_buffer(&tokens2);
         parser_free_buffer(&rpn2);
     }
-    
-    return data;
 }
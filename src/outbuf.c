@@ -0,0 +1,237 @@
+/* Camada de saída com buffer e formatador de ponto fixo (ver include/outbuf.h).
+ *
+ * Formatação de v com d casas: o resultado é round(|v| * 10^d) escrito como
+ * inteiro, com o ponto inserido. O produto é calculado exatamente como a soma
+ * p + e de dois doubles (FMA quando a CPU tem, senão o TwoProduct de Dekker),
+ * e o arredondamento olha o valor exato:
+ *
+ *   f = floor(p), dd = (p - f) - 0.5   (exatos enquanto p < 2^52)
+ *   dd > 0, ou dd == 0 e e > 0        → f + 1
+ *   dd < 0, ou dd == 0 e e < 0        → f
+ *   dd == 0 e e == 0 (empate exato)   → f ou f + 1, o que for par
+ *
+ * Quando dd != 0 ele é múltiplo de ulp(p) e |e| <= ulp(p)/2, então e não
+ * muda o sinal: a decisão é a mesma que a do printf, que arredonda a
+ * expansão decimal exata do double.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/outbuf.h"
+#include "../include/stats.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OUTBUF_MIN_CAPACITY 4096
+
+/* Acima disso floor/subtrações deixam de ser exatos: vai para o snprintf. */
+#define OUTBUF_EXACT_LIMIT 4503599627370496.0   /* 2^52 */
+
+static const double POT10[OUTBUF_MAX_DECIMALS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+static const uint64_t POT10_INT[OUTBUF_MAX_DECIMALS + 1] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull
+};
+
+/* a * b = *p + *e exatamente. */
+static void produto_exato(double a, double b, double *p, double *e) {
+    *p = a * b;
+#ifdef FP_FAST_FMA
+    *e = fma(a, b, -*p);
+#else
+    // Dekker/Veltkamp: divide cada fator em duas metades de 26 bits
+    const double split = 134217729.0;   /* 2^27 + 1 */
+    double c = split * a;
+    const double ah = c - (c - a), al = a - ah;
+    c = split * b;
+    const double bh = c - (c - b), bl = b - bh;
+    *e = ((ah * bh - *p) + ah * bl + al * bh) + al * bl;
+#endif
+}
+
+/* Escreve os dígitos de v (sem zeros à esquerda; "0" para 0) de trás para
+ * frente a partir de `fim`. Retorna o início. */
+static char *digitos(char *fim, uint64_t v) {
+    do {
+        *--fim = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return fim;
+}
+
+size_t outbuf_format_fixed(char *dst, double v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > OUTBUF_MAX_DECIMALS) decimals = OUTBUF_MAX_DECIMALS;
+
+    const double a = fabs(v);
+    double p = 0.0, e = 0.0;
+    if (FLT_EVAL_METHOD == 0 && isfinite(v)) produto_exato(a, POT10[decimals], &p, &e);
+
+    if (!(FLT_EVAL_METHOD == 0 && isfinite(v) && p < OUTBUF_EXACT_LIMIT)) {
+        char tmp[OUTBUF_FIXED_MAX + 1];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        if (n < 0) n = 0;
+        if (n > OUTBUF_FIXED_MAX) n = OUTBUF_FIXED_MAX;
+        memcpy(dst, tmp, n);
+        return (size_t)n;
+    }
+
+    const double f = floor(p);
+    const double dd = (p - f) - 0.5;
+    uint64_t r = (uint64_t)f;
+    if (dd > 0.0 || (dd == 0.0 && e > 0.0)) {
+        r++;
+    } else if (dd == 0.0 && e == 0.0) {
+        r += (r & 1);
+    }
+
+    // Inteiro e fração, montados de trás para frente
+    char tmp[48];
+    char *fim = tmp + sizeof(tmp);
+    char *ini = fim;
+    if (decimals > 0) {
+        uint64_t frac = r % POT10_INT[decimals];
+        for (int k = 0; k < decimals; k++) {
+            *--ini = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        *--ini = '.';
+    }
+    ini = digitos(ini, r / POT10_INT[decimals]);
+    if (signbit(v)) *--ini = '-';
+
+    const size_t n = (size_t)(fim - ini);
+    memcpy(dst, ini, n);
+    return n;
+}
+
+/* ---- Destinos ---- */
+
+static int escrever_fd(int fd, const char *data, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+static int sink_file(void *ctx, const char *data, size_t n) {
+    return fwrite(data, 1, n, (FILE *)ctx) == n;
+}
+
+static void entregar(OutBuf *ob, const char *data, size_t n) {
+    if (n == 0 || ob->error) return;
+    const int anterior = stats_enter(STATS_WRITE);
+    int ok = ob->sink ? ob->sink(ob->ctx, data, n) : escrever_fd(ob->fd, data, n);
+    stats_leave(anterior);
+    if (ok) {
+        Stats *st = stats_current();
+        if (st) st->bytes += n;
+        ob->written += n;
+    } else {
+        ob->error = 1;
+    }
+}
+
+static int iniciar(OutBuf *ob, OutBufSink sink, void *ctx, int fd, size_t capacity) {
+    memset(ob, 0, sizeof(*ob));
+    if (capacity == 0) capacity = OUTBUF_CAPACITY;
+    if (capacity < OUTBUF_MIN_CAPACITY) capacity = OUTBUF_MIN_CAPACITY;
+    ob->buf = malloc(capacity);
+    ob->capacity = capacity;
+    ob->sink = sink;
+    ob->ctx = ctx;
+    ob->fd = fd;
+    if (!ob->buf) {
+        ob->error = 1;
+        ob->capacity = 0;
+        return 0;
+    }
+    return 1;
+}
+
+int outbuf_init_fd(OutBuf *ob, int fd, size_t capacity) {
+    return iniciar(ob, NULL, NULL, fd, capacity);
+}
+
+int outbuf_init_file(OutBuf *ob, FILE *file, size_t capacity) {
+    return iniciar(ob, sink_file, file, -1, capacity);
+}
+
+int outbuf_init_sink(OutBuf *ob, OutBufSink sink, void *ctx, size_t capacity) {
+    return iniciar(ob, sink, ctx, -1, capacity);
+}
+
+int outbuf_flush(OutBuf *ob) {
+    entregar(ob, ob->buf, ob->size);
+    ob->size = 0;
+    return !ob->error;
+}
+
+void outbuf_reset(OutBuf *ob, void *ctx) {
+    ob->size = 0;
+    ob->written = 0;
+    ob->error = ob->buf ? 0 : 1;
+    ob->ctx = ctx;
+}
+
+int outbuf_close(OutBuf *ob) {
+    int ok = outbuf_flush(ob);
+    free(ob->buf);
+    ob->buf = NULL;
+    ob->capacity = 0;
+    return ok;
+}
+
+/* ---- Escrita ---- */
+
+void outbuf_write(OutBuf *ob, const char *data, size_t n) {
+    if (ob->error) return;
+    if (n > ob->capacity - ob->size) {
+        outbuf_flush(ob);
+        if (n > ob->capacity) {
+            entregar(ob, data, n);
+            return;
+        }
+    }
+    memcpy(ob->buf + ob->size, data, n);
+    ob->size += n;
+}
+
+void outbuf_puts(OutBuf *ob, const char *s) {
+    outbuf_write(ob, s, strlen(s));
+}
+
+void outbuf_char(OutBuf *ob, char c) {
+    if (ob->error) return;
+    if (ob->size == ob->capacity) outbuf_flush(ob);
+    ob->buf[ob->size++] = c;
+}
+
+void outbuf_int(OutBuf *ob, long v) {
+    char tmp[24];
+    char *fim = tmp + sizeof(tmp);
+    // Magnitude em unsigned: -LONG_MIN não cabe em long
+    unsigned long long m = (v < 0) ? 0ull - (unsigned long long)v : (unsigned long long)v;
+    char *ini = digitos(fim, m);
+    if (v < 0) *--ini = '-';
+    outbuf_write(ob, ini, (size_t)(fim - ini));
+}
+
+void outbuf_fixed(OutBuf *ob, double v, int decimals) {
+    if (ob->error) return;
+    if (ob->capacity - ob->size < OUTBUF_FIXED_MAX) outbuf_flush(ob);
+    ob->size += outbuf_format_fixed(ob->buf + ob->size, v, decimals);
+}
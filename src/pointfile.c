@@ -0,0 +1,207 @@
+/* Arquivo binário de pontos (ver include/pointfile.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/pointfile.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COLUNA_LOTE 512     /* Doubles convertidos por vez em host big-endian */
+
+static int host_little_endian(void) {
+    const uint16_t um = 1;
+    return *(const unsigned char *)&um == 1;
+}
+
+static void gravar32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void gravar64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t ler32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t ler64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t bits_double(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+static double double_bits(uint64_t u) {
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+/* ---- Escrita ---- */
+
+static void escrever_coluna(OutBuf *out, const double *v, int n) {
+    // Em little-endian a coluna já está no formato do arquivo
+    if (host_little_endian()) {
+        outbuf_write(out, (const char *)v, (size_t)n * sizeof(double));
+        return;
+    }
+    unsigned char tmp[COLUNA_LOTE * 8];
+    for (int i = 0; i < n;) {
+        int k = 0;
+        for (; k < COLUNA_LOTE && i < n; k++, i++) gravar64(tmp + 8 * k, bits_double(v[i]));
+        outbuf_write(out, (const char *)tmp, (size_t)k * 8);
+    }
+}
+
+int pointfile_write(OutBuf *out, const char *expression, const Plot *plot, const PlotData *data) {
+    const size_t len = strlen(expression);
+    if (len >= UINT32_MAX) return 0;
+
+    const size_t mapa = ((size_t)data->evaluations + 7) / 8;
+    const size_t inicio = (POINTFILE_HEADER_SIZE + len + 1 + mapa + 7) & ~(size_t)7;
+    double C, D;
+    plot_interval(plot, &C, &D);
+
+    unsigned char cab[POINTFILE_HEADER_SIZE];
+    memset(cab, 0, sizeof(cab));
+    memcpy(cab, POINTFILE_MAGIC, 8);
+    gravar32(cab + 8, POINTFILE_VERSION);
+    gravar32(cab + 12, (uint32_t)plot->type);
+    gravar64(cab + 16, bits_double(C));
+    gravar64(cab + 24, bits_double(D));
+    gravar64(cab + 32, (uint64_t)data->count);
+    gravar64(cab + 40, (uint64_t)data->evaluations);
+    gravar32(cab + 48, (uint32_t)len);
+    gravar32(cab + 52, data->segmented ? POINTFILE_FLAG_SEGMENTED : 0);
+    gravar64(cab + 56, (uint64_t)inicio);
+    outbuf_write(out, (const char *)cab, sizeof(cab));
+    outbuf_write(out, expression, len + 1);
+
+    // O mapa de status é a própria máscara do PlotData
+    outbuf_write(out, (const char *)data->valid, mapa);
+    for (size_t k = POINTFILE_HEADER_SIZE + len + 1 + mapa; k < inicio; k++) outbuf_char(out, '\0');
+
+    escrever_coluna(out, data->x, data->count);
+    escrever_coluna(out, data->y, data->count);
+    escrever_coluna(out, data->t, data->count);
+    return !out->error;
+}
+
+/* ---- Leitura ---- */
+
+static PointFile *falha(char **errmsg, const char *msg) {
+    if (errmsg) *errmsg = strdup(msg);
+    return NULL;
+}
+
+/* Confere o arquivo mapeado e preenche os campos. Retorna NULL se está tudo
+ * certo ou a mensagem de erro. */
+static const char *validar(PointFile *pf) {
+    const unsigned char *p = pf->map;
+    const size_t tam = pf->map_size;
+
+    if (memcmp(p, POINTFILE_MAGIC, 8) != 0) return "não é um arquivo de pontos do Multicurvas";
+    if (ler32(p + 8) != POINTFILE_VERSION) return "versão do arquivo de pontos não suportada";
+    const uint32_t tipo = ler32(p + 12);
+    if (tipo < PLOT_CARTESIAN || tipo > PLOT_IMPLICIT) return "tipo de curva inválido no arquivo de pontos";
+
+    const uint64_t count = ler64(p + 32), avaliacoes = ler64(p + 40), inicio = ler64(p + 56);
+    const uint64_t len = ler32(p + 48);
+    if (avaliacoes > INT_MAX || count > avaliacoes) return "cabeçalho do arquivo de pontos inválido";
+
+    const uint64_t mapa = (avaliacoes + 7) / 8;
+    if (inicio % 8 != 0 || inicio < POINTFILE_HEADER_SIZE + len + 1 + mapa || inicio > tam ||
+        tam - inicio != count * 3 * sizeof(double)) {
+        return "tamanho do arquivo de pontos não confere com o cabeçalho";
+    }
+    const char *expressao = (const char *)p + POINTFILE_HEADER_SIZE;
+    if (expressao[len] != '\0' || memchr(expressao, '\0', len)) return "expressão inválida no arquivo de pontos";
+
+    const unsigned char *status = p + POINTFILE_HEADER_SIZE + len + 1;
+    uint64_t uns = 0;
+    for (uint64_t i = 0; i < mapa; i++) uns += (uint64_t)__builtin_popcount(status[i]);
+    if ((avaliacoes % 8 && status[mapa - 1] >> (avaliacoes % 8)) || uns != count) {
+        return "mapa de status não confere com o número de pontos";
+    }
+
+    pf->type = (PlotType)tipo;
+    pf->expression = expressao;
+    pf->C = double_bits(ler64(p + 16));
+    pf->D = double_bits(ler64(p + 24));
+
+    // As colunas começam num múltiplo de 8 de um mapeamento alinhado à página
+    double *colunas = (double *)(void *)(p + inicio);
+    if (!host_little_endian() && count > 0) {
+        pf->copy = malloc(count * 3 * sizeof(double));
+        if (!pf->copy) return "memória insuficiente";
+        for (uint64_t i = 0; i < count * 3; i++) {
+            pf->copy[i] = double_bits(ler64(p + inicio + 8 * i));
+        }
+        colunas = pf->copy;
+    }
+
+    PlotData *d = &pf->data;
+    d->x = colunas;
+    d->y = colunas + count;
+    d->t = colunas + 2 * count;
+    d->valid = (unsigned char *)status;
+    d->count = (int)count;
+    d->capacity = (int)count;
+    d->evaluations = (int)avaliacoes;
+    d->segmented = (ler32(p + 52) & POINTFILE_FLAG_SEGMENTED) != 0;
+    return NULL;
+}
+
+PointFile *pointfile_open(const char *path, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return falha(errmsg, "não foi possível abrir o arquivo de pontos");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < POINTFILE_HEADER_SIZE) {
+        close(fd);
+        return falha(errmsg, "arquivo de pontos truncado");
+    }
+
+    const size_t tam = (size_t)st.st_size;
+    void *map = mmap(NULL, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return falha(errmsg, "não foi possível mapear o arquivo de pontos");
+    // Quem lê percorre as colunas do início ao fim
+    posix_madvise(map, tam, POSIX_MADV_SEQUENTIAL);
+
+    PointFile *pf = calloc(1, sizeof(PointFile));
+    if (!pf) {
+        munmap(map, tam);
+        return falha(errmsg, "memória insuficiente");
+    }
+    pf->map = map;
+    pf->map_size = tam;
+
+    const char *erro = validar(pf);
+    if (erro) {
+        pointfile_close(pf);
+        return falha(errmsg, erro);
+    }
+    return pf;
+}
+
+void pointfile_close(PointFile *pf) {
+    if (!pf) return;
+    if (pf->map) munmap(pf->map, pf->map_size);
+    free(pf->copy);
+    free(pf);
+}
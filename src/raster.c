@@ -0,0 +1,257 @@
+/* Framebuffer e codificadores PPM/PBM/PNG (ver include/raster.h) */
+#include "../include/raster.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+Raster *raster_create(int width, int height, unsigned int background) {
+    if (width <= 0 || height <= 0 || width > RASTER_MAX_DIM || height > RASTER_MAX_DIM) return NULL;
+
+    Raster *r = calloc(1, sizeof(Raster));
+    if (!r) return NULL;
+    const size_t n = (size_t)width * height;
+    r->width = width;
+    r->height = height;
+    r->rgb = malloc(n * 3);
+    r->coverage = calloc(n, 1);
+    if (!r->rgb || !r->coverage) {
+        raster_free(r);
+        return NULL;
+    }
+    raster_rect(r, 0, 0, width, height, background);
+    return r;
+}
+
+void raster_free(Raster *r) {
+    if (!r) return;
+    free(r->rgb);
+    free(r->coverage);
+    free(r);
+}
+
+static double limitar(double v, double lo, double hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void raster_stroke(Raster *r, double x0, double y0, double x1, double y1, double width) {
+    if (!(width > 0.0) || !isfinite(x0) || !isfinite(y0) || !isfinite(x1) || !isfinite(y1)) return;
+
+    const double meia = width < 1.0 ? 0.5 : width / 2.0;
+    const double intensidade = width < 1.0 ? width : 1.0;
+    const double alcance = meia + 0.5;      /* Além disso a cobertura é 0 */
+    const double dx = x1 - x0, dy = y1 - y0;
+    const double l2 = dx * dx + dy * dy;
+
+    // Percorre o eixo em que o segmento é mais longo e, em cada coluna (ou
+    // linha), só a faixa em volta do traço
+    const int horizontal = fabs(dx) >= fabs(dy);
+    const double p0 = horizontal ? x0 : y0, q0 = horizontal ? y0 : x0;
+    const double dp = horizontal ? dx : dy, dq = horizontal ? dy : dx;
+    const int max_p = horizontal ? r->width : r->height;
+    const int max_q = horizontal ? r->height : r->width;
+
+    const double a0 = fmin(p0, p0 + dp), a1 = fmax(p0, p0 + dp);
+    const int i0 = (int)limitar(floor(a0 - alcance), 0, max_p - 1);
+    const int i1 = (int)limitar(ceil(a1 + alcance), 0, max_p - 1);
+    const double sec = fabs(dp) > 0.0 ? sqrt(l2) / fabs(dp) : 1.0;
+    const double banda = alcance * sec + 1.0;
+
+    for (int i = i0; i <= i1; i++) {
+        const double c = limitar(i + 0.5, a0, a1);
+        const double s = (dp != 0.0) ? q0 + (c - p0) * dq / dp : q0;
+        const int j0 = (int)limitar(floor(s - banda), 0, max_q - 1);
+        const int j1 = (int)limitar(ceil(s + banda), 0, max_q - 1);
+
+        for (int j = j0; j <= j1; j++) {
+            const int px = horizontal ? i : j, py = horizontal ? j : i;
+            const double cx = px + 0.5, cy = py + 0.5;
+            double u = (l2 > 0.0) ? ((cx - x0) * dx + (cy - y0) * dy) / l2 : 0.0;
+            u = limitar(u, 0.0, 1.0);
+            const double ex = x0 + u * dx - cx, ey = y0 + u * dy - cy;
+            double cob = alcance - sqrt(ex * ex + ey * ey);
+            if (cob <= 0.0) continue;
+            if (cob > 1.0) cob = 1.0;
+
+            const unsigned v = (unsigned)(cob * intensidade * 255.0 + 0.5);
+            unsigned char *m = &r->coverage[(size_t)py * r->width + px];
+            if (v > *m) *m = (unsigned char)v;
+        }
+    }
+}
+
+void raster_fill(Raster *r, unsigned int color) {
+    const unsigned cor[3] = { (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff };
+    const size_t n = (size_t)r->width * r->height;
+    for (size_t i = 0; i < n; i++) {
+        const unsigned a = r->coverage[i];
+        if (!a) continue;
+        unsigned char *p = &r->rgb[i * 3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = (unsigned char)((p[k] * (255 - a) + cor[k] * a + 127) / 255);
+        }
+        r->coverage[i] = 0;
+    }
+}
+
+void raster_rect(Raster *r, int x, int y, int w, int h, unsigned int color) {
+    int xa = x < 0 ? 0 : x, ya = y < 0 ? 0 : y;
+    int xb = x + w > r->width ? r->width : x + w;
+    int yb = y + h > r->height ? r->height : y + h;
+    for (int py = ya; py < yb; py++) {
+        unsigned char *p = &r->rgb[((size_t)py * r->width + xa) * 3];
+        for (int px = xa; px < xb; px++, p += 3) {
+            p[0] = (color >> 16) & 0xff;
+            p[1] = (color >> 8) & 0xff;
+            p[2] = color & 0xff;
+        }
+    }
+}
+
+/* ---- PPM / PBM ---- */
+
+static void cabecalho_pnm(OutBuf *out, const char *magico, const Raster *r) {
+    outbuf_puts(out, magico);
+    outbuf_char(out, '\n');
+    outbuf_int(out, r->width);
+    outbuf_char(out, ' ');
+    outbuf_int(out, r->height);
+    outbuf_char(out, '\n');
+}
+
+int raster_write_ppm(OutBuf *out, const Raster *r) {
+    cabecalho_pnm(out, "P6", r);
+    outbuf_puts(out, "255\n");
+    outbuf_write(out, (const char *)r->rgb, (size_t)r->width * r->height * 3);
+    return !out->error;
+}
+
+int raster_write_pbm(OutBuf *out, const Raster *r) {
+    cabecalho_pnm(out, "P4", r);
+    for (int y = 0; y < r->height; y++) {
+        const unsigned char *p = &r->rgb[(size_t)y * r->width * 3];
+        unsigned char byte = 0;
+        for (int x = 0; x < r->width; x++, p += 3) {
+            // Luminância Rec. 601 abaixo de 50% vira preto (bit 1)
+            if (299u * p[0] + 587u * p[1] + 114u * p[2] < 127500u) byte |= (unsigned char)(0x80 >> (x & 7));
+            if ((x & 7) == 7 || x == r->width - 1) {
+                outbuf_char(out, (char)byte);
+                byte = 0;
+            }
+        }
+    }
+    return !out->error;
+}
+
+/* ---- PNG ---- */
+
+/* CRC-32 (polinômio 0xEDB88320) de 4 em 4 bits: tabela de 16 entradas */
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu, 0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+    0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu, 0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu
+};
+
+#define PNG_STORE_MAX 65535     /* Maior bloco "store" do deflate */
+#define ADLER_MOD 65521
+#define ADLER_NMAX 5552         /* Bytes somados antes de precisar reduzir módulo 65521 */
+
+typedef struct {
+    OutBuf *out;
+    uint32_t crc;               /* CRC do chunk em andamento */
+    uint32_t adler_a, adler_b;
+    size_t restante;            /* Bytes de imagem ainda não escritos */
+    size_t no_bloco;            /* Bytes que faltam no bloco store atual */
+} Png;
+
+static void png_bytes(Png *png, const unsigned char *data, size_t n) {
+    uint32_t crc = png->crc;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 15];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 15];
+    }
+    png->crc = crc;
+    outbuf_write(png->out, (const char *)data, n);
+}
+
+static void png_be32(Png *png, uint32_t v) {
+    const unsigned char b[4] = { v >> 24, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff };
+    png_bytes(png, b, 4);
+}
+
+static void png_inicio_chunk(Png *png, uint32_t tamanho, const char *tipo) {
+    png_be32(png, tamanho);     /* O tamanho não entra no CRC */
+    png->crc = 0xFFFFFFFFu;
+    png_bytes(png, (const unsigned char *)tipo, 4);
+}
+
+static void png_fim_chunk(Png *png) {
+    png_be32(png, png->crc ^ 0xFFFFFFFFu);
+}
+
+/* Bytes da imagem dentro do fluxo zlib: cabeçalhos store + Adler-32 */
+static void png_store(Png *png, const unsigned char *data, size_t n) {
+    while (n > 0) {
+        if (png->no_bloco == 0) {
+            const size_t len = png->restante < PNG_STORE_MAX ? png->restante : PNG_STORE_MAX;
+            const unsigned char cab[5] = {
+                len == png->restante,   /* BFINAL no último bloco, BTYPE 00 */
+                len & 0xff, len >> 8, ~len & 0xff, (~len >> 8) & 0xff
+            };
+            png_bytes(png, cab, 5);
+            png->no_bloco = len;
+        }
+        size_t k = n < png->no_bloco ? n : png->no_bloco;
+        png_bytes(png, data, k);
+
+        for (size_t i = 0; i < k;) {
+            size_t fim = i + ADLER_NMAX < k ? i + ADLER_NMAX : k;
+            for (; i < fim; i++) {
+                png->adler_a += data[i];
+                png->adler_b += png->adler_a;
+            }
+            png->adler_a %= ADLER_MOD;
+            png->adler_b %= ADLER_MOD;
+        }
+
+        data += k;
+        n -= k;
+        png->restante -= k;
+        png->no_bloco -= k;
+    }
+}
+
+int raster_write_png(OutBuf *out, const Raster *r) {
+    static const unsigned char assinatura[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    Png png = { out, 0, 1, 0, 0, 0 };
+    outbuf_write(out, (const char *)assinatura, sizeof(assinatura));
+
+    // IHDR: RGB, 8 bits, sem entrelaçamento
+    png_inicio_chunk(&png, 13, "IHDR");
+    png_be32(&png, (uint32_t)r->width);
+    png_be32(&png, (uint32_t)r->height);
+    const unsigned char ihdr[5] = { 8, 2, 0, 0, 0 };
+    png_bytes(&png, ihdr, 5);
+    png_fim_chunk(&png);
+
+    // IDAT único: zlib (CMF/FLG sem dicionário) + blocos store + Adler-32.
+    // Cada linha é o byte de filtro 0 seguido dos pixels
+    const size_t linha = (size_t)r->width * 3;
+    const size_t bruto = (size_t)r->height * (linha + 1);
+    const size_t blocos = (bruto + PNG_STORE_MAX - 1) / PNG_STORE_MAX;
+    png_inicio_chunk(&png, (uint32_t)(2 + blocos * 5 + bruto + 4), "IDAT");
+    const unsigned char zlib[2] = { 0x78, 0x01 };
+    png_bytes(&png, zlib, 2);
+    png.restante = bruto;
+    for (int y = 0; y < r->height; y++) {
+        const unsigned char filtro = 0;
+        png_store(&png, &filtro, 1);
+        png_store(&png, &r->rgb[(size_t)y * linha], linha);
+    }
+    png_be32(&png, (png.adler_b << 16) | png.adler_a);
+    png_fim_chunk(&png);
+
+    png_inicio_chunk(&png, 0, "IEND");
+    png_fim_chunk(&png);
+    return !out->error;
+}
@@ -1,6 +1,21 @@
-/* Renderizadores simples: CSV e SVG */
+/* Renderizadores simples: CSV, SVG e raster (PPM/PBM/PNG)
+ *
+ * Tudo passa por um OutBuf (include/outbuf.h): sem printf por ponto, e os
+ * números saem do formatador próprio com os mesmos bytes de %.2f/%.6f.
+ * SVG e raster compartilham o layout (limites, grade, eixos e a curva já em
+ * pixels e simplificada).
+ */
+#define _POSIX_C_SOURCE 200809L
+
 #include "../include/render.h"
+#include "../include/simplify.h"
+#include "../include/grid.h"
+#include "../include/raster.h"
+#include "../include/stats.h"
+#include <string.h>
 #include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 // Cores configuráveis
 #define COLOR_BACKGROUND "#ffffff"
@@ -9,28 +24,31 @@
 #define COLOR_AXES       "#808080"
 #define COLOR_CURVE      "#0066cc"
 
-void render_csv(const PlotData *data) {
-    if (!data) return;
-    
-    printf("x,y\n");
-    for (int i = 0; i < data->count; i++) {
-        printf("%.6f,%.6f\n", data->x[i], data->y[i]);
-    }
-}
+// As mesmas cores para o raster (0xRRGGBB)
+#define RGB_BACKGROUND 0xffffff
+#define RGB_GRID_MAJOR 0xd0d0d0
+#define RGB_GRID_MINOR 0xe8e8e8
+#define RGB_AXES       0x808080
+#define RGB_CURVE      0x0066cc
 
-void render_svg(const PlotData *data, const char *title, int canvas_w, int canvas_h) {
-    if (!data || data->count == 0) return;
-    
-    // Dimensões do canvas e área de plotagem (20% margem, 10% cada lado)
-    const double CANVAS_W = (double)canvas_w;
-    const double CANVAS_H = (double)canvas_h;
-    const double PLOT_W = CANVAS_W * 0.8;   // 80% do canvas
-    const double PLOT_H = CANVAS_H * 0.8;   // 80% do canvas
-    const double MARGIN_X = (CANVAS_W - PLOT_W) / 2.0;
-    const double MARGIN_Y = (CANVAS_H - PLOT_H) / 2.0;
-    
+#define MAX_COORD 1e6  // Limite razoável para coordenadas
+
+/* Limites dos dados e área de plotagem em pixels */
+typedef struct {
+    double minx, maxx, miny, maxy;
+    double rangex, rangey;
+    double canvas_h, plot_w, plot_h, margin_x, margin_y;
+} Layout;
+
+// Transformação afim: coordenadas de dados -> pixels
+// px = MARGIN_X + (x - minx) * PLOT_W / rangex
+// py = (CANVAS_H - MARGIN_Y) - (y - miny) * PLOT_H / rangey
+#define TO_PX(l, x) ((l)->margin_x + ((x) - (l)->minx) * (l)->plot_w / (l)->rangex)
+#define TO_PY(l, y) (((l)->canvas_h - (l)->margin_y) - ((y) - (l)->miny) * (l)->plot_h / (l)->rangey)
+
+void render_bounds(const PlotData *data, RenderBounds *b) {
+    const int anterior = stats_enter(STATS_BOUNDS);
     // Calcula bounding box dos dados (com limite para evitar valores extremos)
-    #define MAX_COORD 1e6  // Limite razoável para coordenadas
     double minx = data->x[0], maxx = data->x[0];
     double miny = data->y[0], maxy = data->y[0];
     for (int i = 1; i < data->count; i++) {
@@ -47,134 +65,550 @@ void render_svg(const PlotData *data, const char *title, int canvas_w, int canva
         if (y > maxy) maxy = y;
     }
     
-    double rangex = maxx - minx;
-    double rangey = maxy - miny;
-    if (rangex < 0.01) rangex = 1.0;
-    if (rangey < 0.01) rangey = 1.0;
+    b->minx = minx;
+    b->maxx = maxx;
+    b->miny = miny;
+    b->maxy = maxy;
+    stats_leave(anterior);
+}
+
+static void calcular_layout(const RenderBounds *b, int canvas_w, int canvas_h, Layout *l) {
+    // Dimensões do canvas e área de plotagem (20% margem, 10% cada lado)
+    const double CANVAS_W = (double)canvas_w;
+    const double CANVAS_H = (double)canvas_h;
+    l->canvas_h = CANVAS_H;
+    l->plot_w = CANVAS_W * 0.8;   // 80% do canvas
+    l->plot_h = CANVAS_H * 0.8;   // 80% do canvas
+    l->margin_x = (CANVAS_W - l->plot_w) / 2.0;
+    l->margin_y = (CANVAS_H - l->plot_h) / 2.0;
+    
+    l->minx = b->minx;
+    l->maxx = b->maxx;
+    l->miny = b->miny;
+    l->maxy = b->maxy;
+    l->rangex = b->maxx - b->minx;
+    l->rangey = b->maxy - b->miny;
+    if (l->rangex < 0.01) l->rangex = 1.0;
+    if (l->rangey < 0.01) l->rangey = 1.0;
+}
+
+/* Recebe cada linha da grade ou dos eixos, em pixels */
+typedef void (*TracoGrade)(void *ctx, int vertical, double fixo, double de, double ate);
+
+/* Grade 1-2-5 sobre a área de plotagem: as linhas principais (principal = 1)
+ * ou os tics menores (principal = 0) */
+static void percorrer_grade(const Layout *l, int principal, TracoGrade traco, void *ctx) {
+    const double box_x0 = l->minx, box_x1 = l->minx + l->rangex;
+    const double box_y0 = l->miny, box_y1 = l->miny + l->rangey;
+    GridAxis gx, gy;
     
-    #undef MAX_COORD
+    // Linhas verticais (X)
+    if (grid_axis(box_x0, box_x1, l->plot_w, &gx)) {
+        for (long k = gx.first; k <= gx.last; k++) {
+            if ((k % gx.subdivisions == 0) != principal) continue;
+            traco(ctx, 1, TO_PX(l, k * gx.minor), TO_PY(l, box_y0), TO_PY(l, box_y1));
+        }
+    }
     
-    // Transformação afim: coordenadas de dados -> pixels
-    // px = MARGIN_X + (x - minx) * PLOT_W / rangex
-    // py = (CANVAS_H - MARGIN_Y) - (y - miny) * PLOT_H / rangey
-    #define TO_PX(x) (MARGIN_X + ((x) - minx) * PLOT_W / rangex)
-    #define TO_PY(y) ((CANVAS_H - MARGIN_Y) - ((y) - miny) * PLOT_H / rangey)
+    // Linhas horizontais (Y)
+    if (grid_axis(box_y0, box_y1, l->plot_h, &gy)) {
+        for (long k = gy.first; k <= gy.last; k++) {
+            if ((k % gy.subdivisions == 0) != principal) continue;
+            traco(ctx, 0, TO_PY(l, k * gy.minor), TO_PX(l, box_x0), TO_PX(l, box_x1));
+        }
+    }
+}
+
+/* Eixos em X=0 e Y=0, quando visíveis. Retorna quantos. */
+static int percorrer_eixos(const Layout *l, TracoGrade traco, void *ctx) {
+    const double box_x0 = l->minx, box_x1 = l->minx + l->rangex;
+    const double box_y0 = l->miny, box_y1 = l->miny + l->rangey;
+    int n = 0;
     
+    if (box_x0 <= 0 && box_x1 >= 0) {
+        // Eixo Y (vertical em X=0)
+        if (traco) traco(ctx, 1, TO_PX(l, 0), TO_PY(l, box_y0), TO_PY(l, box_y1));
+        n++;
+    }
+    if (box_y0 <= 0 && box_y1 >= 0) {
+        // Eixo X (horizontal em Y=0)
+        if (traco) traco(ctx, 0, TO_PY(l, 0), TO_PX(l, box_x0), TO_PX(l, box_x1));
+        n++;
+    }
+    return n;
+}
+
+/* Trechos "Mx yVy2" e "Mx yHx2" do atributo d de um <path>, duas casas */
+static void segmento_svg(void *ctx, int vertical, double fixo, double de, double ate) {
+    OutBuf *out = ctx;
+    outbuf_char(out, 'M');
+    outbuf_fixed(out, vertical ? fixo : de, 2);
+    outbuf_char(out, ' ');
+    outbuf_fixed(out, vertical ? de : fixo, 2);
+    outbuf_char(out, vertical ? 'V' : 'H');
+    outbuf_fixed(out, ate, 2);
+}
+
+typedef struct {
+    Raster *r;
+    double largura;
+} TracoRaster;
+
+static void segmento_raster(void *ctx, int vertical, double fixo, double de, double ate) {
+    TracoRaster *t = ctx;
+    if (vertical) {
+        raster_stroke(t->r, fixo, de, fixo, ate, t->largura);
+    } else {
+        raster_stroke(t->r, de, fixo, ate, fixo, t->largura);
+    }
+}
+
+#define POLYLINE_INICIO "  <polyline fill=\"none\" stroke=\"" COLOR_CURVE "\" stroke-width=\"2\" points=\""
+#define POLYLINE_FIM    "\"/>\n"
+
+/* Estado da curva entre um bloco de pontos e o seguinte. Os pontos passam
+ * pelo filtro (finitos, dentro dos limites), vão para pixels e entram no
+ * SimplifyStream; cada vértice decidido é escrito na <polyline> (ou traçado
+ * do anterior, no raster). Em trechos, cada trecho é uma polilinha própria e
+ * o primeiro vértice só sai quando vem o segundo: trechos de um ponto não
+ * são desenhados. */
+struct RenderStream {
+    OutBuf *out;
+    RenderFormat format;
+    Layout lay;
+    Raster *r;
+    int segmentada;
+    SimplifyStream simp;
+    int quebrou;            /* O próximo ponto começa um trecho */
+    long linhas;            /* CSV: pontos escritos */
+    int vertices;           /* Vértices decididos no trecho atual */
+    int desenhados;         /* Vértices escritos/traçados no trecho atual */
+    double pend_x, pend_y;  /* Primeiro vértice do trecho, em espera */
+    double ux, uy;          /* Último vértice desenhado */
+    RenderStats stats;
+};
+
+static void desenhar(RenderStream *rs, double x, double y) {
+    if (rs->format == RENDER_SVG) {
+        if (rs->segmentada && rs->desenhados == 0) outbuf_puts(rs->out, POLYLINE_INICIO);
+        outbuf_fixed(rs->out, x, 2);
+        outbuf_char(rs->out, ',');
+        outbuf_fixed(rs->out, y, 2);
+        outbuf_char(rs->out, ' ');
+    } else if (rs->desenhados > 0) {
+        raster_stroke(rs->r, rs->ux, rs->uy, x, y, 2.0);
+    }
+    rs->ux = x;
+    rs->uy = y;
+    rs->desenhados++;
+    rs->stats.points_out++;
+}
+
+static void vertice(RenderStream *rs, double x, double y) {
+    if (rs->segmentada && rs->vertices == 0) {
+        rs->pend_x = x;
+        rs->pend_y = y;
+    } else {
+        if (rs->segmentada && rs->vertices == 1) desenhar(rs, rs->pend_x, rs->pend_y);
+        desenhar(rs, x, y);
+    }
+    rs->vertices++;
+}
+
+static void fechar_trecho(RenderStream *rs) {
+    double vx, vy;
+    if (simplify_stream_finish(&rs->simp, &vx, &vy)) vertice(rs, vx, vy);
+    if (rs->segmentada && rs->desenhados > 0 && rs->format == RENDER_SVG) outbuf_puts(rs->out, POLYLINE_FIM);
+    rs->vertices = rs->desenhados = 0;
+}
+
+RenderStream *render_stream_begin(OutBuf *out, RenderFormat format, const RenderBounds *bounds,
+                                  const char *title, int canvas_w, int canvas_h, double tolerance,
+                                  int segmented) {
+    if (format == RENDER_BIN) return NULL;
+    RenderStream *rs = calloc(1, sizeof(RenderStream));
+    if (!rs) {
+        out->error = 1;
+        return NULL;
+    }
+    rs->out = out;
+    rs->format = format;
+    rs->segmentada = segmented;
+    rs->quebrou = 1;
+    simplify_stream_init(&rs->simp, tolerance);
+
+    if (format == RENDER_CSV) {
+        outbuf_puts(out, "x,y\n");
+        return rs;
+    }
+
+    calcular_layout(bounds, canvas_w, canvas_h, &rs->lay);
+    const Layout *l = &rs->lay;
+    if (format != RENDER_SVG) {
+        // Mesmo layout, cores e espessuras do SVG, antialiasado
+        rs->r = raster_create(canvas_w, canvas_h, RGB_BACKGROUND);
+        if (!rs->r) {
+            free(rs);
+            return NULL;
+        }
+        TracoRaster t = { rs->r, 1.0 };
+        percorrer_grade(l, 1, segmento_raster, &t);
+        raster_fill(rs->r, RGB_GRID_MAJOR);
+        t.largura = 0.5;
+        percorrer_grade(l, 0, segmento_raster, &t);
+        raster_fill(rs->r, RGB_GRID_MINOR);
+        t.largura = 2.0;
+        percorrer_eixos(l, segmento_raster, &t);
+        raster_fill(rs->r, RGB_AXES);
+        return rs;
+    }
+
     // Header SVG
-    printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-    printf("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n", canvas_w, canvas_h);
+    outbuf_puts(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    outbuf_puts(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    outbuf_int(out, canvas_w);
+    outbuf_puts(out, "\" height=\"");
+    outbuf_int(out, canvas_h);
+    outbuf_puts(out, "\">\n");
     
     if (title) {
-        printf("  <title>%s</title>\n", title);
+        outbuf_puts(out, "  <title>");
+        outbuf_puts(out, title);
+        outbuf_puts(out, "</title>\n");
     }
     
     // Fundo branco
-    printf("  <rect width=\"%d\" height=\"%d\" fill=\"%s\"/>\n", canvas_w, canvas_h, COLOR_BACKGROUND);
+    outbuf_puts(out, "  <rect width=\"");
+    outbuf_int(out, canvas_w);
+    outbuf_puts(out, "\" height=\"");
+    outbuf_int(out, canvas_h);
+    outbuf_puts(out, "\" fill=\"" COLOR_BACKGROUND "\"/>\n");
     
-    // Grade principal (1.0 em 1.0)
-    printf("  <g stroke=\"%s\" stroke-width=\"1\">\n", COLOR_GRID_MAJOR);
-    
-    // Linhas verticais (X)
-    int x_start = (int)floor(minx);
-    int x_end = (int)ceil(maxx);
-    for (int ix = x_start; ix <= x_end; ix++) {
-        double x = (double)ix;
-        double px = TO_PX(x);
-        double py_bottom = TO_PY(miny);
-        double py_top = TO_PY(maxy);
-        printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-               px, py_bottom, px, py_top);
+    // Grade, um <path> por nível: principal (stroke 1) e tics menores (stroke 0.5)
+    for (int principal = 1; principal >= 0; principal--) {
+        outbuf_puts(out, principal ? "  <path stroke=\"" COLOR_GRID_MAJOR "\" stroke-width=\"1\""
+                                   : "  <path stroke=\"" COLOR_GRID_MINOR "\" stroke-width=\"0.5\"");
+        outbuf_puts(out, " fill=\"none\" d=\"");
+        percorrer_grade(l, principal, segmento_svg, out);
+        outbuf_puts(out, "\"/>\n");
     }
     
-    // Linhas horizontais (Y)
-    int y_start = (int)floor(miny);
-    int y_end = (int)ceil(maxy);
-    for (int iy = y_start; iy <= y_end; iy++) {
-        double y = (double)iy;
-        double py = TO_PY(y);
-        double px_left = TO_PX(minx);
-        double px_right = TO_PX(maxx);
-        printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-               px_left, py, px_right, py);
-    }
-    
-    printf("  </g>\n");
-    
-    // Tics menores (0.2 em 0.2)
-    printf("  <g stroke=\"%s\" stroke-width=\"0.5\">\n", COLOR_GRID_MINOR);
-    
-    // Tics verticais
-    double x_tic_start = ceil(minx / 0.2) * 0.2;
-    for (double xt = x_tic_start; xt <= maxx + 0.01; xt += 0.2) {
-        // Pula múltiplos de 1.0
-        if (fabs(xt - round(xt)) < 0.01) continue;
-        double px = TO_PX(xt);
-        double py_bottom = TO_PY(miny);
-        double py_top = TO_PY(maxy);
-        printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-               px, py_bottom, px, py_top);
-    }
-    
-    // Tics horizontais
-    double y_tic_start = ceil(miny / 0.2) * 0.2;
-    for (double yt = y_tic_start; yt <= maxy + 0.01; yt += 0.2) {
-        // Pula múltiplos de 1.0
-        if (fabs(yt - round(yt)) < 0.01) continue;
-        double py = TO_PY(yt);
-        double px_left = TO_PX(minx);
-        double px_right = TO_PX(maxx);
-        printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-               px_left, py, px_right, py);
-    }
-    
-    printf("  </g>\n");
-    
     // Eixos em X=0 e Y=0 (destacados)
-    int x_zero_visible = (minx <= 0 && maxx >= 0);
-    int y_zero_visible = (miny <= 0 && maxy >= 0);
-    
-    if (x_zero_visible || y_zero_visible) {
-        printf("  <g stroke=\"%s\" stroke-width=\"2\">\n", COLOR_AXES);
-        
-        if (y_zero_visible) {
-            // Eixo Y (vertical em X=0)
-            double px = TO_PX(0);
-            double py_bottom = TO_PY(miny);
-            double py_top = TO_PY(maxy);
-            printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-                   px, py_bottom, px, py_top);
+    if (percorrer_eixos(l, NULL, NULL) > 0) {
+        outbuf_puts(out, "  <path stroke=\"" COLOR_AXES "\" stroke-width=\"2\" fill=\"none\" d=\"");
+        percorrer_eixos(l, segmento_svg, out);
+        outbuf_puts(out, "\"/>\n");
+    }
+
+    // Sem trechos, uma <polyline> só, mesmo vazia
+    if (!segmented) outbuf_puts(out, POLYLINE_INICIO);
+    return rs;
+}
+
+void render_stream_points(RenderStream *rs, const PlotData *block) {
+    const Layout *l = &rs->lay;
+    int amostra = 0;
+    for (int i = 0; i < block->count; i++) {
+        double x = block->x[i];
+        double y = block->y[i];
+        // Em trechos, amostras sem ponto levantam a caneta
+        if (rs->segmentada) {
+            while (!PLOT_DATA_VALID(block, amostra)) {
+                rs->quebrou = 1;
+                amostra++;
+            }
+            amostra++;
         }
-        
-        if (x_zero_visible) {
-            // Eixo X (horizontal em Y=0)
-            double py = TO_PY(0);
-            double px_left = TO_PX(minx);
-            double px_right = TO_PX(maxx);
-            printf("    <line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\"/>\n",
-                   px_left, py, px_right, py);
+
+        if (rs->format == RENDER_CSV) {
+            // Linha vazia onde a caneta levanta
+            if (rs->segmentada && rs->quebrou && rs->linhas > 0) outbuf_char(rs->out, '\n');
+            rs->quebrou = 0;
+            outbuf_fixed(rs->out, x, 6);
+            outbuf_char(rs->out, ',');
+            outbuf_fixed(rs->out, y, 6);
+            outbuf_char(rs->out, '\n');
+            rs->linhas++;
+            continue;
         }
         
-        printf("  </g>\n");
+        // Pula pontos com valores extremos
+        if (!isfinite(x) || !isfinite(y) ||
+            x < l->minx || x > l->maxx || y < l->miny || y > l->maxy) {
+            rs->quebrou = 1;
+            continue;
+        }
+        if (rs->segmentada && rs->quebrou) fechar_trecho(rs);
+        rs->quebrou = 0;
+        rs->stats.points_in++;
+
+        double vx, vy;
+        if (simplify_stream_push(&rs->simp, TO_PX(l, x), TO_PY(l, y), &vx, &vy)) vertice(rs, vx, vy);
+    }
+    // Amostras sem ponto no fim do bloco separam do próximo
+    if (rs->segmentada && amostra < block->evaluations) rs->quebrou = 1;
+}
+
+int render_stream_end(RenderStream *rs, RenderStats *stats) {
+    int ok = 1;
+    if (rs->format == RENDER_CSV) {
+        rs->stats.points_in = rs->stats.points_out = (int)rs->linhas;
+    } else {
+        fechar_trecho(rs);
+    }
+    if (rs->format == RENDER_SVG) {
+        if (!rs->segmentada) outbuf_puts(rs->out, POLYLINE_FIM);
+        outbuf_puts(rs->out, "</svg>\n");
+    } else if (rs->r) {
+        raster_fill(rs->r, RGB_CURVE);
+        if (rs->format == RENDER_PPM) {
+            ok = raster_write_ppm(rs->out, rs->r);
+        } else if (rs->format == RENDER_PBM) {
+            ok = raster_write_pbm(rs->out, rs->r);
+        } else {
+            ok = raster_write_png(rs->out, rs->r);
+        }
+        raster_free(rs->r);
+    }
+    if (stats) *stats = rs->stats;
+    free(rs);
+    return ok;
+}
+
+void render_csv_out(OutBuf *out, const PlotData *data) {
+    if (!data) return;
+    RenderStream *rs = render_stream_begin(out, RENDER_CSV, NULL, NULL, 0, 0, 0.0, data->segmented);
+    if (!rs) return;
+    render_stream_points(rs, data);
+    render_stream_end(rs, NULL);
+}
+
+void render_svg_out(OutBuf *out, const PlotData *data, const char *title, int canvas_w, int canvas_h,
+                    double tolerance, RenderStats *stats) {
+    if (stats) stats->points_in = stats->points_out = 0;
+    if (!data || data->count == 0) return;
+    
+    RenderBounds b;
+    render_bounds(data, &b);
+    RenderStream *rs = render_stream_begin(out, RENDER_SVG, &b, title, canvas_w, canvas_h, tolerance,
+                                           data->segmented);
+    if (!rs) return;
+    render_stream_points(rs, data);
+    render_stream_end(rs, stats);
+}
+
+/* ---- Varreduras (plot_generate_frames) ---- */
+
+int render_bounds_frames(const PlotData *frames, int count, RenderBounds *b) {
+    int achou = 0;
+    for (int f = 0; f < count; f++) {
+        if (frames[f].count == 0) continue;
+        RenderBounds q;
+        render_bounds(&frames[f], &q);
+        if (!achou) {
+            *b = q;
+            achou = 1;
+            continue;
+        }
+        b->minx = fmin(b->minx, q.minx);
+        b->maxx = fmax(b->maxx, q.maxx);
+        b->miny = fmin(b->miny, q.miny);
+        b->maxy = fmax(b->maxy, q.maxy);
+    }
+    return achou;
+}
+
+int render_frame_out(OutBuf *out, const PlotData *data, RenderFormat format, const RenderBounds *bounds,
+                     const char *title, int canvas_w, int canvas_h, double tolerance, RenderStats *stats) {
+    if (stats) stats->points_in = stats->points_out = 0;
+    if (format != RENDER_SVG && format != RENDER_PPM && format != RENDER_PBM && format != RENDER_PNG) return 0;
+    RenderStream *rs = render_stream_begin(out, format, bounds, (format == RENDER_SVG) ? title : NULL, canvas_w,
+                                           canvas_h, tolerance, data->segmented);
+    if (!rs) return 0;
+    render_stream_points(rs, data);
+    return render_stream_end(rs, stats);
+}
+
+/* Curva de um quadro do SVG animado, com o estado da curva zerado antes */
+static void curva_do_quadro(RenderStream *rs, const PlotData *data, double tolerance) {
+    rs->segmentada = data->segmented;
+    rs->quebrou = 1;
+    rs->vertices = rs->desenhados = 0;
+    simplify_stream_init(&rs->simp, tolerance);
+    if (!rs->segmentada) outbuf_puts(rs->out, POLYLINE_INICIO);
+    render_stream_points(rs, data);
+    fechar_trecho(rs);
+    if (!rs->segmentada) outbuf_puts(rs->out, POLYLINE_FIM);
+}
+
+void render_svg_animation_out(OutBuf *out, const PlotData *frames, int count, const RenderBounds *bounds,
+                              const char *title, int canvas_w, int canvas_h, double tolerance, double fps,
+                              RenderStats *stats) {
+    if (stats) stats->points_in = stats->points_out = 0;
+    if (count < 1 || !(fps > 0)) return;
+    // Cabeçalho, grade e eixos (segmented = 1: as polylines ficam por quadro)
+    RenderStream *rs = render_stream_begin(out, RENDER_SVG, bounds, title, canvas_w, canvas_h, tolerance, 1);
+    if (!rs) return;
+
+    for (int f = 0; f < count; f++) {
+        // Visível em [f/count, (f+1)/count) do ciclo; o primeiro já começa visível
+        outbuf_puts(out, f ? "  <g visibility=\"hidden\">\n" : "  <g>\n");
+        outbuf_puts(out, "    <animate attributeName=\"visibility\" calcMode=\"discrete\" "
+                         "repeatCount=\"indefinite\" dur=\"");
+        outbuf_fixed(out, count / fps, 3);
+        outbuf_puts(out, f ? "s\" values=\"hidden;visible;hidden\" keyTimes=\"0;"
+                           : "s\" values=\"visible;hidden\" keyTimes=\"0;");
+        if (f) {
+            outbuf_fixed(out, (double)f / count, 6);
+            outbuf_char(out, ';');
+        }
+        outbuf_fixed(out, (double)(f + 1) / count, 6);
+        outbuf_puts(out, "\"/>\n");
+        curva_do_quadro(rs, &frames[f], tolerance);
+        outbuf_puts(out, "  </g>\n");
+    }
+
+    // Polylines já fechadas: o fim só escreve </svg>
+    rs->segmentada = 1;
+    render_stream_end(rs, stats);
+}
+
+/* ---- Raster ---- */
+
+/* Modo ZX81 do Referencia/CURVAS.bas: 64x44 blocos (PLOT), escala
+ * isotrópica K = 21/AUX com AUX o maior |x| ou |y| (linhas 2030-2060 e
+ * 2560-2580), origem no bloco (31,21) e os "+" das linhas 2500-2550. Cada
+ * bloco tem 4x4 pixels da tela do ZX81 (256x176), ampliada pelo maior fator
+ * inteiro que cabe no canvas. */
+#define ZX81_BLOCOS_X 64
+#define ZX81_BLOCOS_Y 44
+#define ZX81_TELA_W   256
+#define ZX81_TELA_H   176
+
+static const unsigned char ZX81_MAIS[8] = { 0x00, 0x00, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x00 };
+static const int ZX81_POS_MAIS[5][2] = { { 11, 15 }, { 0, 15 }, { 11, 3 }, { 21, 15 }, { 11, 27 } };
+
+static Raster *rasterizar_zx81(const PlotData *data, int canvas_w, int canvas_h, RenderStats *stats) {
+    int escala = canvas_w / ZX81_TELA_W;
+    if (canvas_h / ZX81_TELA_H < escala) escala = canvas_h / ZX81_TELA_H;
+    if (escala < 1) escala = 1;
+    
+    Raster *r = raster_create(ZX81_TELA_W * escala, ZX81_TELA_H * escala, 0xffffff);
+    if (!r) return NULL;
+    
+    // PRINT AT linha,coluna;"+" (caractere de 8x8 pixels)
+    for (int p = 0; p < 5; p++) {
+        for (int lin = 0; lin < 8; lin++) {
+            for (int bit = 0; bit < 8; bit++) {
+                if (!(ZX81_MAIS[lin] & (0x80 >> bit))) continue;
+                raster_rect(r, (ZX81_POS_MAIS[p][1] * 8 + bit) * escala,
+                            (ZX81_POS_MAIS[p][0] * 8 + lin) * escala, escala, escala, 0x000000);
+            }
+        }
     }
     
-    // Curva (filtra pontos com valores extremos)
-    printf("  <polyline fill=\"none\" stroke=\"%s\" stroke-width=\"2\" points=\"", COLOR_CURVE);
+    double aux = 0.0;
+    int validos = 0;
     for (int i = 0; i < data->count; i++) {
-        double x = data->x[i];
-        double y = data->y[i];
-        
-        // Pula pontos com valores extremos
-        if (!isfinite(x) || !isfinite(y)) continue;
-        if (x < minx || x > maxx || y < miny || y > maxy) continue;
-        
-        double px = TO_PX(x);
-        double py = TO_PY(y);
-        printf("%.2f,%.2f ", px, py);
+        if (!isfinite(data->x[i]) || !isfinite(data->y[i])) continue;
+        if (fabs(data->x[i]) > aux) aux = fabs(data->x[i]);
+        if (fabs(data->y[i]) > aux) aux = fabs(data->y[i]);
+        validos++;
     }
-    printf("\"/>\n");
+    const double K = aux > 0.0 ? 21.0 / aux : 0.0;
     
-    printf("</svg>\n");
+    // PLOT A(N)*K+31,B(N)*K+21: o ZX81 arredonda para o inteiro mais próximo
+    // e recusa coordenadas fora da tela
+    int plotados = 0;
+    const int bloco = 4 * escala;
+    for (int i = 0; i < data->count; i++) {
+        if (!isfinite(data->x[i]) || !isfinite(data->y[i])) continue;
+        double bx = floor(data->x[i] * K + 31.0 + 0.5);
+        double by = floor(data->y[i] * K + 21.0 + 0.5);
+        if (bx < 0 || bx >= ZX81_BLOCOS_X || by < 0 || by >= ZX81_BLOCOS_Y) continue;
+        raster_rect(r, (int)bx * bloco, (ZX81_BLOCOS_Y - 1 - (int)by) * bloco, bloco, bloco, 0x000000);
+        plotados++;
+    }
     
-    #undef TO_PX
-    #undef TO_PY
+    if (stats) {
+        stats->points_in = validos;
+        stats->points_out = plotados;
+    }
+    return r;
+}
+
+int render_raster_out(OutBuf *out, const PlotData *data, RenderFormat format, int canvas_w, int canvas_h,
+                      double tolerance, int zx81, RenderStats *stats) {
+    if (stats) stats->points_in = stats->points_out = 0;
+    if (!data || data->count == 0) return 1;
+    if (format != RENDER_PPM && format != RENDER_PBM && format != RENDER_PNG) return 0;
+    
+    if (!zx81) {
+        RenderBounds b;
+        render_bounds(data, &b);
+        RenderStream *rs = render_stream_begin(out, format, &b, NULL, canvas_w, canvas_h, tolerance,
+                                               data->segmented);
+        if (!rs) return 0;
+        render_stream_points(rs, data);
+        return render_stream_end(rs, stats);
+    }
+
+    Raster *r = rasterizar_zx81(data, canvas_w, canvas_h, stats);
+    if (!r) return 0;
+    
+    int ok = 0;
+    if (format == RENDER_PPM) {
+        ok = raster_write_ppm(out, r);
+    } else if (format == RENDER_PBM) {
+        ok = raster_write_pbm(out, r);
+    } else if (format == RENDER_PNG) {
+        ok = raster_write_png(out, r);
+    }
+    raster_free(r);
+    return ok;
+}
+
+int render_format_parse(const char *name, RenderFormat *format) {
+    static const struct { const char *nome; RenderFormat formato; } FORMATOS[] = {
+        { "csv", RENDER_CSV }, { "svg", RENDER_SVG }, { "ppm", RENDER_PPM },
+        { "pbm", RENDER_PBM }, { "png", RENDER_PNG }, { "bin", RENDER_BIN }
+    };
+    for (size_t i = 0; i < sizeof(FORMATOS) / sizeof(FORMATOS[0]); i++) {
+        if (strcmp(name, FORMATOS[i].nome) == 0) {
+            *format = FORMATOS[i].formato;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void render_csv_file(FILE *out, const PlotData *data) {
+    OutBuf ob;
+    if (!outbuf_init_file(&ob, out, 0)) return;
+    render_csv_out(&ob, data);
+    outbuf_close(&ob);
+}
+
+void render_svg_file(FILE *out, const PlotData *data, const char *title, int canvas_w, int canvas_h) {
+    OutBuf ob;
+    if (!outbuf_init_file(&ob, out, 0)) return;
+    render_svg_out(&ob, data, title, canvas_w, canvas_h, RENDER_SIMPLIFY_TOLERANCE, NULL);
+    outbuf_close(&ob);
+}
+
+/* stdout vai direto pelo fd 1, sem passar pelo buffer do stdio */
+void render_csv(const PlotData *data) {
+    OutBuf ob;
+    fflush(stdout);
+    if (!outbuf_init_fd(&ob, STDOUT_FILENO, 0)) return;
+    render_csv_out(&ob, data);
+    outbuf_close(&ob);
+}
+
+void render_svg(const PlotData *data, const char *title, int canvas_w, int canvas_h) {
+    OutBuf ob;
+    fflush(stdout);
+    if (!outbuf_init_fd(&ob, STDOUT_FILENO, 0)) return;
+    render_svg_out(&ob, data, title, canvas_w, canvas_h, RENDER_SIMPLIFY_TOLERANCE, NULL);
+    outbuf_close(&ob);
 }
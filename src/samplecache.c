@@ -0,0 +1,173 @@
+/* Amostras já avaliadas de uma curva (ver include/samplecache.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/samplecache.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SampleCache {
+    pthread_mutex_t lock;
+    double *t, *x, *y;          /* Em ordem crescente de t, sem repetição */
+    unsigned char *ok;
+    int count;
+    int capacity;
+};
+
+SampleCache *samplecache_create(void) {
+    SampleCache *c = calloc(1, sizeof(SampleCache));
+    if (!c) return NULL;
+    if (pthread_mutex_init(&c->lock, NULL) != 0) {
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void esvaziar(SampleCache *c) {
+    free(c->t);
+    free(c->x);
+    free(c->y);
+    free(c->ok);
+    c->t = c->x = c->y = NULL;
+    c->ok = NULL;
+    c->count = c->capacity = 0;
+}
+
+void samplecache_free(void *cache) {
+    SampleCache *c = cache;
+    if (!c) return;
+    esvaziar(c);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+/* Primeiro índice em [lo, count) com t >= v */
+static int limite_inferior(const double *t, int lo, int count, double v) {
+    int hi = count;
+    while (lo < hi) {
+        int m = lo + (hi - lo) / 2;
+        if (t[m] < v) lo = m + 1;
+        else hi = m;
+    }
+    return lo;
+}
+
+/* Como limite_inferior a partir de j, em passos dobrados: num pedido mais
+ * esparso que o cache (zoom out) não percorre os pontos do meio um a um. */
+static int avancar(const double *t, int count, int j, double v) {
+    if (j >= count || t[j] >= v) return j;
+    int passo = 1;
+    while (j + passo < count && t[j + passo] < v) {
+        j += passo;
+        passo *= 2;
+    }
+    const int fim = (j + passo < count) ? j + passo + 1 : count;
+    return limite_inferior(t, j + 1, fim, v);
+}
+
+int samplecache_lookup(SampleCache *cache, const double *ts, int n, double *x, double *y,
+                       unsigned char *ok, int *faltas) {
+    int m = 0;
+    pthread_mutex_lock(&cache->lock);
+    const double *t = cache->t;
+    const int count = cache->count;
+    for (int i = 0, j = 0; i < n; i++) {
+        j = (i == 0 || ts[i] < ts[i - 1]) ? limite_inferior(t, 0, count, ts[i])
+                                          : avancar(t, count, j, ts[i]);
+        if (j < count && t[j] == ts[i]) {
+            x[i] = cache->x[j];
+            y[i] = cache->y[j];
+            ok[i] = cache->ok[j];
+        } else {
+            faltas[m++] = i;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return m;
+}
+
+/* Garante espaço para `n` amostras sem passar de `max` (em amostras). */
+static int garantir(SampleCache *c, int n, int max) {
+    if (n <= c->capacity) return 1;
+    int cap = c->capacity + c->capacity / 2;
+    if (cap < n) cap = n;
+    if (cap > max) cap = max;
+
+    double *t = realloc(c->t, (size_t)cap * sizeof(double));
+    if (t) c->t = t;
+    double *x = realloc(c->x, (size_t)cap * sizeof(double));
+    if (x) c->x = x;
+    double *y = realloc(c->y, (size_t)cap * sizeof(double));
+    if (y) c->y = y;
+    unsigned char *ok = realloc(c->ok, (size_t)cap);
+    if (ok) c->ok = ok;
+    if (!t || !x || !y || !ok) return 0;
+    c->capacity = cap;
+    return 1;
+}
+
+size_t samplecache_insert(SampleCache *cache, const double *ts, const double *x, const double *y,
+                          const unsigned char *ok, int n, size_t max_bytes) {
+    int crescente = 1;
+    for (int i = 1; i < n && crescente; i++) crescente = ts[i] > ts[i - 1];
+    size_t max = max_bytes / SAMPLECACHE_BYTES(1);
+    if (max > INT_MAX) max = INT_MAX;
+
+    SampleCache *c = cache;
+    pthread_mutex_lock(&c->lock);
+    if (crescente && n > 0) {
+        int novos = 0;
+        for (int i = 0, j = limite_inferior(c->t, 0, c->count, ts[0]); i < n; i++) {
+            j = avancar(c->t, c->count, j, ts[i]);
+            if (j >= c->count || c->t[j] != ts[i]) novos++;
+        }
+        const size_t total = (size_t)c->count + novos;
+
+        if (total > max) {
+            // O que já estava sai: fica a geração atual, que é o que está na tela
+            esvaziar(c);
+            if ((size_t)n <= max && garantir(c, n, n)) {
+                memcpy(c->t, ts, (size_t)n * sizeof(double));
+                memcpy(c->x, x, (size_t)n * sizeof(double));
+                memcpy(c->y, y, (size_t)n * sizeof(double));
+                memcpy(c->ok, ok, (size_t)n);
+                c->count = n;
+            }
+        } else if (novos > 0 && garantir(c, (int)total, (int)max)) {
+            // Intercala de trás para frente, no lugar: o que fica antes da
+            // primeira amostra nova não se move (pan para a direita só anexa)
+            int i = n - 1, j = c->count - 1, k = (int)total - 1;
+            while (i >= 0) {
+                int de_cache = j >= 0 && c->t[j] >= ts[i];
+                if (de_cache) {
+                    if (c->t[j] == ts[i]) i--;
+                    c->t[k] = c->t[j];
+                    c->x[k] = c->x[j];
+                    c->y[k] = c->y[j];
+                    c->ok[k] = c->ok[j];
+                    j--;
+                } else {
+                    c->t[k] = ts[i];
+                    c->x[k] = x[i];
+                    c->y[k] = y[i];
+                    c->ok[k] = ok[i];
+                    i--;
+                }
+                k--;
+            }
+            c->count = (int)total;
+        }
+    }
+    const size_t bytes = sizeof(SampleCache) + SAMPLECACHE_BYTES(c->capacity);
+    pthread_mutex_unlock(&c->lock);
+    return bytes;
+}
+
+size_t samplecache_bytes(SampleCache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    const size_t bytes = sizeof(SampleCache) + SAMPLECACHE_BYTES(cache->capacity);
+    pthread_mutex_unlock(&cache->lock);
+    return bytes;
+}
@@ -0,0 +1,559 @@
+/* Servidor de renderização num socket local (ver include/server.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_EVENTS 64   /* Eventos por epoll_wait */
+
+typedef struct Conexao {
+    int fd;
+    char entrada[SERVER_MAX_LINE];   /* Bytes lidos e ainda não atendidos */
+    int usados;
+    int fim;                 /* O cliente fechou o envio (ou a leitura falhou) */
+    double chegada;          /* Quando as linhas em espera ficaram completas */
+    double prazo;            /* Do pedido em atendimento */
+    int estourou;            /* O prazo acabou antes de um pedaço sair */
+    int quebrada;            /* Um envio falhou no meio: o enquadramento se perdeu */
+    struct Conexao *fila;    /* Próxima na fila dos workers */
+    struct Conexao *ant, *prox;   /* Lista das conexões abertas */
+} Conexao;
+
+typedef struct {
+    const ServerConfig *config;
+    double prazo;            /* config->timeout_ms em segundos */
+    int max_conexoes;
+    int tcp;
+    int epoll;
+    int escuta;
+    int aviso[2];            /* server_stop() escreve em aviso[1] */
+
+    pthread_mutex_t lock;
+    pthread_cond_t tem_trabalho;
+    Conexao *inicio, *fim;   /* Fila de conexões com pedido completo */
+    Conexao *abertas;
+    int n_abertas;
+    int encerrando;
+    ServerStats stats;
+} Servidor;
+
+/* Estado de um worker, reaproveitado de um pedido para o outro */
+typedef struct {
+    Servidor *srv;
+    PlotData dados;
+    OutBuf out;
+    char linha[SERVER_MAX_LINE + 1];
+    ServerStats stats;
+} Worker;
+
+/* Marcas do epoll para o que não é conexão */
+static char marca_escuta, marca_aviso;
+
+/* Lado de escrita do aviso do servidor em execução (-1 se nenhum) */
+static volatile int aviso_fd = -1;
+
+double server_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void server_stop(void) {
+    int fd = aviso_fd;
+    if (fd >= 0) {
+        ssize_t r = write(fd, "x", 1);
+        (void)r;
+    }
+}
+
+static void tratar_sinal(int sinal) {
+    (void)sinal;
+    server_stop();
+}
+
+static int falha(char **errmsg, const char *msg) {
+    if (errmsg) {
+        char tmp[256];
+        snprintf(tmp, sizeof(tmp), "%s: %s", msg, strerror(errno));
+        *errmsg = strdup(tmp);
+    }
+    return 0;
+}
+
+static int sem_bloqueio(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/* Abre o socket de escuta. Retorna o fd ou -1. */
+static int escutar(const char *endereco, int *tcp, char **errmsg) {
+    int fd;
+    *tcp = strncmp(endereco, "tcp:", 4) == 0;
+    if (*tcp) {
+        char *fim;
+        long porta = strtol(endereco + 4, &fim, 10);
+        if (fim == endereco + 4 || *fim || porta < 1 || porta > 65535) {
+            if (errmsg) *errmsg = strdup("porta TCP inválida (use tcp:<1..65535>)");
+            return -1;
+        }
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((unsigned short)porta);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            falha(errmsg, "socket");
+            return -1;
+        }
+        int um = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            falha(errmsg, "não foi possível escutar na porta");
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(endereco) >= sizeof(sa.sun_path)) {
+            if (errmsg) *errmsg = strdup("caminho do socket longo demais");
+            return -1;
+        }
+        strcpy(sa.sun_path, endereco);
+
+        // Um socket que sobrou de uma execução anterior é trocado; outro arquivo, não
+        struct stat st;
+        if (lstat(endereco, &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                if (errmsg) *errmsg = strdup("o caminho já existe e não é um socket");
+                return -1;
+            }
+            unlink(endereco);
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            falha(errmsg, "socket");
+            return -1;
+        }
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            falha(errmsg, "não foi possível criar o socket");
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) != 0 || !sem_bloqueio(fd)) {
+        falha(errmsg, "listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* ---- Conexões ---- */
+
+/* Devolve a conexão ao epoll (depois disso quem chamou não toca mais nela).
+ * O epoll_ctl fica dentro do mutex, e o laço passa pelo mutex ao receber o
+ * evento (em ler()): o que o worker fez na conexão fica ordenado antes do
+ * que o laço vai fazer sem depender só do kernel (e o TSan enxerga). */
+static void rearmar(Servidor *srv, Conexao *c) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = c;
+    pthread_mutex_lock(&srv->lock);
+    epoll_ctl(srv->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+/* Fecha e libera. Só quem tem a conexão (o laço ou um worker) chama. */
+static void fechar(Servidor *srv, Conexao *c) {
+    pthread_mutex_lock(&srv->lock);
+    if (c->ant) c->ant->prox = c->prox;
+    else srv->abertas = c->prox;
+    if (c->prox) c->prox->ant = c->ant;
+    srv->n_abertas--;
+    pthread_mutex_unlock(&srv->lock);
+    close(c->fd);
+    free(c);
+}
+
+static void aceitar(Servidor *srv) {
+    for (;;) {
+        int fd = accept(srv->escuta, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (!sem_bloqueio(fd)) {
+            close(fd);
+            continue;
+        }
+        if (srv->tcp) {
+            int um = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+        }
+
+        Conexao *c = NULL;
+        pthread_mutex_lock(&srv->lock);
+        if (srv->n_abertas < srv->max_conexoes && (c = calloc(1, sizeof(Conexao)))) {
+            c->fd = fd;
+            c->prox = srv->abertas;
+            if (c->prox) c->prox->ant = c;
+            srv->abertas = c;
+            srv->n_abertas++;
+            srv->stats.connections++;
+        } else {
+            srv->stats.rejected++;
+        }
+        pthread_mutex_unlock(&srv->lock);
+        if (!c) {
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = c;
+        if (epoll_ctl(srv->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) fechar(srv, c);
+    }
+}
+
+static void enfileirar(Servidor *srv, Conexao *c) {
+    pthread_mutex_lock(&srv->lock);
+    c->fila = NULL;
+    if (srv->fim) srv->fim->fila = c;
+    else srv->inicio = c;
+    srv->fim = c;
+    pthread_cond_signal(&srv->tem_trabalho);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+/* Lê o que chegou. Com uma linha completa (ou o buffer cheio sem nenhuma) a
+ * conexão vai para os workers; senão volta para o epoll. */
+static void ler(Servidor *srv, Conexao *c) {
+    pthread_mutex_lock(&srv->lock);
+    pthread_mutex_unlock(&srv->lock);
+    while (c->usados < SERVER_MAX_LINE) {
+        ssize_t r = read(c->fd, c->entrada + c->usados, SERVER_MAX_LINE - c->usados);
+        if (r > 0) {
+            c->usados += (int)r;
+        } else if (r < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) c->fim = 1;
+            break;
+        }
+    }
+
+    if (c->usados == SERVER_MAX_LINE || memchr(c->entrada, '\n', c->usados)) {
+        c->chegada = server_now();
+        enfileirar(srv, c);
+    } else if (c->fim) {
+        fechar(srv, c);
+    } else {
+        rearmar(srv, c);
+    }
+}
+
+/* ---- Respostas ---- */
+
+/* Envia tudo antes de `limite`, esperando o socket quando ele enche. */
+static int enviar(Conexao *c, struct iovec *v, int n, double limite) {
+    while (n > 0) {
+        struct msghdr m;
+        memset(&m, 0, sizeof(m));
+        m.msg_iov = v;
+        m.msg_iovlen = n;
+        ssize_t w = sendmsg(c->fd, &m, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+            int ms = (int)((limite - server_now()) * 1e3);
+            if (ms <= 0) return 0;
+            struct pollfd p = { c->fd, POLLOUT, 0 };
+            if (poll(&p, 1, ms) < 0 && errno != EINTR) return 0;
+            continue;
+        }
+        // Avança pelo que saiu
+        size_t k = (size_t)w;
+        while (n > 0 && k >= v->iov_len) {
+            k -= v->iov_len;
+            v++;
+            n--;
+        }
+        if (n > 0) {
+            v->iov_base = (char *)v->iov_base + k;
+            v->iov_len -= k;
+        }
+    }
+    return 1;
+}
+
+/* Destino do OutBuf do worker: cada buffer cheio vira um pedaço "<n>\n". */
+static int enviar_pedaco(void *ctx, const char *data, size_t n) {
+    Conexao *c = ctx;
+    if (server_now() > c->prazo) {
+        // Nada deste pedaço saiu: ainda dá para responder ERRO
+        c->estourou = 1;
+        return 0;
+    }
+    char cab[32];
+    struct iovec v[2];
+    v[0].iov_base = cab;
+    v[0].iov_len = (size_t)snprintf(cab, sizeof(cab), "%zu\n", n);
+    v[1].iov_base = (void *)data;
+    v[1].iov_len = n;
+    if (!enviar(c, v, 2, c->prazo)) {
+        c->quebrada = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/* Atende uma linha. Retorna 0 se a conexão não serve mais. */
+static int atender(Worker *w, Conexao *c, char *linha) {
+    Servidor *srv = w->srv;
+    const double inicio = server_now();
+    c->prazo = c->chegada + srv->prazo;
+    c->estourou = c->quebrada = 0;
+    outbuf_reset(&w->out, c);
+
+    char *errmsg = NULL;
+    int ok = 0;
+    if (inicio > c->prazo) {
+        // Esperou demais na fila
+        c->estourou = 1;
+    } else {
+        ok = srv->config->handler(srv->config->ctx, linha, &w->dados, &w->out, c->prazo, &errmsg);
+        if (ok) outbuf_flush(&w->out);
+    }
+    if (c->estourou || (!ok && server_now() > c->prazo)) {
+        free(errmsg);
+        errmsg = strdup("tempo esgotado");
+        w->stats.timeouts++;
+        ok = 0;
+    } else if (ok && w->out.error) {
+        errmsg = strdup("erro ao enviar a saída");
+        ok = 0;
+    }
+
+    w->stats.requests++;
+    w->stats.bytes += w->out.written;
+    if (!ok) w->stats.errors++;
+    const double ms = (server_now() - inicio) * 1e3;
+    if (ms > w->stats.max_ms) w->stats.max_ms = ms;
+
+    if (c->quebrada) {
+        free(errmsg);
+        return 0;
+    }
+
+    // Fim da resposta, com prazo novo: o pedido já foi contado
+    char fim[256];
+    int n;
+    if (ok) {
+        n = snprintf(fim, sizeof(fim), "0\n");
+    } else {
+        n = snprintf(fim, sizeof(fim), "ERRO %s\n", errmsg ? errmsg : "desconhecido");
+        if (n >= (int)sizeof(fim)) n = (int)sizeof(fim) - 1;
+        for (int k = 0; k < n - 1; k++) {
+            if (fim[k] == '\n' || fim[k] == '\r') fim[k] = ' ';
+        }
+        fim[n - 1] = '\n';
+    }
+    free(errmsg);
+    struct iovec v = { fim, (size_t)n };
+    return enviar(c, &v, 1, server_now() + srv->prazo);
+}
+
+/* Responde as linhas completas da conexão e a devolve ao epoll. */
+static void atender_conexao(Worker *w, Conexao *c) {
+    int aberta = 1;
+    while (aberta) {
+        char *nl = memchr(c->entrada, '\n', c->usados);
+        if (!nl) {
+            if (c->usados == SERVER_MAX_LINE) {
+                // Sem '\n' em SERVER_MAX_LINE bytes: não dá para achar o próximo pedido
+                static const char msg[] = "ERRO pedido longo demais\n";
+                struct iovec v = { (void *)msg, sizeof(msg) - 1 };
+                enviar(c, &v, 1, server_now() + w->srv->prazo);
+                w->stats.requests++;
+                w->stats.errors++;
+                aberta = 0;
+            }
+            break;
+        }
+        int n = (int)(nl - c->entrada);
+        memcpy(w->linha, c->entrada, n);
+        if (n > 0 && w->linha[n - 1] == '\r') n--;
+        w->linha[n] = '\0';
+        c->usados -= (int)(nl + 1 - c->entrada);
+        memmove(c->entrada, nl + 1, c->usados);
+        if (n > 0) aberta = atender(w, c, w->linha);
+    }
+
+    if (!aberta || c->fim) {
+        fechar(w->srv, c);
+    } else {
+        rearmar(w->srv, c);
+    }
+}
+
+static void *worker(void *arg) {
+    Worker *w = arg;
+    Servidor *srv = w->srv;
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        while (!srv->inicio && !srv->encerrando) {
+            pthread_cond_wait(&srv->tem_trabalho, &srv->lock);
+        }
+        if (srv->encerrando) {
+            pthread_mutex_unlock(&srv->lock);
+            break;
+        }
+        Conexao *c = srv->inicio;
+        srv->inicio = c->fila;
+        if (!srv->inicio) srv->fim = NULL;
+        pthread_mutex_unlock(&srv->lock);
+
+        atender_conexao(w, c);
+    }
+    return NULL;
+}
+
+/* ---- Laço principal ---- */
+
+int server_run(const ServerConfig *config, ServerStats *stats, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+    if (aviso_fd >= 0) {
+        if (errmsg) *errmsg = strdup("já há um servidor em execução");
+        return 0;
+    }
+
+    Servidor srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.config = config;
+    srv.prazo = (config->timeout_ms > 0 ? config->timeout_ms : SERVER_TIMEOUT_MS) * 1e-3;
+    srv.max_conexoes = config->max_connections > 0 ? config->max_connections : SERVER_MAX_CONNECTIONS;
+    srv.aviso[0] = srv.aviso[1] = -1;
+    srv.epoll = -1;
+
+    srv.escuta = escutar(config->address, &srv.tcp, errmsg);
+    if (srv.escuta < 0) return 0;
+
+    int n_workers = plot_thread_count(config->threads);
+    Worker *workers = calloc(n_workers, sizeof(Worker));
+    pthread_t *th = calloc(n_workers, sizeof(pthread_t));
+    int ok = workers && th;
+    if (!ok && errmsg) *errmsg = strdup("memória insuficiente");
+    if (ok && (pipe(srv.aviso) != 0 || !sem_bloqueio(srv.aviso[0]) ||
+               (srv.epoll = epoll_create1(0)) < 0)) {
+        ok = falha(errmsg, "epoll");
+    }
+    if (ok) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &marca_escuta;
+        ok = epoll_ctl(srv.epoll, EPOLL_CTL_ADD, srv.escuta, &ev) == 0;
+        ev.data.ptr = &marca_aviso;
+        ok = ok && epoll_ctl(srv.epoll, EPOLL_CTL_ADD, srv.aviso[0], &ev) == 0;
+        if (!ok) falha(errmsg, "epoll_ctl");
+    }
+
+    // Workers: PlotData e buffer de saída ficam com eles do começo ao fim
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.tem_trabalho, NULL);
+    int criados = 0;
+    for (int k = 0; ok && k < n_workers; k++) {
+        workers[k].srv = &srv;
+        if (!outbuf_init_sink(&workers[k].out, enviar_pedaco, NULL, 0) ||
+            pthread_create(&th[k], NULL, worker, &workers[k]) != 0) {
+            outbuf_close(&workers[k].out);
+            ok = falha(errmsg, "não foi possível criar os workers");
+            break;
+        }
+        criados++;
+    }
+
+    struct sigaction sa, antigo_int, antigo_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = tratar_sinal;
+    sigemptyset(&sa.sa_mask);
+    if (ok) {
+        aviso_fd = srv.aviso[1];
+        sigaction(SIGINT, &sa, &antigo_int);
+        sigaction(SIGTERM, &sa, &antigo_term);
+    }
+
+    struct epoll_event eventos[SERVER_EVENTS];
+    while (ok) {
+        int n = epoll_wait(srv.epoll, eventos, SERVER_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int parar = 0;
+        for (int k = 0; k < n; k++) {
+            void *p = eventos[k].data.ptr;
+            if (p == &marca_escuta) aceitar(&srv);
+            else if (p == &marca_aviso) parar = 1;
+            else ler(&srv, p);
+        }
+        if (parar) break;
+    }
+
+    if (ok) {
+        sigaction(SIGINT, &antigo_int, NULL);
+        sigaction(SIGTERM, &antigo_term, NULL);
+        aviso_fd = -1;
+    }
+
+    // Encerra: os workers terminam o pedido atual; o resto é fechado aqui
+    pthread_mutex_lock(&srv.lock);
+    srv.encerrando = 1;
+    pthread_cond_broadcast(&srv.tem_trabalho);
+    pthread_mutex_unlock(&srv.lock);
+    for (int k = 0; k < criados; k++) {
+        pthread_join(th[k], NULL);
+        ServerStats *s = &workers[k].stats;
+        srv.stats.requests += s->requests;
+        srv.stats.errors += s->errors;
+        srv.stats.timeouts += s->timeouts;
+        srv.stats.bytes += s->bytes;
+        if (s->max_ms > srv.stats.max_ms) srv.stats.max_ms = s->max_ms;
+        outbuf_close(&workers[k].out);
+        plot_data_release(&workers[k].dados);
+    }
+    while (srv.abertas) fechar(&srv, srv.abertas);
+
+    if (srv.epoll >= 0) close(srv.epoll);
+    if (srv.aviso[0] >= 0) close(srv.aviso[0]);
+    if (srv.aviso[1] >= 0) close(srv.aviso[1]);
+    close(srv.escuta);
+    if (!srv.tcp) unlink(config->address);
+    pthread_cond_destroy(&srv.tem_trabalho);
+    pthread_mutex_destroy(&srv.lock);
+    free(workers);
+    free(th);
+
+    if (stats) *stats = srv.stats;
+    return ok;
+}
@@ -0,0 +1,109 @@
+/* Simplificação de polilinhas (ver include/simplify.h) */
+#include "../include/simplify.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Nova âncora em (x, y): cone aberto, sem direção de referência */
+static void ancorar(SimplifyStream *s, double x, double y) {
+    s->ax = s->px = x;
+    s->ay = s->py = y;
+    s->lo = -M_PI;
+    s->hi = M_PI;
+    s->ref = 0.0;
+    s->tem_ref = 0;
+    s->max_d = 0.0;
+}
+
+/* Tenta estender o segmento da âncora até (x, y). Retorna 0 se o ponto não
+ * serve de fim (não cobre os intermediários); senão estreita o cone. */
+static int estender(SimplifyStream *s, double x, double y) {
+    const double dx = x - s->ax, dy = y - s->ay;
+    const double d = sqrt(dx * dx + dy * dy);
+
+    // Cone de direções aceitas, em ângulos relativos à direção do primeiro
+    // ponto que sai do círculo de raio tol em volta da âncora
+    double rel = 0.0;
+    if (d > s->tol) {
+        if (s->tem_ref) {
+            rel = remainder(atan2(dy, dx) - s->ref, 2.0 * M_PI);
+        } else {
+            s->ref = atan2(dy, dx);
+            s->tem_ref = 1;
+        }
+    }
+
+    // P_j serve de fim se cobre os intermediários; P_{a+1} sempre serve
+    if (d < s->max_d) return 0;
+    if (d > s->tol && (rel < s->lo || rel > s->hi)) return 0;
+
+    if (d > s->tol) {
+        const double w = asin(s->tol / d);
+        if (rel - w > s->lo) s->lo = rel - w;
+        if (rel + w < s->hi) s->hi = rel + w;
+    }
+    s->max_d = d;
+    return 1;
+}
+
+void simplify_stream_init(SimplifyStream *s, double tol) {
+    s->tol = tol;
+    s->pontos = 0;
+    ancorar(s, 0.0, 0.0);
+}
+
+int simplify_stream_push(SimplifyStream *s, double x, double y, double *vx, double *vy) {
+    if (s->pontos++ == 0) {
+        ancorar(s, x, y);
+        *vx = x;
+        *vy = y;
+        return 1;
+    }
+
+    // Sem tolerância, todos os vértices ficam
+    if (s->tol > 0.0 && estender(s, x, y)) {
+        s->px = x;
+        s->py = y;
+        return 0;
+    }
+
+    // O ponto anterior vira vértice e âncora (sem tolerância, o segundo
+    // ponto chega aqui com o primeiro, que já saiu); (x, y) é o primeiro
+    // depois dela, que sempre serve
+    const int novo = s->pontos > 2;
+    *vx = s->px;
+    *vy = s->py;
+    ancorar(s, s->px, s->py);
+    if (s->tol > 0.0) estender(s, x, y);
+    s->px = x;
+    s->py = y;
+    return novo;
+}
+
+int simplify_stream_finish(SimplifyStream *s, double *vx, double *vy) {
+    const int resta = s->pontos > 1;
+    *vx = s->px;
+    *vy = s->py;
+    s->pontos = 0;
+    return resta;
+}
+
+int simplify_polyline(const double *x, const double *y, int n, double tol, int *keep) {
+    if (n <= 2 || !(tol > 0.0)) {
+        for (int i = 0; i < n; i++) keep[i] = i;
+        return n;
+    }
+
+    // Cada vértice decidido no ponto i é o anterior (ou o próprio, no primeiro)
+    SimplifyStream s;
+    double vx, vy;
+    int m = 0;
+    simplify_stream_init(&s, tol);
+    for (int i = 0; i < n; i++) {
+        if (simplify_stream_push(&s, x[i], y[i], &vx, &vy)) keep[m++] = i ? i - 1 : 0;
+    }
+    if (simplify_stream_finish(&s, &vx, &vy)) keep[m++] = n - 1;
+    return m;
+}
@@ -0,0 +1,189 @@
+/* Instrumentação do pipeline (ver include/stats.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/stats.h"
+#include "evaluator.h"
+#include <string.h>
+#include <time.h>
+
+static const char *const NOMES_ETAPAS[STATS_STAGES] = {
+    "parse", "compile", "eval", "sample", "bounds", "render", "write"
+};
+
+/* Chaves do JSON e rótulos do texto, na ordem de StatsError */
+static const char *const CHAVES_ERROS[STATS_ERRORS] = {
+    "divisao_por_zero", "dominio", "matematico", "pilha", "outros"
+};
+static const char *const NOMES_ERROS[STATS_ERRORS] = {
+    "divisão por zero", "domínio", "matemático", "pilha", "outros"
+};
+
+#ifndef MULTICURVAS_NO_STATS
+
+/* Estado da coleta da thread: o Stats ligado, a etapa em que o relógio está
+ * (-1 = nenhuma) e desde quando. */
+typedef struct {
+    Stats *st;
+    int etapa;
+    double desde;
+    double inicio;
+} Coleta;
+
+static __thread Coleta coleta;
+
+static double relogio(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void stats_attach(Stats *st) {
+    coleta.st = st;
+    coleta.etapa = -1;
+    coleta.inicio = coleta.desde = st ? relogio() : 0.0;
+}
+
+void stats_detach(void) {
+    if (!coleta.st) return;
+    const double t = relogio();
+    if (coleta.etapa >= 0) coleta.st->seconds[coleta.etapa] += t - coleta.desde;
+    coleta.st->total += t - coleta.inicio;
+    coleta.st = NULL;
+}
+
+Stats *stats_current(void) {
+    return coleta.st;
+}
+
+int stats_enter(StatsStage stage) {
+    Stats *st = coleta.st;
+    if (!st) return -1;
+    const double t = relogio();
+    if (coleta.etapa >= 0) st->seconds[coleta.etapa] += t - coleta.desde;
+    st->calls[stage]++;
+    const int anterior = coleta.etapa;
+    coleta.etapa = (int)stage;
+    coleta.desde = t;
+    return anterior;
+}
+
+void stats_leave(int previous) {
+    Stats *st = coleta.st;
+    if (!st) return;
+    const double t = relogio();
+    if (coleta.etapa >= 0) st->seconds[coleta.etapa] += t - coleta.desde;
+    coleta.etapa = previous;
+    coleta.desde = t;
+}
+
+#endif /* MULTICURVAS_NO_STATS */
+
+int stats_error_kind(int eval_error) {
+    switch (eval_error) {
+    case EVAL_DIVISION_BY_ZERO: return STATS_ERROR_DIVISION_BY_ZERO;
+    case EVAL_DOMAIN_ERROR:     return STATS_ERROR_DOMAIN;
+    case EVAL_MATH_ERROR:       return STATS_ERROR_MATH;
+    case EVAL_STACK_ERROR:      return STATS_ERROR_STACK;
+    default:                    return STATS_ERROR_OTHER;
+    }
+}
+
+void stats_merge(Stats *dst, const Stats *src) {
+    for (int k = 0; k < STATS_STAGES; k++) {
+        dst->seconds[k] += src->seconds[k];
+        dst->calls[k] += src->calls[k];
+    }
+    for (int k = 0; k < STATS_ERRORS; k++) dst->errors[k] += src->errors[k];
+    dst->total += src->total;
+    dst->curves += src->curves;
+    dst->evaluations += src->evaluations;
+    dst->points += src->points;
+    dst->emitted += src->emitted;
+    dst->bytes += src->bytes;
+}
+
+const char *stats_stage_name(StatsStage stage) {
+    return (stage >= 0 && stage < STATS_STAGES) ? NOMES_ETAPAS[stage] : "?";
+}
+
+int stats_format_parse(const char *name, StatsFormat *format) {
+    if (strcmp(name, "text") == 0) {
+        *format = STATS_FORMAT_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        *format = STATS_FORMAT_JSON;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static unsigned long total_erros(const Stats *st) {
+    unsigned long n = 0;
+    for (int k = 0; k < STATS_ERRORS; k++) n += st->errors[k];
+    return n;
+}
+
+static void imprimir_texto(FILE *out, const Stats *st, const char *title) {
+    double medido = 0.0;
+    for (int k = 0; k < STATS_STAGES; k++) medido += st->seconds[k];
+    const double total = st->total > medido ? st->total : medido;
+    const double pct = total > 0.0 ? 100.0 / total : 0.0;
+
+    fprintf(out, "%s: %lu curva%s, %.3f ms\n", title ? title : "estatísticas", st->curves,
+            st->curves == 1 ? "" : "s", total * 1e3);
+    fprintf(out, "  %-8s %12s %7s %10s\n", "etapa", "ms", "%", "chamadas");
+    for (int k = 0; k < STATS_STAGES; k++) {
+        fprintf(out, "  %-8s %12.3f %6.1f%% %10lu\n", NOMES_ETAPAS[k], st->seconds[k] * 1e3,
+                st->seconds[k] * pct, st->calls[k]);
+    }
+    fprintf(out, "  %-8s %12.3f %6.1f%%\n", "outros", (total - medido) * 1e3, (total - medido) * pct);
+
+    const unsigned long erros = total_erros(st);
+    fprintf(out, "  avaliações: %lu, %lu com erro (%.1f%%)", st->evaluations, erros,
+            st->evaluations ? 100.0 * erros / st->evaluations : 0.0);
+    const char *sep = ": ";
+    for (int k = 0; k < STATS_ERRORS; k++) {
+        if (!st->errors[k]) continue;
+        fprintf(out, "%s%lu %s", sep, st->errors[k], NOMES_ERROS[k]);
+        sep = ", ";
+    }
+    fprintf(out, "\n  pontos: %lu gerados, %lu escritos; %lu bytes de saída\n", st->points, st->emitted,
+            st->bytes);
+}
+
+static void imprimir_json(FILE *out, const Stats *st) {
+    fprintf(out, "{\"curvas\": %lu, \"total_ms\": %.3f, \"etapas\": {", st->curves, st->total * 1e3);
+    for (int k = 0; k < STATS_STAGES; k++) {
+        fprintf(out, "%s\"%s\": {\"ms\": %.3f, \"chamadas\": %lu}", k ? ", " : "", NOMES_ETAPAS[k],
+                st->seconds[k] * 1e3, st->calls[k]);
+    }
+    fprintf(out, "}, \"avaliacoes\": %lu, \"erros\": {", st->evaluations);
+    for (int k = 0; k < STATS_ERRORS; k++) {
+        fprintf(out, "%s\"%s\": %lu", k ? ", " : "", CHAVES_ERROS[k], st->errors[k]);
+    }
+    fprintf(out, "}, \"pontos\": %lu, \"escritos\": %lu, \"bytes\": %lu}", st->points, st->emitted,
+            st->bytes);
+}
+
+void stats_print(FILE *out, const Stats *st, StatsFormat format, const char *title) {
+    if (format == STATS_FORMAT_JSON) {
+        imprimir_json(out, st);
+    } else {
+        imprimir_texto(out, st, title);
+    }
+}
+
+void stats_print_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; p && *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
@@ -0,0 +1,196 @@
+/* Renderização em fluxo (ver include/stream.h) */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/stream.h"
+#include "../include/stats.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Anel de blocos entre a produtora e a consumidora. O bloco k vai na posição
+ * k % slots; a produtora só escreve nela depois que o bloco k - slots foi
+ * consumido, e a consumidora só lê blocos já publicados, então os PlotData
+ * em si são lidos e escritos fora do mutex. */
+typedef struct {
+    PlotSampler *sampler;
+    PlotData *anel;
+    int slots, bloco;
+    int total, blocos;
+    pthread_mutex_t mutex;
+    pthread_cond_t mudou;
+    int produzidos;          /* Blocos publicados */
+    int consumidos;          /* Blocos já renderizados (posições livres) */
+    int fim;                 /* A produtora terminou (ou falhou) */
+    int falhou;              /* Faltou memória num bloco */
+    int cancelado;           /* A consumidora desistiu (erro de escrita) */
+    Stats stats;             /* Da produtora, se a consumidora tem Stats */
+    int com_stats;
+} Anel;
+
+/* Avalia o bloco k na sua posição do anel. Retorna 0 se faltou memória. */
+static int produzir_bloco(Anel *a, int k) {
+    PlotData *d = &a->anel[k % a->slots];
+    const int inicio = k * a->bloco;
+    const int n = (a->total - inicio < a->bloco) ? a->total - inicio : a->bloco;
+    if (!plot_sampler_block(a->sampler, inicio, n, d)) return 0;
+    Stats *st = stats_current();
+    if (st) st->points += (unsigned long)d->count;
+    return 1;
+}
+
+static void *produzir(void *arg) {
+    Anel *a = arg;
+    if (a->com_stats) stats_attach(&a->stats);
+    for (int k = 0; k < a->blocos; k++) {
+        pthread_mutex_lock(&a->mutex);
+        while (k - a->consumidos >= a->slots && !a->cancelado) pthread_cond_wait(&a->mudou, &a->mutex);
+        const int cancelado = a->cancelado;
+        pthread_mutex_unlock(&a->mutex);
+        if (cancelado) break;
+
+        const int ok = produzir_bloco(a, k);
+        pthread_mutex_lock(&a->mutex);
+        if (ok) {
+            a->produzidos = k + 1;
+        } else {
+            a->falhou = 1;
+        }
+        pthread_cond_signal(&a->mudou);
+        pthread_mutex_unlock(&a->mutex);
+        if (!ok) break;
+    }
+    stats_detach();
+
+    pthread_mutex_lock(&a->mutex);
+    a->fim = 1;
+    pthread_cond_signal(&a->mudou);
+    pthread_mutex_unlock(&a->mutex);
+    return NULL;
+}
+
+/* Caixa do SVG/raster pela pré-passada: a mesma curva numa grade curta.
+ * Retorna 0 (com *errmsg) se ela não achou nenhum ponto. */
+static int estimar_caixa(const Plot *plot, RenderBounds *b, char **errmsg) {
+    Plot previa = *plot;
+    previa.adaptive = previa.interval = previa.incremental = 0;
+    if (previa.samples > STREAM_PREPASS_SAMPLES) previa.samples = STREAM_PREPASS_SAMPLES;
+
+    PlotData *d = plot_generate_samples(&previa, errmsg);
+    if (!d) return 0;
+    const int achou = d->count > 0;
+    if (achou) {
+        render_bounds(d, b);
+    } else if (errmsg) {
+        *errmsg = strdup("a pré-passada não achou pontos da curva; informe o viewport");
+    }
+    plot_data_free(d);
+    return achou;
+}
+
+int stream_render(OutBuf *out, const Plot *plot, RenderFormat format, const char *title, int canvas_w,
+                  int canvas_h, const StreamOptions *opts, RenderStats *stats, char **errmsg) {
+    if (errmsg) *errmsg = NULL;
+    if (stats) stats->points_in = stats->points_out = 0;
+    if (format == RENDER_BIN) {
+        if (errmsg) *errmsg = strdup("o formato bin não é gerado em fluxo");
+        return 0;
+    }
+
+    RenderBounds caixa;
+    if (format != RENDER_CSV) {
+        if (opts->viewport) {
+            caixa = *opts->viewport;
+        } else if (!estimar_caixa(plot, &caixa, errmsg)) {
+            return 0;
+        }
+    }
+
+    Anel a;
+    memset(&a, 0, sizeof(a));
+    a.bloco = opts->block > 0 ? opts->block : STREAM_BLOCK_SAMPLES;
+    a.slots = opts->slots >= 2 ? opts->slots : STREAM_SLOTS;
+    a.total = plot->samples;
+    a.blocos = (int)(((long)a.total + a.bloco - 1) / a.bloco);
+    a.sampler = plot_sampler_open(plot, errmsg);
+    if (!a.sampler) return 0;
+    a.anel = calloc(a.slots, sizeof(PlotData));
+    RenderStream *rs = a.anel ? render_stream_begin(out, format, &caixa, title, canvas_w, canvas_h,
+                                                    opts->tolerance, 0) : NULL;
+    if (!rs) {
+        if (errmsg) *errmsg = strdup(a.anel && format != RENDER_SVG && format != RENDER_CSV
+                                         ? "canvas grande demais ou memória insuficiente para a imagem"
+                                         : "memória insuficiente");
+        free(a.anel);
+        plot_sampler_close(a.sampler);
+        return 0;
+    }
+
+    Stats *st = stats_current();
+    a.com_stats = (st != NULL);
+    pthread_mutex_init(&a.mutex, NULL);
+    pthread_cond_init(&a.mudou, NULL);
+    pthread_t produtora;
+    const int paralela = (pthread_create(&produtora, NULL, produzir, &a) == 0);
+
+    // Sem a thread, produz e consome um bloco de cada vez aqui mesmo
+    for (int k = 0; k < a.blocos; k++) {
+        int pronto;
+        if (paralela) {
+            pthread_mutex_lock(&a.mutex);
+            while (k >= a.produzidos && !a.fim) pthread_cond_wait(&a.mudou, &a.mutex);
+            pronto = (k < a.produzidos);
+            pthread_mutex_unlock(&a.mutex);
+        } else {
+            pronto = produzir_bloco(&a, k);
+            a.falhou = !pronto;
+        }
+        if (!pronto) break;
+
+        const int anterior = stats_enter(STATS_RENDER);
+        render_stream_points(rs, &a.anel[k % a.slots]);
+        stats_leave(anterior);
+
+        pthread_mutex_lock(&a.mutex);
+        a.consumidos = k + 1;
+        a.cancelado = out->error;
+        pthread_cond_signal(&a.mudou);
+        pthread_mutex_unlock(&a.mutex);
+        if (out->error) break;
+    }
+    if (paralela) {
+        pthread_mutex_lock(&a.mutex);
+        a.cancelado = 1;
+        pthread_cond_signal(&a.mudou);
+        pthread_mutex_unlock(&a.mutex);
+        pthread_join(produtora, NULL);
+    }
+
+    const int anterior = stats_enter(STATS_RENDER);
+    const int imagem = render_stream_end(rs, stats);
+    stats_leave(anterior);
+
+    // O total da produtora se sobrepõe ao da thread atual: fica só o dela
+    if (st && paralela) {
+        a.stats.total = 0.0;
+        stats_merge(st, &a.stats);
+    }
+    pthread_cond_destroy(&a.mudou);
+    pthread_mutex_destroy(&a.mutex);
+    for (int k = 0; k < a.slots; k++) plot_data_release(&a.anel[k]);
+    free(a.anel);
+    plot_sampler_close(a.sampler);
+
+    if (a.falhou) {
+        if (errmsg) *errmsg = strdup("memória insuficiente");
+        return 0;
+    }
+    if (out->error) {
+        if (errmsg) *errmsg = strdup("erro ao gravar a saída");
+        return 0;
+    }
+    if (!imagem) {
+        if (errmsg) *errmsg = strdup("não foi possível gravar a imagem");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,332 @@
+/* Kernels matemáticos vetoriais com despacho por CPU em tempo de execução.
+ *
+ * O corpo dos kernels está em vecmath_impl.h e é instanciado duas vezes (SSE2
+ * e AVX2) com __attribute__((target)), então o binário roda em qualquer
+ * x86-64 e usa AVX2 só se a CPU tiver. O nível escalar chama a libm.
+ */
+
+#include "../include/vecmath.h"
+#include <math.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VECMATH_X86 1
+#include <immintrin.h>
+#else
+#define VECMATH_X86 0
+#endif
+
+/* ---- Laços escalares (libm) ---- */
+
+static void scalar_sin(const double *x, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = sin(x[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+static void scalar_cos(const double *x, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = cos(x[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+static void scalar_exp(const double *x, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = exp(x[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+static void scalar_log(const double *x, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = log(x[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+static void scalar_sqrt(const double *x, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = sqrt(x[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+static void scalar_sincos(const double *x, double *s, double *c, int n) {
+    for (int i = 0; i < n; i++) {
+        const double xi = x[i];
+        s[i] = sin(xi);
+        c[i] = cos(xi);
+    }
+}
+
+/* Prévia em float: sem kernel vetorial, a libm em float */
+static void scalar_sin_f(const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) y[i] = sinf(x[i]);
+}
+
+static void scalar_cos_f(const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) y[i] = cosf(x[i]);
+}
+
+static void scalar_exp_f(const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) y[i] = expf(x[i]);
+}
+
+static void scalar_log_f(const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) y[i] = logf(x[i]);
+}
+
+static void scalar_sincos_f(const float *x, float *s, float *c, int n) {
+    for (int i = 0; i < n; i++) {
+        const float xi = x[i];
+        s[i] = sinf(xi);
+        c[i] = cosf(xi);
+    }
+}
+
+/* ---- Kernels vetoriais ---- */
+
+#if VECMATH_X86
+
+/* Constantes do fdlibm */
+#define VM_MAGIC          6755399441055744.0        /* 1.5·2^52: arredonda p/ inteiro */
+#define VM_INVLN2         1.44269504088896338700e+00
+#define VM_LN2_HI         6.93147180369123816490e-01
+#define VM_LN2_LO         1.90821492927058770002e-10
+#define VM_EXP_OVERFLOW   7.09782712893383973096e+02
+#define VM_EXP_UNDERFLOW  -7.45133219101941108420e+02
+#define VM_EXP_P1         1.66666666666666019037e-01
+#define VM_EXP_P2         -2.77777777770155933842e-03
+#define VM_EXP_P3         6.61375632143793436117e-05
+#define VM_EXP_P4         -1.65339022054652515390e-06
+#define VM_EXP_P5         4.13813679705723846039e-08
+#define VM_DBL_MIN        2.2250738585072014e-308
+#define VM_TWO54          1.80143985094819840000e+16
+#define VM_SQRT2          1.41421356237309504880e+00
+#define VM_LG1            6.666666666666735130e-01
+#define VM_LG2            3.999999999940941908e-01
+#define VM_LG3            2.857142874366239149e-01
+#define VM_LG4            2.222219843214978396e-01
+#define VM_LG5            1.818357216161805012e-01
+#define VM_LG6            1.531383769920937332e-01
+#define VM_LG7            1.479819860511658591e-01
+#define VM_TRIG_MAX       8.23549664582643e+05      /* 2^19·π/2 */
+#define VM_INVPIO2        6.36619772367581382433e-01
+#define VM_PIO2_1         1.57079632673412561417e+00
+#define VM_PIO2_2         6.07710050630396597660e-11
+#define VM_PIO2_2T        2.02226624879595063154e-21
+#define VM_PIO2_3         2.02226624871116645580e-21
+#define VM_PIO2_3T        8.47842766036889956997e-32
+#define VM_S1             -1.66666666666666324348e-01
+#define VM_S2             8.33333333332248946124e-03
+#define VM_S3             -1.98412698298579493134e-04
+#define VM_S4             2.75573137070700676789e-06
+#define VM_S5             -2.50507602534068634195e-08
+#define VM_S6             1.58969099521155010221e-10
+#define VM_C1             4.16666666666666019037e-02
+#define VM_C2             -1.38888888888741095749e-03
+#define VM_C3             2.48015872894767294178e-05
+#define VM_C4             -2.75573143513906633035e-07
+#define VM_C5             2.08757232129817482790e-09
+#define VM_C6             -1.13596475577881948265e-11
+
+/* Constantes do Cephes (float) */
+#define VF_MAGIC          12582912.0f               /* 1.5·2^23: arredonda p/ inteiro */
+#define VF_LOG2E          1.44269504088896341f
+#define VF_LN2_HI         0.693359375f
+#define VF_LN2_LO         -2.12194440e-4f
+#define VF_EXP_OVERFLOW   88.72283905206835f
+#define VF_EXP_UNDERFLOW  -87.33654475f
+#define VF_EXP_P0         1.9875691500e-4f
+#define VF_EXP_P1         1.3981999507e-3f
+#define VF_EXP_P2         8.3334519073e-3f
+#define VF_EXP_P3         4.1665795894e-2f
+#define VF_EXP_P4         1.6666665459e-1f
+#define VF_EXP_P5         5.0000001201e-1f
+#define VF_FLT_MIN        1.17549435e-38f
+#define VF_SQRTHF         0.707106781186547524f
+#define VF_LOG_P0         7.0376836292e-2f
+#define VF_LOG_P1         -1.1514610310e-1f
+#define VF_LOG_P2         1.1676998740e-1f
+#define VF_LOG_P3         -1.2420140846e-1f
+#define VF_LOG_P4         1.4249322787e-1f
+#define VF_LOG_P5         -1.6668057665e-1f
+#define VF_LOG_P6         2.0000714765e-1f
+#define VF_LOG_P7         -2.4999993993e-1f
+#define VF_LOG_P8         3.3333331174e-1f
+#define VF_TRIG_MAX       8192.0f
+#define VF_INVPIO2        0.636619772367581343f
+#define VF_PIO2_1         1.5703125f
+#define VF_PIO2_2         4.837512969970703125e-4f
+#define VF_PIO2_3         7.54978995489188216e-8f
+#define VF_SIN_P0         -1.9515295891e-4f
+#define VF_SIN_P1         8.3321608736e-3f
+#define VF_SIN_P2         -1.6666654611e-1f
+#define VF_COS_P0         2.443315711809948e-5f
+#define VF_COS_P1         -1.388731625493765e-3f
+#define VF_COS_P2         4.166664568298827e-2f
+
+#define VM_LANES 2
+#define VF_LANES 4
+#define VM_TARGET "sse2"
+#define VM_NAME(f) f##_sse2
+#define VM_SQRT(v) ((VM_V)_mm_sqrt_pd((__m128d)(v)))
+#include "vecmath_impl.h"
+#include "vecmath_float_impl.h"
+#undef VM_LANES
+#undef VF_LANES
+#undef VM_TARGET
+#undef VM_NAME
+#undef VM_SQRT
+
+#define VM_LANES 4
+#define VF_LANES 8
+#define VM_TARGET "avx2"
+#define VM_NAME(f) f##_avx2
+#define VM_SQRT(v) ((VM_V)_mm256_sqrt_pd((__m256d)(v)))
+#include "vecmath_impl.h"
+#include "vecmath_float_impl.h"
+#undef VM_LANES
+#undef VF_LANES
+#undef VM_TARGET
+#undef VM_NAME
+#undef VM_SQRT
+
+#endif /* VECMATH_X86 */
+
+/* ---- Despacho ---- */
+
+typedef void (*UnaryFn)(const double *, double *, unsigned char *, int);
+typedef void (*SinCosFn)(const double *, double *, double *, int);
+typedef void (*UnaryFloatFn)(const float *, float *, int);
+typedef void (*SinCosFloatFn)(const float *, float *, float *, int);
+
+typedef struct {
+    UnaryFn sin_fn, cos_fn, exp_fn, log_fn, sqrt_fn;
+    SinCosFn sincos_fn;
+    UnaryFloatFn sin_f, cos_f, exp_f, log_f;
+    SinCosFloatFn sincos_f;
+} VecMathTable;
+
+static const VecMathTable TABLE_SCALAR = {
+    scalar_sin, scalar_cos, scalar_exp, scalar_log, scalar_sqrt, scalar_sincos,
+    scalar_sin_f, scalar_cos_f, scalar_exp_f, scalar_log_f, scalar_sincos_f
+};
+
+#if VECMATH_X86
+/* Com só 2 lanes (e deslocamentos de 64 bits emulados), exp e log do fdlibm
+ * perdem para a glibc, que usa tabelas: no nível SSE2 elas ficam com a libm. */
+static const VecMathTable TABLE_SSE2 = {
+    vm_sin_array_sse2, vm_cos_array_sse2, scalar_exp,
+    scalar_log, vm_sqrt_array_sse2, vm_sincos_array_sse2,
+    vf_sin_array_sse2, vf_cos_array_sse2, vf_exp_array_sse2,
+    vf_log_array_sse2, vf_sincos_array_sse2
+};
+static const VecMathTable TABLE_AVX2 = {
+    vm_sin_array_avx2, vm_cos_array_avx2, vm_exp_array_avx2,
+    vm_log_array_avx2, vm_sqrt_array_avx2, vm_sincos_array_avx2,
+    vf_sin_array_avx2, vf_cos_array_avx2, vf_exp_array_avx2,
+    vf_log_array_avx2, vf_sincos_array_avx2
+};
+#endif
+
+static const VecMathTable *table = NULL;
+static VecMathLevel current_level = VECMATH_SCALAR;
+
+static VecMathLevel detect_level(void) {
+#if VECMATH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return VECMATH_AVX2;
+    if (__builtin_cpu_supports("sse2")) return VECMATH_SSE2;
+#endif
+    return VECMATH_SCALAR;
+}
+
+VecMathLevel vecmath_set_level(VecMathLevel level) {
+    VecMathLevel best = detect_level();
+    if (level > best) level = best;
+
+    switch (level) {
+#if VECMATH_X86
+        case VECMATH_AVX2: table = &TABLE_AVX2; break;
+        case VECMATH_SSE2: table = &TABLE_SSE2; break;
+#endif
+        default:
+            level = VECMATH_SCALAR;
+            table = &TABLE_SCALAR;
+    }
+    current_level = level;
+    return level;
+}
+
+VecMathLevel vecmath_level(void) {
+    if (!table) vecmath_set_level(VECMATH_AVX2);
+    return current_level;
+}
+
+const char *vecmath_level_name(VecMathLevel level) {
+    switch (level) {
+        case VECMATH_AVX2: return "avx2";
+        case VECMATH_SSE2: return "sse2";
+        default:           return "scalar";
+    }
+}
+
+static const VecMathTable *get_table(void) {
+    if (!table) vecmath_set_level(VECMATH_AVX2);
+    return table;
+}
+
+void vecmath_sin(const double *x, double *y, unsigned char *bad, int n) {
+    get_table()->sin_fn(x, y, bad, n);
+}
+
+void vecmath_cos(const double *x, double *y, unsigned char *bad, int n) {
+    get_table()->cos_fn(x, y, bad, n);
+}
+
+void vecmath_exp(const double *x, double *y, unsigned char *bad, int n) {
+    get_table()->exp_fn(x, y, bad, n);
+}
+
+void vecmath_log(const double *x, double *y, unsigned char *bad, int n) {
+    get_table()->log_fn(x, y, bad, n);
+}
+
+void vecmath_sqrt(const double *x, double *y, unsigned char *bad, int n) {
+    get_table()->sqrt_fn(x, y, bad, n);
+}
+
+/* pow não tem kernel vetorial: uma versão com erro limitado exigiria log em
+ * precisão dupla-dupla. Fica a libm por lane, com a mesma marcação em `bad`. */
+void vecmath_pow(const double *x, const double *e, double *y, unsigned char *bad, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = pow(x[i], e[i]);
+        if (bad && !isfinite(y[i])) bad[i] = 1;
+    }
+}
+
+void vecmath_sincos(const double *x, double *s, double *c, int n) {
+    get_table()->sincos_fn(x, s, c, n);
+}
+
+void vecmath_sin_f(const float *x, float *y, int n) {
+    get_table()->sin_f(x, y, n);
+}
+
+void vecmath_cos_f(const float *x, float *y, int n) {
+    get_table()->cos_f(x, y, n);
+}
+
+void vecmath_exp_f(const float *x, float *y, int n) {
+    get_table()->exp_f(x, y, n);
+}
+
+void vecmath_log_f(const float *x, float *y, int n) {
+    get_table()->log_f(x, y, n);
+}
+
+void vecmath_sincos_f(const float *x, float *s, float *c, int n) {
+    get_table()->sincos_f(x, s, c, n);
+}
@@ -0,0 +1,199 @@
+/* Corpo dos kernels em float de vecmath.c (prévia), incluído uma vez por
+ * conjunto de instruções. Antes de incluir, defina:
+ *   VF_LANES      número de floats por vetor (4 ou 8: o dobro dos doubles)
+ *   VM_TARGET     string para __attribute__((target(...))) ("sse2", "avx2")
+ *   VM_NAME(f)    nome com sufixo do nível (ex.: f##_avx2)
+ *
+ * Mesmas extensões de vetor de vecmath_impl.h. Constantes e polinômios do
+ * Cephes (sinf.c, cosf.c, expf.c, logf.c), com a redução de faixa em três
+ * partes de π/2. Não há caminho lento aqui: o que os kernels não calculam
+ * com erro de poucos ULPs do float (argumento de sin/cos acima de
+ * VF_TRIG_MAX, log de subnormal) sai NaN, e o avaliador da prévia refaz a
+ * lane em double.
+ */
+
+#define VF_ATTR static inline __attribute__((target(VM_TARGET)))
+#define VF_V VM_NAME(vf_vf)
+#define VF_I VM_NAME(vf_vi)
+
+typedef float VF_V __attribute__((vector_size(VF_LANES * 4)));
+typedef __INT32_TYPE__ VF_I __attribute__((vector_size(VF_LANES * 4)));
+
+VF_ATTR VF_V VM_NAME(vf_splat)(float a) {
+    VF_V v = { 0 };
+    return v + a;
+}
+
+VF_ATTR VF_V VM_NAME(vf_sel)(VF_I mask, VF_V a, VF_V b) {
+    return (VF_V)((mask & (VF_I)a) | (~mask & (VF_I)b));
+}
+
+VF_ATTR VF_V VM_NAME(vf_load)(const float *p) {
+    VF_V v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+VF_ATTR void VM_NAME(vf_store)(float *p, VF_V v) {
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+/* exp(x) = 2^k·exp(r), |r| ≤ ln2/2, polinômio de grau 5 em r */
+VF_ATTR VF_V VM_NAME(vf_exp)(VF_V x) {
+    const VF_I over = x > VF_EXP_OVERFLOW;
+    const VF_I under = x < VF_EXP_UNDERFLOW;
+    const VF_I nan = x != x;
+    const VF_V zero = VM_NAME(vf_splat)(0.0f);
+    const VF_V xc = VM_NAME(vf_sel)(over | under | nan, zero, x);
+
+    const VF_V t = xc * VF_LOG2E + VF_MAGIC;
+    const VF_V k = t - VF_MAGIC;
+    const VF_I ki = (VF_I)t - (VF_I)VM_NAME(vf_splat)(VF_MAGIC);
+
+    const VF_V r = (xc - k * VF_LN2_HI) - k * VF_LN2_LO;
+    const VF_V z = r * r;
+    const VF_V p = ((((VF_EXP_P0 * r + VF_EXP_P1) * r + VF_EXP_P2) * r + VF_EXP_P3) * r + VF_EXP_P4) * r + VF_EXP_P5;
+    VF_V y = p * z + r + 1.0f;
+
+    // 2^k em dois passos: k chega a 128 perto do overflow
+    const VF_I k1 = ki >> 1;
+    const VF_I k2 = ki - k1;
+    y = y * (VF_V)((k1 + 127) << 23);
+    y = y * (VF_V)((k2 + 127) << 23);
+
+    y = VM_NAME(vf_sel)(over, VM_NAME(vf_splat)(INFINITY), y);
+    y = VM_NAME(vf_sel)(under, zero, y);
+    return VM_NAME(vf_sel)(nan, x, y);
+}
+
+/* log(x) = k·ln2 + log(m), m em [√2/2, √2), polinômio de grau 9 em m - 1 */
+VF_ATTR VF_V VM_NAME(vf_log)(VF_V x) {
+    const VF_I neg = x < 0.0f;
+    const VF_I zero = x == 0.0f;
+    const VF_I inf = x == INFINITY;
+    const VF_I nan = x != x;
+    const VF_I sub = (x < VF_FLT_MIN) & ~neg & ~zero;
+
+    const VF_I bits = (VF_I)x;
+    VF_I k = ((bits >> 23) & 0xff) - 126;
+    VF_V m = (VF_V)((bits & 0x007fffff) | 0x3f000000);  // [0.5, 1)
+
+    const VF_I small = m < VF_SQRTHF;
+    k = k + small;  // small é -1 nas lanes verdadeiras
+    m = VM_NAME(vf_sel)(small, m + m, m);
+
+    const VF_V f = m - 1.0f;
+    const VF_V dk = __builtin_convertvector(k, VF_V);
+    const VF_V z = f * f;
+    VF_V y = VF_LOG_P0 * f + VF_LOG_P1;
+    y = y * f + VF_LOG_P2;
+    y = y * f + VF_LOG_P3;
+    y = y * f + VF_LOG_P4;
+    y = y * f + VF_LOG_P5;
+    y = y * f + VF_LOG_P6;
+    y = y * f + VF_LOG_P7;
+    y = y * f + VF_LOG_P8;
+    y = y * f * z;
+    y = y + dk * VF_LN2_LO;
+    y = y - 0.5f * z;
+    y = f + y + dk * VF_LN2_HI;
+
+    y = VM_NAME(vf_sel)(neg | sub, VM_NAME(vf_splat)(NAN), y);
+    y = VM_NAME(vf_sel)(zero, VM_NAME(vf_splat)(-INFINITY), y);
+    y = VM_NAME(vf_sel)(inf, x, y);
+    return VM_NAME(vf_sel)(nan, x, y);
+}
+
+/* sin e/ou cos: redução x = q·π/2 + r em três partes (exata para
+ * |x| ≤ VF_TRIG_MAX), polinômios de grau 7 (sin) e 8 (cos) em |r| ≤ π/4.
+ * Lanes fora da faixa (ou Inf/NaN) saem NaN. */
+VF_ATTR void VM_NAME(vf_sincos)(VF_V x, VF_V *s, VF_V *c) {
+    const VF_V ax = (VF_V)((VF_I)x & 0x7fffffff);
+    const VF_I far = ~(ax <= VF_TRIG_MAX);
+    const VF_V xc = VM_NAME(vf_sel)(far, VM_NAME(vf_splat)(0.0f), x);
+
+    const VF_V t = xc * VF_INVPIO2 + VF_MAGIC;
+    const VF_V fn = t - VF_MAGIC;
+    const VF_I q = ((VF_I)t - (VF_I)VM_NAME(vf_splat)(VF_MAGIC)) & 3;
+    const VF_V r = ((xc - fn * VF_PIO2_1) - fn * VF_PIO2_2) - fn * VF_PIO2_3;
+
+    const VF_V z = r * r;
+    const VF_V ks = ((VF_SIN_P0 * z + VF_SIN_P1) * z + VF_SIN_P2) * z * r + r;
+    const VF_V kc = ((VF_COS_P0 * z + VF_COS_P1) * z + VF_COS_P2) * z * z - 0.5f * z + 1.0f;
+    const VF_I swap = (q & 1) != 0;
+    const VF_I sign = (VF_I){ 0 } + (-0x7fffffff - 1);
+    const VF_V nan = VM_NAME(vf_splat)(NAN);
+
+    if (s) {
+        const VF_I neg = (q & 2) != 0;
+        *s = VM_NAME(vf_sel)(far, nan, (VF_V)((VF_I)VM_NAME(vf_sel)(swap, kc, ks) ^ (neg & sign)));
+    }
+    if (c) {
+        const VF_I neg = ((q + 1) & 2) != 0;
+        *c = VM_NAME(vf_sel)(far, nan, (VF_V)((VF_I)VM_NAME(vf_sel)(swap, ks, kc) ^ (neg & sign)));
+    }
+}
+
+VF_ATTR VF_V VM_NAME(vf_sin)(VF_V x) {
+    VF_V s;
+    VM_NAME(vf_sincos)(x, &s, NULL);
+    return s;
+}
+
+VF_ATTR VF_V VM_NAME(vf_cos)(VF_V x) {
+    VF_V c;
+    VM_NAME(vf_sincos)(x, NULL, &c);
+    return c;
+}
+
+/* Laço sobre o array: blocos de VF_LANES direto da memória; o resto vai num
+ * vetor preenchido com 1.0f. */
+#define VF_DEFINE_UNARY(name, kernel)                                           \
+    __attribute__((target(VM_TARGET), unused))                                  \
+    static void VM_NAME(name)(const float *x, float *y, int n) {                \
+        for (int i = 0; i < n; i += VF_LANES) {                                 \
+            const int m = (n - i < VF_LANES) ? n - i : VF_LANES;                \
+            if (m == VF_LANES) {                                                \
+                VM_NAME(vf_store)(y + i, VM_NAME(kernel)(VM_NAME(vf_load)(x + i))); \
+                continue;                                                       \
+            }                                                                   \
+            float tmp[VF_LANES];                                                \
+            for (int j = 0; j < VF_LANES; j++) tmp[j] = (j < m) ? x[i + j] : 1.0f; \
+            VM_NAME(vf_store)(tmp, VM_NAME(kernel)(VM_NAME(vf_load)(tmp)));     \
+            for (int j = 0; j < m; j++) y[i + j] = tmp[j];                      \
+        }                                                                       \
+    }
+
+VF_DEFINE_UNARY(vf_sin_array, vf_sin)
+VF_DEFINE_UNARY(vf_cos_array, vf_cos)
+VF_DEFINE_UNARY(vf_exp_array, vf_exp)
+VF_DEFINE_UNARY(vf_log_array, vf_log)
+
+#undef VF_DEFINE_UNARY
+
+__attribute__((target(VM_TARGET)))
+static void VM_NAME(vf_sincos_array)(const float *x, float *s, float *c, int n) {
+    for (int i = 0; i < n; i += VF_LANES) {
+        const int m = (n - i < VF_LANES) ? n - i : VF_LANES;
+        VF_V vs, vc;
+        if (m == VF_LANES) {
+            VM_NAME(vf_sincos)(VM_NAME(vf_load)(x + i), &vs, &vc);
+            VM_NAME(vf_store)(s + i, vs);
+            VM_NAME(vf_store)(c + i, vc);
+            continue;
+        }
+        float ts[VF_LANES], tc[VF_LANES];
+        for (int j = 0; j < VF_LANES; j++) ts[j] = (j < m) ? x[i + j] : 1.0f;
+        VM_NAME(vf_sincos)(VM_NAME(vf_load)(ts), &vs, &vc);
+        VM_NAME(vf_store)(ts, vs);
+        VM_NAME(vf_store)(tc, vc);
+        for (int j = 0; j < m; j++) {
+            s[i + j] = ts[j];
+            c[i + j] = tc[j];
+        }
+    }
+}
+
+#undef VF_ATTR
+#undef VF_V
+#undef VF_I
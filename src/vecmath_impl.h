@@ -0,0 +1,272 @@
+/* Corpo dos kernels vetoriais de vecmath.c, incluído uma vez por conjunto de
+ * instruções. Antes de incluir, defina:
+ *   VM_LANES      número de doubles por vetor (2 ou 4)
+ *   VM_TARGET     string para __attribute__((target(...))) ("sse2", "avx2")
+ *   VM_NAME(f)    nome com sufixo do nível (ex.: f##_avx2)
+ *   VM_SQRT(v)    raiz quadrada vetorial (intrínseca do nível)
+ *
+ * Usa as extensões de vetor do GCC/Clang: +, -, *, / e comparações operam
+ * lane a lane, e cast entre vetores de mesmo tamanho reinterpreta os bits.
+ * Constantes e algoritmos vêm do fdlibm (e_exp.c, e_log.c, k_sin.c, k_cos.c,
+ * e_rem_pio2.c).
+ */
+
+#define VM_ATTR static inline __attribute__((target(VM_TARGET)))
+#define VM_V VM_NAME(vm_vd)
+#define VM_I VM_NAME(vm_vi)
+
+typedef double VM_V __attribute__((vector_size(VM_LANES * 8)));
+/* Inteiro de 64 bits por lane: é o tipo que as comparações entre VM_V
+ * produzem (-1 = verdadeiro, 0 = falso). */
+typedef __INT64_TYPE__ VM_I __attribute__((vector_size(VM_LANES * 8)));
+
+VM_ATTR VM_V VM_NAME(vm_splat)(double a) {
+    VM_V v = { 0 };
+    return v + a;
+}
+
+VM_ATTR VM_V VM_NAME(vm_sel)(VM_I mask, VM_V a, VM_V b) {
+    return (VM_V)((mask & (VM_I)a) | (~mask & (VM_I)b));
+}
+
+VM_ATTR VM_V VM_NAME(vm_load)(const double *p) {
+    VM_V v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+VM_ATTR void VM_NAME(vm_store)(double *p, VM_V v) {
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+/* exp(x): redução x = k·ln2 + r, |r| ≤ ln2/2, e aproximação racional de
+ * Remez para exp(r). 2^k é aplicado em dois passos para cobrir resultados
+ * subnormais sem overflow intermediário. */
+VM_ATTR VM_V VM_NAME(vm_exp)(VM_V x) {
+    const VM_I over = x > VM_EXP_OVERFLOW;
+    const VM_I under = x < VM_EXP_UNDERFLOW;
+    const VM_I nan = x != x;
+    const VM_V zero = VM_NAME(vm_splat)(0.0);
+    const VM_V xc = VM_NAME(vm_sel)(over | under | nan, zero, x);
+
+    const VM_V t = xc * VM_INVLN2 + VM_MAGIC;
+    const VM_V k = t - VM_MAGIC;
+    const VM_I ki = (VM_I)t - (VM_I)VM_NAME(vm_splat)(VM_MAGIC);
+
+    const VM_V hi = xc - k * VM_LN2_HI;
+    const VM_V lo = k * VM_LN2_LO;
+    const VM_V r = hi - lo;
+    const VM_V z = r * r;
+    const VM_V c = r - z * (VM_EXP_P1 + z * (VM_EXP_P2 + z * (VM_EXP_P3 + z * (VM_EXP_P4 + z * VM_EXP_P5))));
+    VM_V y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+    const VM_I k1 = ki >> 1;
+    const VM_I k2 = ki - k1;
+    y = y * (VM_V)((k1 + 1023) << 52);
+    y = y * (VM_V)((k2 + 1023) << 52);
+
+    y = VM_NAME(vm_sel)(over, VM_NAME(vm_splat)(INFINITY), y);
+    y = VM_NAME(vm_sel)(under, zero, y);
+    return VM_NAME(vm_sel)(nan, x, y);
+}
+
+/* log(x): x = 2^k·m com m em [√2/2, √2), log(m) = 2·atanh(f/(2+f)) por
+ * polinômio em s². */
+VM_ATTR VM_V VM_NAME(vm_log)(VM_V x) {
+    const VM_I neg = x < 0.0;
+    const VM_I zero = x == 0.0;
+    const VM_I inf = x == INFINITY;
+    const VM_I nan = x != x;
+    const VM_I sub = (x < VM_DBL_MIN) & ~neg & ~zero;
+
+    const VM_V xs = VM_NAME(vm_sel)(sub, x * VM_TWO54, x);
+    const VM_I bits = (VM_I)xs;
+    VM_I k = ((bits >> 52) & 0x7ff) - 1023 - (sub & 54);
+    VM_V m = (VM_V)((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+
+    const VM_I big = m > VM_SQRT2;
+    m = VM_NAME(vm_sel)(big, m * 0.5, m);
+    k = k - big;  // big é -1 nas lanes verdadeiras
+
+    const VM_V dk = (VM_V)(k + (VM_I)VM_NAME(vm_splat)(VM_MAGIC)) - VM_MAGIC;
+    const VM_V f = m - 1.0;
+    const VM_V s = f / (2.0 + f);
+    const VM_V z = s * s;
+    const VM_V w = z * z;
+    const VM_V t1 = w * (VM_LG2 + w * (VM_LG4 + w * VM_LG6));
+    const VM_V t2 = z * (VM_LG1 + w * (VM_LG3 + w * (VM_LG5 + w * VM_LG7)));
+    const VM_V R = t1 + t2;
+    const VM_V hfsq = 0.5 * f * f;
+    VM_V y = dk * VM_LN2_HI - ((hfsq - (s * (hfsq + R) + dk * VM_LN2_LO)) - f);
+
+    y = VM_NAME(vm_sel)(neg, VM_NAME(vm_splat)(NAN), y);
+    y = VM_NAME(vm_sel)(zero, VM_NAME(vm_splat)(-INFINITY), y);
+    y = VM_NAME(vm_sel)(inf, x, y);
+    return VM_NAME(vm_sel)(nan, x, y);
+}
+
+/* sin e cos de (y0 + y1), |y0| ≤ π/4 (k_sin.c / k_cos.c, forma do musl). */
+VM_ATTR VM_V VM_NAME(vm_ksin)(VM_V x, VM_V y) {
+    const VM_V z = x * x;
+    const VM_V w = z * z;
+    const VM_V r = VM_S2 + z * (VM_S3 + z * VM_S4) + z * w * (VM_S5 + z * VM_S6);
+    const VM_V v = z * x;
+    return x - ((z * (0.5 * y - v * r) - y) - v * VM_S1);
+}
+
+VM_ATTR VM_V VM_NAME(vm_kcos)(VM_V x, VM_V y) {
+    const VM_V z = x * x;
+    const VM_V w = z * z;
+    const VM_V r = z * (VM_C1 + z * (VM_C2 + z * VM_C3)) + w * w * (VM_C4 + z * (VM_C5 + z * VM_C6));
+    const VM_V hz = 0.5 * z;
+    const VM_V u = 1.0 - hz;
+    return u + (((1.0 - u) - hz) + (z * r - x * y));
+}
+
+/* Calcula sin e/ou cos. Redução de Cody-Waite em três etapas (π/2 com
+ * ~118 bits), exata para |x| ≤ 2^19·π/2. Lanes fora disso (incluindo
+ * Inf/NaN) saem em `far` para a libm. */
+VM_ATTR void VM_NAME(vm_sincos)(VM_V x, VM_V *s, VM_V *c, VM_I *far) {
+    const VM_V ax = (VM_V)((VM_I)x & 0x7fffffffffffffffLL);
+    *far = ~(ax <= VM_TRIG_MAX);
+    const VM_V xc = VM_NAME(vm_sel)(*far, VM_NAME(vm_splat)(0.0), x);
+
+    const VM_V t = xc * VM_INVPIO2 + VM_MAGIC;
+    const VM_V fn = t - VM_MAGIC;
+    const VM_I q = (VM_I)t & 3;
+
+    VM_V r = xc - fn * VM_PIO2_1;
+    VM_V u = r;
+    VM_V w = fn * VM_PIO2_2;
+    r = u - w;
+    w = fn * VM_PIO2_2T - ((u - r) - w);
+    u = r;
+    w = fn * VM_PIO2_3;
+    r = u - w;
+    w = fn * VM_PIO2_3T - ((u - r) - w);
+    const VM_V y0 = r - w;
+    const VM_V y1 = (r - y0) - w;
+
+    const VM_V ks = VM_NAME(vm_ksin)(y0, y1);
+    const VM_V kc = VM_NAME(vm_kcos)(y0, y1);
+    const VM_I swap = (q & 1) != 0;
+    const VM_I sign = (VM_I){ 0 } + (-0x7fffffffffffffffLL - 1);
+
+    if (s) {
+        const VM_I neg = (q & 2) != 0;
+        *s = (VM_V)((VM_I)VM_NAME(vm_sel)(swap, kc, ks) ^ (neg & sign));
+    }
+    if (c) {
+        const VM_I neg = ((q + 1) & 2) != 0;
+        *c = (VM_V)((VM_I)VM_NAME(vm_sel)(swap, ks, kc) ^ (neg & sign));
+    }
+}
+
+VM_ATTR VM_V VM_NAME(vm_sin)(VM_V x, VM_I *far) {
+    VM_V s;
+    VM_NAME(vm_sincos)(x, &s, NULL, far);
+    return s;
+}
+
+VM_ATTR VM_V VM_NAME(vm_cos)(VM_V x, VM_I *far) {
+    VM_V c;
+    VM_NAME(vm_sincos)(x, NULL, &c, far);
+    return c;
+}
+
+VM_ATTR VM_V VM_NAME(vm_exp_far)(VM_V x, VM_I *far) {
+    *far = (VM_I){ 0 };
+    return VM_NAME(vm_exp)(x);
+}
+
+VM_ATTR VM_V VM_NAME(vm_log_far)(VM_V x, VM_I *far) {
+    *far = (VM_I){ 0 };
+    return VM_NAME(vm_log)(x);
+}
+
+VM_ATTR VM_V VM_NAME(vm_sqrt_far)(VM_V x, VM_I *far) {
+    *far = (VM_I){ 0 };
+    return VM_SQRT(x);
+}
+
+/* Retorna não zero se alguma lane da máscara estiver ligada. */
+VM_ATTR int VM_NAME(vm_any)(VM_I mask) {
+    __INT64_TYPE__ acc = 0;
+    for (int j = 0; j < VM_LANES; j++) acc |= mask[j];
+    return acc != 0;
+}
+
+/* Laço sobre o array: blocos de VM_LANES direto da memória; o resto vai num
+ * vetor preenchido com 1.0 (valor válido para todos os kernels). Lanes
+ * marcadas em `far` são refeitas com a função escalar `libm_fn`; lanes com
+ * resultado não finito são marcadas em `bad`. */
+#define VM_DEFINE_UNARY(name, kernel, libm_fn)                                   \
+    __attribute__((target(VM_TARGET), unused))                                  \
+    static void VM_NAME(name)(const double *x, double *y, unsigned char *bad, int n) { \
+        for (int i = 0; i < n; i += VM_LANES) {                                 \
+            double tmp[VM_LANES];                                               \
+            const int m = (n - i < VM_LANES) ? n - i : VM_LANES;                \
+            VM_V v;                                                             \
+            if (m == VM_LANES) {                                                \
+                v = VM_NAME(vm_load)(x + i);                                    \
+            } else {                                                            \
+                for (int j = 0; j < VM_LANES; j++) tmp[j] = (j < m) ? x[i + j] : 1.0; \
+                v = VM_NAME(vm_load)(tmp);                                      \
+            }                                                                   \
+            VM_I far;                                                           \
+            const VM_V r = VM_NAME(kernel)(v, &far);                            \
+            const VM_I nf = (r - r) != 0.0;                                     \
+            VM_NAME(vm_store)(tmp, r);                                          \
+            if (!VM_NAME(vm_any)(far | nf)) {                                   \
+                for (int j = 0; j < m; j++) y[i + j] = tmp[j];                  \
+                continue;                                                       \
+            }                                                                   \
+            for (int j = 0; j < m; j++) {                                       \
+                const double out = far[j] ? libm_fn(x[i + j]) : tmp[j];         \
+                if (bad && !isfinite(out)) bad[i + j] = 1;                      \
+                y[i + j] = out;                                                 \
+            }                                                                   \
+        }                                                                       \
+    }
+
+VM_DEFINE_UNARY(vm_sin_array, vm_sin, sin)
+VM_DEFINE_UNARY(vm_cos_array, vm_cos, cos)
+VM_DEFINE_UNARY(vm_exp_array, vm_exp_far, exp)
+VM_DEFINE_UNARY(vm_log_array, vm_log_far, log)
+VM_DEFINE_UNARY(vm_sqrt_array, vm_sqrt_far, sqrt)
+
+#undef VM_DEFINE_UNARY
+
+__attribute__((target(VM_TARGET)))
+static void VM_NAME(vm_sincos_array)(const double *x, double *s, double *c, int n) {
+    for (int i = 0; i < n; i += VM_LANES) {
+        double ts[VM_LANES], tc[VM_LANES];
+        const int m = (n - i < VM_LANES) ? n - i : VM_LANES;
+        VM_V v;
+        if (m == VM_LANES) {
+            v = VM_NAME(vm_load)(x + i);
+        } else {
+            for (int j = 0; j < VM_LANES; j++) ts[j] = (j < m) ? x[i + j] : 1.0;
+            v = VM_NAME(vm_load)(ts);
+        }
+        VM_I far;
+        VM_V vs, vc;
+        VM_NAME(vm_sincos)(v, &vs, &vc, &far);
+        if (m == VM_LANES && !VM_NAME(vm_any)(far)) {
+            VM_NAME(vm_store)(s + i, vs);
+            VM_NAME(vm_store)(c + i, vc);
+            continue;
+        }
+        VM_NAME(vm_store)(ts, vs);
+        VM_NAME(vm_store)(tc, vc);
+        for (int j = 0; j < m; j++) {
+            const double xj = x[i + j];
+            s[i + j] = far[j] ? sin(xj) : ts[j];
+            c[i + j] = far[j] ? cos(xj) : tc[j];
+        }
+    }
+}
+
+#undef VM_ATTR
+#undef VM_V
+#undef VM_I
@@ -0,0 +1,128 @@
+/* Teste da qualidade de prévia (Plot.quality = PLOT_QUALITY_PREVIEW).
+ *
+ * Algumas curvas de gerar_77_curvas.sh (cartesianas, com polo, paramétricas e
+ * polares) são renderizadas em PBM 800x600 nas duas qualidades, com
+ * render_raster_out. As imagens têm de coincidir a menos da vizinhança de 1
+ * pixel documentada: um pixel que difere precisa ter a mesma cor na outra
+ * imagem a até 1 pixel de distância (a borda do traço antialiasado, cortada
+ * no limiar do PBM, muda com desvios bem menores que um pixel).
+ */
+#include "../include/multicurvas_plot.h"
+#include "../include/outbuf.h"
+#include "../include/render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CANVAS_W 800
+#define CANVAS_H 600
+#define AMOSTRAS 20000
+
+static const char *CURVAS[] = {
+    "Y=sin(x):-pi,pi:",
+    "Y=x*x*x:-1.5,1.5:",
+    "Y=1/(x*x):-3,3:",
+    "X=t-sin(t);Y=1-cos(t):-2,2:",
+    "X=sin(3*t+pi/2);Y=sin(t)",
+    "R=4*sin(3*t)/sin(2*t):.1,1.5:",
+    "R**2=sin(2*t)",
+    "R=cos(t/2):0,4:",
+};
+
+#define NUM_CURVAS ((int)(sizeof(CURVAS) / sizeof(CURVAS[0])))
+
+/* Bytes da saída em memória */
+typedef struct {
+    unsigned char *dados;
+    size_t n, cap;
+} Buffer;
+
+static int buffer_sink(void *ctx, const char *data, size_t n) {
+    Buffer *b = ctx;
+    if (b->n + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (cap < b->n + n) cap *= 2;
+        unsigned char *novo = realloc(b->dados, cap);
+        if (!novo) return 0;
+        b->dados = novo;
+        b->cap = cap;
+    }
+    memcpy(b->dados + b->n, data, n);
+    b->n += n;
+    return 1;
+}
+
+/* PBM de `linha` na qualidade pedida, em `b` */
+static int pbm(const char *linha, PlotQuality qualidade, Buffer *b) {
+    Plot *plot = plot_parse_text(linha, NULL);
+    if (!plot) return 0;
+    plot->samples = AMOSTRAS;
+    plot->quality = qualidade;
+    PlotData *data = plot_generate_samples(plot, NULL);
+    plot_free(plot);
+    if (!data) return 0;
+
+    OutBuf out;
+    b->n = 0;
+    int ok = outbuf_init_sink(&out, buffer_sink, b, 0);
+    if (ok) {
+        ok = render_raster_out(&out, data, RENDER_PBM, CANVAS_W, CANVAS_H, RENDER_SIMPLIFY_TOLERANCE, 0, NULL);
+        outbuf_close(&out);
+        ok = ok && !out.error;
+    }
+    plot_data_free(data);
+    return ok;
+}
+
+static int pixel(const unsigned char *bits, int px, int py) {
+    const int linha = (CANVAS_W + 7) / 8;
+    return (bits[(size_t)py * linha + px / 8] >> (7 - px % 8)) & 1;
+}
+
+/* Pixels de `a` sem a mesma cor em `b` a até 1 pixel de distância; -1 se os
+ * tamanhos diferem. *diferentes recebe todos os pixels que diferem. */
+static long pixels_longe(const Buffer *a, const Buffer *b, long *diferentes) {
+    const size_t bytes = (size_t)(CANVAS_W + 7) / 8 * CANVAS_H;
+    if (a->n != b->n || a->n < bytes) return -1;
+    const unsigned char *pa = a->dados + a->n - bytes, *pb = b->dados + b->n - bytes;
+    long longe = 0;
+    *diferentes = 0;
+    for (int py = 0; py < CANVAS_H; py++) {
+        for (int px = 0; px < CANVAS_W; px++) {
+            const int v = pixel(pa, px, py);
+            if (v == pixel(pb, px, py)) continue;
+            (*diferentes)++;
+            int perto = 0;
+            for (int dy = -1; dy <= 1 && !perto; dy++) {
+                for (int dx = -1; dx <= 1 && !perto; dx++) {
+                    const int qx = px + dx, qy = py + dy;
+                    if (qx < 0 || qy < 0 || qx >= CANVAS_W || qy >= CANVAS_H) continue;
+                    perto = pixel(pb, qx, qy) == v;
+                }
+            }
+            longe += !perto;
+        }
+    }
+    return longe;
+}
+
+int main(void) {
+    Buffer exato = { 0 }, previa = { 0 };
+    int falhas = 0;
+
+    for (int i = 0; i < NUM_CURVAS; i++) {
+        long diferentes = 0, longe = -1;
+        if (pbm(CURVAS[i], PLOT_QUALITY_EXACT, &exato) && pbm(CURVAS[i], PLOT_QUALITY_PREVIEW, &previa)) {
+            longe = pixels_longe(&exato, &previa, &diferentes);
+        }
+        const int ok = (longe == 0);
+        printf("  %-34s %s (%ld pixels diferentes, %ld além de 1 pixel)\n", CURVAS[i], ok ? "ok" : "FALHOU",
+               diferentes, longe < 0 ? 0 : longe);
+        falhas += !ok;
+    }
+    free(exato.dados);
+    free(previa.dados);
+
+    printf("prévia: %d de %d curvas iguais ao modo exato\n", NUM_CURVAS - falhas, NUM_CURVAS);
+    return falhas ? 1 : 0;
+}